@@ -936,6 +936,8 @@ DoubleSetting AudioIOLatencyCorrection{
    L"/AudioIO/LatencyCorrection", -130.0 };
 DoubleSetting AudioIOLatencyDuration{
    L"/AudioIO/LatencyDuration", 100.0 };
+IntSetting AudioIOMixerThreads{
+   L"/AudioIO/MixerThreads", 0 };
 StringSetting AudioIOPlaybackDevice{
    L"/AudioIO/PlaybackDevice", L"" };
 DoubleSetting AudioIOPlaybackVolume {
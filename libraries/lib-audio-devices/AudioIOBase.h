@@ -328,6 +328,9 @@ protected:
 extern AUDIO_DEVICES_API StringSetting AudioIOHost;
 extern AUDIO_DEVICES_API DoubleSetting AudioIOLatencyCorrection;
 extern AUDIO_DEVICES_API DoubleSetting AudioIOLatencyDuration;
+//! Threads, besides the audio thread, that prepare playback of tracks;
+//! zero or less chooses according to the number of processors
+extern AUDIO_DEVICES_API IntSetting    AudioIOMixerThreads;
 extern AUDIO_DEVICES_API StringSetting AudioIOPlaybackDevice;
 extern AUDIO_DEVICES_API DoubleSetting AudioIOPlaybackVolume;
 extern AUDIO_DEVICES_API IntSetting    AudioIORecordChannels;
@@ -0,0 +1,67 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file CPUFeatures.cpp
+
+**********************************************************************/
+
+#include "CPUFeatures.h"
+
+#if defined(AUDACITY_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+
+struct Features
+{
+   bool sse2{ false };
+   bool avx2{ false };
+
+   Features()
+   {
+#if defined(AUDACITY_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+      int info[4];
+      __cpuid(info, 0);
+      const int maxLeaf = info[0];
+      if (maxLeaf >= 1) {
+         __cpuid(info, 1);
+         sse2 = (info[3] & (1 << 26)) != 0;
+         const bool osxsave = (info[2] & (1 << 27)) != 0;
+         const bool avx = (info[2] & (1 << 28)) != 0;
+         // The operating system must save the YMM registers
+         const bool ymmSaved = osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+         if (ymmSaved && maxLeaf >= 7) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+         }
+      }
+#else
+      // These builtins also consult the operating system support
+      __builtin_cpu_init();
+      sse2 = __builtin_cpu_supports("sse2");
+      avx2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+   }
+};
+
+const Features &GetFeatures()
+{
+   static const Features features;
+   return features;
+}
+
+}
+
+bool CPUFeatures::SSE2()
+{
+   return GetFeatures().sse2;
+}
+
+bool CPUFeatures::AVX2()
+{
+   return GetFeatures().avx2;
+}
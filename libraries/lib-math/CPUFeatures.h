@@ -0,0 +1,39 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file CPUFeatures.h
+  @brief Detection of instruction set extensions at run time
+
+**********************************************************************/
+
+#ifndef __AUDACITY_CPU_FEATURES__
+#define __AUDACITY_CPU_FEATURES__
+
+//! Defined when compiling for x86 or x86-64, where the queries below can be
+//! true, and the intrinsics of <immintrin.h> may be used in functions that
+//! are compiled for the instruction set with AUDACITY_TARGET
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+   defined(_M_IX86)
+#define AUDACITY_X86 1
+#endif
+
+//! Compile one function for an instruction set, given as a string such as
+//! "avx2", that the rest of the program may not assume; call it only when
+//! the corresponding query below is true
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC permits all intrinsics anywhere
+#define AUDACITY_TARGET(isa)
+#else
+#define AUDACITY_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+//! Each query is answered once, and is cheap to repeat
+namespace CPUFeatures
+{
+MATH_API bool SSE2();
+//! Also tests that the operating system saves the wider registers
+MATH_API bool AVX2();
+}
+
+#endif
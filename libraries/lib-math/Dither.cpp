@@ -32,10 +32,17 @@ state. Call Dither::Apply() to apply the dither. You can call
 Reset() between subsequent dithers to reset the dither state
 and get deterministic behaviour.
 
+Instances share nothing, so different threads may dither at once, each
+with its own instance. The noise comes from four small xorshift
+generators, used in turn, so that contiguous float samples can be
+dithered four at a time with SSE2 by all but the noise-shaped
+algorithm, which feeds back the error of each sample into the next.
+
 *//*******************************************************************/
 
 
 #include "Dither.h"
+#include "CPUFeatures.h"
 
 #include "Internat.h"
 #include "Prefs.h"
@@ -45,6 +52,7 @@ and get deterministic behaviour.
 // (Note: this file should be included first)
 #include "float_cast.h"
 
+#include <algorithm>
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
@@ -54,6 +62,10 @@ and get deterministic behaviour.
 
 #include <wx/defs.h>
 
+#ifdef AUDACITY_X86
+#include <immintrin.h>
+#endif
+
 //////////////////////////////////////////////////////////////////////////
 
 // Constants for the noise shaping buffer
@@ -63,19 +75,23 @@ constexpr int BUF_MASK = 7;
 // Lipshitz's minimally audible FIR
 const float SHAPED_BS[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
 
-// Dither state
-struct State {
-    int mPhase;
-    float mTriangleState;
-    float mBuffer[8 /* = BUF_SIZE */];
-} mState;
+using State = Dither::State;
+static_assert(sizeof(State::mBuffer) == BUF_SIZE * sizeof(float), "");
 
 using Ditherer = float (*)(State &, float);
 
+// Scales the top 24 bits of a generator's output to [0, 1)
+constexpr auto NOISE_SCALE = 1.0f / (1 << 24);
+
 // This is supposed to produce white noise and no dc
-static inline float DITHER_NOISE()
+static inline float DITHER_NOISE(State &state)
 {
-    return rand() / (float)RAND_MAX - 0.5f;
+    auto &x = state.mNoise[state.mLane];
+    state.mLane = (state.mLane + 1) & 3;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return (x >> 8) * NOISE_SCALE - 0.5f;
 }
 
 // Defines for sample conversion
@@ -180,10 +196,144 @@ static inline void DITHER( Ditherer dither, State &state,
 
 
 static inline float NoDither(State &, float sample);
-static inline float RectangleDither(State &, float sample);
+static inline float RectangleDither(State &state, float sample);
 static inline float TriangleDither(State &state, float sample);
 static inline float ShapedDither(State &state, float sample);
 
+static void DitherScalar(DitherType ditherType, State &state,
+   samplePtr dst, sampleFormat dstFormat, size_t dstStride,
+   constSamplePtr src, sampleFormat srcFormat, size_t srcStride, size_t len)
+{
+    switch (ditherType)
+    {
+    case DitherType::none:
+        DITHER(NoDither, state, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
+        break;
+    case DitherType::rectangle:
+        DITHER(RectangleDither, state, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
+        break;
+    case DitherType::triangle:
+        DITHER(TriangleDither, state, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
+        break;
+    case DitherType::shaped:
+        DITHER(ShapedDither, state, dst, dstFormat, dstStride, src, srcFormat, srcStride, len);
+        break;
+    default:
+        wxASSERT(false); // unknown dither algorithm
+    }
+}
+
+#ifdef AUDACITY_X86
+
+// Advance the four generators at once, as DITHER_NOISE() does each
+AUDACITY_TARGET("sse2")
+static inline __m128 NoiseSSE2(__m128i &x)
+{
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    return _mm_sub_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)),
+            _mm_set1_ps(NOISE_SCALE)),
+        _mm_set1_ps(0.5f));
+}
+
+// Convert four samples at a time, doing the same arithmetic in the same
+// order as DITHER_LOOP, so the results are the same.  Clipping before
+// rounding is equivalent to the clipping of IMPLEMENT_STORE after it.
+// Returns the number of samples converted, a multiple of four.
+template<DitherType ditherType, typename dstType>
+AUDACITY_TARGET("sse2")
+static size_t DitherFloatsSSE2(State &state,
+    dstType *dst, const float *src, size_t len, float scale, float lo, float hi)
+{
+    const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f);
+    const __m128 vScale = _mm_set1_ps(scale),
+        vLo = _mm_set1_ps(lo), vHi = _mm_set1_ps(hi);
+    __m128i noise =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(state.mNoise));
+    __m128 previous = _mm_set1_ps(state.mTriangleState);
+
+    size_t ii = 0;
+    for (; ii + 4 <= len; ii += 4) {
+        __m128 x = _mm_mul_ps(
+            _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + ii), one), minusOne),
+            vScale);
+        if (ditherType == DitherType::rectangle)
+            x = _mm_sub_ps(x, NoiseSSE2(noise));
+        else if (ditherType == DitherType::triangle) {
+            const __m128 r = NoiseSSE2(noise);
+            // The noise of each preceding sample
+            const __m128 shifted = _mm_move_ss(
+                _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 1, 0, 3)), previous);
+            x = _mm_sub_ps(_mm_add_ps(x, r), shifted);
+            previous = _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        const __m128i ints =
+            _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(x, vHi), vLo));
+        if (sizeof(dstType) == sizeof(short))
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + ii),
+                _mm_packs_epi32(ints, ints));
+        else
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii), ints);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state.mNoise), noise);
+    state.mTriangleState = _mm_cvtss_f32(previous);
+    return ii;
+}
+
+template<typename dstType>
+static size_t DitherFloatsSSE2(DitherType ditherType, State &state,
+    dstType *dst, const float *src, size_t len, float scale, float lo, float hi)
+{
+    switch (ditherType)
+    {
+    case DitherType::none:
+        return DitherFloatsSSE2<DitherType::none>(
+            state, dst, src, len, scale, lo, hi);
+    case DitherType::rectangle:
+        return DitherFloatsSSE2<DitherType::rectangle>(
+            state, dst, src, len, scale, lo, hi);
+    case DitherType::triangle:
+        return DitherFloatsSSE2<DitherType::triangle>(
+            state, dst, src, len, scale, lo, hi);
+    default:
+        return 0;
+    }
+}
+
+#endif
+
+// Convert contiguous float samples with vector instructions where possible,
+// beginning at the first generator as the vector code requires; returns the
+// number of samples converted, leaving the rest to DitherScalar()
+static size_t DitherFloatsVectorized(DitherType ditherType, State &state,
+    samplePtr dst, sampleFormat dstFormat, const float *src, size_t len)
+{
+#ifdef AUDACITY_X86
+    if (ditherType == DitherType::shaped || !CPUFeatures::SSE2())
+        return 0;
+
+    const size_t head = std::min<size_t>((4 - state.mLane) & 3, len);
+    DitherScalar(ditherType, state, dst, dstFormat, 1,
+        reinterpret_cast<constSamplePtr>(src), floatSample, 1, head);
+    src += head;
+    len -= head;
+
+    if (dstFormat == int16Sample)
+        return head + DitherFloatsSSE2(ditherType, state,
+            reinterpret_cast<short*>(dst) + head, src, len,
+            CONVERT_DIV16, -32768.0f, 32767.0f);
+    else
+        return head + DitherFloatsSSE2(ditherType, state,
+            reinterpret_cast<int*>(dst) + head, src, len,
+            CONVERT_DIV24, -8388608.0f, 8388607.0f);
+#else
+    return 0;
+#endif
+}
+
 Dither::Dither()
 {
     // On startup, initialize dither by resetting values
@@ -191,6 +341,17 @@ Dither::Dither()
 }
 
 void Dither::Reset()
+{
+    // Any nonzero seeds will do
+    mState.mNoise[0] = 0x9E3779B9u;
+    mState.mNoise[1] = 0x243F6A88u;
+    mState.mNoise[2] = 0xB7E15162u;
+    mState.mNoise[3] = 0x6A09E667u;
+    mState.mLane = 0;
+    ResetFilters();
+}
+
+void Dither::ResetFilters()
 {
     mState.mTriangleState = 0;
     mState.mPhase = 0;
@@ -303,25 +464,19 @@ void Dither::Apply(enum DitherType ditherType,
     } else
     {
         // We must do dithering
-        switch (ditherType)
-        {
-        case DitherType::none:
-            DITHER(NoDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::rectangle:
-            DITHER(RectangleDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::triangle:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(TriangleDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        case DitherType::shaped:
-            Reset(); // reset dither filter for this NEW conversion
-            DITHER(ShapedDither, mState, dest, destFormat, destStride, source, sourceFormat, sourceStride, len);
-            break;
-        default:
-            wxASSERT(false); // unknown dither algorithm
-        }
+        if (ditherType == DitherType::triangle ||
+            ditherType == DitherType::shaped)
+            ResetFilters(); // reset dither filter for this NEW conversion
+
+        size_t done = 0;
+        if (sourceFormat == floatSample && sourceStride == 1 && destStride == 1)
+            done = DitherFloatsVectorized(ditherType, mState,
+                dest, destFormat, reinterpret_cast<const float*>(source), len);
+
+        DitherScalar(ditherType, mState,
+            dest + done * SAMPLE_SIZE(destFormat), destFormat, destStride,
+            source + done * SAMPLE_SIZE(sourceFormat), sourceFormat,
+            sourceStride, len - done);
     }
 }
 
@@ -334,15 +489,15 @@ inline float NoDither(State &, float sample)
 }
 
 // Rectangle dithering, apply one-step noise
-inline float RectangleDither(State &, float sample)
+inline float RectangleDither(State &state, float sample)
 {
-    return sample - DITHER_NOISE();
+    return sample - DITHER_NOISE(state);
 }
 
 // Triangle dither - high pass filtered
 inline float TriangleDither(State &state, float sample)
 {
-    float r = DITHER_NOISE();
+    float r = DITHER_NOISE(state);
     float result = sample + r - state.mTriangleState;
     state.mTriangleState = r;
 
@@ -353,7 +508,7 @@ inline float TriangleDither(State &state, float sample)
 inline float ShapedDither(State &state, float sample)
 {
     // Generate triangular dither, +-1 LSB, flat psd
-    float r = DITHER_NOISE() + DITHER_NOISE();
+    float r = DITHER_NOISE(state) + DITHER_NOISE(state);
     if(sample != sample)  // test for NaN
        sample = 0; // and do the best we can with it
 
@@ -10,6 +10,7 @@
 #ifndef __AUDACITY_DITHER_H__
 #define __AUDACITY_DITHER_H__
 
+#include <cstdint>
 #include "SampleFormat.h"
 
 template< typename Enum > class EnumSetting;
@@ -31,7 +32,8 @@ public:
     /// Default constructor
     Dither();
 
-    /// Reset state of the dither.
+    /// Reset state of the dither, including the noise generator, so that
+    /// the same input dithers to the same output again.
     void Reset();
 
     /// Apply the actual dithering. Expects the source sample in the
@@ -44,6 +46,23 @@ public:
                unsigned int len,
                unsigned int sourceStride = 1,
                unsigned int destStride = 1);
+
+    /// State of one instance; each thread that dithers needs its own
+    struct State {
+        /// Four xorshift generators of noise, drawn from in turn, so that
+        /// four samples at a time may be dithered with vector instructions
+        uint32_t mNoise[4];
+        unsigned mLane;
+        int mPhase;
+        float mTriangleState;
+        float mBuffer[8];
+    };
+
+private:
+    /// Reset the filters, but continue the sequence of noise
+    void ResetFilters();
+
+    State mState;
 };
 
 #endif /* __AUDACITY_DITHER_H__ */
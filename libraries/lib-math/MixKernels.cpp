@@ -0,0 +1,172 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file MixKernels.cpp
+
+**********************************************************************/
+
+#include "MixKernels.h"
+#include "CPUFeatures.h"
+
+#ifdef AUDACITY_X86
+#include <immintrin.h>
+#endif
+
+using namespace MixKernels;
+
+namespace {
+
+// The vector kernels do the same operations in the same order as these,
+// so the results are the same
+
+void MultiplyScalar(float *buffer, const float *gains, size_t len)
+{
+   for (size_t i = 0; i < len; ++i)
+      buffer[i] *= gains[i];
+}
+
+void AccumulateScalar(float *dest, size_t destStride,
+   const float *src, size_t begin, size_t len, float gain, float deltaGain)
+{
+   for (size_t i = begin; i < len; ++i)
+      dest[i * destStride] += (gain + deltaGain * i) * src[i];
+}
+
+#ifdef AUDACITY_X86
+
+AUDACITY_TARGET("sse2")
+void MultiplySSE2(float *buffer, const float *gains, size_t len)
+{
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4)
+      _mm_storeu_ps(buffer + i,
+         _mm_mul_ps(_mm_loadu_ps(buffer + i), _mm_loadu_ps(gains + i)));
+   MultiplyScalar(buffer + i, gains + i, len - i);
+}
+
+AUDACITY_TARGET("avx2")
+void MultiplyAVX2(float *buffer, const float *gains, size_t len)
+{
+   size_t i = 0;
+   for (; i + 8 <= len; i += 8)
+      _mm256_storeu_ps(buffer + i, _mm256_mul_ps(
+         _mm256_loadu_ps(buffer + i), _mm256_loadu_ps(gains + i)));
+   MultiplyScalar(buffer + i, gains + i, len - i);
+}
+
+AUDACITY_TARGET("sse2")
+void AccumulatePlanarSSE2(float *dest,
+   const float *src, size_t len, float gain, float deltaGain)
+{
+   const __m128 vGain = _mm_set1_ps(gain), vDelta = _mm_set1_ps(deltaGain),
+      four = _mm_set1_ps(4.0f);
+   // Indices as floats, exact as long as there are fewer than 2^24
+   __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+   size_t i = 0;
+   for (; i + 4 <= len; i += 4, index = _mm_add_ps(index, four)) {
+      const __m128 g = _mm_add_ps(vGain, _mm_mul_ps(vDelta, index));
+      _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i),
+         _mm_mul_ps(g, _mm_loadu_ps(src + i))));
+   }
+   AccumulateScalar(dest, 1, src, i, len, gain, deltaGain);
+}
+
+AUDACITY_TARGET("avx2")
+void AccumulatePlanarAVX2(float *dest,
+   const float *src, size_t len, float gain, float deltaGain)
+{
+   const __m256 vGain = _mm256_set1_ps(gain),
+      vDelta = _mm256_set1_ps(deltaGain), eight = _mm256_set1_ps(8.0f);
+   __m256 index = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+   size_t i = 0;
+   for (; i + 8 <= len; i += 8, index = _mm256_add_ps(index, eight)) {
+      const __m256 g = _mm256_add_ps(vGain, _mm256_mul_ps(vDelta, index));
+      _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i),
+         _mm256_mul_ps(g, _mm256_loadu_ps(src + i))));
+   }
+   AccumulateScalar(dest, 1, src, i, len, gain, deltaGain);
+}
+
+//! For a stride of two:  each vector of dest holds two of the samples to
+//! change, alternating with samples of the other channel, to which zero
+//! is added
+AUDACITY_TARGET("sse2")
+void AccumulateStereoSSE2(float *dest,
+   const float *src, size_t len, float gain, float deltaGain)
+{
+   const __m128 vGain = _mm_set1_ps(gain), vDelta = _mm_set1_ps(deltaGain),
+      four = _mm_set1_ps(4.0f), zero = _mm_setzero_ps();
+   __m128 index = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+   size_t i = 0;
+   // The last vector ends with the sample of the other channel that
+   // precedes sample i + 4, so stop before reading past the buffer
+   for (; i + 4 < len; i += 4, index = _mm_add_ps(index, four)) {
+      const __m128 g = _mm_add_ps(vGain, _mm_mul_ps(vDelta, index));
+      const __m128 v = _mm_mul_ps(g, _mm_loadu_ps(src + i));
+      float *const d = dest + 2 * i;
+      _mm_storeu_ps(d,
+         _mm_add_ps(_mm_loadu_ps(d), _mm_unpacklo_ps(v, zero)));
+      _mm_storeu_ps(d + 4,
+         _mm_add_ps(_mm_loadu_ps(d + 4), _mm_unpackhi_ps(v, zero)));
+   }
+   AccumulateScalar(dest, 2, src, i, len, gain, deltaGain);
+}
+
+#endif
+
+}
+
+bool MixKernels::IsSupported(Kernel kernel)
+{
+   switch (kernel) {
+   case Kernel::AVX2:
+      return CPUFeatures::AVX2();
+   case Kernel::SSE2:
+      return CPUFeatures::SSE2();
+   default:
+      return true;
+   }
+}
+
+Kernel MixKernels::BestKernel()
+{
+   static const Kernel best =
+        IsSupported(Kernel::AVX2) ? Kernel::AVX2
+      : IsSupported(Kernel::SSE2) ? Kernel::SSE2
+      : Kernel::Scalar;
+   return best;
+}
+
+void MixKernels::Multiply(float *buffer, const float *gains, size_t len,
+   Kernel kernel)
+{
+#ifdef AUDACITY_X86
+   switch (kernel) {
+   case Kernel::AVX2:
+      return MultiplyAVX2(buffer, gains, len);
+   case Kernel::SSE2:
+      return MultiplySSE2(buffer, gains, len);
+   default:
+      break;
+   }
+#endif
+   MultiplyScalar(buffer, gains, len);
+}
+
+void MixKernels::Accumulate(float *dest, size_t destStride,
+   const float *src, size_t len, float gain, float deltaGain, Kernel kernel)
+{
+#ifdef AUDACITY_X86
+   if (kernel != Kernel::Scalar) {
+      if (destStride == 1) {
+         if (kernel == Kernel::AVX2)
+            return AccumulatePlanarAVX2(dest, src, len, gain, deltaGain);
+         return AccumulatePlanarSSE2(dest, src, len, gain, deltaGain);
+      }
+      if (destStride == 2)
+         return AccumulateStereoSSE2(dest, src, len, gain, deltaGain);
+   }
+#endif
+   AccumulateScalar(dest, destStride, src, 0, len, gain, deltaGain);
+}
@@ -0,0 +1,51 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file MixKernels.h
+  @brief Application of gains and accumulation of samples into mixes
+
+**********************************************************************/
+
+#ifndef __AUDACITY_MIX_KERNELS__
+#define __AUDACITY_MIX_KERNELS__
+
+#include <cstddef>
+
+namespace MixKernels
+{
+
+//! Implementations of the functions below, which give the same results and
+//! differ only in speed
+enum class Kernel { Scalar, SSE2, AVX2 };
+
+//! Whether the processor can run the kernel
+MATH_API bool IsSupported(Kernel kernel);
+
+//! The fastest supported kernel
+MATH_API Kernel BestKernel();
+
+//! Multiply each sample by its own gain, as from an envelope
+/*!
+ @pre IsSupported(kernel)
+ */
+MATH_API void Multiply(float *buffer, const float *gains, size_t len,
+   Kernel kernel = BestKernel());
+
+//! Add samples times a gain that changes linearly, into one channel of a
+//! planar or interleaved buffer
+/*!
+ For each i < len, `dest[i * destStride] += (gain + deltaGain * i) * src[i]`.
+ Only the samples so addressed are written; interleaved channels between
+ them are left unchanged, and the buffer need not extend past the last.
+ Strides of one and two are vectorized.
+
+ @pre IsSupported(kernel)
+ */
+MATH_API void Accumulate(float *dest, size_t destStride,
+   const float *src, size_t len, float gain, float deltaGain = 0,
+   Kernel kernel = BestKernel());
+
+}
+
+#endif
@@ -16,9 +16,9 @@
 
       libsoxr, written by Rob Sykes. LGPL.
 
-   Since Audacity always does resampling on mono streams that are
-   contiguous in memory, this class doesn't support multiple channels
-   or some of the other optional features of some of these resamplers.
+   The channels of one track may be resampled together by one instance,
+   each channel contiguous in memory (not interleaved).  This class doesn't
+   support some of the other optional features of some of these resamplers.
 
 *//*******************************************************************/
 
@@ -27,11 +27,26 @@
 #include "Internat.h"
 #include "ComponentInterface.h"
 
+#include <algorithm>
 #include <soxr.h>
 
-Resample::Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor)
+Resample::Resample(const bool useBestMethod,
+   const double dMinFactor, const double dMaxFactor, unsigned nChannels)
+   : Resample{
+      useBestMethod
+         ? BestMethodSetting.ReadEnum() : FastMethodSetting.ReadEnum(),
+      dMinFactor, dMaxFactor, nChannels,
+      // The fast method is for real-time audio I/O, which has its own thread
+      useBestMethod }
+{
+}
+
+Resample::Resample(int method,
+   const double dMinFactor, const double dMaxFactor,
+   unsigned nChannels, bool multithreaded)
+   : mMethod{ method }
+   , mNumChannels{ std::max(1u, nChannels) }
 {
-   this->SetMethod(useBestMethod);
    soxr_quality_spec_t q_spec;
    if (dMinFactor == dMaxFactor)
    {
@@ -43,7 +58,13 @@ Resample::Resample(const bool useBestMethod, const double dMinFactor, const doub
       mbWantConstRateResampling = false; // variable rate resampling
       q_spec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
    }
-   mHandle.reset(soxr_create(1, dMinFactor, 1, 0, 0, &q_spec, 0));
+   // Channels are not interleaved, and the Process() overloads agree
+   const auto io_spec = soxr_io_spec(SOXR_FLOAT32_S, SOXR_FLOAT32_S);
+   // 0 means as many threads as OpenMP allows, if libsoxr was built with it
+   const auto runtime_spec =
+      soxr_runtime_spec(multithreaded && mNumChannels > 1 ? 0 : 1);
+   mHandle.reset(soxr_create(1, dMinFactor, mNumChannels, 0,
+      &io_spec, &q_spec, &runtime_spec));
 }
 
 Resample::~Resample()
@@ -92,6 +113,23 @@ std::pair<size_t, size_t>
                         float  *outBuffer,
                         size_t  outBufferLen)
 {
+   wxASSERT(mNumChannels == 1);
+   return Process(factor, &inBuffer, inBufferLen, lastFlag,
+      &outBuffer, outBufferLen);
+}
+
+std::pair<size_t, size_t>
+      Resample::Process(double  factor,
+                        const float *const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float *const *outBuffers,
+                        size_t  outBufferLen)
+{
+   // With split channels, soxr takes the arrays of pointers, and writes
+   // only where they point
+   const soxr_in_t inBuffer = inBuffers;
+   const soxr_out_t outBuffer = const_cast<float **>(outBuffers);
    size_t idone, odone;
    if (mbWantConstRateResampling)
    {
@@ -110,11 +148,3 @@ std::pair<size_t, size_t>
    }
    return { idone, odone };
 }
-
-void Resample::SetMethod(const bool useBestMethod)
-{
-   if (useBestMethod)
-      mMethod = BestMethodSetting.ReadEnum();
-   else
-      mMethod = FastMethodSetting.ReadEnum();
-}
@@ -36,9 +36,20 @@ class MATH_API Resample final
    /// the fast method.
    // dMinFactor and dMaxFactor specify the range of factors for variable-rate resampling.
    // For constant-rate, pass the same value for both.
-   Resample(const bool useBestMethod, const double dMinFactor, const double dMaxFactor);
+   // nChannels channels are resampled together, in lockstep; with more than
+   // one, the best method may use more than one thread.
+   Resample(const bool useBestMethod,
+      const double dMinFactor, const double dMaxFactor,
+      unsigned nChannels = 1);
+   //! Select the method by its index in the choices of the settings,
+   //! without reading preferences
+   Resample(int method,
+      const double dMinFactor, const double dMaxFactor,
+      unsigned nChannels, bool multithreaded);
    ~Resample();
 
+   unsigned GetNumChannels() const { return mNumChannels; }
+
    static EnumSetting< int > FastMethodSetting;
    static EnumSetting< int > BestMethodSetting;
 
@@ -53,7 +64,8 @@ class MATH_API Resample final
     * This function may do nothing if you don't pass a large enough output
     * buffer (i.e. there is no where to put a full block of output data)
     @param factor The scaling factor to resample by.
-    @param inBuffer Buffer of input samples to be processed (mono)
+    @param inBuffer Buffer of input samples to be processed (mono; the
+    resampler must have one channel)
     @param inBufferLen Length of the input buffer, in samples.
     @param lastFlag Flag to indicate this is the last lot of input samples and
     the buffer needs to be emptied out into the rate converter.
@@ -72,11 +84,24 @@ class MATH_API Resample final
                         float  *outBuffer,
                         size_t  outBufferLen);
 
- protected:
-   void SetMethod(const bool useBestMethod);
+   /** @brief Resample all channels at once
+    *
+    * As for the mono overload, but each of inBuffers and outBuffers points to
+    * GetNumChannels() buffers of the given lengths.  The same number of
+    * samples is consumed from each input buffer and generated into each
+    * output buffer.
+    */
+   std::pair<size_t, size_t>
+                Process(double  factor,
+                        const float *const *inBuffers,
+                        size_t  inBufferLen,
+                        bool    lastFlag,
+                        float *const *outBuffers,
+                        size_t  outBufferLen);
 
  protected:
    int   mMethod; // resampler-specific enum for resampling method
+   unsigned mNumChannels;
    soxrHandle mHandle; // constant-rate or variable-rate resampler (XOR per instance)
    bool mbWantConstRateResampling;
 };
@@ -0,0 +1,496 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleCompression.cpp
+
+**********************************************************************/
+
+#include "SampleCompression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+// Layout of the compressed stream:
+//    byte 0      StreamVersion
+//    byte 1      Mode of the samples
+//    bytes 2-5   count of samples, little endian
+// followed by bits, most significant first, in frames of up to FrameSize
+// samples.  Each frame begins with its predictor order in 3 bits, then that
+// many warm-up samples in WarmupBits(mode) bits each, then the residuals of
+// the rest of the frame in partitions of up to PartitionSize.  Each partition
+// begins with a 5 bit Rice parameter, or else EscapeParameter followed by a
+// 5 bit width, and the residuals are then plain binary numbers of that width.
+
+constexpr unsigned char StreamVersion = 1;
+constexpr size_t HeaderSize = SampleCompression::HeaderBytes;
+constexpr size_t FrameSize = 4096;
+constexpr size_t PartitionSize = 256;
+constexpr unsigned MaxOrder = 4;
+constexpr unsigned MaxRiceParameter = 30;
+constexpr unsigned EscapeParameter = 31;
+
+enum Mode : unsigned char
+{
+   Int16Mode,
+   Int24Mode,
+   //! Floats that are all exactly 24 bit integers scaled by 2^-23
+   Float24Mode,
+};
+
+constexpr int32_t Int24Min = -(1 << 23);
+constexpr int32_t Int24Max = (1 << 23) - 1;
+constexpr float Float24Scale = 8388608.0f;
+
+unsigned WarmupBits(Mode mode)
+{
+   return mode == Int16Mode ? 16 : 24;
+}
+
+bool ModeMatches(Mode mode, sampleFormat format)
+{
+   switch (mode) {
+   case Int16Mode:
+      return format == int16Sample;
+   case Int24Mode:
+      return format == int24Sample;
+   case Float24Mode:
+      return format == floatSample;
+   default:
+      return false;
+   }
+}
+
+inline uint32_t ZigZag(int32_t value)
+{
+   return (uint32_t(value) << 1) ^ uint32_t(value >> 31);
+}
+
+inline int32_t UnZigZag(uint32_t value)
+{
+   return int32_t(value >> 1) ^ -int32_t(value & 1);
+}
+
+//! Fixed polynomial predictions, as in FLAC; x points at the predicted sample
+template<unsigned Order>
+inline int64_t Predict(const int32_t *x)
+{
+   if constexpr (Order == 0)
+      return 0;
+   else if constexpr (Order == 1)
+      return x[-1];
+   else if constexpr (Order == 2)
+      return 2 * int64_t(x[-1]) - x[-2];
+   else if constexpr (Order == 3)
+      return 3 * (int64_t(x[-1]) - x[-2]) + x[-3];
+   else
+      return 4 * (int64_t(x[-1]) + x[-3]) - 6 * int64_t(x[-2]) - x[-4];
+}
+
+//! Invoke function with the predictor order as a compile time constant
+template<typename Function>
+void WithOrder(unsigned order, const Function &function)
+{
+   switch (order) {
+   case 0:
+      function(std::integral_constant<unsigned, 0>{}); break;
+   case 1:
+      function(std::integral_constant<unsigned, 1>{}); break;
+   case 2:
+      function(std::integral_constant<unsigned, 2>{}); break;
+   case 3:
+      function(std::integral_constant<unsigned, 3>{}); break;
+   default:
+      function(std::integral_constant<unsigned, 4>{}); break;
+   }
+}
+
+inline int CountLeadingZeros(uint64_t x)
+{
+   // x is not zero
+   int n = 0;
+   if (!(x & 0xFFFFFFFF00000000ull)) { n += 32; x <<= 32; }
+   if (!(x & 0xFFFF000000000000ull)) { n += 16; x <<= 16; }
+   if (!(x & 0xFF00000000000000ull)) { n += 8; x <<= 8; }
+   if (!(x & 0xF000000000000000ull)) { n += 4; x <<= 4; }
+   if (!(x & 0xC000000000000000ull)) { n += 2; x <<= 2; }
+   if (!(x & 0x8000000000000000ull)) { n += 1; }
+   return n;
+}
+
+class BitWriter
+{
+public:
+   explicit BitWriter(std::vector<unsigned char> &out) : mOut{ out } {}
+
+   //! Write the low bits of value; bits must not exceed 32
+   void Write(uint32_t value, unsigned bits)
+   {
+      mAcc = (mAcc << bits) | (value & ((uint64_t(1) << bits) - 1));
+      mBits += bits;
+      while (mBits >= 8) {
+         mBits -= 8;
+         mOut.push_back(static_cast<unsigned char>(mAcc >> mBits));
+      }
+   }
+
+   //! Write count zeroes and a one
+   void WriteUnary(uint32_t count)
+   {
+      for (; count >= 32; count -= 32)
+         Write(0, 32);
+      Write(1, count + 1);
+   }
+
+   void Flush()
+   {
+      if (mBits > 0)
+         mOut.push_back(static_cast<unsigned char>(mAcc << (8 - mBits)));
+      mBits = 0;
+   }
+
+private:
+   std::vector<unsigned char> &mOut;
+   uint64_t mAcc{ 0 };
+   unsigned mBits{ 0 };
+};
+
+class BitReader
+{
+public:
+   BitReader(const unsigned char *data, size_t size)
+      : mData{ data }, mSize{ size }
+   {}
+
+   //! Read bits, which must not exceed 32
+   uint32_t Read(unsigned bits)
+   {
+      if (bits == 0)
+         return 0;
+      Refill();
+      if (mBits < bits) {
+         mFailed = true;
+         return 0;
+      }
+      const auto value = static_cast<uint32_t>(mAcc >> (64 - bits));
+      mAcc <<= bits;
+      mBits -= bits;
+      return value;
+   }
+
+   //! Count zeroes up to and consuming the next one
+   uint32_t ReadUnary()
+   {
+      uint32_t count = 0;
+      while (true) {
+         Refill();
+         if (mBits == 0 || count > (1u << 28)) {
+            mFailed = true;
+            return 0;
+         }
+         if (mAcc == 0) {
+            // All of the valid bits are zeroes
+            count += mBits;
+            mBits = 0;
+            continue;
+         }
+         const unsigned zeroes = CountLeadingZeros(mAcc);
+         count += zeroes;
+         mAcc = (zeroes + 1 < 64) ? mAcc << (zeroes + 1) : 0;
+         mBits -= zeroes + 1;
+         return count;
+      }
+   }
+
+   bool Failed() const { return mFailed; }
+
+private:
+   void Refill()
+   {
+      while (mBits <= 56 && mPos < mSize) {
+         mAcc |= uint64_t(mData[mPos++]) << (56 - mBits);
+         mBits += 8;
+      }
+   }
+
+   const unsigned char *const mData;
+   const size_t mSize;
+   size_t mPos{ 0 };
+   //! Valid bits are the most significant; the rest are zero
+   uint64_t mAcc{ 0 };
+   unsigned mBits{ 0 };
+   bool mFailed{ false };
+};
+
+bool ToIntegers(constSamplePtr src, sampleFormat format, size_t len,
+   int32_t *dest, Mode &mode)
+{
+   switch (format) {
+   case int16Sample: {
+      const auto samples = reinterpret_cast<const short *>(src);
+      std::copy(samples, samples + len, dest);
+      mode = Int16Mode;
+      return true;
+   }
+   case int24Sample: {
+      const auto samples = reinterpret_cast<const int *>(src);
+      for (size_t i = 0; i < len; ++i) {
+         if (samples[i] < Int24Min || samples[i] > Int24Max)
+            return false;
+         dest[i] = samples[i];
+      }
+      mode = Int24Mode;
+      return true;
+   }
+   case floatSample: {
+      const auto samples = reinterpret_cast<const float *>(src);
+      for (size_t i = 0; i < len; ++i) {
+         const float sample = samples[i];
+         // Scaling by a power of two is exact; the comparisons reject NaN
+         const float scaled = sample * Float24Scale;
+         if (!(scaled >= Int24Min && scaled <= Int24Max))
+            return false;
+         const auto value = static_cast<int32_t>(scaled);
+         // Compare bits, so that fractions and negative zero are rejected
+         const float restored = value / Float24Scale;
+         if (memcmp(&restored, &sample, sizeof(float)) != 0)
+            return false;
+         dest[i] = value;
+      }
+      mode = Float24Mode;
+      return true;
+   }
+   default:
+      return false;
+   }
+}
+
+void FromIntegers(const int32_t *src, size_t len, Mode mode, samplePtr dest)
+{
+   switch (mode) {
+   case Int16Mode:
+      std::transform(src, src + len, reinterpret_cast<short *>(dest),
+         [](int32_t value){ return static_cast<short>(value); });
+      break;
+   case Int24Mode:
+      std::copy(src, src + len, reinterpret_cast<int *>(dest));
+      break;
+   case Float24Mode:
+      std::transform(src, src + len, reinterpret_cast<float *>(dest),
+         [](int32_t value){ return value / Float24Scale; });
+      break;
+   }
+}
+
+unsigned ChooseOrder(const int32_t *x, size_t len)
+{
+   if (len <= MaxOrder)
+      return 0;
+
+   // Compare total magnitudes of residuals, over the positions where all
+   // orders can predict
+   uint64_t costs[MaxOrder + 1]{};
+   for (size_t i = MaxOrder; i < len; ++i) {
+      const auto p = x + i;
+      costs[0] += std::abs(int64_t(*p) - Predict<0>(p));
+      costs[1] += std::abs(int64_t(*p) - Predict<1>(p));
+      costs[2] += std::abs(int64_t(*p) - Predict<2>(p));
+      costs[3] += std::abs(int64_t(*p) - Predict<3>(p));
+      costs[4] += std::abs(int64_t(*p) - Predict<4>(p));
+   }
+   return std::min_element(costs, costs + MaxOrder + 1) - costs;
+}
+
+struct PartitionCoding
+{
+   unsigned parameter;
+   //! Used only with EscapeParameter
+   unsigned width;
+};
+
+PartitionCoding ChooseCoding(const uint32_t *residuals, size_t len)
+{
+   uint64_t sum = 0;
+   uint32_t largest = 0;
+   for (size_t i = 0; i < len; ++i) {
+      sum += residuals[i];
+      largest = std::max(largest, residuals[i]);
+   }
+
+   // Residuals of valid input are less than 2^28, so the width fits 5 bits
+   unsigned width = 0;
+   while ((uint64_t(largest) >> width) != 0)
+      ++width;
+   PartitionCoding best{ EscapeParameter, width };
+   uint64_t bestCost = 5 + uint64_t(width) * len;
+
+   // Estimate the Rice parameter from the mean, then try its neighbors
+   unsigned guess = 0;
+   while (guess < MaxRiceParameter && (uint64_t(len) << (guess + 1)) < sum)
+      ++guess;
+   const auto first = (guess > 0) ? guess - 1 : 0;
+   const auto last = std::min(guess + 1, MaxRiceParameter);
+   for (auto parameter = first; parameter <= last; ++parameter) {
+      uint64_t cost = uint64_t(len) * (parameter + 1);
+      for (size_t i = 0; i < len; ++i)
+         cost += residuals[i] >> parameter;
+      if (cost < bestCost) {
+         bestCost = cost;
+         best = { parameter, 0 };
+      }
+   }
+   return best;
+}
+
+}
+
+namespace SampleCompression
+{
+
+std::vector<unsigned char> Compress(
+   constSamplePtr src, sampleFormat format, size_t numSamples)
+{
+   std::vector<unsigned char> result;
+   if (numSamples == 0 || numSamples > UINT32_MAX)
+      return result;
+
+   std::vector<int32_t> values(numSamples);
+   Mode mode;
+   if (!ToIntegers(src, format, numSamples, values.data(), mode))
+      return result;
+
+   const size_t rawBytes = numSamples * SAMPLE_SIZE(format);
+   result.reserve(rawBytes);
+   result.push_back(StreamVersion);
+   result.push_back(mode);
+   for (int shift = 0; shift < 32; shift += 8)
+      result.push_back(static_cast<unsigned char>(numSamples >> shift));
+
+   BitWriter writer{ result };
+   const auto warmupBits = WarmupBits(mode);
+   std::vector<uint32_t> residuals(FrameSize);
+
+   for (size_t start = 0; start < numSamples; start += FrameSize) {
+      const auto len = std::min(FrameSize, numSamples - start);
+      const auto x = values.data() + start;
+
+      const auto order = ChooseOrder(x, len);
+      writer.Write(order, 3);
+      for (unsigned i = 0; i < order; ++i)
+         writer.Write(ZigZag(x[i]), warmupBits);
+
+      WithOrder(order, [&](auto constant){
+         constexpr unsigned Order = decltype(constant)::value;
+         for (size_t i = Order; i < len; ++i)
+            residuals[i - Order] =
+               ZigZag(static_cast<int32_t>(x[i] - Predict<Order>(x + i)));
+      });
+
+      const auto count = len - order;
+      for (size_t begin = 0; begin < count; begin += PartitionSize) {
+         const auto partition = residuals.data() + begin;
+         const auto partitionLen = std::min(PartitionSize, count - begin);
+         const auto coding = ChooseCoding(partition, partitionLen);
+         writer.Write(coding.parameter, 5);
+         if (coding.parameter == EscapeParameter) {
+            writer.Write(coding.width, 5);
+            for (size_t i = 0; i < partitionLen; ++i)
+               writer.Write(partition[i], coding.width);
+         }
+         else {
+            for (size_t i = 0; i < partitionLen; ++i) {
+               writer.WriteUnary(partition[i] >> coding.parameter);
+               writer.Write(partition[i], coding.parameter);
+            }
+         }
+      }
+
+      // Give up early on incompressible data
+      if (result.size() >= rawBytes)
+         return {};
+   }
+   writer.Flush();
+
+   if (result.size() >= rawBytes)
+      return {};
+   return result;
+}
+
+size_t GetSampleCount(const void *src, size_t srcBytes)
+{
+   const auto bytes = static_cast<const unsigned char *>(src);
+   if (srcBytes < HeaderSize ||
+       bytes[0] != StreamVersion || bytes[1] > Float24Mode)
+      return 0;
+   return size_t(bytes[2]) | (size_t(bytes[3]) << 8) |
+      (size_t(bytes[4]) << 16) | (size_t(bytes[5]) << 24);
+}
+
+size_t Decompress(const void *src, size_t srcBytes,
+   sampleFormat format, samplePtr dest, size_t numSamples)
+{
+   const auto total = GetSampleCount(src, srcBytes);
+   const auto bytes = static_cast<const unsigned char *>(src);
+   if (total == 0 || !ModeMatches(Mode(bytes[1]), format))
+      return 0;
+
+   const auto mode = Mode(bytes[1]);
+   const auto warmupBits = WarmupBits(mode);
+   const auto sampleSize = SAMPLE_SIZE(format);
+   numSamples = std::min(numSamples, total);
+
+   BitReader reader{ bytes + HeaderSize, srcBytes - HeaderSize };
+   std::vector<int32_t> frame(FrameSize);
+   size_t decoded = 0;
+   while (decoded < numSamples) {
+      const auto len = std::min(FrameSize, total - decoded);
+      const auto order = reader.Read(3);
+      if (order > MaxOrder || (order > 0 && order >= len))
+         break;
+
+      for (unsigned i = 0; i < order; ++i)
+         frame[i] = UnZigZag(reader.Read(warmupBits));
+
+      // Decode residuals in place, then restore the samples from them
+      const auto count = len - order;
+      for (size_t begin = 0; begin < count; begin += PartitionSize) {
+         const auto partition = frame.data() + order + begin;
+         const auto partitionLen = std::min(PartitionSize, count - begin);
+         const auto parameter = reader.Read(5);
+         if (parameter == EscapeParameter) {
+            const auto width = reader.Read(5);
+            for (size_t i = 0; i < partitionLen; ++i)
+               partition[i] = UnZigZag(reader.Read(width));
+         }
+         else {
+            for (size_t i = 0; i < partitionLen; ++i) {
+               const auto high = reader.ReadUnary();
+               partition[i] =
+                  UnZigZag((high << parameter) | reader.Read(parameter));
+            }
+         }
+      }
+      if (reader.Failed())
+         break;
+
+      WithOrder(order, [&](auto constant){
+         constexpr unsigned Order = decltype(constant)::value;
+         const auto x = frame.data();
+         for (size_t i = Order; i < len; ++i)
+            x[i] = static_cast<int32_t>(x[i] + Predict<Order>(x + i));
+      });
+
+      const auto copied = std::min(len, numSamples - decoded);
+      FromIntegers(frame.data(), copied, mode, dest + decoded * sampleSize);
+      decoded += copied;
+   }
+
+   return decoded;
+}
+
+}
@@ -0,0 +1,67 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleCompression.h
+  @brief Lossless compression of blocks of samples
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_COMPRESSION__
+#define __AUDACITY_SAMPLE_COMPRESSION__
+
+#include "SampleFormat.h"
+
+#include <vector>
+
+//! Lossless codec for blocks of samples, in the manner of FLAC
+/*!
+ Samples are coded in frames, each with the fixed polynomial predictor of
+ order 0 to 4 that best fits it, and prediction residuals are coded with
+ partitioned Rice codes.
+
+ Integer samples are always eligible.  Float samples are eligible only when
+ every one of them is exactly some 24 bit integer divided by 2^23, as is
+ the case for recordings and imports of 16 and 24 bit material that have not
+ been processed since; otherwise compression declines.
+ */
+namespace SampleCompression
+{
+
+//! Identifies how samples of a block are stored
+/*! These values persist in saved project files, so must not be changed in
+ later program versions */
+enum Codec : int
+{
+   Raw = 0,
+   //! Fixed linear prediction and partitioned Rice coding
+   FixedRice = 1,
+};
+
+//! How many leading bytes of compressed data GetSampleCount() examines
+constexpr size_t HeaderBytes = 6;
+
+//! Compress samples losslessly
+/*!
+ @return the compressed bytes, or an empty vector if the samples are not
+ eligible or would not become smaller
+ */
+MATH_API std::vector<unsigned char> Compress(
+   constSamplePtr src, sampleFormat format, size_t numSamples);
+
+//! @return the number of samples encoded in src, or zero if src is malformed
+MATH_API size_t GetSampleCount(const void *src, size_t srcBytes);
+
+//! Decompress a prefix of the samples, in the format they were compressed from
+/*!
+ Decoding stops as soon as numSamples are produced, so it is cheaper to
+ fetch the start of a block than all of it.
+ @return the number of samples decoded, which is less than numSamples only if
+ src is malformed or holds fewer samples
+ */
+MATH_API size_t Decompress(const void *src, size_t srcBytes,
+   sampleFormat format, samplePtr dest, size_t numSamples);
+
+}
+
+#endif
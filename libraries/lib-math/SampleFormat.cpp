@@ -48,7 +48,6 @@
 
 DitherType gLowQualityDither = DitherType::none;
 DitherType gHighQualityDither = DitherType::shaped;
-static Dither gDitherAlgorithm;
 
 void InitDitherers()
 {
@@ -114,7 +113,9 @@ void CopySamples(constSamplePtr src, sampleFormat srcFormat,
    unsigned int srcStride /* = 1 */,
    unsigned int dstStride /* = 1 */)
 {
-   gDitherAlgorithm.Apply(
+   // Each thread has its own state of dithering
+   static thread_local Dither sDitherAlgorithm;
+   sDitherAlgorithm.Apply(
       ditherType,
       src, srcFormat, dst, dstFormat, len, srcStride, dstStride);
 }
@@ -168,6 +168,7 @@ void SamplesToFloats(constSamplePtr src, sampleFormat srcFormat,
 MATH_API
 //! Copy samples from any format to any other format; apply dithering only if narrowing the format
 /*!
+ Safe to call in several threads at once
  @copydetails SamplesToFloats()
  @param dstFormat format of destination samples, determines sizeof each one
  @param ditherType choice of dithering algorithm to use if narrowing the format
@@ -0,0 +1,187 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleSummary.cpp
+
+**********************************************************************/
+
+#include "SampleSummary.h"
+#include "CPUFeatures.h"
+
+#include <algorithm>
+
+#ifdef AUDACITY_X86
+#include <immintrin.h>
+#endif
+
+using namespace SampleSummary;
+
+namespace {
+
+void SummarizeScalar(const float *samples, size_t count, float *dest)
+{
+   float min = samples[0], max = samples[0], sumsq = min * min;
+   for (size_t j = 1; j < count; ++j) {
+      const float f = samples[j];
+      min = std::min(min, f);
+      max = std::max(max, f);
+      sumsq += f * f;
+   }
+   dest[0] = min;
+   dest[1] = max;
+   dest[2] = sumsq;
+}
+
+#ifdef AUDACITY_X86
+
+AUDACITY_TARGET("sse2")
+void SummarizeSSE2(const float *samples, size_t count, float *dest)
+{
+   // Two accumulators of squares shorten the chain of dependent additions
+   __m128 vmin = _mm_loadu_ps(samples), vmax = vmin;
+   __m128 sum0 = _mm_mul_ps(vmin, vmin), sum1 = _mm_setzero_ps();
+   size_t j = 4;
+   for (; j + 8 <= count; j += 8) {
+      const __m128 v0 = _mm_loadu_ps(samples + j);
+      const __m128 v1 = _mm_loadu_ps(samples + j + 4);
+      vmin = _mm_min_ps(vmin, _mm_min_ps(v0, v1));
+      vmax = _mm_max_ps(vmax, _mm_max_ps(v0, v1));
+      sum0 = _mm_add_ps(sum0, _mm_mul_ps(v0, v0));
+      sum1 = _mm_add_ps(sum1, _mm_mul_ps(v1, v1));
+   }
+   for (; j + 4 <= count; j += 4) {
+      const __m128 v = _mm_loadu_ps(samples + j);
+      vmin = _mm_min_ps(vmin, v);
+      vmax = _mm_max_ps(vmax, v);
+      sum0 = _mm_add_ps(sum0, _mm_mul_ps(v, v));
+   }
+
+   // Reduce the lanes
+   vmin = _mm_min_ps(vmin, _mm_movehl_ps(vmin, vmin));
+   vmin = _mm_min_ss(vmin, _mm_shuffle_ps(vmin, vmin, 1));
+   vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+   vmax = _mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, 1));
+   __m128 sum = _mm_add_ps(sum0, sum1);
+   sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+   sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+   float min = _mm_cvtss_f32(vmin), max = _mm_cvtss_f32(vmax),
+      sumsq = _mm_cvtss_f32(sum);
+   for (; j < count; ++j) {
+      const float f = samples[j];
+      min = std::min(min, f);
+      max = std::max(max, f);
+      sumsq += f * f;
+   }
+   dest[0] = min;
+   dest[1] = max;
+   dest[2] = sumsq;
+}
+
+AUDACITY_TARGET("avx2")
+void SummarizeAVX2(const float *samples, size_t count, float *dest)
+{
+   __m256 vmin = _mm256_loadu_ps(samples), vmax = vmin;
+   __m256 sum0 = _mm256_mul_ps(vmin, vmin), sum1 = _mm256_setzero_ps();
+   size_t j = 8;
+   for (; j + 16 <= count; j += 16) {
+      const __m256 v0 = _mm256_loadu_ps(samples + j);
+      const __m256 v1 = _mm256_loadu_ps(samples + j + 8);
+      vmin = _mm256_min_ps(vmin, _mm256_min_ps(v0, v1));
+      vmax = _mm256_max_ps(vmax, _mm256_max_ps(v0, v1));
+      sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(v0, v0));
+      sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(v1, v1));
+   }
+   for (; j + 8 <= count; j += 8) {
+      const __m256 v = _mm256_loadu_ps(samples + j);
+      vmin = _mm256_min_ps(vmin, v);
+      vmax = _mm256_max_ps(vmax, v);
+      sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(v, v));
+   }
+
+   // Reduce the lanes, first to four and then as for SSE
+   __m128 min4 = _mm_min_ps(
+      _mm256_castps256_ps128(vmin), _mm256_extractf128_ps(vmin, 1));
+   __m128 max4 = _mm_max_ps(
+      _mm256_castps256_ps128(vmax), _mm256_extractf128_ps(vmax, 1));
+   const __m256 sum8 = _mm256_add_ps(sum0, sum1);
+   __m128 sum4 = _mm_add_ps(
+      _mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+   min4 = _mm_min_ps(min4, _mm_movehl_ps(min4, min4));
+   min4 = _mm_min_ss(min4, _mm_shuffle_ps(min4, min4, 1));
+   max4 = _mm_max_ps(max4, _mm_movehl_ps(max4, max4));
+   max4 = _mm_max_ss(max4, _mm_shuffle_ps(max4, max4, 1));
+   sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+   sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+
+   float min = _mm_cvtss_f32(min4), max = _mm_cvtss_f32(max4),
+      sumsq = _mm_cvtss_f32(sum4);
+   for (; j < count; ++j) {
+      const float f = samples[j];
+      min = std::min(min, f);
+      max = std::max(max, f);
+      sumsq += f * f;
+   }
+   dest[0] = min;
+   dest[1] = max;
+   dest[2] = sumsq;
+}
+
+#endif
+
+using FrameFunction = void (*)(const float *, size_t, float *);
+
+FrameFunction GetFrameFunction(Kernel kernel, size_t count)
+{
+#ifdef AUDACITY_X86
+   // The vector kernels need a full first vector
+   switch (kernel) {
+   case Kernel::AVX2:
+      if (count >= 8)
+         return SummarizeAVX2;
+      break;
+   case Kernel::SSE2:
+      if (count >= 4)
+         return SummarizeSSE2;
+      break;
+   default:
+      break;
+   }
+#endif
+   return SummarizeScalar;
+}
+
+}
+
+bool SampleSummary::IsSupported(Kernel kernel)
+{
+   switch (kernel) {
+   case Kernel::AVX2:
+      return CPUFeatures::AVX2();
+   case Kernel::SSE2:
+      return CPUFeatures::SSE2();
+   default:
+      return true;
+   }
+}
+
+Kernel SampleSummary::BestKernel()
+{
+   static const Kernel best =
+        IsSupported(Kernel::AVX2) ? Kernel::AVX2
+      : IsSupported(Kernel::SSE2) ? Kernel::SSE2
+      : Kernel::Scalar;
+   return best;
+}
+
+void SampleSummary::Summarize256(const float *samples, size_t nSamples,
+   float *dest, Kernel kernel)
+{
+   const auto summarizeFull = GetFrameFunction(kernel, FrameSize);
+   for (; nSamples >= FrameSize;
+        nSamples -= FrameSize, samples += FrameSize, dest += 3)
+      summarizeFull(samples, FrameSize, dest);
+   if (nSamples > 0)
+      GetFrameFunction(kernel, nSamples)(samples, nSamples, dest);
+}
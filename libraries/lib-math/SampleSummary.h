@@ -0,0 +1,42 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SampleSummary.h
+  @brief Minimum, maximum, and sum of squares of runs of samples
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SAMPLE_SUMMARY__
+#define __AUDACITY_SAMPLE_SUMMARY__
+
+#include <cstddef>
+
+namespace SampleSummary
+{
+
+//! How many samples each triple computed by Summarize256() describes
+constexpr size_t FrameSize = 256;
+
+//! Implementations of Summarize256(), which differ only in speed and in the
+//! rounding of sums of squares
+enum class Kernel { Scalar, SSE2, AVX2 };
+
+//! Whether the processor can run the kernel
+MATH_API bool IsSupported(Kernel kernel);
+
+//! The fastest supported kernel
+MATH_API Kernel BestKernel();
+
+//! Summarize each run of FrameSize samples, the last run possibly shorter
+/*!
+ @param dest receives, for each run, its minimum, maximum, and sum of
+ squares; it must have room for 3 * ceil(nSamples / FrameSize) floats
+ @pre IsSupported(kernel)
+ */
+MATH_API void Summarize256(const float *samples, size_t nSamples,
+   float *dest, Kernel kernel = BestKernel());
+
+}
+
+#endif
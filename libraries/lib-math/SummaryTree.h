@@ -0,0 +1,430 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SummaryTree.h
+  @brief Sequence of runs of samples, with their minimum, maximum, and sum
+  of squares, that finds, splits, and joins in logarithmic time
+
+**********************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_TREE__
+#define __AUDACITY_SUMMARY_TREE__
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cfloat>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#include "SampleCount.h"
+
+//! Minimum, maximum, and sum of squares of a run of samples
+struct RangeSummary
+{
+   //! The default describes no samples, and is the identity of Combine()
+   float min = FLT_MAX;
+   float max = -FLT_MAX;
+   double sumsq = 0;
+
+   void Combine(const RangeSummary &other)
+   {
+      if (other.min < min)
+         min = other.min;
+      if (other.max > max)
+         max = other.max;
+      sumsq += other.sumsq;
+   }
+};
+
+//! Sequence of items, each describing a run of samples, that follow one
+//! another without gaps
+/*!
+ It is a balanced binary tree of immutable nodes.  Each node has the count,
+ the total length, and the combined RangeSummary of the items under it, so
+ that the start of an item, the item at a sample position, and the summary of
+ any range of items take logarithmic time.  So do splitting and joining,
+ which copy only the nodes on one path.  Copying a whole tree copies one
+ pointer, and a copy never sees changes to the original.
+
+ Starts are not stored, but found from lengths, so that inserting or removing
+ items changes nothing after them.
+
+ @tparam Item copyable, and cheap to copy, such as a shared pointer
+ */
+template<typename Item> class SummaryTree
+{
+public:
+   //! What the tree holds for each item
+   struct Leaf
+   {
+      Item item;
+      sampleCount length;
+      RangeSummary summary;
+   };
+
+private:
+   struct Node;
+   using NodePtr = std::shared_ptr<const Node>;
+
+   //! Bound on the height of any tree:  one of height h has at least
+   //! Fibonacci(h + 2) - 1 nodes, which is more than size_t counts for h = 92
+   static constexpr size_t MaxHeight = 92;
+
+public:
+   //! Visits leaves in order, with their starts
+   class const_iterator
+   {
+   public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Leaf;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const Leaf *;
+      using reference = const Leaf &;
+
+      const_iterator() = default;
+
+      reference operator *() const { return Top()->leaf; }
+      pointer operator ->() const { return &Top()->leaf; }
+      //! Sum of the lengths of the preceding leaves
+      sampleCount Start() const { return mStart; }
+
+      const_iterator &operator ++()
+      {
+         auto pNode = mStack[--mDepth];
+         mStart += pNode->leaf.length;
+         Descend(pNode->right.get());
+         return *this;
+      }
+      const_iterator operator ++(int)
+      {
+         auto result = *this;
+         ++*this;
+         return result;
+      }
+
+      friend bool operator ==(
+         const const_iterator &a, const const_iterator &b)
+      {
+         return a.mDepth == 0
+            ? b.mDepth == 0
+            : b.mDepth != 0 && a.Top() == b.Top();
+      }
+      friend bool operator !=(
+         const const_iterator &a, const const_iterator &b)
+      { return !(a == b); }
+
+   private:
+      friend SummaryTree;
+      const Node *Top() const { return mStack[mDepth - 1]; }
+      void Push(const Node *pNode)
+      {
+         assert(mDepth < MaxHeight);
+         mStack[mDepth++] = pNode;
+      }
+      //! Push the path to the leftmost node under pNode
+      void Descend(const Node *pNode)
+      {
+         for (; pNode; pNode = pNode->left.get())
+            Push(pNode);
+      }
+
+      //! Nodes whose leaves are not yet visited, each the parent of the next
+      //! or an ancestor of it, the current one last; kept inline, so that
+      //! making and copying iterators never allocates
+      std::array<const Node *, MaxHeight> mStack{};
+      size_t mDepth{ 0 };
+      sampleCount mStart{ 0 };
+   };
+
+   SummaryTree() = default;
+
+   size_t size() const { return Count(mRoot); }
+   bool empty() const { return !mRoot; }
+   //! Sum of the lengths of all leaves
+   sampleCount Length() const { return Length(mRoot); }
+
+   const_iterator begin() const
+   {
+      const_iterator result;
+      result.Descend(mRoot.get());
+      return result;
+   }
+   const_iterator end() const { return {}; }
+
+   //! Iterator at leaf ii, or end() if ii is not less than size()
+   const_iterator IteratorAt(size_t ii) const
+   {
+      const_iterator result;
+      if (ii >= size())
+         return result;
+      for (auto pNode = mRoot.get(); pNode;) {
+         const auto nLeft = Count(pNode->left);
+         if (ii < nLeft) {
+            result.Push(pNode);
+            pNode = pNode->left.get();
+         }
+         else {
+            result.mStart += Length(pNode->left);
+            if (ii == nLeft) {
+               result.Push(pNode);
+               break;
+            }
+            ii -= nLeft + 1;
+            result.mStart += pNode->leaf.length;
+            pNode = pNode->right.get();
+         }
+      }
+      return result;
+   }
+
+   //! Leaf ii, without making an iterator
+   /*!
+    @pre ii < size()
+    @param[out] start sum of the lengths of the preceding leaves
+    @return valid while this tree, or a copy of it, is unchanged
+    */
+   const Leaf &At(size_t ii, sampleCount &start) const
+   {
+      assert(ii < size());
+      start = 0;
+      auto pNode = mRoot.get();
+      while (true) {
+         const auto nLeft = Count(pNode->left);
+         if (ii < nLeft)
+            pNode = pNode->left.get();
+         else {
+            start += Length(pNode->left);
+            if (ii == nLeft)
+               return pNode->leaf;
+            ii -= nLeft + 1;
+            start += pNode->leaf.length;
+            pNode = pNode->right.get();
+         }
+      }
+   }
+
+   //! Index of the leaf whose run contains position pos
+   /*! @pre 0 <= pos && pos < Length() */
+   size_t Find(sampleCount pos) const
+   {
+      assert(0 <= pos && pos < Length());
+      size_t result = 0;
+      for (auto pNode = mRoot.get(); pNode;) {
+         const auto leftLength = Length(pNode->left);
+         if (pos < leftLength)
+            pNode = pNode->left.get();
+         else {
+            result += Count(pNode->left);
+            pos -= leftLength;
+            if (pos < pNode->leaf.length)
+               break;
+            ++result;
+            pos -= pNode->leaf.length;
+            pNode = pNode->right.get();
+         }
+      }
+      return result;
+   }
+
+   //! Combined summary of leaves [first, last)
+   RangeSummary Query(size_t first, size_t last) const
+   {
+      return Query(mRoot.get(), first, std::min(last, size()));
+   }
+
+   //! Leaves [first, last) as another tree
+   SummaryTree Slice(size_t first, size_t last) const
+   {
+      last = std::min(last, size());
+      if (first >= last)
+         return {};
+      auto right = Split(mRoot, last).first;
+      return SummaryTree{ Split(right, first).second };
+   }
+
+   //! Append all leaves of another tree
+   void Append(const SummaryTree &other)
+   {
+      mRoot = Join2(mRoot, other.mRoot);
+   }
+
+   void PushBack(Leaf leaf)
+   {
+      mRoot = Join(mRoot, std::move(leaf), nullptr);
+   }
+
+   //! Replace leaves [first, last) with all leaves of another tree
+   void Splice(size_t first, size_t last, const SummaryTree &other)
+   {
+      auto parts = Split(mRoot, first);
+      mRoot = Join2(Join2(parts.first, other.mRoot),
+         Split(parts.second, last - first).second);
+   }
+
+private:
+   struct Node
+   {
+      Node(NodePtr left_, Leaf leaf_, NodePtr right_)
+         : left{ std::move(left_) }
+         , right{ std::move(right_) }
+         , leaf{ std::move(leaf_) }
+         , count{ Count(left) + 1 + Count(right) }
+         , length{ Length(left) + leaf.length + Length(right) }
+         , height{ 1 + std::max(Height(left), Height(right)) }
+         , summary{ Combined(left, leaf, right) }
+      {}
+
+      static RangeSummary Combined(
+         const NodePtr &left, const Leaf &leaf, const NodePtr &right)
+      {
+         auto result = Summary(left);
+         result.Combine(leaf.summary);
+         result.Combine(Summary(right));
+         return result;
+      }
+
+      const NodePtr left, right;
+      const Leaf leaf;
+      const size_t count;
+      const sampleCount length;
+      const int height;
+      const RangeSummary summary;
+   };
+
+   explicit SummaryTree(NodePtr root) : mRoot{ std::move(root) } {}
+
+   static size_t Count(const NodePtr &p) { return p ? p->count : 0; }
+   static sampleCount Length(const NodePtr &p) { return p ? p->length : 0; }
+   static int Height(const NodePtr &p) { return p ? p->height : 0; }
+   static RangeSummary Summary(const NodePtr &p)
+      { return p ? p->summary : RangeSummary{}; }
+
+   static NodePtr Make(NodePtr left, Leaf leaf, NodePtr right)
+   {
+      return std::make_shared<const Node>(
+         std::move(left), std::move(leaf), std::move(right));
+   }
+
+   static NodePtr RotateLeft(const NodePtr &p)
+   {
+      const auto &r = p->right;
+      return Make(Make(p->left, p->leaf, r->left), r->leaf, r->right);
+   }
+
+   static NodePtr RotateRight(const NodePtr &p)
+   {
+      const auto &l = p->left;
+      return Make(l->left, l->leaf, Make(l->right, p->leaf, p->right));
+   }
+
+   //! Join two balanced trees and a leaf between them into a balanced tree,
+   //! in time proportional to the difference of heights
+   static NodePtr Join(NodePtr left, Leaf leaf, NodePtr right)
+   {
+      if (Height(left) > Height(right) + 1)
+         return JoinRight(left, std::move(leaf), std::move(right));
+      if (Height(right) > Height(left) + 1)
+         return JoinLeft(std::move(left), std::move(leaf), right);
+      return Make(std::move(left), std::move(leaf), std::move(right));
+   }
+
+   //! Join when left is the taller
+   static NodePtr JoinRight(const NodePtr &left, Leaf leaf, NodePtr right)
+   {
+      const auto &c = left->right;
+      if (Height(c) <= Height(right) + 1) {
+         auto t = Make(c, std::move(leaf), std::move(right));
+         if (Height(t) <= Height(left->left) + 1)
+            return Make(left->left, left->leaf, std::move(t));
+         return RotateLeft(Make(left->left, left->leaf, RotateRight(t)));
+      }
+      auto t = JoinRight(c, std::move(leaf), std::move(right));
+      const bool balanced = Height(t) <= Height(left->left) + 1;
+      auto result = Make(left->left, left->leaf, std::move(t));
+      return balanced ? result : RotateLeft(result);
+   }
+
+   //! Join when right is the taller
+   static NodePtr JoinLeft(NodePtr left, Leaf leaf, const NodePtr &right)
+   {
+      const auto &c = right->left;
+      if (Height(c) <= Height(left) + 1) {
+         auto t = Make(std::move(left), std::move(leaf), c);
+         if (Height(t) <= Height(right->right) + 1)
+            return Make(std::move(t), right->leaf, right->right);
+         return RotateRight(Make(RotateLeft(t), right->leaf, right->right));
+      }
+      auto t = JoinLeft(std::move(left), std::move(leaf), c);
+      const bool balanced = Height(t) <= Height(right->right) + 1;
+      auto result = Make(std::move(t), right->leaf, right->right);
+      return balanced ? result : RotateRight(result);
+   }
+
+   //! Join two balanced trees without a leaf between them
+   static NodePtr Join2(NodePtr left, NodePtr right)
+   {
+      if (!left)
+         return right;
+      if (!right)
+         return left;
+      auto parts = SplitLast(left);
+      return Join(std::move(parts.first), std::move(parts.second), right);
+   }
+
+   //! The tree without its last leaf, and that leaf
+   static std::pair<NodePtr, Leaf> SplitLast(const NodePtr &p)
+   {
+      if (!p->right)
+         return { p->left, p->leaf };
+      auto parts = SplitLast(p->right);
+      return { Join(p->left, p->leaf, std::move(parts.first)),
+         std::move(parts.second) };
+   }
+
+   //! The first n leaves, and the rest
+   static std::pair<NodePtr, NodePtr> Split(const NodePtr &p, size_t n)
+   {
+      if (!p)
+         return {};
+      if (n == 0)
+         return { nullptr, p };
+      if (n >= p->count)
+         return { p, nullptr };
+      const auto nLeft = Count(p->left);
+      if (n <= nLeft) {
+         auto parts = Split(p->left, n);
+         return { std::move(parts.first),
+            Join(std::move(parts.second), p->leaf, p->right) };
+      }
+      auto parts = Split(p->right, n - nLeft - 1);
+      return { Join(p->left, p->leaf, std::move(parts.first)),
+         std::move(parts.second) };
+   }
+
+   static RangeSummary Query(const Node *pNode, size_t first, size_t last)
+   {
+      if (!pNode || first >= last)
+         return {};
+      if (first == 0 && last >= pNode->count)
+         return pNode->summary;
+      RangeSummary result;
+      const auto nLeft = Count(pNode->left);
+      if (first < nLeft)
+         result.Combine(
+            Query(pNode->left.get(), first, std::min(last, nLeft)));
+      if (first <= nLeft && nLeft < last)
+         result.Combine(pNode->leaf.summary);
+      if (last > nLeft + 1)
+         result.Combine(Query(pNode->right.get(),
+            std::max(first, nLeft + 1) - (nLeft + 1), last - (nLeft + 1)));
+      return result;
+   }
+
+   NodePtr mRoot;
+};
+
+#endif
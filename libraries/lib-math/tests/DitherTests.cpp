@@ -0,0 +1,153 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file DitherTests.cpp
+ @brief Tests and a benchmark of conversion of float samples with dither
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Dither.h"
+
+namespace
+{
+std::vector<float> MakeNoise(size_t len)
+{
+   std::mt19937 generator{ 7 };
+   std::uniform_real_distribution<float> distribution{ -1.1f, 1.1f };
+   std::vector<float> result(len);
+   for (auto &sample : result)
+      sample = distribution(generator);
+   return result;
+}
+
+template<typename Sample>
+std::vector<Sample> Convert(Dither &dither, DitherType type,
+   sampleFormat format, const std::vector<float> &input,
+   size_t blockSize, size_t srcStride = 1)
+{
+   // Spread out the input to use the strided path
+   std::vector<float> spread;
+   if (srcStride > 1) {
+      spread.resize(input.size() * srcStride);
+      for (size_t ii = 0; ii < input.size(); ++ii)
+         spread[ii * srcStride] = input[ii];
+   }
+   const auto &source = srcStride > 1 ? spread : input;
+
+   std::vector<Sample> result(input.size());
+   for (size_t pos = 0; pos < input.size(); pos += blockSize) {
+      const auto len = std::min(blockSize, input.size() - pos);
+      dither.Apply(type,
+         reinterpret_cast<constSamplePtr>(source.data() + pos * srcStride),
+         floatSample,
+         reinterpret_cast<samplePtr>(result.data() + pos), format,
+         len, srcStride);
+   }
+   return result;
+}
+
+const DitherType types[]{
+   DitherType::none, DitherType::rectangle,
+   DitherType::triangle, DitherType::shaped };
+}
+
+TEST_CASE("Dither without noise rounds and clips", "[Dither]")
+{
+   const std::vector<float> input{
+      0.0f, 0.5f / 32768, 1.5f / 32768, -1.0f, 1.0f, 2.0f, -2.0f, 0.25f, 0.0f };
+   Dither dither;
+   const auto actual = Convert<short>(
+      dither, DitherType::none, int16Sample, input, input.size());
+   const std::vector<short> expected{
+      0, 0, 2, -32768, 32767, 32767, -32768, 8192, 0 };
+   REQUIRE(actual == expected);
+}
+
+TEST_CASE("Dither in vectors as one sample at a time", "[Dither]")
+{
+   // Odd lengths of blocks make the vector code begin at each generator
+   const auto input = MakeNoise(10007);
+   for (const auto type : types) {
+      for (const size_t blockSize : { size_t(10007), size_t(333), size_t(5) }) {
+         Dither contiguous, strided;
+         REQUIRE(Convert<short>(contiguous, type, int16Sample, input, blockSize)
+            == Convert<short>(strided, type, int16Sample, input, blockSize, 2));
+         REQUIRE(Convert<int>(contiguous, type, int24Sample, input, blockSize)
+            == Convert<int>(strided, type, int24Sample, input, blockSize, 2));
+      }
+   }
+}
+
+TEST_CASE("Dither noise is within bounds", "[Dither]")
+{
+   const auto input = MakeNoise(10000);
+   Dither plain;
+   const auto undithered =
+      Convert<short>(plain, DitherType::none, int16Sample, input, 1000);
+   for (const auto type : { DitherType::rectangle, DitherType::triangle }) {
+      Dither dither;
+      const auto actual = Convert<short>(dither, type, int16Sample, input, 1000);
+      for (size_t ii = 0; ii < input.size(); ++ii)
+         REQUIRE(std::abs(actual[ii] - undithered[ii]) <= 1);
+   }
+}
+
+TEST_CASE("Dither instances in threads are independent", "[Dither]")
+{
+   const auto input = MakeNoise(100000);
+   std::vector<short> expected;
+   {
+      Dither dither;
+      expected = Convert<short>(
+         dither, DitherType::shaped, int16Sample, input, 4096);
+   }
+
+   std::vector<std::vector<short>> results(4);
+   std::vector<std::thread> threads;
+   for (auto &result : results)
+      threads.emplace_back([&]{
+         Dither dither;
+         result = Convert<short>(
+            dither, DitherType::shaped, int16Sample, input, 4096);
+      });
+   for (auto &thread : threads)
+      thread.join();
+   for (auto &result : results)
+      REQUIRE(result == expected);
+}
+
+// Hidden from the default run; run the test executable with [benchmark]
+TEST_CASE("Dither throughput", "[.][benchmark]")
+{
+   constexpr size_t BlockSize = 65536;
+   // A minute of stereo audio
+   const auto input = MakeNoise(2 * 60 * 44100);
+   const char *const names[]{ "none", "rectangle", "triangle", "shaped" };
+
+   using namespace std::chrono;
+   for (const auto type : types) {
+      Dither dither;
+      auto start = steady_clock::now();
+      Convert<short>(dither, type, int16Sample, input, BlockSize);
+      const duration<double> elapsed16 = steady_clock::now() - start;
+
+      start = steady_clock::now();
+      Convert<int>(dither, type, int24Sample, input, BlockSize);
+      const duration<double> elapsed24 = steady_clock::now() - start;
+
+      printf("%-9s  %7.1f Msamples/s to int16, %7.1f Msamples/s to int24\n",
+         names[type],
+         input.size() / elapsed16.count() / 1e6,
+         input.size() / elapsed24.count() / 1e6);
+   }
+}
@@ -0,0 +1,109 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file MixKernelsTests.cpp
+ @brief Tests and a benchmark of the kernels that mix samples
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "MixKernels.h"
+
+using namespace MixKernels;
+
+namespace
+{
+std::vector<float> MakeNoise(size_t len, unsigned seed = 7)
+{
+   std::mt19937 generator{ seed };
+   std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+   std::vector<float> result(len);
+   for (auto &sample : result)
+      sample = distribution(generator);
+   return result;
+}
+
+const Kernel kernels[]{ Kernel::Scalar, Kernel::SSE2, Kernel::AVX2 };
+}
+
+TEST_CASE("MixKernels::Multiply", "[MixKernels]")
+{
+   for (const size_t len : { 1000, 17, 3 }) {
+      const auto samples = MakeNoise(len), gains = MakeNoise(len, 8);
+      auto expected = samples;
+      Multiply(expected.data(), gains.data(), len, Kernel::Scalar);
+      for (const auto kernel : kernels) {
+         if (!IsSupported(kernel))
+            continue;
+         auto actual = samples;
+         Multiply(actual.data(), gains.data(), len, kernel);
+         REQUIRE(actual == expected);
+      }
+   }
+}
+
+TEST_CASE("MixKernels::Accumulate", "[MixKernels]")
+{
+   for (const size_t nChannels : { 1, 2, 3 }) {
+      for (const size_t len : { 1000, 17, 5, 4, 1 }) {
+         const auto src = MakeNoise(len);
+         // Planar or interleaved, exactly as long as needed
+         const auto mix = MakeNoise(nChannels * len, 8);
+         for (size_t channel = 0; channel < nChannels; ++channel) {
+            for (const float deltaGain : { 0.0f, 0.001f }) {
+               auto expected = mix;
+               for (size_t i = 0; i < len; ++i)
+                  expected[i * nChannels + channel] +=
+                     (0.5f + deltaGain * i) * src[i];
+
+               for (const auto kernel : kernels) {
+                  if (!IsSupported(kernel))
+                     continue;
+                  auto actual = mix;
+                  Accumulate(actual.data() + channel, nChannels,
+                     src.data(), len, 0.5f, deltaGain, kernel);
+                  REQUIRE(actual == expected);
+               }
+            }
+         }
+      }
+   }
+}
+
+// Hidden from the default run; run the test executable with [benchmark]
+TEST_CASE("MixKernels throughput", "[.][benchmark]")
+{
+   // Mix ten minutes of a mono track into a stereo interleaved buffer with
+   // an envelope, in blocks as the Mixer does
+   constexpr size_t BlockSize = 4096;
+   constexpr size_t Len = 10 * 60 * 44100;
+   const auto src = MakeNoise(Len), envelope = MakeNoise(Len, 8);
+   std::vector<float> block(BlockSize), mix(2 * BlockSize);
+   const char *const names[]{ "Scalar", "SSE2", "AVX2" };
+
+   using namespace std::chrono;
+   for (const auto kernel : kernels) {
+      if (!IsSupported(kernel))
+         continue;
+      const auto start = steady_clock::now();
+      for (size_t pos = 0; pos + BlockSize <= Len; pos += BlockSize) {
+         std::copy(&src[pos], &src[pos] + BlockSize, block.begin());
+         Multiply(block.data(), &envelope[pos], BlockSize, kernel);
+         for (size_t channel : { 0, 1 })
+            Accumulate(mix.data() + channel, 2,
+               block.data(), BlockSize, 0.7f, 0, kernel);
+      }
+      const duration<double> elapsed = steady_clock::now() - start;
+      printf("%-6s  %.3f s for 10 min, %.0fx realtime\n",
+         names[static_cast<int>(kernel)], elapsed.count(),
+         600 / elapsed.count());
+   }
+}
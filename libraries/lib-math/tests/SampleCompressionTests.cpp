@@ -0,0 +1,126 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file SampleCompressionTests.cpp
+ @brief Tests for lossless compression of sample blocks
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "SampleCompression.h"
+
+namespace
+{
+// A sine with some noise, quantized as if recorded at 24 bits
+std::vector<int> MakeSignal(size_t len, int noise)
+{
+   std::mt19937 generator{ 42 };
+   std::uniform_int_distribution<int> distribution{ -noise, noise };
+   std::vector<int> result(len);
+   for (size_t i = 0; i < len; ++i)
+      result[i] = static_cast<int>(4000000 * std::sin(i * 0.01)) +
+         distribution(generator);
+   return result;
+}
+
+template<typename T>
+void TestRoundTrip(const std::vector<T> &samples, sampleFormat format)
+{
+   const auto src = reinterpret_cast<constSamplePtr>(samples.data());
+   const auto compressed =
+      SampleCompression::Compress(src, format, samples.size());
+   REQUIRE(!compressed.empty());
+   REQUIRE(compressed.size() < samples.size() * sizeof(T));
+   REQUIRE(SampleCompression::GetSampleCount(
+      compressed.data(), compressed.size()) == samples.size());
+
+   std::vector<T> decoded(samples.size());
+   REQUIRE(SampleCompression::Decompress(compressed.data(), compressed.size(),
+      format, reinterpret_cast<samplePtr>(decoded.data()), decoded.size())
+         == samples.size());
+   REQUIRE(decoded == samples);
+
+   // A prefix decodes alone
+   const auto prefix = samples.size() / 3;
+   std::vector<T> partial(prefix);
+   REQUIRE(SampleCompression::Decompress(compressed.data(), compressed.size(),
+      format, reinterpret_cast<samplePtr>(partial.data()), prefix) == prefix);
+   REQUIRE(std::equal(partial.begin(), partial.end(), samples.begin()));
+}
+}
+
+TEST_CASE("SampleCompression round trips", "[SampleCompression]")
+{
+   const auto signal = MakeSignal(262144 + 17, 300);
+
+   SECTION("int16")
+   {
+      std::vector<short> samples(signal.size());
+      for (size_t i = 0; i < signal.size(); ++i)
+         samples[i] = static_cast<short>(signal[i] / 256);
+      TestRoundTrip(samples, int16Sample);
+   }
+
+   SECTION("int24")
+   {
+      TestRoundTrip(signal, int24Sample);
+   }
+
+   SECTION("float from 24 bit integers")
+   {
+      std::vector<float> samples(signal.size());
+      for (size_t i = 0; i < signal.size(); ++i)
+         samples[i] = signal[i] / 8388608.0f;
+      TestRoundTrip(samples, floatSample);
+   }
+}
+
+TEST_CASE("SampleCompression declines", "[SampleCompression]")
+{
+   SECTION("floats that are not scaled integers")
+   {
+      std::vector<float> samples{ 0.1f, 0.2f, 0.3f, 0.4f, 0.5f };
+      REQUIRE(SampleCompression::Compress(
+         reinterpret_cast<constSamplePtr>(samples.data()),
+         floatSample, samples.size()).empty());
+   }
+
+   SECTION("white noise")
+   {
+      std::mt19937 generator{ 7 };
+      std::vector<short> samples(65536);
+      for (auto &sample : samples)
+         sample = static_cast<short>(generator());
+      REQUIRE(SampleCompression::Compress(
+         reinterpret_cast<constSamplePtr>(samples.data()),
+         int16Sample, samples.size()).empty());
+   }
+}
+
+TEST_CASE("SampleCompression rejects malformed data", "[SampleCompression]")
+{
+   const auto signal = MakeSignal(10000, 1000);
+   const auto compressed = SampleCompression::Compress(
+      reinterpret_cast<constSamplePtr>(signal.data()),
+      int24Sample, signal.size());
+   REQUIRE(!compressed.empty());
+
+   std::vector<int> decoded(signal.size());
+   const auto dest = reinterpret_cast<samplePtr>(decoded.data());
+
+   // Wrong format
+   REQUIRE(SampleCompression::Decompress(compressed.data(), compressed.size(),
+      floatSample, dest, decoded.size()) == 0);
+
+   // Truncated
+   REQUIRE(SampleCompression::Decompress(compressed.data(),
+      compressed.size() / 2, int24Sample, dest, decoded.size()) <
+         decoded.size());
+}
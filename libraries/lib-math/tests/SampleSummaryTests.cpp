@@ -0,0 +1,104 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file SampleSummaryTests.cpp
+ @brief Tests and a benchmark of the kernels summarizing samples
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "SampleSummary.h"
+
+using namespace SampleSummary;
+
+namespace
+{
+std::vector<float> MakeNoise(size_t len)
+{
+   std::mt19937 generator{ 7 };
+   std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+   std::vector<float> result(len);
+   for (auto &sample : result)
+      sample = distribution(generator);
+   return result;
+}
+
+std::vector<float> Summarize(const std::vector<float> &samples, Kernel kernel)
+{
+   std::vector<float> result(
+      3 * ((samples.size() + FrameSize - 1) / FrameSize));
+   Summarize256(samples.data(), samples.size(), result.data(), kernel);
+   return result;
+}
+
+const Kernel kernels[]{ Kernel::Scalar, Kernel::SSE2, Kernel::AVX2 };
+}
+
+TEST_CASE("Summarize256", "[SampleSummary]")
+{
+   // Full frames, a short last frame, and frames shorter than one vector
+   for (const size_t len : { 4096, 1000, 258, 7, 1 }) {
+      const auto samples = MakeNoise(len);
+      const auto expected = Summarize(samples, Kernel::Scalar);
+
+      for (const auto kernel : kernels) {
+         if (!IsSupported(kernel))
+            continue;
+         const auto actual = Summarize(samples, kernel);
+         REQUIRE(actual.size() == expected.size());
+         for (size_t ii = 0; ii < actual.size(); ii += 3) {
+            // Extremes are exact; sums may round differently
+            REQUIRE(actual[ii] == expected[ii]);
+            REQUIRE(actual[ii + 1] == expected[ii + 1]);
+            REQUIRE(actual[ii + 2] == Approx(expected[ii + 2]).epsilon(1e-5));
+         }
+      }
+   }
+}
+
+TEST_CASE("Summarize256 finds extremes anywhere", "[SampleSummary]")
+{
+   std::vector<float> samples(FrameSize, 0.25f);
+   for (const auto kernel : kernels) {
+      if (!IsSupported(kernel))
+         continue;
+      for (size_t position : { size_t(0), size_t(5), FrameSize - 1 }) {
+         samples[position] = -2.0f;
+         samples[(position + 7) % FrameSize] = 3.0f;
+         const auto result = Summarize(samples, kernel);
+         REQUIRE(result[0] == -2.0f);
+         REQUIRE(result[1] == 3.0f);
+         samples[position] = samples[(position + 7) % FrameSize] = 0.25f;
+      }
+   }
+}
+
+// Hidden from the default run; run the test executable with [benchmark]
+TEST_CASE("Summarize256 throughput", "[.][benchmark]")
+{
+   constexpr size_t BlockSize = 1 << 20;
+   constexpr int Repetitions = 100;
+   const auto samples = MakeNoise(BlockSize);
+   std::vector<float> summary(3 * BlockSize / FrameSize);
+   const char *const names[]{ "scalar", "SSE2", "AVX2" };
+
+   for (const auto kernel : kernels) {
+      if (!IsSupported(kernel))
+         continue;
+      using namespace std::chrono;
+      const auto start = steady_clock::now();
+      for (int ii = 0; ii < Repetitions; ++ii)
+         Summarize256(samples.data(), BlockSize, summary.data(), kernel);
+      const duration<double> elapsed = steady_clock::now() - start;
+      printf("%-6s %8.1f Msamples/s on 1M sample blocks\n",
+         names[static_cast<int>(kernel)],
+         Repetitions * BlockSize / elapsed.count() / 1e6);
+   }
+}
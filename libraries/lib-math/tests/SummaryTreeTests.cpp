@@ -0,0 +1,167 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file SummaryTreeTests.cpp
+ @brief Tests of SummaryTree against a vector of the same leaves
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <vector>
+
+#include "SummaryTree.h"
+
+namespace
+{
+using Tree = SummaryTree<int>;
+
+Tree::Leaf MakeLeaf(std::mt19937 &generator, int item)
+{
+   std::uniform_real_distribution<float> distribution{ -1.0f, 1.0f };
+   std::uniform_int_distribution<int> lengths{ 1, 100 };
+   auto a = distribution(generator), b = distribution(generator);
+   return { item, lengths(generator),
+      { std::min(a, b), std::max(a, b), double(a * a + b * b) } };
+}
+
+Tree MakeTree(const std::vector<Tree::Leaf> &leaves)
+{
+   Tree result;
+   for (const auto &leaf : leaves)
+      result.PushBack(leaf);
+   return result;
+}
+
+void RequireSame(const RangeSummary &actual, const RangeSummary &expected)
+{
+   REQUIRE(actual.min == expected.min);
+   REQUIRE(actual.max == expected.max);
+   REQUIRE(actual.sumsq == Approx(expected.sumsq));
+}
+
+void RequireContents(const Tree &tree, const std::vector<Tree::Leaf> &leaves)
+{
+   REQUIRE(tree.size() == leaves.size());
+   REQUIRE(tree.empty() == leaves.empty());
+
+   sampleCount start = 0;
+   auto iter = tree.begin();
+   for (size_t ii = 0; ii < leaves.size(); ++ii, ++iter) {
+      REQUIRE(iter != tree.end());
+      REQUIRE(iter->item == leaves[ii].item);
+      REQUIRE(iter.Start() == start);
+
+      auto at = tree.IteratorAt(ii);
+      REQUIRE(at->item == leaves[ii].item);
+      REQUIRE(at.Start() == start);
+
+      sampleCount atStart = -1;
+      REQUIRE(&tree.At(ii, atStart) == &*at);
+      REQUIRE(atStart == start);
+
+      REQUIRE(tree.Find(start) == ii);
+      REQUIRE(tree.Find(start + leaves[ii].length - 1) == ii);
+      start += leaves[ii].length;
+   }
+   REQUIRE(iter == tree.end());
+   REQUIRE(tree.IteratorAt(leaves.size()) == tree.end());
+   REQUIRE(tree.Length() == start);
+
+   // Some ranges of every length
+   for (size_t first = 0; first <= leaves.size(); first += 1 + first / 4) {
+      RangeSummary expected;
+      for (size_t last = first; last <= leaves.size(); ++last) {
+         RequireSame(tree.Query(first, last), expected);
+         if (last < leaves.size())
+            expected.Combine(leaves[last].summary);
+      }
+   }
+}
+}
+
+TEST_CASE("SummaryTree appends", "[SummaryTree]")
+{
+   std::mt19937 generator{ 11 };
+   Tree tree;
+   std::vector<Tree::Leaf> leaves;
+   RequireContents(tree, leaves);
+
+   for (int ii = 0; ii < 70; ++ii) {
+      leaves.push_back(MakeLeaf(generator, ii));
+      tree.PushBack(leaves.back());
+      RequireContents(tree, leaves);
+   }
+}
+
+TEST_CASE("SummaryTree splices", "[SummaryTree]")
+{
+   std::mt19937 generator{ 13 };
+   int item = 0;
+   std::vector<Tree::Leaf> leaves;
+   for (; item < 200; ++item)
+      leaves.push_back(MakeLeaf(generator, item));
+   auto tree = MakeTree(leaves);
+
+   for (int ii = 0; ii < 200; ++ii) {
+      std::uniform_int_distribution<size_t> positions{ 0, leaves.size() };
+      auto first = positions(generator), last = positions(generator);
+      if (first > last)
+         std::swap(first, last);
+      std::vector<Tree::Leaf> inserted;
+      for (size_t nn = std::uniform_int_distribution<size_t>{ 0, 5 }(generator);
+           nn--;)
+         inserted.push_back(MakeLeaf(generator, item++));
+
+      // Splicing leaves the original copy unchanged
+      const auto copy = tree;
+      const auto original = leaves;
+      tree.Splice(first, last, MakeTree(inserted));
+      leaves.erase(leaves.begin() + first, leaves.begin() + last);
+      leaves.insert(leaves.begin() + first, inserted.begin(), inserted.end());
+      RequireContents(tree, leaves);
+      RequireContents(copy, original);
+   }
+}
+
+TEST_CASE("SummaryTree slices and appends", "[SummaryTree]")
+{
+   std::mt19937 generator{ 17 };
+   std::vector<Tree::Leaf> leaves;
+   for (int item = 0; item < 100; ++item)
+      leaves.push_back(MakeLeaf(generator, item));
+   const auto tree = MakeTree(leaves);
+
+   for (size_t first = 0; first <= leaves.size(); first += 7)
+      for (size_t last = first; last <= leaves.size(); last += 11) {
+         auto head = tree.Slice(0, first);
+         auto middle = tree.Slice(first, last);
+         RequireContents(middle, { leaves.begin() + first,
+            leaves.begin() + last });
+         head.Append(middle);
+         head.Append(tree.Slice(last, leaves.size()));
+         RequireContents(head, leaves);
+      }
+}
+
+TEST_CASE("SummaryTree iterates a deep tree", "[SummaryTree]")
+{
+   // Iterators keep their paths in fixed space
+   Tree tree;
+   const int count = 100000;
+   for (int ii = 0; ii < count; ++ii)
+      tree.PushBack({ ii, 1, {} });
+
+   int expected = 0;
+   for (auto iter = tree.begin(), end = tree.end(); iter != end; ++iter) {
+      REQUIRE(iter->item == expected);
+      REQUIRE(iter.Start() == expected);
+      ++expected;
+   }
+   REQUIRE(expected == count);
+   sampleCount start;
+   REQUIRE(tree.At(count - 1, start).item == count - 1);
+   REQUIRE(start == count - 1);
+}
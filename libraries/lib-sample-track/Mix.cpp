@@ -26,6 +26,7 @@
 #include <cmath>
 
 #include "Envelope.h"
+#include "MixKernels.h"
 #include "SampleTrack.h"
 #include "SampleTrackCache.h"
 #include "Prefs.h"
@@ -61,6 +62,18 @@ Mixer::WarpOptions::WarpOptions(double min, double max, double initial)
    }
 }
 
+namespace {
+//! Whether track is another channel of the same track as prev, at the same
+//! rate, so that they may be resampled together
+bool SameGroup(const SampleTrack &prev, const SampleTrack &track)
+{
+   const auto pOwner = track.GetOwner();
+   return pOwner && pOwner == prev.GetOwner() && !track.IsLeader() &&
+      *pOwner->FindLeader(&track) == *pOwner->FindLeader(&prev) &&
+      track.GetRate() == prev.GetRate();
+}
+}
+
 Mixer::Mixer(const SampleTrackConstArray &inputTracks,
              bool mayThrow,
              const WarpOptions &warpOptions,
@@ -95,7 +108,14 @@ Mixer::Mixer(const SampleTrackConstArray &inputTracks,
    for(size_t i=0; i<mNumInputTracks; i++) {
       mInputTrack[i].SetTrack(inputTracks[i]);
       mSamplePos[i] = inputTracks[i]->TimeToLongSamples(startTime);
+      if (i > 0 && SameGroup(*inputTracks[i - 1], *inputTracks[i]))
+         ++mGroups.back().second;
+      else
+         mGroups.emplace_back(i, 1);
    }
+   size_t maxGroupChannels = 1;
+   for (auto &group : mGroups)
+      maxGroupChannels = std::max(maxGroupChannels, group.second);
    mEnvelope = warpOptions.envelope;
    mT0 = startTime;
    mT1 = stopTime;
@@ -125,7 +145,9 @@ Mixer::Mixer(const SampleTrackConstArray &inputTracks,
       mTemp[c].reinit(mInterleavedBufferSize);
    }
    // PRL:  Bug2536: see other comments below
-   mFloatBuffer = Floats{ mInterleavedBufferSize + 1 };
+   mFloatBuffer = FloatBuffers{ maxGroupChannels, mInterleavedBufferSize + 1 };
+   mResampleIn.resize(maxGroupChannels);
+   mResampleOut.resize(maxGroupChannels);
 
    // But cut the queue into blocks of this finer size
    // for variable rate resampling.  Each block is resampled at some
@@ -137,7 +159,7 @@ Mixer::Mixer(const SampleTrackConstArray &inputTracks,
 
    // For each queue, the number of available samples after the queue start.
    mQueueLen.reinit(mNumInputTracks);
-   mResample.reinit(mNumInputTracks);
+   mResample.reinit(mGroups.size());
    mMinFactor.resize(mNumInputTracks);
    mMaxFactor.resize(mNumInputTracks);
    for (size_t i = 0; i<mNumInputTracks; i++) {
@@ -176,8 +198,12 @@ Mixer::~Mixer()
 
 void Mixer::MakeResamplers()
 {
-   for (size_t i = 0; i < mNumInputTracks; i++)
-      mResample[i] = std::make_unique<Resample>(mHighQuality, mMinFactor[i], mMaxFactor[i]);
+   // Tracks of a group have the same rate and so the same factors
+   for (size_t i = 0; i < mGroups.size(); i++) {
+      const auto first = mGroups[i].first;
+      mResample[i] = std::make_unique<Resample>(mHighQuality,
+         mMinFactor[first], mMaxFactor[first], mGroups[i].second);
+   }
 }
 
 void Mixer::Clear()
@@ -187,7 +213,7 @@ void Mixer::Clear()
    }
 }
 
-static void MixBuffers(unsigned numChannels, int *channelFlags, float *gains,
+static void MixBuffers(unsigned numChannels, const int *channelFlags, float *gains,
                 const float *src, Floats *dests,
                 int len, bool interleaved)
 {
@@ -195,22 +221,11 @@ static void MixBuffers(unsigned numChannels, int *channelFlags, float *gains,
       if (!channelFlags[c])
          continue;
 
-      float *dest;
-      unsigned skip;
-
-      if (interleaved) {
-         dest = dests[0].get() + c;
-         skip = numChannels;
-      } else {
-         dest = dests[c].get();
-         skip = 1;
-      }
-
-      float gain = gains[c];
-      for (int j = 0; j < len; j++) {
-         *dest += src[j] * gain;   // the actual mixing process
-         dest += skip;
-      }
+      if (interleaved)
+         MixKernels::Accumulate(
+            dests[0].get() + c, numChannels, src, len, gains[c]);
+      else
+         MixKernels::Accumulate(dests[c].get(), 1, src, len, gains[c]);
    }
 }
 
@@ -234,12 +249,18 @@ double ComputeWarpFactor(const Envelope &env, double t0, double t1)
 
 }
 
-size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
-                                    sampleCount *pos, float *queue,
-                                    int *queueStart, int *queueLen,
-                                    Resample * pResample)
+size_t Mixer::MixVariableRates(size_t iGroup, const int *channelFlags)
 {
-   const auto track = cache.GetTrack().get();
+   const auto first = mGroups[iGroup].first;
+   const auto nChannels = mGroups[iGroup].second;
+   // The channels of the group share one position and queue layout, kept
+   // in the entries for the first, and copied to the others at the end
+   auto &pos = mSamplePos[first];
+   auto &queueStart = mQueueStart[first];
+   auto &queueLen = mQueueLen[first];
+   const auto pResample = mResample[iGroup].get();
+
+   const auto track = mInputTrack[first].GetTrack().get();
    const double trackRate = track->GetRate();
    const double initialWarp = mRate / mSpeed / trackRate;
    const double tstep = 1.0 / trackRate;
@@ -258,74 +279,74 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
     *       to calculate the position.
     */
 
-   // Find the last sample
+   // Find the last sample of any channel; the others are read as silence
+   // past their ends
    double endTime = track->GetEndTime();
    double startTime = track->GetStartTime();
+   for (size_t c = 1; c < nChannels; ++c) {
+      const auto other = mInputTrack[first + c].GetTrack().get();
+      endTime = std::max(endTime, other->GetEndTime());
+      startTime = std::min(startTime, other->GetStartTime());
+   }
    const bool backwards = (mT1 < mT0);
    const double tEnd = backwards
       ? std::max(startTime, mT1)
       : std::min(endTime, mT1);
    const auto endPos = track->TimeToLongSamples(tEnd);
    // Find the time corresponding to the start of the queue, for use with time track
-   double t = ((*pos).as_long_long() +
-               (backwards ? *queueLen : - *queueLen)) / trackRate;
+   double t = (pos.as_long_long() +
+               (backwards ? queueLen : - queueLen)) / trackRate;
 
    while (out < mMaxOut) {
-      if (*queueLen < (int)mProcessLen) {
+      if (queueLen < (int)mProcessLen) {
          // Shift pending portion to start of the buffer
-         memmove(queue, &queue[*queueStart], (*queueLen) * sampleSize);
-         *queueStart = 0;
+         for (size_t c = 0; c < nChannels; ++c) {
+            const auto queue = mSampleQueue[first + c].get();
+            memmove(queue, &queue[queueStart], queueLen * sampleSize);
+         }
+         queueStart = 0;
 
          auto getLen = limitSampleBufferSize(
-            mQueueMaxLen - *queueLen,
-            backwards ? *pos - endPos : endPos - *pos
+            mQueueMaxLen - queueLen,
+            backwards ? pos - endPos : endPos - pos
          );
 
          // Nothing to do if past end of play interval
          if (getLen > 0) {
-            if (backwards) {
-               auto results =
-                  cache.GetFloats(*pos - (getLen - 1), getLen, mMayThrow);
-               if (results)
-                  memcpy(&queue[*queueLen], results, sizeof(float) * getLen);
-               else
-                  memset(&queue[*queueLen], 0, sizeof(float) * getLen);
-
-               track->GetEnvelopeValues(mEnvValues.get(),
-                                        getLen,
-                                        (*pos - (getLen- 1)).as_double() / trackRate);
-               *pos -= getLen;
-            }
-            else {
-               auto results = cache.GetFloats(*pos, getLen, mMayThrow);
+            const auto start = backwards ? pos - (getLen - 1) : pos;
+            for (size_t c = 0; c < nChannels; ++c) {
+               auto &cache = mInputTrack[first + c];
+               const auto queue = mSampleQueue[first + c].get();
+               auto results = cache.GetFloats(start, getLen, mMayThrow);
                if (results)
-                  memcpy(&queue[*queueLen], results, sizeof(float) * getLen);
+                  memcpy(&queue[queueLen], results, sizeof(float) * getLen);
                else
-                  memset(&queue[*queueLen], 0, sizeof(float) * getLen);
+                  memset(&queue[queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               cache.GetTrack()->GetEnvelopeValues(mEnvValues.get(),
                                         getLen,
-                                        (*pos).as_double() / trackRate);
+                                        start.as_double() / trackRate);
 
-               *pos += getLen;
-            }
+               MixKernels::Multiply(
+                  &queue[queueLen], mEnvValues.get(), getLen);
 
-            for (decltype(getLen) i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
+               if (backwards)
+                  ReverseSamples((samplePtr)&queue[0], floatSample,
+                                 queueLen, getLen);
             }
 
             if (backwards)
-               ReverseSamples((samplePtr)&queue[0], floatSample,
-                              *queueLen, getLen);
-
-            *queueLen += getLen;
+               pos -= getLen;
+            else
+               pos += getLen;
+            queueLen += getLen;
          }
       }
 
       auto thisProcessLen = mProcessLen;
-      bool last = (*queueLen < (int)mProcessLen);
+      bool last = (queueLen < (int)mProcessLen);
       if (last) {
-         thisProcessLen = *queueLen;
+         thisProcessLen = queueLen;
       }
 
       double factor = initialWarp;
@@ -344,10 +365,8 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
                t, t + (double)thisProcessLen / trackRate);
       }
 
-      auto results = pResample->Process(factor,
-         &queue[*queueStart],
-         thisProcessLen,
-         last,
+      for (size_t c = 0; c < nChannels; ++c) {
+         mResampleIn[c] = &mSampleQueue[first + c][queueStart];
          // PRL:  Bug2536: crash in soxr happened on Mac, sometimes, when
          // mMaxOut - out == 1 and &mFloatBuffer[out + 1] was an unmapped
          // address, because soxr, strangely, fetched an 8-byte (misaligned!)
@@ -355,12 +374,18 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
          // in soxr_output_no_callback.
          // Now we make the bug go away by allocating a little more space in
          // the buffer than we need.
-         &mFloatBuffer[out],
+         mResampleOut[c] = &mFloatBuffer[c][out];
+      }
+      auto results = pResample->Process(factor,
+         mResampleIn.data(),
+         thisProcessLen,
+         last,
+         mResampleOut.data(),
          mMaxOut - out);
 
       const auto input_used = results.first;
-      *queueStart += input_used;
-      *queueLen -= input_used;
+      queueStart += input_used;
+      queueLen -= input_used;
       out += results.second;
       t += (input_used / trackRate) * (backwards ? -1 : 1);
 
@@ -369,22 +394,31 @@ size_t Mixer::MixVariableRates(int *channelFlags, SampleTrackCache &cache,
       }
    }
 
-   for (size_t c = 0; c < mNumChannels; c++) {
-      if (mApplyTrackGains) {
-         mGains[c] = track->GetChannelGain(c);
-      }
-      else {
-         mGains[c] = 1.0;
-      }
+   for (size_t c = 1; c < nChannels; ++c) {
+      mSamplePos[first + c] = pos;
+      mQueueStart[first + c] = queueStart;
+      mQueueLen[first + c] = queueLen;
    }
 
-   MixBuffers(mNumChannels,
-              channelFlags,
-              mGains.get(),
-              mFloatBuffer.get(),
-              mTemp.get(),
-              out,
-              mInterleaved);
+   for (size_t c = 0; c < nChannels; ++c) {
+      const auto channel = mInputTrack[first + c].GetTrack().get();
+      for (size_t j = 0; j < mNumChannels; j++) {
+         if (mApplyTrackGains) {
+            mGains[j] = channel->GetChannelGain(j);
+         }
+         else {
+            mGains[j] = 1.0;
+         }
+      }
+
+      MixBuffers(mNumChannels,
+                 channelFlags + c * mNumChannels,
+                 mGains.get(),
+                 mFloatBuffer[c].get(),
+                 mTemp.get(),
+                 out,
+                 mInterleaved);
+   }
 
    return out;
 }
@@ -416,25 +450,25 @@ size_t Mixer::MixSameRate(int *channelFlags, SampleTrackCache &cache,
    if (backwards) {
       auto results = cache.GetFloats(*pos - (slen - 1), slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(mFloatBuffer[0].get(), results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
+         memset(mFloatBuffer[0].get(), 0, sizeof(float) * slen);
       track->GetEnvelopeValues(mEnvValues.get(), slen, t - (slen - 1) / mRate);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
-      ReverseSamples((samplePtr)mFloatBuffer.get(), floatSample, 0, slen);
+      // Track gain control will go here?
+      MixKernels::Multiply(mFloatBuffer[0].get(), mEnvValues.get(), slen);
+      ReverseSamples((samplePtr)mFloatBuffer[0].get(), floatSample, 0, slen);
 
       *pos -= slen;
    }
    else {
       auto results = cache.GetFloats(*pos, slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(mFloatBuffer[0].get(), results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
+         memset(mFloatBuffer[0].get(), 0, sizeof(float) * slen);
       track->GetEnvelopeValues(mEnvValues.get(), slen, t);
-      for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+      // Track gain control will go here?
+      MixKernels::Multiply(mFloatBuffer[0].get(), mEnvValues.get(), slen);
 
       *pos += slen;
    }
@@ -446,11 +480,42 @@ size_t Mixer::MixSameRate(int *channelFlags, SampleTrackCache &cache,
          mGains[c] = 1.0;
 
    MixBuffers(mNumChannels, channelFlags, mGains.get(),
-              mFloatBuffer.get(), mTemp.get(), slen, mInterleaved);
+              mFloatBuffer[0].get(), mTemp.get(), slen, mInterleaved);
 
    return slen;
 }
 
+void Mixer::FindChannelFlags(size_t iTrack, int *channelFlags)
+{
+   const auto track = mInputTrack[iTrack].GetTrack().get();
+   for(size_t j=0; j<mNumChannels; j++)
+      channelFlags[j] = 0;
+
+   if( mMixerSpec ) {
+      //ignore left and right when downmixing is not required
+      for(size_t j = 0; j < mNumChannels; j++ )
+         channelFlags[ j ] = mMixerSpec->mMap[ iTrack ][ j ] ? 1 : 0;
+   }
+   else {
+      switch(track->GetChannel()) {
+      case Track::MonoChannel:
+      default:
+         for(size_t j=0; j<mNumChannels; j++)
+            channelFlags[j] = 1;
+         break;
+      case Track::LeftChannel:
+         channelFlags[0] = 1;
+         break;
+      case Track::RightChannel:
+         if (mNumChannels >= 2)
+            channelFlags[1] = 1;
+         else
+            channelFlags[0] = 1;
+         break;
+      }
+   }
+}
+
 size_t Mixer::Process(size_t maxToProcess)
 {
    // MB: this is wrong! mT represented warped time, and mTime is too inaccurate to use
@@ -459,55 +524,37 @@ size_t Mixer::Process(size_t maxToProcess)
    //   return 0;
 
    decltype(Process(0)) maxOut = 0;
-   ArrayOf<int> channelFlags{ mNumChannels };
+   ArrayOf<int> channelFlags{ mNumInputTracks * mNumChannels };
 
    mMaxOut = maxToProcess;
 
    Clear();
-   for(size_t i=0; i<mNumInputTracks; i++) {
-      const auto track = mInputTrack[i].GetTrack().get();
-      for(size_t j=0; j<mNumChannels; j++)
-         channelFlags[j] = 0;
-
-      if( mMixerSpec ) {
-         //ignore left and right when downmixing is not required
-         for(size_t j = 0; j < mNumChannels; j++ )
-            channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
-      }
-      else {
-         switch(track->GetChannel()) {
-         case Track::MonoChannel:
-         default:
-            for(size_t j=0; j<mNumChannels; j++)
-               channelFlags[j] = 1;
-            break;
-         case Track::LeftChannel:
-            channelFlags[0] = 1;
-            break;
-         case Track::RightChannel:
-            if (mNumChannels >= 2)
-               channelFlags[1] = 1;
-            else
-               channelFlags[0] = 1;
-            break;
-         }
-      }
-      if (mbVariableRates || track->GetRate() != mRate)
-         maxOut = std::max(maxOut,
-            MixVariableRates(channelFlags.get(), mInputTrack[i],
-               &mSamplePos[i], mSampleQueue[i].get(),
-               &mQueueStart[i], &mQueueLen[i], mResample[i].get()));
-      else
+   for (size_t g = 0; g < mGroups.size(); g++) {
+      const auto first = mGroups[g].first;
+      const auto nChannels = mGroups[g].second;
+      for (size_t i = first; i < first + nChannels; i++)
+         FindChannelFlags(i, &channelFlags[(i - first) * mNumChannels]);
+
+      if (mbVariableRates ||
+          mInputTrack[first].GetTrack()->GetRate() != mRate)
          maxOut = std::max(maxOut,
-            MixSameRate(channelFlags.get(), mInputTrack[i], &mSamplePos[i]));
-
-      double t = mSamplePos[i].as_double() / (double)track->GetRate();
-      if (mT0 > mT1)
-         // backwards (as possibly in scrubbing)
-         mTime = std::max(std::min(t, mTime), mT1);
+            MixVariableRates(g, channelFlags.get()));
       else
-         // forwards (the usual)
-         mTime = std::min(std::max(t, mTime), mT1);
+         for (size_t i = first; i < first + nChannels; i++)
+            maxOut = std::max(maxOut,
+               MixSameRate(&channelFlags[(i - first) * mNumChannels],
+                  mInputTrack[i], &mSamplePos[i]));
+
+      for (size_t i = first; i < first + nChannels; i++) {
+         const auto track = mInputTrack[i].GetTrack().get();
+         double t = mSamplePos[i].as_double() / (double)track->GetRate();
+         if (mT0 > mT1)
+            // backwards (as possibly in scrubbing)
+            mTime = std::max(std::min(t, mTime), mT1);
+         else
+            // forwards (the usual)
+            mTime = std::min(std::max(t, mTime), mT1);
+      }
    }
    if(mInterleaved) {
       for(size_t c=0; c<mNumChannels; c++) {
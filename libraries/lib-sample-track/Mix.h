@@ -133,13 +133,13 @@ class SAMPLE_TRACK_API Mixer {
  private:
 
    void Clear();
+   void FindChannelFlags(size_t iTrack, int *channelFlags);
    size_t MixSameRate(int *channelFlags, SampleTrackCache &cache,
                            sampleCount *pos);
 
-   size_t MixVariableRates(int *channelFlags, SampleTrackCache &cache,
-                                sampleCount *pos, float *queue,
-                                int *queueStart, int *queueLen,
-                                Resample * pResample);
+   //! Resample the input tracks of one group together
+   /*! @param channelFlags mNumChannels flags for each track of the group */
+   size_t MixVariableRates(size_t iGroup, const int *channelFlags);
 
    void MakeResamplers();
 
@@ -156,6 +156,10 @@ class SAMPLE_TRACK_API Mixer {
    double           mT0; // Start time
    double           mT1; // Stop time (none if mT0==mT1)
    double           mTime;  // Current time (renamed from mT to mTime for consistency with AudioIO - mT represented warped time there)
+   //! Consecutive input tracks that are the channels of one track, at one
+   //! rate:  index of the first, and number of channels
+   std::vector<std::pair<size_t, size_t>> mGroups;
+   //! One for each group
    ArrayOf<std::unique_ptr<Resample>> mResample;
    const size_t     mQueueMaxLen;
    FloatBuffers     mSampleQueue;
@@ -175,7 +179,11 @@ class SAMPLE_TRACK_API Mixer {
    bool             mInterleaved;
    ArrayOf<SampleBuffer> mBuffer;
    ArrayOf<Floats>  mTemp;
-   Floats           mFloatBuffer;
+   //! Enough for the group of most channels
+   FloatBuffers     mFloatBuffer;
+   //! Scratch space for the arguments of Resample::Process()
+   std::vector<const float *> mResampleIn;
+   std::vector<float *> mResampleOut;
    const double     mRate;
    double           mSpeed;
    bool             mHighQuality;
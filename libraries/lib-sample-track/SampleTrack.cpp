@@ -32,6 +32,10 @@ auto SampleTrack::GetTypeInfo() const -> const TypeInfo &
    return typeInfo();
 }
 
+void SampleTrack::Prefetch(sampleCount, sampleCount) const
+{
+}
+
 sampleCount SampleTrack::TimeToLongSamples(double t0) const
 {
    return sampleCount( floor(t0 * GetRate() + 0.5) );
@@ -85,6 +85,10 @@ public:
       // contiguous range.
       sampleCount * pNumWithinClips = nullptr) const = 0;
 
+   //! Hint that samples in the range will soon be retrieved, in order
+   /*! Non-throwing; the default does nothing */
+   virtual void Prefetch(sampleCount start, sampleCount len) const;
+
    /** @brief Convert correctly between an (absolute) time in seconds and a number of samples.
     *
     * This method will not give the correct results if used on a relative time (difference of two
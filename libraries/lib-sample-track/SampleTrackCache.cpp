@@ -31,6 +31,20 @@ void SampleTrackCache::SetTrack(const std::shared_ptr<const SampleTrack> &pTrack
          Free();
       mPTrack = pTrack;
       mNValidBuffers = 0;
+      mReadAheadStart = mReadAheadEnd = 0;
+      mLastFill = -1;
+   }
+}
+
+void SampleTrackCache::ReadAhead(sampleCount start)
+{
+   // Not when moving backward, as in scrubbing
+   const bool forward = start > mLastFill;
+   mLastFill = start;
+   if (forward && (start < mReadAheadStart || start >= mReadAheadEnd)) {
+      mReadAheadStart = start;
+      mReadAheadEnd = start + ReadAheadBuffers * mBufferSize;
+      mPTrack->Prefetch(start, mReadAheadEnd - start);
    }
 }
 
@@ -86,6 +100,7 @@ const float *SampleTrackCache::GetFloats(
          if (start0 >= 0) {
             const auto len0 = mPTrack->GetBestBlockSize(start0);
             wxASSERT(len0 <= mBufferSize);
+            ReadAhead(start0);
             if (!mPTrack->GetFloats(
                   mBuffers[0].data.get(), start0, len0,
                   fillZero, mayThrow))
@@ -114,6 +129,7 @@ const float *SampleTrackCache::GetFloats(
             if (start1 == end0) {
                const auto len1 = mPTrack->GetBestBlockSize(start1);
                wxASSERT(len1 <= mBufferSize);
+               ReadAhead(start1);
                if (!mPTrack->GetFloats(mBuffers[1].data.get(), start1, len1, fillZero, mayThrow))
                   return nullptr;
                mBuffers[1].start = start1;
@@ -220,4 +236,6 @@ void SampleTrackCache::Free()
    mBuffers[1].Free();
    mOverlapBuffer.Free();
    mNValidBuffers = 0;
+   mReadAheadStart = mReadAheadEnd = 0;
+   mLastFill = -1;
 }
@@ -50,6 +50,12 @@ public:
 
 private:
    void Free();
+   //! Before filling a buffer from start:  if moving forward past what was
+   //! read ahead, read ahead again
+   void ReadAhead(sampleCount start);
+
+   //! How many buffers' worth to read ahead at once
+   static constexpr int ReadAheadBuffers = 16;
 
    struct Buffer {
       Floats data;
@@ -73,6 +79,10 @@ private:
    Buffer mBuffers[2];
    GrowableSampleBuffer mOverlapBuffer;
    int mNValidBuffers;
+   //! Range last passed to SampleTrack::Prefetch()
+   sampleCount mReadAheadStart{ 0 }, mReadAheadEnd{ 0 };
+   //! Start of the last buffer filled; negative when none
+   sampleCount mLastFill{ -1 };
 };
 
 #endif
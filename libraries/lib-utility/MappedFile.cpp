@@ -0,0 +1,96 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file MappedFile.cpp
+
+ **********************************************************************/
+
+#include "MappedFile.h"
+
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path)
+{
+   const auto length = MultiByteToWideChar(
+      CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+   if (length <= 0)
+      return;
+   std::wstring widePath(length, L'\0');
+   MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], length);
+
+   const auto file = CreateFileW(widePath.c_str(), GENERIC_READ,
+      FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+   if (file == INVALID_HANDLE_VALUE)
+      return;
+   LARGE_INTEGER size;
+   if (GetFileSizeEx(file, &size) && size.QuadPart > 0 &&
+       static_cast<unsigned long long>(size.QuadPart) <= SIZE_MAX) {
+      // The mapping keeps the file open
+      mMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0,
+         nullptr);
+      if (mMapping) {
+         mData = static_cast<const char *>(
+            MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+         if (mData)
+            mSize = static_cast<size_t>(size.QuadPart);
+         else {
+            CloseHandle(mMapping);
+            mMapping = nullptr;
+         }
+      }
+   }
+   CloseHandle(file);
+}
+
+MappedFile::~MappedFile()
+{
+   if (mData)
+      UnmapViewOfFile(mData);
+   if (mMapping)
+      CloseHandle(mMapping);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path)
+{
+   const auto fd = open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+      return;
+   struct stat status;
+   if (fstat(fd, &status) == 0 && status.st_size > 0 &&
+       static_cast<unsigned long long>(status.st_size) <= SIZE_MAX) {
+      const auto size = static_cast<size_t>(status.st_size);
+      // The mapping keeps the file open
+      const auto address =
+         mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address != MAP_FAILED) {
+         // Ask for read-ahead
+         madvise(address, size, MADV_SEQUENTIAL);
+         mData = static_cast<const char *>(address);
+         mSize = size;
+      }
+   }
+   close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+   if (mData)
+      munmap(const_cast<char *>(mData), mSize);
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file MappedFile.h
+ @brief Read-only view of the contents of a file in memory
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_MAPPED_FILE__
+#define __AUDACITY_MAPPED_FILE__
+
+#include <cstddef>
+#include <string>
+
+//! Maps the whole of a file into memory for reading, without copying it
+/*!
+ Pages are read by the operating system as they are first touched, so
+ reading the view from start to end is like reading the file, less one copy
+ into a buffer.  The view must not be used after the file shrinks.
+ */
+class UTILITY_API MappedFile final
+{
+public:
+   //! Map the file, or leave the view empty if that fails
+   /*!
+    @param path encoded in UTF-8
+    */
+   explicit MappedFile(const std::string &path);
+   MappedFile(const MappedFile&) = delete;
+   MappedFile &operator=(const MappedFile&) = delete;
+   ~MappedFile();
+
+   //! Null if the file could not be mapped, or is empty
+   const char *Data() const { return mData; }
+   size_t Size() const { return mSize; }
+   explicit operator bool() const { return mData != nullptr; }
+
+private:
+   const char *mData{};
+   size_t mSize{};
+#ifdef _WIN32
+   void *mMapping{};
+#endif
+};
+
+#endif
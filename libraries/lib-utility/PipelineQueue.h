@@ -0,0 +1,90 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file PipelineQueue.h
+ @brief Passes blocks of work from one thread to the next
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_PIPELINE_QUEUE__
+#define __AUDACITY_PIPELINE_QUEUE__
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+//! A queue of pointers to blocks, between stages of a pipeline of threads
+/*!
+ The blocks are not owned.  A pipeline typically allocates a few, and passes
+ them around a cycle of queues, the last stage returning each one to a queue
+ of free blocks for the first, so that the number in flight is bounded.
+ */
+template<typename Block> class PipelineQueue
+{
+public:
+   void Push(Block *pBlock)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mBlocks.push_back(pBlock);
+      }
+      mCondition.notify_one();
+   }
+
+   //! No more will be pushed; Pop() returns null after the rest
+   void Close()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mClosed = true;
+      }
+      mCondition.notify_all();
+   }
+
+   //! Pop() returns null at once
+   void Abort()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mAborted = true;
+      }
+      mCondition.notify_all();
+   }
+
+   //! Null after Close() or Abort()
+   Block *Pop()
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mCondition.wait(lock, [this]{ return Ready(); });
+      return Take();
+   }
+
+   //! Like Pop(), but also null after the timeout, then setting timedOut
+   template<typename Duration>
+   Block *Pop(Duration timeout, bool &timedOut)
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      timedOut = !mCondition.wait_for(lock, timeout, [this]{ return Ready(); });
+      return timedOut ? nullptr : Take();
+   }
+
+private:
+   bool Ready() const { return mAborted || mClosed || !mBlocks.empty(); }
+   Block *Take()
+   {
+      if (mAborted || mBlocks.empty())
+         return nullptr;
+      auto pBlock = mBlocks.front();
+      mBlocks.pop_front();
+      return pBlock;
+   }
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::deque<Block *> mBlocks;
+   bool mClosed{ false };
+   bool mAborted{ false };
+};
+
+#endif
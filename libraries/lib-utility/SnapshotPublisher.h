@@ -0,0 +1,99 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file SnapshotPublisher.h
+ @brief Read-copy-update of an immutable value shared with one reader thread
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_SNAPSHOT_PUBLISHER__
+#define __AUDACITY_SNAPSHOT_PUBLISHER__
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+//! Publishes immutable snapshots from a writer thread to a reader thread
+/*!
+ The reader, such as the audio thread, never waits, allocates or frees:  it
+ only loads a pointer while it announces itself in a ReadScope.  The writer
+ makes each new snapshot, swaps it in, and then waits until the reader can
+ no longer use the old one, which it then destroys.  The wait is as long as
+ the reader's scope, such as one block of audio, at most.
+
+ Only one thread may read at a time, in one ReadScope at a time; only one
+ thread may write at a time.
+ */
+template<typename T> class SnapshotPublisher final
+{
+public:
+   SnapshotPublisher() = default;
+   SnapshotPublisher(const SnapshotPublisher&) = delete;
+   SnapshotPublisher &operator=(const SnapshotPublisher&) = delete;
+   //! There must be no reader
+   ~SnapshotPublisher() { delete mpCurrent.load(); }
+
+   //! The reader's use of one snapshot, which is not replaced under it
+   class ReadScope final
+   {
+   public:
+      explicit ReadScope(SnapshotPublisher &publisher)
+         : mPublisher{ publisher }
+      {
+         // Announce before looking, so the writer waits for this scope if
+         // it swaps after the look
+         mPublisher.mReaderGeneration.store(mPublisher.mGeneration.load());
+         mpSnapshot = mPublisher.mpCurrent.load();
+      }
+      ReadScope(const ReadScope&) = delete;
+      ReadScope &operator=(const ReadScope&) = delete;
+      ~ReadScope() { mPublisher.mReaderGeneration.store(0); }
+
+      //! May be null, if none was published
+      const T *get() const noexcept { return mpSnapshot; }
+      const T *operator->() const noexcept { return mpSnapshot; }
+      explicit operator bool() const noexcept { return mpSnapshot != nullptr; }
+
+   private:
+      SnapshotPublisher &mPublisher;
+      const T *mpSnapshot{};
+   };
+
+   //! Writer replaces the snapshot, and destroys the old when the reader
+   //! is done with it
+   void Publish(std::unique_ptr<const T> pSnapshot)
+   {
+      const std::unique_ptr<const T> pOld{
+         mpCurrent.exchange(pSnapshot.release()) };
+      Synchronize();
+   }
+
+   //! Writer waits until any ReadScope begun before now has ended
+   /*!
+    Also useful after changing other atomic state that the reader examines
+    in its scope
+    */
+   void Synchronize()
+   {
+      const auto generation = mGeneration.fetch_add(1) + 1;
+      while (true) {
+         const auto reader = mReaderGeneration.load();
+         // The reader is outside any scope, or began one after the swap
+         if (reader == 0 || reader >= generation)
+            break;
+         std::this_thread::sleep_for(std::chrono::microseconds{ 200 });
+      }
+   }
+
+private:
+   std::atomic<const T*> mpCurrent{ nullptr };
+   //! Incremented by each Synchronize(); never zero
+   std::atomic<unsigned long long> mGeneration{ 1 };
+   //! Zero when the reader is outside any ReadScope; else the generation
+   //! when it began
+   std::atomic<unsigned long long> mReaderGeneration{ 0 };
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file ThreadPool.cpp
+
+ **********************************************************************/
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+
+//! Lives on the stack of the thread calling ParallelFor
+struct ThreadPool::Job
+{
+   Job(size_t count, Invoker invoker, const void *context)
+      : count{ count }, invoker{ invoker }, context{ context }
+   {}
+
+   //! Claim and run iterations until none remain
+   void Work() noexcept
+   {
+      size_t index;
+      while ((index = next.fetch_add(1, std::memory_order_relaxed)) < count) {
+         try {
+            invoker(context, index);
+         }
+         catch (...) {
+            if (!failed.exchange(true))
+               exception = std::current_exception();
+            // Skip the rest
+            Skip();
+         }
+      }
+   }
+
+   bool Exhausted() const
+   {
+      return next.load(std::memory_order_relaxed) >= count;
+   }
+
+   //! Leave unstarted iterations undone
+   void Skip()
+   {
+      next.store(count, std::memory_order_relaxed);
+   }
+
+   const size_t count;
+   const Invoker invoker;
+   const void *const context;
+
+   std::atomic<size_t> next{ 0 };
+   std::atomic<bool> failed{ false };
+   std::exception_ptr exception;
+
+   // Guarded by the pool's mutex:
+   //! How many workers are in Work()
+   size_t users{ 0 };
+   Job *pNext{};
+   bool linked{ false };
+};
+
+size_t ThreadPool::DefaultWorkerCount()
+{
+   const size_t processors = std::thread::hardware_concurrency();
+   return std::max<size_t>(processors, 1) - 1;
+}
+
+ThreadPool::ThreadPool(size_t nWorkers)
+{
+   mWorkers.reserve(nWorkers);
+   for (size_t ii = 0; ii < nWorkers; ++ii)
+      mWorkers.emplace_back([this]{ WorkerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStopping = true;
+   }
+   mWakeWorkers.notify_all();
+   for (auto &worker : mWorkers)
+      worker.join();
+}
+
+void ThreadPool::DoParallelFor(
+   size_t count, Invoker invoker, const void *context)
+{
+   Job job{ count, invoker, context };
+   Run(job);
+
+   if (job.exception)
+      std::rethrow_exception(job.exception);
+}
+
+void ThreadPool::DoParallelForPolling(size_t count, Invoker invoker,
+   const void *context, PollInvoker pollInvoker, const void *pollContext,
+   std::chrono::milliseconds interval)
+{
+   Job job{ count, invoker, context };
+   // Another thread takes the place of this one in the job
+   auto done = std::async(std::launch::async, [&]{ Run(job); });
+   try {
+      while (done.wait_for(interval) != std::future_status::ready)
+         pollInvoker(pollContext);
+   }
+   catch (...) {
+      job.Skip();
+      done.wait();
+      throw;
+   }
+
+   if (job.exception)
+      std::rethrow_exception(job.exception);
+   pollInvoker(pollContext);
+}
+
+void ThreadPool::Run(Job &job)
+{
+   if (job.count == 0)
+      return;
+
+   // Not worth waking anyone for one iteration
+   const bool share = !mWorkers.empty() && job.count > 1;
+   if (share) {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         job.pNext = mpJobs;
+         job.linked = true;
+         mpJobs = &job;
+      }
+      mWakeWorkers.notify_all();
+   }
+
+   job.Work();
+
+   if (share) {
+      // Every iteration is claimed; wait for workers still running some
+      std::unique_lock<std::mutex> lock{ mMutex };
+      Unlink(job);
+      mJobReleased.wait(lock, [&]{ return job.users == 0; });
+   }
+}
+
+void ThreadPool::Unlink(Job &job)
+{
+   if (!job.linked)
+      return;
+   for (auto ppJob = &mpJobs; *ppJob; ppJob = &(*ppJob)->pNext)
+      if (*ppJob == &job) {
+         *ppJob = job.pNext;
+         break;
+      }
+   job.linked = false;
+}
+
+void ThreadPool::WorkerLoop()
+{
+   std::unique_lock<std::mutex> lock{ mMutex };
+   while (true) {
+      mWakeWorkers.wait(lock, [this]{ return mStopping || mpJobs; });
+      if (mStopping)
+         return;
+
+      auto &job = *mpJobs;
+      ++job.users;
+      lock.unlock();
+      job.Work();
+      lock.lock();
+
+      if (job.Exhausted())
+         Unlink(job);
+      if (--job.users == 0)
+         mJobReleased.notify_all();
+   }
+}
@@ -0,0 +1,101 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file ThreadPool.h
+ @brief Worker threads that share the iterations of loops
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_THREAD_POOL__
+#define __AUDACITY_THREAD_POOL__
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! A fixed set of worker threads that run iterations of loops concurrently
+/*!
+ The thread calling ParallelFor() works too, so a pool of n workers runs up
+ to n + 1 iterations at once.  Each free thread claims the next unstarted
+ iteration, so iterations of uneven cost balance out.
+
+ Several threads may call ParallelFor() on one pool at once.
+ */
+class UTILITY_API ThreadPool final
+{
+public:
+   //! One less than the number of processors, so that with the calling
+   //! thread each processor is busy
+   static size_t DefaultWorkerCount();
+
+   explicit ThreadPool(size_t nWorkers = DefaultWorkerCount());
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool &operator=(const ThreadPool&) = delete;
+   //! Waits for workers to finish iterations already started
+   ~ThreadPool();
+
+   size_t GetWorkerCount() const { return mWorkers.size(); }
+
+   //! Call function(i) for each i in [0, count), returning when all are done
+   /*!
+    Allocates no memory, so it may be used in the audio thread.
+    If a call throws, iterations not yet started are skipped, and the first
+    exception is rethrown after the others finish.
+    */
+   template<typename Function>
+   void ParallelFor(size_t count, const Function &function)
+   {
+      DoParallelFor(count, [](const void *context, size_t index){
+         (*static_cast<const Function*>(context))(index);
+      }, &function);
+   }
+
+   //! Like ParallelFor(), but the calling thread runs no iterations; it calls
+   //! poll() about every interval while some remain, and once after
+   /*!
+    Use it when the calling thread must stay responsive, as to update a
+    progress indicator.  If poll() throws, iterations not yet started are
+    skipped, and its exception is rethrown after the others finish.
+    */
+   template<typename Function, typename Poll>
+   void ParallelForPolling(size_t count, const Function &function,
+      const Poll &poll,
+      std::chrono::milliseconds interval = std::chrono::milliseconds{ 50 })
+   {
+      DoParallelForPolling(count, [](const void *context, size_t index){
+         (*static_cast<const Function*>(context))(index);
+      }, &function, [](const void *context){
+         (*static_cast<const Poll*>(context))();
+      }, &poll, interval);
+   }
+
+private:
+   using Invoker = void (*)(const void *context, size_t index);
+   using PollInvoker = void (*)(const void *context);
+   struct Job;
+
+   void DoParallelFor(size_t count, Invoker invoker, const void *context);
+   void DoParallelForPolling(size_t count, Invoker invoker,
+      const void *context, PollInvoker pollInvoker, const void *pollContext,
+      std::chrono::milliseconds interval);
+   //! Share the iterations of job with the workers, returning when all are
+   //! done
+   void Run(Job &job);
+   void Unlink(Job &job);
+   void WorkerLoop();
+
+   std::mutex mMutex;
+   std::condition_variable mWakeWorkers;
+   std::condition_variable mJobReleased;
+   //! Intrusive list of jobs that may have unclaimed iterations
+   Job *mpJobs{};
+   bool mStopping{ false };
+
+   std::vector<std::thread> mWorkers;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file WorkerWakeup.h
+ @brief Sleeps and wakes a worker thread, and lets others wait for it
+
+ **********************************************************************/
+
+#ifndef __AUDACITY_WORKER_WAKEUP__
+#define __AUDACITY_WORKER_WAKEUP__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+//! Lets other threads wake a worker that sleeps between passes, and wait for
+//! the worker to respond
+/*!
+ The state the threads exchange is in atomics of their own; this only sleeps
+ and wakes.  One thread is the worker; any others may wake it or wait for it.
+ */
+class WorkerWakeup
+{
+public:
+   //! Wake the worker after a change of the state it tests
+   /*! Locks briefly, so no wakeup is lost */
+   void Wake()
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         mPending.store(true, std::memory_order_release);
+      }
+      mWakeup.notify_one();
+   }
+
+   //! Wake the worker without locking, as a real-time callback must
+   /*! A wakeup might rarely be missed, if the worker is between testing and
+    blocking; then it wakes at its deadline, or at the next repeated signal
+    @param repeat notify even if a wakeup is already pending, because it
+    might have been missed */
+   void Signal(bool repeat = false)
+   {
+      // Don't make a system call for every signal while the worker has not
+      // yet responded to the last one, unless asked
+      if (!mPending.exchange(true, std::memory_order_release) || repeat)
+         mWakeup.notify_one();
+   }
+
+   //! Called by the worker; sleep until woken
+   void Sleep()
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mWakeup.wait(lock, [this]{ return Woken(); });
+   }
+
+   //! Called by the worker; sleep until woken or until the deadline
+   template<typename Clock, typename Duration>
+   void SleepUntil(const std::chrono::time_point<Clock, Duration> &deadline)
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mWakeup.wait_until(lock, deadline, [this]{ return Woken(); });
+   }
+
+   //! Called by the worker after changing the state that others wait for
+   void Respond()
+   {
+      {
+         // Empty critical section, so that a waiter can't miss the
+         // notification between testing its predicate and blocking
+         std::lock_guard<std::mutex> lock{ mMutex };
+      }
+      mResponse.notify_all();
+   }
+
+   //! Block until the worker makes pred() true
+   template<typename Pred> void WaitFor(const Pred &pred)
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mResponse.wait(lock, pred);
+   }
+
+   //! Like WaitFor(), but call poll() at once and again after each interval
+   //! that it returns, while pred() is false
+   template<typename Pred, typename Poll>
+   void WaitFor(const Pred &pred, const Poll &poll)
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      while (!pred()) {
+         lock.unlock();
+         const auto interval = poll();
+         lock.lock();
+         mResponse.wait_for(lock, interval, pred);
+      }
+   }
+
+private:
+   bool Woken()
+   {
+      return mPending.exchange(false, std::memory_order_acquire);
+   }
+
+   std::mutex mMutex;
+   //! The worker waits on this for work or for a change of state
+   std::condition_variable mWakeup;
+   //! Other threads wait on this for the worker to respond
+   std::condition_variable mResponse;
+   std::atomic<bool> mPending{ false };
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file MappedFileTests.cpp
+ @brief Tests of MappedFile, and a benchmark of reading through it
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+namespace
+{
+std::vector<char> MakeNoise(size_t len)
+{
+   std::mt19937 generator{ 7 };
+   std::uniform_int_distribution<int> distribution{ -128, 127 };
+   std::vector<char> result(len);
+   for (auto &byte : result)
+      byte = static_cast<char>(distribution(generator));
+   return result;
+}
+
+//! Writes the bytes to a file in the working directory, removed after
+struct TempFile
+{
+   explicit TempFile(const std::vector<char> &bytes)
+   {
+      if (auto file = fopen(path.c_str(), "wb")) {
+         fwrite(bytes.data(), 1, bytes.size(), file);
+         fclose(file);
+      }
+   }
+   ~TempFile() { remove(path.c_str()); }
+
+   const std::string path{ "MappedFileTests.tmp" };
+};
+}
+
+TEST_CASE("MappedFile views the contents of the file", "[MappedFile]")
+{
+   const auto bytes = MakeNoise(200000);
+   TempFile temp{ bytes };
+
+   const MappedFile file{ temp.path };
+   REQUIRE(file);
+   REQUIRE(file.Size() == bytes.size());
+   REQUIRE(memcmp(file.Data(), bytes.data(), bytes.size()) == 0);
+}
+
+TEST_CASE("MappedFile is empty for a missing or empty file", "[MappedFile]")
+{
+   TempFile temp{ {} };
+
+   const MappedFile empty{ temp.path };
+   REQUIRE(!empty);
+   REQUIRE(empty.Data() == nullptr);
+   REQUIRE(empty.Size() == 0);
+
+   const MappedFile missing{ temp.path + ".missing" };
+   REQUIRE(!missing);
+   REQUIRE(missing.Data() == nullptr);
+   REQUIRE(missing.Size() == 0);
+}
+
+// Hidden from the default run; run the test executable with [benchmark]
+TEST_CASE("MappedFile read throughput", "[.][benchmark]")
+{
+   // As much as five minutes of stereo 16 bit audio, read in pieces of the
+   // default block size
+   constexpr size_t BlockSize = 262144;
+   const auto bytes = MakeNoise(2 * 2 * 5 * 60 * 44100);
+   const double megabytes = bytes.size() / 1e6;
+   TempFile temp{ bytes };
+   std::vector<char> block(BlockSize);
+   unsigned checksum = 0;
+
+   using namespace std::chrono;
+   {
+      // Read into a staging buffer, then copy
+      const auto start = steady_clock::now();
+      auto file = fopen(temp.path.c_str(), "rb");
+      REQUIRE(file);
+      std::vector<char> buffer(BlockSize);
+      while (const auto len = fread(buffer.data(), 1, BlockSize, file)) {
+         memcpy(block.data(), buffer.data(), len);
+         checksum += block[0];
+      }
+      fclose(file);
+      const duration<double> elapsed = steady_clock::now() - start;
+      printf("fread   %8.1f MB/s\n", megabytes / elapsed.count());
+   }
+   {
+      // Copy each piece once from the mapping
+      const auto start = steady_clock::now();
+      const MappedFile file{ temp.path };
+      REQUIRE(file);
+      for (size_t pos = 0; pos < file.Size(); pos += BlockSize) {
+         const auto len = std::min(BlockSize, file.Size() - pos);
+         memcpy(block.data(), file.Data() + pos, len);
+         checksum += block[0];
+      }
+      const duration<double> elapsed = steady_clock::now() - start;
+      printf("mapped  %8.1f MB/s\n", megabytes / elapsed.count());
+   }
+   // Keep the copies from being optimized away
+   REQUIRE(checksum != 1);
+}
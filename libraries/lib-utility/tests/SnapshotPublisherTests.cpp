@@ -0,0 +1,178 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file SnapshotPublisherTests.cpp
+ @brief Tests of SnapshotPublisher, with a stress test that edits lists of
+ effects while a simulated audio callback processes them
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "SnapshotPublisher.h"
+
+namespace
+{
+//! Stands for an effect state, which knows when it is used after destruction
+struct Item
+{
+   explicit Item(std::thread::id reader) : mReader{ reader } {}
+   ~Item()
+   {
+      mAlive = false;
+      if (std::this_thread::get_id() == mReader)
+         ++freedByReader;
+   }
+
+   static std::atomic<int> freedByReader;
+
+   const std::thread::id mReader;
+   std::atomic<unsigned> mCount{ 0 };
+   // Last, where the allocator is less likely to overwrite it once freed
+   std::atomic<bool> mAlive{ true };
+};
+std::atomic<int> Item::freedByReader{ 0 };
+
+struct List
+{
+   ~List() { mAlive = false; }
+   std::vector<std::shared_ptr<Item>> mItems;
+   std::atomic<bool> mAlive{ true };
+};
+}
+
+TEST_CASE("SnapshotPublisher publishes to the reader", "[SnapshotPublisher]")
+{
+   SnapshotPublisher<int> publisher;
+   {
+      SnapshotPublisher<int>::ReadScope scope{ publisher };
+      REQUIRE(!scope);
+   }
+   publisher.Publish(std::make_unique<int>(1));
+   {
+      SnapshotPublisher<int>::ReadScope scope{ publisher };
+      REQUIRE(scope);
+      REQUIRE(*scope.get() == 1);
+   }
+   publisher.Publish(std::make_unique<int>(2));
+   SnapshotPublisher<int>::ReadScope scope{ publisher };
+   REQUIRE(*scope.get() == 2);
+}
+
+TEST_CASE("Lists are edited while the callback processes them",
+   "[SnapshotPublisher]")
+{
+   SnapshotPublisher<List> publisher;
+   std::atomic<bool> stop{ false };
+   std::atomic<int> usedAfterFree{ 0 };
+   std::atomic<unsigned> blocks{ 0 };
+
+   // The simulated audio callback
+   std::thread reader{ [&]{
+      while (!stop) {
+         SnapshotPublisher<List>::ReadScope scope{ publisher };
+         if (scope) {
+            // Like ProcessStart, Process and ProcessEnd, revisit the items,
+            // taking some time as effects would
+            for (int pass = 0; pass < 30; ++pass) {
+               if (!scope->mAlive)
+                  ++usedAfterFree;
+               for (auto &pItem : scope->mItems) {
+                  if (!pItem->mAlive)
+                     ++usedAfterFree;
+                  ++pItem->mCount;
+               }
+               std::this_thread::yield();
+            }
+         }
+         ++blocks;
+      }
+   } };
+   const auto readerId = reader.get_id();
+
+   // The main thread adds, removes and reorders items, often enough to
+   // overlap many blocks
+   Item::freedByReader = 0;
+   std::mt19937 generator{ 7 };
+   std::vector<std::shared_ptr<Item>> list;
+   while (blocks == 0)
+      std::this_thread::yield();
+   for (int edit = 0; edit < 2000; ++edit) {
+      const auto choice = generator() % 3;
+      if (choice == 0 || list.empty())
+         list.push_back(std::make_shared<Item>(readerId));
+      else if (choice == 1)
+         list.erase(list.begin() + generator() % list.size());
+      else
+         std::swap(list.front(), list.back());
+      // The snapshot shares the items; the list's copy may be the last owner
+      // of a removed item, but only after the publication
+      auto pSnapshot = std::make_unique<List>();
+      pSnapshot->mItems = list;
+      publisher.Publish(move(pSnapshot));
+      // Interleave with the callback even on one core
+      std::this_thread::yield();
+   }
+   list.clear();
+   publisher.Publish(nullptr);
+
+   stop = true;
+   reader.join();
+   REQUIRE(blocks > 0);
+   REQUIRE(usedAfterFree == 0);
+   REQUIRE(Item::freedByReader == 0);
+}
+
+TEST_CASE("Synchronize waits for blocks that did not see a suspension",
+   "[SnapshotPublisher]")
+{
+   SnapshotPublisher<int> publisher;
+   publisher.Publish(std::make_unique<int>(0));
+   std::atomic<bool> stop{ false };
+   std::atomic<bool> suspended{ false };
+   // Stands for the effects' state between Suspend() and Resume()
+   std::atomic<bool> finalized{ false };
+   std::atomic<int> processedWhileFinalized{ 0 };
+   std::atomic<unsigned> blocks{ 0 };
+
+   // Like ProcessStart, announce the use of the snapshot, then examine the
+   // flag
+   std::thread reader{ [&]{
+      while (!stop) {
+         SnapshotPublisher<int>::ReadScope scope{ publisher };
+         if (!suspended)
+            for (int pass = 0; pass < 30; ++pass) {
+               if (finalized)
+                  ++processedWhileFinalized;
+               std::this_thread::yield();
+            }
+         ++blocks;
+      }
+   } };
+
+   // Like Suspend, set the flag, then wait for the callback
+   while (blocks == 0)
+      std::this_thread::yield();
+   for (int cycle = 0; cycle < 500; ++cycle) {
+      suspended = true;
+      publisher.Synchronize();
+      finalized = true;
+      std::this_thread::yield();
+      finalized = false;
+      suspended = false;
+      std::this_thread::yield();
+   }
+
+   stop = true;
+   reader.join();
+   REQUIRE(blocks > 0);
+   REQUIRE(processedWhileFinalized == 0);
+}
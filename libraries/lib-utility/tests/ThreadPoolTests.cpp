@@ -0,0 +1,212 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file ThreadPoolTests.cpp
+ @brief Tests of ThreadPool, with and without polling
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+using namespace std::chrono;
+
+namespace
+{
+//! Counts of the calls for each index
+struct Calls
+{
+   explicit Calls(size_t count) : mCounts(count) {}
+
+   void operator()(size_t index) const { ++mCounts[index]; }
+
+   bool EachOnce() const
+   {
+      for (auto &count : mCounts)
+         if (count != 1)
+            return false;
+      return true;
+   }
+
+   int Total() const
+   {
+      int total = 0;
+      for (auto &count : mCounts)
+         total += count;
+      return total;
+   }
+
+   mutable std::vector<std::atomic<int>> mCounts;
+};
+
+//! Wait, but not forever, in case of a bug
+template<typename Predicate> bool WaitFor(const Predicate &predicate)
+{
+   const auto deadline = steady_clock::now() + 5s;
+   while (!predicate()) {
+      if (steady_clock::now() > deadline)
+         return false;
+      std::this_thread::sleep_for(1ms);
+   }
+   return true;
+}
+}
+
+TEST_CASE("ThreadPool runs each iteration once", "[ThreadPool]")
+{
+   const size_t nWorkers = GENERATE(0, 1, 3);
+   const size_t count = GENERATE(0, 1, 2, 1000);
+   ThreadPool pool{ nWorkers };
+   REQUIRE(pool.GetWorkerCount() == nWorkers);
+
+   Calls calls{ count };
+   pool.ParallelFor(count, calls);
+   REQUIRE(calls.EachOnce());
+}
+
+TEST_CASE("ThreadPool runs loops of several threads at once", "[ThreadPool]")
+{
+   ThreadPool pool{ 2 };
+   constexpr size_t count = 1000;
+   std::vector<std::unique_ptr<Calls>> calls;
+   std::vector<std::thread> threads;
+   for (int ii = 0; ii < 4; ++ii)
+      calls.push_back(std::make_unique<Calls>(count));
+   for (auto &pCalls : calls)
+      threads.emplace_back([&pool, &calls = *pCalls]{
+         for (int jj = 0; jj < 10; ++jj)
+            pool.ParallelFor(count, [&](size_t index){
+               calls(index);
+               std::this_thread::yield();
+            });
+      });
+   for (auto &thread : threads)
+      thread.join();
+   for (auto &pCalls : calls)
+      REQUIRE(pCalls->Total() == 10 * count);
+}
+
+TEST_CASE("ThreadPool rethrows and skips iterations not begun",
+   "[ThreadPool]")
+{
+   SECTION("Without workers, nothing after the throw runs")
+   {
+      ThreadPool pool{ 0 };
+      Calls calls{ 100 };
+      REQUIRE_THROWS_AS(pool.ParallelFor(100, [&](size_t index){
+         calls(index);
+         if (index == 10)
+            throw std::runtime_error{ "iteration" };
+      }), std::runtime_error);
+      REQUIRE(calls.Total() == 11);
+   }
+
+   SECTION("With workers, all that began have ended")
+   {
+      ThreadPool pool{ 3 };
+      std::atomic<int> begun{ 0 }, ended{ 0 };
+      REQUIRE_THROWS_AS(pool.ParallelFor(100000, [&](size_t index){
+         ++begun;
+         if (index == 0)
+            throw std::runtime_error{ "iteration" };
+         ++ended;
+      }), std::runtime_error);
+      REQUIRE(ended == begun - 1);
+      REQUIRE(begun < 100000);
+   }
+}
+
+TEST_CASE("ThreadPool polls while it runs a loop", "[ThreadPool]")
+{
+   const size_t nWorkers = GENERATE(0, 2);
+   ThreadPool pool{ nWorkers };
+   std::atomic<int> polls{ 0 };
+
+   SECTION("No iterations, one poll")
+   {
+      Calls calls{ 0 };
+      pool.ParallelForPolling(0, calls, [&]{ ++polls; });
+      REQUIRE(calls.Total() == 0);
+      REQUIRE(polls == 1);
+   }
+
+   SECTION("One iteration, and a poll after")
+   {
+      Calls calls{ 1 };
+      int total = -1;
+      pool.ParallelForPolling(1, calls, [&]{
+         ++polls;
+         total = calls.Total();
+      });
+      REQUIRE(calls.EachOnce());
+      REQUIRE(polls >= 1);
+      // The final poll sees all done
+      REQUIRE(total == 1);
+   }
+
+   SECTION("Polls at intervals, and once more after")
+   {
+      constexpr size_t count = 10;
+      Calls calls{ count };
+      int total = -1;
+      std::atomic<bool> waited{ false };
+      pool.ParallelForPolling(count, [&](size_t index){
+         // Let this thread be polled a few times first
+         if (index == 0)
+            waited = WaitFor([&]{ return polls >= 3; });
+         calls(index);
+      }, [&]{
+         ++polls;
+         total = calls.Total();
+      }, 1ms);
+      REQUIRE(waited);
+      REQUIRE(calls.EachOnce());
+      REQUIRE(polls >= 4);
+      REQUIRE(total == count);
+   }
+
+   SECTION("An iteration's exception passes to the caller")
+   {
+      REQUIRE_THROWS_AS(pool.ParallelForPolling(10, [](size_t index){
+         if (index == 5)
+            throw std::runtime_error{ "iteration" };
+      }, [&]{ ++polls; }), std::runtime_error);
+   }
+}
+
+TEST_CASE("ThreadPool skips the rest of a loop when a poll throws",
+   "[ThreadPool]")
+{
+   ThreadPool pool{ 0 };
+   constexpr size_t count = 100;
+   Calls calls{ count };
+   std::atomic<bool> thrown{ false }, ended{ false };
+   std::atomic<int> polls{ 0 };
+
+   REQUIRE_THROWS_AS(pool.ParallelForPolling(count, [&](size_t index){
+      // Still running when the poll throws
+      if (index == 0)
+         WaitFor([&]{ return thrown.load(); });
+      calls(index);
+      if (index == 0)
+         ended = true;
+   }, [&]{
+      ++polls;
+      thrown = true;
+      throw std::runtime_error{ "poll" };
+   }, 1ms), std::runtime_error);
+
+   // The iteration begun was waited for; no other began; no final poll
+   REQUIRE(ended);
+   REQUIRE(calls.Total() == 1);
+   REQUIRE(polls == 1);
+}
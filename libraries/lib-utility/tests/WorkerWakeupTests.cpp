@@ -0,0 +1,208 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file WorkerWakeupTests.cpp
+ @brief Tests of WorkerWakeup, with a measurement of the latency of the
+ audio thread's handshakes
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "WorkerWakeup.h"
+
+using namespace std::chrono;
+
+namespace
+{
+//! A worker that sleeps until woken, then does as AudioThread::Entry() does
+//! with a request to call TrackBufferExchange once
+struct Worker
+{
+   explicit Worker(bool polling = false)
+      : mThread{ [this, polling]{
+         while (!mStopping.load()) {
+            mWokenAt.store(steady_clock::now().time_since_epoch().count());
+            ++mPasses;
+            if (mRequest.exchange(false))
+               ++mDone;
+            wakeup.Respond();
+            if (polling)
+               // As the audio thread did before it was woken
+               std::this_thread::sleep_for(10ms);
+            else
+               wakeup.Sleep();
+         }
+      } }
+   {}
+
+   ~Worker()
+   {
+      mStopping.store(true);
+      wakeup.Wake();
+      mThread.join();
+   }
+
+   //! Ask for a pass, as ProcessOnceAndWait() does
+   int Request()
+   {
+      const int done = mDone.load();
+      mRequest.store(true);
+      wakeup.Wake();
+      return done;
+   }
+
+   WorkerWakeup wakeup;
+   std::atomic<bool> mStopping{ false };
+   std::atomic<bool> mRequest{ false };
+   std::atomic<int> mPasses{ 0 };
+   std::atomic<int> mDone{ 0 };
+   std::atomic<steady_clock::rep> mWokenAt{ 0 };
+   // Last, so the members it uses are ready before it starts
+   std::thread mThread;
+};
+
+//! Microseconds, at the median and the maximum
+struct Latencies
+{
+   void Add(steady_clock::duration latency) { mSamples.push_back(latency); }
+   void Print(const char *name)
+   {
+      std::sort(mSamples.begin(), mSamples.end());
+      const auto us = [](steady_clock::duration d){
+         return duration<double, std::micro>(d).count();
+      };
+      printf("%-32s median %10.1f us, max %10.1f us\n", name,
+         us(mSamples[mSamples.size() / 2]), us(mSamples.back()));
+   }
+   std::vector<steady_clock::duration> mSamples;
+};
+}
+
+TEST_CASE("WorkerWakeup wakes the worker for each request", "[WorkerWakeup]")
+{
+   Worker worker;
+   for (int ii = 1; ii <= 1000; ++ii) {
+      const auto done = worker.Request();
+      worker.wakeup.WaitFor([&]{ return worker.mDone.load() > done; });
+      REQUIRE(worker.mDone == ii);
+   }
+}
+
+TEST_CASE("WorkerWakeup loses no wakeup before the worker sleeps",
+   "[WorkerWakeup]")
+{
+   WorkerWakeup wakeup;
+   // Woken before sleeping; the sleep returns at once, and only once
+   wakeup.Wake();
+   wakeup.Sleep();
+   const auto start = steady_clock::now();
+   wakeup.SleepUntil(start + 20ms);
+   REQUIRE(steady_clock::now() - start >= 20ms);
+
+   wakeup.Signal();
+   // Already pending, so needs no other notification
+   wakeup.Signal();
+   wakeup.Sleep();
+}
+
+TEST_CASE("WorkerWakeup polls while it waits", "[WorkerWakeup]")
+{
+   WorkerWakeup wakeup;
+   std::atomic<bool> responded{ false };
+   int polls = 0;
+
+   SECTION("Already true")
+   {
+      wakeup.WaitFor([]{ return true; }, [&]{ ++polls; return 1ms; });
+      REQUIRE(polls == 0);
+   }
+
+   SECTION("Until the worker responds")
+   {
+      std::thread worker{ [&]{
+         wakeup.Sleep();
+         responded.store(true);
+         wakeup.Respond();
+      } };
+      wakeup.WaitFor([&]{ return responded.load(); }, [&]{
+         if (++polls == 3)
+            wakeup.Wake();
+         return 1ms;
+      });
+      worker.join();
+      REQUIRE(polls >= 3);
+   }
+}
+
+// Hidden from the default run; run the test executable with [benchmark]
+TEST_CASE("WorkerWakeup latency", "[.][benchmark]")
+{
+   constexpr int trials = 1000;
+   {
+      // From a locking wakeup, as for start, stop and seek requests, to the
+      // worker's pass
+      Worker worker;
+      Latencies latencies;
+      for (int ii = 0; ii < trials; ++ii) {
+         const auto done = worker.mDone.load();
+         const auto start = steady_clock::now();
+         worker.Request();
+         worker.wakeup.WaitFor([&]{ return worker.mDone.load() > done; });
+         latencies.Add(steady_clock::duration{ worker.mWokenAt.load() } -
+            start.time_since_epoch());
+      }
+      latencies.Print("Wake to worker");
+   }
+   {
+      // From a signal without a lock, as the PortAudio callback gives when
+      // the ring buffers need service and during a seek, to the worker's pass
+      Worker worker;
+      Latencies latencies;
+      for (int ii = 0; ii < trials; ++ii) {
+         const auto passes = worker.mPasses.load();
+         // Let the worker go to sleep
+         std::this_thread::sleep_for(100us);
+         const auto start = steady_clock::now();
+         worker.wakeup.Signal();
+         worker.wakeup.WaitFor([&]{ return worker.mPasses.load() > passes; });
+         latencies.Add(steady_clock::duration{ worker.mWokenAt.load() } -
+            start.time_since_epoch());
+      }
+      latencies.Print("Signal to worker");
+   }
+   {
+      // A request and its acknowledgement, as ProcessOnceAndWait() makes
+      Worker worker;
+      Latencies latencies;
+      for (int ii = 0; ii < trials; ++ii) {
+         const auto start = steady_clock::now();
+         const auto done = worker.Request();
+         worker.wakeup.WaitFor([&]{ return worker.mDone.load() > done; });
+         latencies.Add(steady_clock::now() - start);
+      }
+      latencies.Print("Request and response");
+   }
+   {
+      // The same, as it was before:  the worker sleeps 10 ms between
+      // passes, and the requester checks every 50 ms
+      Worker worker{ true };
+      Latencies latencies;
+      for (int ii = 0; ii < 20; ++ii) {
+         const auto start = steady_clock::now();
+         const auto done = worker.Request();
+         while (worker.mDone.load() == done)
+            std::this_thread::sleep_for(50ms);
+         latencies.Add(steady_clock::now() - start);
+      }
+      latencies.Print("Request and response, polling");
+   }
+}
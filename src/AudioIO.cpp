@@ -113,8 +113,10 @@ time warp info and AudioIOListener and whether the playback is looped.
 
 #include "Meter.h"
 #include "Mix.h"
+#include "MixKernels.h"
 #include "Resample.h"
 #include "RingBuffer.h"
+#include "ThreadPool.h"
 #include "Decibels.h"
 #include "Prefs.h"
 #include "Project.h"
@@ -406,6 +408,9 @@ AudioIO::~AudioIO()
    // This causes reentrancy issues during application shutdown
    // wxTheApp->Yield();
 
+   // The audio thread may be waiting without a deadline; let it find that
+   // AudioIO::Get() is now null
+   WakeAudioThread();
    mThread->Delete();
    mThread.reset();
 }
@@ -878,6 +883,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    mRate    = options.rate;
 
    mSeek    = 0;
+   mSeekState = SeekState::eNone;
    mLastRecordingOffset = 0;
    mCaptureTracks = tracks.captureTracks;
    mPlaybackTracks = tracks.playbackTracks;
@@ -1006,18 +1012,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    // so that they will have data in them when the stream starts.  Having the
    // audio thread call TrackBufferExchange here makes the code more predictable, since
    // TrackBufferExchange will ALWAYS get called from the Audio thread.
-   mAudioThreadShouldCallTrackBufferExchangeOnce
-      .store(true, std::memory_order_release);
-
-   while( mAudioThreadShouldCallTrackBufferExchangeOnce
-      .load(std::memory_order_acquire)) {
-      using namespace std::chrono;
-      auto interval = 50ms;
-      if (options.playbackStreamPrimer) {
-         interval = options.playbackStreamPrimer();
-      }
-      std::this_thread::sleep_for(interval);
-   }
+   ProcessOnceAndWait(options.playbackStreamPrimer);
 
    if(mNumPlaybackChannels > 0 || mNumCaptureChannels > 0) {
 
@@ -1257,6 +1252,23 @@ bool AudioIO::AllocateBuffers(
                );
             }
 
+            if (mPlaybackTracks.size() > 1) {
+               const auto nThreads = AudioIOMixerThreads.Read();
+               const size_t nWorkers = nThreads > 0
+                  ? nThreads
+                  : ThreadPool::DefaultWorkerCount();
+               if (nWorkers == 0)
+                  mpMixerPool.reset();
+               else if (!mpMixerPool ||
+                  mpMixerPool->GetWorkerCount() != nWorkers)
+                  mpMixerPool = std::make_unique<ThreadPool>(nWorkers);
+            }
+
+            // Allow for the few samples that GetCommonlyFreePlayback() and
+            // RingBuffer hold back
+            mPlaybackWakeLevel = playbackBufferSize -
+               std::min(playbackBufferSize, mPlaybackSamplesToCopy + 16);
+
             const auto timeQueueSize = 1 +
                (playbackBufferSize + TimeQueueGrainSize - 1)
                   / TimeQueueGrainSize;
@@ -1278,6 +1290,9 @@ bool AudioIO::AllocateBuffers(
                return false;
             }
 
+            mCaptureWakeLevel = captureBufferSize - std::min(captureBufferSize,
+               (size_t)(mRate * mMinCaptureSecsToCopy + 0.5));
+
             mCaptureBuffers.reinit(mCaptureTracks.size());
             mResample.reinit(mCaptureTracks.size());
             mFactor = sampleRate / mRate;
@@ -1750,9 +1765,10 @@ AudioThread::ExitCode AudioThread::Entry()
       auto &schedule = gAudioIO->mPlaybackSchedule;
       const auto interval = schedule.GetPolicy().SleepInterval(schedule);
 
-      // Set LoopActive outside the tests to avoid race condition
-      gAudioIO->mAudioThreadTrackBufferExchangeLoopActive
-         .store(true, std::memory_order_relaxed);
+      // Set LoopActive outside the tests to avoid race condition.
+      // Sequentially consistent, pairing with CallbackDoSeek(), which stores
+      // LoopRunning before it tests LoopActive
+      gAudioIO->mAudioThreadTrackBufferExchangeLoopActive.store(true);
       if( gAudioIO->mAudioThreadShouldCallTrackBufferExchangeOnce
          .load(std::memory_order_acquire) )
       {
@@ -1762,8 +1778,7 @@ AudioThread::ExitCode AudioThread::Entry()
 
          lastState = State::eOnce;
       }
-      else if( gAudioIO->mAudioThreadTrackBufferExchangeLoopRunning
-         .load(std::memory_order_relaxed))
+      else if( gAudioIO->mAudioThreadTrackBufferExchangeLoopRunning.load() )
       {
          if (lastState != State::eLoopRunning)
          {
@@ -1795,8 +1810,16 @@ AudioThread::ExitCode AudioThread::Entry()
 
       gAudioIO->mAudioThreadTrackBufferExchangeLoopActive
          .store(false, std::memory_order_relaxed);
-
-      std::this_thread::sleep_until( loopPassStart + interval );
+      gAudioIO->NotifyAudioThreadResponse();
+
+      // Sleep until there is work.  While the loop runs, the PortAudio
+      // callback wakes us when the ring buffers need service, and the
+      // deadline covers any missed wakeup and policies that poll, such as
+      // scrubbing.  Otherwise only other threads' requests wake us.
+      if (lastState == State::eLoopRunning)
+         gAudioIO->mAudioThreadWakeup.SleepUntil(loopPassStart + interval);
+      else
+         gAudioIO->mAudioThreadWakeup.Sleep();
    }
 
    return 0;
@@ -1895,24 +1918,29 @@ void AudioIO::FillPlayBuffers()
       // atomic variables, the time queue doesn't.
       mPlaybackSchedule.mTimeQueue.Producer(mPlaybackSchedule, slice);
 
-      for (size_t i = 0; i < mPlaybackTracks.size(); i++)
-      {
-         // The mixer here isn't actually mixing: it's just doing
-         // resampling, format conversion, and possibly time track
-         // warping
-         if (frames > 0)
-         {
-            size_t produced = 0;
-            if ( toProduce )
-               produced = mPlaybackMixers[i]->Process( toProduce );
-            //wxASSERT(produced <= toProduce);
-            auto warpedSamples = mPlaybackMixers[i]->GetBuffer();
-            const auto put = mPlaybackBuffers[i]->Put(
-               warpedSamples, floatSample, produced, frames - produced);
-            // wxASSERT(put == frames);
-            // but we can't assert in this thread
-            wxUnusedVar(put);
-         }
+      // The mixer here isn't actually mixing: it's just doing
+      // resampling, format conversion, and possibly time track
+      // warping
+      // Each track has its own mixer and ring buffer, so tracks may be
+      // processed concurrently, and the result doesn't depend on the order
+      const auto produceTrack = [&](size_t i){
+         size_t produced = 0;
+         if ( toProduce )
+            produced = mPlaybackMixers[i]->Process( toProduce );
+         //wxASSERT(produced <= toProduce);
+         auto warpedSamples = mPlaybackMixers[i]->GetBuffer();
+         const auto put = mPlaybackBuffers[i]->Put(
+            warpedSamples, floatSample, produced, frames - produced);
+         // wxASSERT(put == frames);
+         // but we can't assert in this thread
+         wxUnusedVar(put);
+      };
+      if (frames > 0) {
+         if (mpMixerPool)
+            mpMixerPool->ParallelFor(mPlaybackTracks.size(), produceTrack);
+         else
+            for (size_t i = 0; i < mPlaybackTracks.size(); i++)
+               produceTrack(i);
       }
 
       if (mPlaybackTracks.empty())
@@ -2463,9 +2491,8 @@ void AudioIoCallback::AddToOutputChannel( unsigned int chan,
    // Output volume emulation: possibly copy meter samples, then
    // apply volume, then copy to the output buffer
    if (outputMeterFloats != outputFloats)
-      for ( unsigned i = 0; i < len; ++i)
-         outputMeterFloats[numPlaybackChannels*i+chan] +=
-            gain*tempBuf[i];
+      MixKernels::Accumulate(outputMeterFloats + chan, numPlaybackChannels,
+         tempBuf, len, gain);
 
    // DV: We use gain to emulate panning.
    // Let's keep the old behavior for panning.
@@ -2481,8 +2508,8 @@ void AudioIoCallback::AddToOutputChannel( unsigned int chan,
 
    // Linear interpolate.
    float deltaGain = (gain - oldGain) / len;
-   for (unsigned i = 0; i < len; i++)
-      outputFloats[numPlaybackChannels*i+chan] += (oldGain + deltaGain * i) *tempBuf[i];
+   MixKernels::Accumulate(outputFloats + chan, numPlaybackChannels,
+      tempBuf, len, oldGain, deltaGain);
 };
 
 // Limit values to -1.0..+1.0
@@ -2524,7 +2551,7 @@ bool AudioIoCallback::FillOutputBuffers(
    if (mSeek && !mPlaybackSchedule.GetPolicy().AllowSeek(mPlaybackSchedule))
       mSeek = 0.0;
 
-   if (mSeek){
+   if (mSeek || mSeekState != SeekState::eNone){
       mCallbackReturn = CallbackDoSeek();
       return true;
    }
@@ -3122,6 +3149,8 @@ int AudioIoCallback::AudioCallback(
 
    SendVuOutputMeterData( outputMeterFloats, framesPerBuffer);
 
+   CallbackWakeAudioThread();
+
    return mCallbackReturn;
 }
 
@@ -3131,66 +3160,82 @@ int AudioIoCallback::AudioCallback(
 
 int AudioIoCallback::CallbackDoSeek()
 {
-   const int token = mStreamToken;
-   wxMutexLocker locker(mSuspendAudioThread);
-   if (token != mStreamToken)
-      // This stream got destroyed while we waited for it
-      return paAbort;
+   // This never blocks, as the PortAudio callback must not.  The handshake
+   // with the audio thread spans several callbacks, which output silence
+   // until it completes.  The audio thread may be waiting without a deadline,
+   // so each callback repeats its wakeup, in case one was missed.
+   switch (mSeekState) {
+   case SeekState::eNone:
+      // Pause the audio thread
+      mAudioThreadTrackBufferExchangeLoopRunning.store(false);
+      mSeekState = SeekState::eStopping;
+      SignalAudioThread(true);
+      return paContinue;
+
+   case SeekState::eStopping:
+   {
+      // Sequentially consistent, pairing with the audio thread's store of
+      // mAudioThreadTrackBufferExchangeLoopActive before it tests
+      // mAudioThreadTrackBufferExchangeLoopRunning
+      if (mAudioThreadTrackBufferExchangeLoopActive.load() ||
+          // StopStream() is tearing down this stream
+          mSuspendAudioThread.TryLock() != wxMUTEX_NO_ERROR) {
+         SignalAudioThread(true);
+         return paContinue;
+      }
 
-   const auto numPlaybackTracks = mPlaybackTracks.size();
+      const auto numPlaybackTracks = mPlaybackTracks.size();
 
-   // Pause audio thread and wait for it to finish
-   // 
-   // [PM] the following 8 lines of code could be probably replaced by
-   // a single call to StopAudioThreadAndWait()
-   // 
-   // CAUTION: when trying the above, you must also replace the setting of the
-   // atomic before the return, with a call to StartAudioThread() 
-   // 
-   // If that works, then we can remove mAudioThreadTrackBufferExchangeLoopActive,
-   // as it will become unused; consequently, the AudioThread loop would get simpler too.
-   //
-   mAudioThreadTrackBufferExchangeLoopRunning
-      .store(false, std::memory_order_relaxed);
+      // Calculate the NEW time position, in the PortAudio callback
+      const auto time =
+         mPlaybackSchedule.GetPolicy().OffsetTrackTime( mPlaybackSchedule, mSeek );
 
-   while( mAudioThreadTrackBufferExchangeLoopActive
-      .load(std::memory_order_relaxed ) )
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
+      mPlaybackSchedule.SetTrackTime( time );
+      mSeek = 0.0;
 
-   // Calculate the NEW time position, in the PortAudio callback
-   const auto time =
-      mPlaybackSchedule.GetPolicy().OffsetTrackTime( mPlaybackSchedule, mSeek );
 
-   mPlaybackSchedule.SetTrackTime( time );
-   mSeek = 0.0;
+      // Reset mixer positions and flush buffers for all tracks
+      for (size_t i = 0; i < numPlaybackTracks; i++)
+      {
+         const bool skipping = true;
+         mPlaybackMixers[i]->Reposition( time, skipping );
+         const auto toDiscard =
+            mPlaybackBuffers[i]->AvailForGet();
+         const auto discarded =
+            mPlaybackBuffers[i]->Discard( toDiscard );
+         // wxASSERT( discarded == toDiscard );
+         // but we can't assert in this thread
+         wxUnusedVar(discarded);
+      }
 
+      mPlaybackSchedule.mTimeQueue.Prime(time);
+      mSuspendAudioThread.Unlock();
 
-   // Reset mixer positions and flush buffers for all tracks
-   for (size_t i = 0; i < numPlaybackTracks; i++)
-   {
-      const bool skipping = true;
-      mPlaybackMixers[i]->Reposition( time, skipping );
-      const auto toDiscard =
-         mPlaybackBuffers[i]->AvailForGet();
-      const auto discarded =
-         mPlaybackBuffers[i]->Discard( toDiscard );
-      // wxASSERT( discarded == toDiscard );
-      // but we can't assert in this thread
-      wxUnusedVar(discarded);
+      // Reload the ring buffers
+      mAudioThreadShouldCallTrackBufferExchangeOnce
+         .store(true, std::memory_order_release);
+      mSeekState = SeekState::eRefilling;
+      SignalAudioThread(true);
+      return paContinue;
    }
 
-   mPlaybackSchedule.mTimeQueue.Prime(time);
-
-   // Reload the ring buffers
-   ProcessOnceAndWait();
-
-   // Reenable the audio thread
-   mAudioThreadTrackBufferExchangeLoopRunning
-      .store(true, std::memory_order_relaxed);
+   case SeekState::eRefilling:
+      if (mAudioThreadShouldCallTrackBufferExchangeOnce
+         .load(std::memory_order_acquire) ||
+          // Don't undo StopStream()'s stopping of the audio thread
+          mSuspendAudioThread.TryLock() != wxMUTEX_NO_ERROR) {
+         SignalAudioThread(true);
+         return paContinue;
+      }
 
+      // Reenable the audio thread
+      mAudioThreadTrackBufferExchangeLoopRunning
+         .store(true, std::memory_order_relaxed);
+      mSuspendAudioThread.Unlock();
+      mSeekState = SeekState::eNone;
+      SignalAudioThread(true);
+      return paContinue;
+   }
    return paContinue;
 }
 
@@ -3218,18 +3263,50 @@ auto AudioIoCallback::AudioIOExtIterator::operator *() const -> AudioIOExt &
 }
 
 
+void AudioIoCallback::WakeAudioThread()
+{
+   mAudioThreadWakeup.Wake();
+}
+
+void AudioIoCallback::SignalAudioThread(bool repeat)
+{
+   mAudioThreadWakeup.Signal(repeat);
+}
+
+void AudioIoCallback::CallbackWakeAudioThread()
+{
+   if (mStreamToken <= 0)
+      return;
+   if ((mNumPlaybackChannels > 0 &&
+        GetCommonlyReadyPlayback() <= mPlaybackWakeLevel) ||
+       (!mCaptureTracks.empty() &&
+        mCaptureBuffers[0]->AvailForPut() <= mCaptureWakeLevel))
+      SignalAudioThread();
+}
+
+void AudioIoCallback::NotifyAudioThreadResponse()
+{
+   mAudioThreadWakeup.Respond();
+}
+
+template<typename Pred>
+void AudioIoCallback::WaitForAudioThread(const Pred &pred)
+{
+   mAudioThreadWakeup.WaitFor(pred);
+}
+
 void AudioIoCallback::StartAudioThread()
 {
    mAudioThreadTrackBufferExchangeLoopRunning.store(true, std::memory_order_release);
+   WakeAudioThread();
 }
 
 void AudioIoCallback::WaitForAudioThreadStarted()
 {
-   while (mAudioThreadAcknowledge.load(std::memory_order_acquire) != Acknowledge::eStart)
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
+   WaitForAudioThread([this]{
+      return mAudioThreadAcknowledge.load(std::memory_order_acquire)
+         == Acknowledge::eStart;
+   });
    mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_release);
 }
 
@@ -3244,15 +3321,15 @@ void AudioIoCallback::StartAudioThreadAndWait()
 void AudioIoCallback::StopAudioThread()
 {
    mAudioThreadTrackBufferExchangeLoopRunning.store(false, std::memory_order_release);
+   WakeAudioThread();
 }
 
 void AudioIoCallback::WaitForAudioThreadStopped()
 {
-   while (mAudioThreadAcknowledge.load(std::memory_order_acquire) != Acknowledge::eStop)
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(50ms);
-   }
+   WaitForAudioThread([this]{
+      return mAudioThreadAcknowledge.load(std::memory_order_acquire)
+         == Acknowledge::eStop;
+   });
    mAudioThreadAcknowledge.store(Acknowledge::eNone, std::memory_order_release);
 }
 
@@ -3263,17 +3340,21 @@ void AudioIoCallback::StopAudioThreadAndWait()
 }
 
 
-void AudioIoCallback::ProcessOnceAndWait(std::chrono::milliseconds sleepTime)
+void AudioIoCallback::ProcessOnceAndWait(
+   const std::function< std::chrono::milliseconds() > &poll)
 {
    mAudioThreadShouldCallTrackBufferExchangeOnce
       .store(true, std::memory_order_release);
+   WakeAudioThread();
 
-   while (mAudioThreadShouldCallTrackBufferExchangeOnce
-      .load(std::memory_order_acquire))
-   {
-      using namespace std::chrono;
-      std::this_thread::sleep_for(sleepTime);
-   }
+   const auto done = [this]{
+      return !mAudioThreadShouldCallTrackBufferExchangeOnce
+         .load(std::memory_order_acquire);
+   };
+   if (poll)
+      mAudioThreadWakeup.WaitFor(done, poll);
+   else
+      WaitForAudioThread(done);
 }
 
 
@@ -17,6 +17,7 @@
 
 #include "AudioIOBase.h" // to inherit
 #include "PlaybackSchedule.h" // member variable
+#include "WorkerWakeup.h" // member variable
 
 #include <functional>
 #include <memory>
@@ -37,6 +38,7 @@ class Mixer;
 class RealtimeEffectState;
 class Resample;
 class AudioThread;
+class ThreadPool;
 
 class AudacityProject;
 
@@ -176,7 +178,7 @@ public:
       { return mListener.lock(); }
    void SetListener( const std::shared_ptr< AudioIOListener > &listener);
    
-   // Part of the callback
+   // Part of the callback; a step of the seek, never blocking
    int CallbackDoSeek();
 
    // Part of the callback
@@ -272,6 +274,10 @@ public:
    std::vector<float *> mScratchPointers; //!< pointing into mScratchBuffers
 
    std::vector<std::unique_ptr<Mixer>> mPlaybackMixers;
+   //! Runs the mixers of several playback tracks at once
+   /*! Kept between streams, because each thread that reads the database
+    caches its own prepared statements */
+   std::unique_ptr<ThreadPool> mpMixerPool;
 
    std::atomic<float>  mMixerOutputVol{ 1.0 };
    static int          mNextStreamToken;
@@ -281,6 +287,10 @@ public:
    bool                mbMicroFades;
 
    double              mSeek;
+   //! Steps of CallbackDoSeek(), which spans several callbacks
+   enum class SeekState { eNone, eStopping, eRefilling };
+   //! Used only in the PortAudio callback, and reset in StartStream()
+   SeekState           mSeekState{ SeekState::eNone };
    PlaybackPolicy::Duration mPlaybackRingBufferSecs;
    double              mCaptureRingBufferSecs;
 
@@ -308,6 +318,35 @@ public:
       
    std::atomic<Acknowledge>  mAudioThreadAcknowledge;
 
+   //! Sleeps and wakes the audio thread, but guards none of the atomics
+   //! above
+   WorkerWakeup mAudioThreadWakeup;
+
+   //! The callback wakes the audio thread when every playback buffer holds
+   //! no more than this, leaving room for a batch of mPlaybackSamplesToCopy
+   size_t mPlaybackWakeLevel{ 0 };
+   //! The callback wakes the audio thread when capture buffers have no more
+   //! free space than this, holding mMinCaptureSecsToCopy of samples
+   size_t mCaptureWakeLevel{ 0 };
+
+   //! Wake the audio thread after a change of the states above
+   /*! Locks briefly, so no wakeup is lost */
+   void WakeAudioThread();
+   //! Wake the audio thread without locking, for the PortAudio callback
+   /*! A wakeup might rarely be missed; then the audio thread finds its work
+    at the deadline given by PlaybackPolicy::SleepInterval(), or at the next
+    repeated signal
+    @param repeat notify even if a wakeup is already pending, because it
+    might have been missed */
+   void SignalAudioThread(bool repeat = false);
+   //! Called in the PortAudio callback; wakes the audio thread if the ring
+   //! buffers need service
+   void CallbackWakeAudioThread();
+   //! Called by the audio thread after changing the states above
+   void NotifyAudioThreadResponse();
+   //! Block until the audio thread makes pred() true
+   template<typename Pred> void WaitForAudioThread(const Pred &pred);
+
    // Sync start/stop of AudioThread processing
    void StartAudioThreadAndWait();
    void StopAudioThreadAndWait();
@@ -320,7 +359,11 @@ public:
    void StopAudioThread();
    void WaitForAudioThreadStopped();
 
-   void ProcessOnceAndWait( std::chrono::milliseconds sleepTime = std::chrono::milliseconds(50) );
+   //! Have the audio thread call TrackBufferExchange once, and wait for that
+   /*! @param poll if not empty, called repeatedly while waiting, returning
+    the time to wait before the next call */
+   void ProcessOnceAndWait(
+      const std::function< std::chrono::milliseconds() > &poll = {} );
 
 
 
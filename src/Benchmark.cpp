@@ -18,7 +18,13 @@ of sample block storage.
 
 #include "Benchmark.h"
 
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
 #include <wx/app.h>
+#include <wx/file.h>
+#include <wx/filename.h>
 #include <wx/log.h>
 #include <wx/textctrl.h>
 #include <wx/button.h>
@@ -33,6 +39,7 @@ of sample block storage.
 #include <wx/valtext.h>
 #include <wx/intl.h>
 
+#include "BasicUI.h"
 #include "SampleBlock.h"
 #include "ShuttleGui.h"
 #include "Project.h"
@@ -43,8 +50,13 @@ of sample block storage.
 #include "ProjectRate.h"
 #include "ViewInfo.h"
 
+#include "FileFormats.h"
 #include "FileNames.h"
+#include "ProjectFileIO.h"
 #include "SelectFile.h"
+#include "Tags.h"
+#include "TempDirectory.h"
+#include "import/Import.h"
 #include "widgets/AudacityMessageBox.h"
 #include "widgets/wxPanelWrapper.h"
 
@@ -320,6 +332,74 @@ void BenchmarkDialog::FlushPrint()
    mToPrint = wxT("");
 }
 
+//! Resident memory of the process in bytes, or 0 where not known
+static long long ResidentBytes()
+{
+#ifdef __linux__
+   long long size = 0, resident = 0;
+   if (auto file = fopen("/proc/self/statm", "r")) {
+      if (fscanf(file, "%lld %lld", &size, &resident) != 2)
+         resident = 0;
+      fclose(file);
+   }
+   return resident * sysconf(_SC_PAGESIZE);
+#else
+   return 0;
+#endif
+}
+
+//! Milliseconds to import a new file of random stereo 16 bit samples, as one
+//! of several files imported at once is, and to store it; or -1 on failure
+/*!
+ @param format the libsndfile format of the file, which decides the path
+ of the import
+ */
+static long TimeImport(AudacityProject &project, const FilePath &path,
+   int format, size_t frames)
+{
+   {
+      SF_INFO info{};
+      info.samplerate = 44100;
+      info.channels = 2;
+      info.format = format;
+      wxFile f;
+      SFFile sf;
+      if (f.Open(path, wxFile::write))
+         sf.reset(SFCall<SNDFILE*>(
+            sf_open_fd, f.fd(), SFM_WRITE, &info, FALSE));
+      if (!sf)
+         return -1;
+      constexpr size_t bufferFrames = 65536;
+      std::vector<short> buffer(info.channels * bufferFrames);
+      for (size_t done = 0; done < frames;) {
+         const auto count = std::min(bufferFrames, frames - done);
+         for (auto &sample : buffer)
+            sample = short(rand());
+         if (SFCall<sf_count_t>(sf_writef_short,
+               sf.get(), buffer.data(), count) != sf_count_t(count))
+            return -1;
+         done += count;
+      }
+   }
+   const auto cleanup = finally([&]{ wxRemoveFile(path); });
+
+   TrackHolders tracks;
+   const auto tags = Tags::Get( project ).Duplicate();
+   TranslatableString errorMessage;
+   ImportFileHandle::BackgroundImport work;
+   wxStopWatch timer;
+   if (!Importer::Get().Import(project, path,
+         &WaveTrackFactory::Get( project ), tracks, tags.get(),
+         errorMessage, &work))
+      return -1;
+   if (work && work([](double){ return BasicUI::ProgressResult::Success; })
+         != BasicUI::ProgressResult::Success)
+      return -1;
+   // Wait for the sample blocks to be written too
+   ProjectFileIO::Get( project ).GetTotalUsage();
+   return timer.Time();
+}
+
 void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
 {
    TransferDataFromWindow();
@@ -437,6 +517,19 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
       goto fail;
    }
 
+   {
+      // Storage depends on whether the project stores compressed samples;
+      // compare runs with and without that preference, and their read times
+      unsigned long long stored = 0;
+      const auto accumulate = BlockSpaceUsageAccumulator( stored );
+      for (const auto &seqBlock :
+         t->GetClipByIndex(0)->GetSequence()->GetBlockArray())
+         accumulate( *seqBlock.sb );
+      const unsigned long long raw = nChunks * chunkSize * sizeof(SampleType);
+      Printf( XO("Sample blocks written: %llu bytes for %llu bytes of samples (%.1f%%).\n")
+         .Format( stored, raw, 100.0 * stored / raw ) );
+   }
+
    Printf( XO("Performing %d edits...\n").Format( trials ) );
    wxTheApp->Yield();
    FlushPrint();
@@ -513,6 +606,62 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    FlushPrint();
    wxTheApp->Yield();
 
+   {
+      // Copy the tracks as UndoManager::PushState does, for more and more
+      // tracks like the edited one
+      constexpr int nStates = 20;
+      for (int nTracks : { 1, 10, 100 }) {
+         auto tracks = TrackList::Create( nullptr );
+         for (int i = 0; i < nTracks; ++i)
+            tracks->Add(t->Duplicate());
+
+         std::vector<std::shared_ptr<TrackList>> states;
+         const auto before = ResidentBytes();
+         timer.Start();
+         for (int i = 0; i < nStates; ++i) {
+            auto tracksCopy = TrackList::Create( nullptr );
+            for (auto pTrack : *tracks)
+               tracksCopy->Add(pTrack->Duplicate());
+            states.push_back(std::move(tracksCopy));
+         }
+         elapsed = timer.Time();
+         const auto grown = ResidentBytes() - before;
+         Printf( XO("Time to push %d undo states of %d tracks: %ld ms, memory grown by %lld KB\n")
+            .Format( nStates, nTracks, elapsed, grown / 1024 ) );
+      }
+      FlushPrint();
+      wxTheApp->Yield();
+   }
+
+   {
+      // Import WAV files of the test data size.  Little-endian WAV is read
+      // through a memory mapping; the same samples in big-endian (RIFX) WAV
+      // are decoded by libsndfile, as all WAV files were before
+      const auto frames = dataSize * 1048576ull / (2 * sizeof(short));
+      const auto megabytes = frames * 2 * sizeof(short) / 1048576.0;
+      const auto path = wxFileName(
+         TempDirectory::TempDir(), wxT("benchmark.wav")).GetFullPath();
+      for (const auto &[format, name] : {
+         std::pair{ SF_ENDIAN_BIG, XO("decoded") },
+         std::pair{ SF_ENDIAN_FILE, XO("memory-mapped") },
+      }) {
+         Printf( XO("Importing %.1f MB of %s WAV...\n")
+            .Format( megabytes, name ) );
+         FlushPrint();
+         wxTheApp->Yield();
+         elapsed = TimeImport(mProject, path,
+            SF_FORMAT_WAV | SF_FORMAT_PCM_16 | format, frames);
+         if (elapsed < 0) {
+            Printf( XO("Import failed.\n") );
+            goto fail;
+         }
+         Printf( XO("Time to import and store: %ld ms, %.1f MB/s\n")
+            .Format( elapsed, megabytes * 1000.0 / std::max(elapsed, 1L) ) );
+      }
+      FlushPrint();
+      wxTheApp->Yield();
+   }
+
 
 #if 0
    Printf( XO("Checking file pointer leaks:\n") );
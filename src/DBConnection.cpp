@@ -13,6 +13,8 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 #include "sqlite3.h"
 
+#include <algorithm>
+#include <utility>
 #include <wx/string.h>
 
 #include "AudacityLogger.h"
@@ -31,6 +33,8 @@ Paul Licameli -- split from ProjectFileIO.cpp
 
 static const char* PageSizeConfig =
    "PRAGMA <schema>.page_size = " xstr(AUDACITY_PROJECT_PAGE_SIZE) ";"
+   // Lets ProjectFileIO::VacuumIncrementally() free pages in place
+   "PRAGMA <schema>.auto_vacuum = INCREMENTAL;"
    "VACUUM;";
 
 // Configuration to provide "safe" connections
@@ -63,6 +67,8 @@ DBConnection::DBConnection(
 
 DBConnection::~DBConnection()
 {
+   StopWriter();
+
    wxASSERT(mDB == nullptr);
    if (mDB)
    {
@@ -81,6 +87,36 @@ bool DBConnection::ShouldBypass()
    return mBypass;
 }
 
+bool DBConnection::HasSampleBlockCodec()
+{
+   int has = mHasSampleBlockCodec;
+   if (has < 0)
+   {
+      // Preparing fails if there is no such column
+      sqlite3_stmt *stmt = nullptr;
+      has = sqlite3_prepare_v2(mDB, "SELECT codec FROM sampleblocks LIMIT 0;",
+         -1, &stmt, nullptr) == SQLITE_OK;
+      sqlite3_finalize(stmt);
+      mHasSampleBlockCodec = has;
+   }
+   return has > 0;
+}
+
+bool DBConnection::HasSpectra()
+{
+   int has = mHasSpectra;
+   if (has < 0)
+   {
+      // Preparing fails if there is no such table
+      sqlite3_stmt *stmt = nullptr;
+      has = sqlite3_prepare_v2(mDB, "SELECT blockid FROM spectra LIMIT 0;",
+         -1, &stmt, nullptr) == SQLITE_OK;
+      sqlite3_finalize(stmt);
+      mHasSpectra = has;
+   }
+   return has > 0;
+}
+
 void DBConnection::SetError(
    const TranslatableString &msg, const TranslatableString &libraryError, int errorCode)
 {
@@ -148,6 +184,7 @@ int DBConnection::Open(const FilePath fileName)
    mCheckpointStop = false;
    mCheckpointPending = false;
    mCheckpointActive = false;
+   mNextSampleBlockID = 0;
    rc = OpenStepByStep( fileName );
    if ( rc != SQLITE_OK)
    {
@@ -241,6 +278,10 @@ bool DBConnection::Close()
       return true;
    }
 
+   // Write what remains of deferred updates, and stop the writer thread
+   GuardedCall( [this]{ FlushDeferred(); } );
+   StopWriter();
+
    // Uninstall our checkpoint hook so that no additional checkpoints
    // are sent our way.  (Though this shouldn't really happen.)
    sqlite3_wal_hook(mDB, nullptr, nullptr);
@@ -257,18 +298,19 @@ bool DBConnection::Close()
          title = XO("Checkpointing %s").Format(project->GetProjectName());
       }
 
-      // Provides a progress dialog with indeterminate mode
+      // Provides a progress dialog with indeterminate mode, unless there
+      // are no UI services, as in unit tests
       using namespace BasicUI;
       auto pd = MakeGenericProgress({},
          title, XO("This may take several seconds"));
-      wxASSERT(pd);
 
       // Wait for the checkpoints to end
       while (mCheckpointPending || mCheckpointActive)
       {
          using namespace std::chrono;
          std::this_thread::sleep_for(50ms);
-         pd->Pulse();
+         if (pd)
+            pd->Pulse();
       }
    }
 
@@ -479,6 +521,298 @@ sqlite3_stmt *DBConnection::Prepare(enum StatementID id, const char *sql)
    return stmt;
 }
 
+SampleBlockID DBConnection::NewSampleBlockID()
+{
+   std::lock_guard<std::mutex> guard(mSampleBlockIDMutex);
+   if (mNextSampleBlockID <= 0)
+   {
+      // Continue the AUTOINCREMENT sequence, which never reuses the id of a
+      // deleted row
+      sqlite3_stmt *stmt = nullptr;
+      int rc = sqlite3_prepare_v2(mDB,
+         "SELECT max("
+         "   ifnull((SELECT seq FROM sqlite_sequence"
+         "             WHERE name = 'sampleblocks'), 0),"
+         "   ifnull((SELECT max(blockid) FROM sampleblocks), 0));",
+         -1, &stmt, nullptr);
+      if (rc == SQLITE_OK)
+         rc = sqlite3_step(stmt);
+      const auto last =
+         (rc == SQLITE_ROW) ? sqlite3_column_int64(stmt, 0) : 0;
+      sqlite3_finalize(stmt);
+      if (rc != SQLITE_ROW)
+      {
+         ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+         ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::NewSampleBlockID");
+         ThrowException( false );
+      }
+      mNextSampleBlockID = last + 1;
+   }
+   return mNextSampleBlockID++;
+}
+
+// Don't let the writer fall farther behind than this, so that memory for
+// blocks not yet written stays bounded
+static constexpr size_t MaxDeferred = 256;
+
+void DBConnection::Defer(DeferredUpdate update,
+   DeferredCallback onApplied, DeferredCallback onReverted)
+{
+   {
+      std::unique_lock<std::mutex> lock(mDeferredMutex);
+      mDeferredTaken.wait(lock, [this]{
+         return mDeferred.size() < MaxDeferred || mHolds > 0 ||
+            mDeferredFailed;
+      });
+      mDeferred.push_back({ std::move(update),
+         std::move(onApplied), std::move(onReverted) });
+      if (mHolds == 0 && !mDeferredFailed)
+      {
+         if (!mWriterThread.joinable())
+         {
+            mWriterStop = false;
+            mWriterThread = std::thread([this]{ WriterThread(); });
+         }
+         mDeferredCondition.notify_one();
+         return;
+      }
+      // A hold keeps the updates waiting, perhaps for its transaction to
+      // flush them at commit, until the queue is full
+      if (!mDeferredFailed && mDeferred.size() < MaxDeferred)
+         return;
+   }
+
+   // The queue is full while held, and the updates join any open
+   // transaction; or the writer failed, and this retries and reports any
+   // failure to the producer
+   FlushDeferred();
+}
+
+void DBConnection::FlushDeferred()
+{
+   int rc;
+   std::string message;
+   {
+      std::lock_guard<std::mutex> writing(mWriteMutex);
+      if (ApplyDeferred())
+         return;
+      rc = mDeferredErrorCode;
+      message = mDeferredErrorMessage;
+   }
+
+   ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+   ADD_EXCEPTION_CONTEXT("sqlite3.context", "DBConnection::FlushDeferred");
+
+   wxLogMessage("Failed to apply deferred updates to %s\n"
+                "\tErrCode: %d\n"
+                "\tErrMsg: %s",
+                sqlite3_db_filename(mDB, nullptr),
+                rc,
+                message);
+
+   // Just showing the user a simple message, not the library error too
+   // which isn't internationalized
+   ThrowException( true );
+}
+
+bool DBConnection::ApplyDeferred()
+{
+   CommitJoined();
+
+   std::vector<Deferred> batch;
+   {
+      std::lock_guard<std::mutex> guard(mDeferredMutex);
+      batch.swap(mDeferred);
+   }
+   mDeferredTaken.notify_all();
+   if (batch.empty())
+      return true;
+
+   // Make one transaction of the batch, or if one is open already, join
+   // it.  A savepoint does either, and a failure undoes only this batch.
+   const bool joining = !sqlite3_get_autocommit(mDB);
+   int rc = sqlite3_exec(mDB, "SAVEPOINT deferred;", nullptr, nullptr, nullptr);
+   if (rc == SQLITE_OK)
+   {
+      for (auto &deferred : batch)
+      {
+         try
+         {
+            rc = deferred.update();
+         }
+         catch (...)
+         {
+            // Such as failure to prepare a statement
+            rc = SQLITE_ERROR;
+         }
+         if (rc != SQLITE_OK)
+            break;
+      }
+      if (rc == SQLITE_OK)
+         rc = sqlite3_exec(mDB, "RELEASE deferred;", nullptr, nullptr, nullptr);
+      if (rc != SQLITE_OK)
+      {
+         mDeferredErrorMessage = sqlite3_errmsg(mDB);
+         sqlite3_exec(mDB, "ROLLBACK TO deferred; RELEASE deferred;",
+            nullptr, nullptr, nullptr);
+      }
+   }
+   else
+      mDeferredErrorMessage = sqlite3_errmsg(mDB);
+   mDeferredErrorCode = rc;
+
+   if (rc != SQLITE_OK)
+   {
+      // Keep the updates, ahead of any deferred meanwhile, to try again at
+      // the next flush; until then the writer thread waits
+      {
+         std::lock_guard<std::mutex> guard(mDeferredMutex);
+         mDeferred.insert(mDeferred.begin(),
+            std::make_move_iterator(batch.begin()),
+            std::make_move_iterator(batch.end()));
+         mDeferredFailed = true;
+      }
+      mDeferredTaken.notify_all();
+      return false;
+   }
+
+   // All updates so far are applied, so there is no failure to report
+   mDeferredErrorMessage.clear();
+   {
+      std::lock_guard<std::mutex> guard(mDeferredMutex);
+      mDeferredFailed = false;
+   }
+
+   for (auto &deferred : batch)
+      if (deferred.onApplied)
+         deferred.onApplied();
+
+   if (joining)
+      // Not committed until the enclosing transaction is, which may yet
+      // roll back
+      mJoined.insert(mJoined.end(),
+         std::make_move_iterator(batch.begin()),
+         std::make_move_iterator(batch.end()));
+
+   return true;
+}
+
+void DBConnection::PostDeferredFailure()
+{
+   // Only the main thread may show the error
+   BasicUI::CallAfter([wProject = mpProject, this]{
+      auto pProject = wProject.lock();
+      // The connection may have been closed or replaced meanwhile
+      if (!pProject ||
+          ConnectionPtr::Get(*pProject).mpConnection.get() != this)
+         return;
+      GuardedCall([this]{ FlushDeferred(); });
+   });
+}
+
+void DBConnection::CommitJoined()
+{
+   if (!mJoined.empty() && sqlite3_get_autocommit(mDB))
+      mJoined.clear();
+}
+
+int DBConnection::RollbackJoined(
+   size_t first, const std::function<int()> &rollback)
+{
+   first = std::min(first, mJoined.size());
+   for (auto iter = mJoined.begin() + first; iter != mJoined.end(); ++iter)
+      if (iter->onReverted)
+         iter->onReverted();
+
+   const auto rc = rollback();
+   if (rc != SQLITE_OK)
+   {
+      // The updates stay applied
+      for (auto iter = mJoined.begin() + first; iter != mJoined.end(); ++iter)
+         if (iter->onApplied)
+            iter->onApplied();
+      return rc;
+   }
+
+   // These were deferred before any that still wait, or that failed
+   {
+      std::lock_guard<std::mutex> guard(mDeferredMutex);
+      mDeferred.insert(mDeferred.begin(),
+         std::make_move_iterator(mJoined.begin() + first),
+         std::make_move_iterator(mJoined.end()));
+   }
+   mJoined.erase(mJoined.begin() + first, mJoined.end());
+   return rc;
+}
+
+void DBConnection::WriterThread()
+{
+   std::unique_lock<std::mutex> lock(mDeferredMutex);
+   while (true)
+   {
+      mDeferredCondition.wait(lock, [this]{
+         return mWriterStop ||
+            (!mDeferred.empty() && mHolds == 0 && !mDeferredFailed);
+      });
+      if (mWriterStop)
+         break;
+      lock.unlock();
+      bool failed = false;
+      {
+         std::lock_guard<std::mutex> writing(mWriteMutex);
+         // A hold may have been made meanwhile, to write directly, and then
+         // it has applied the updates
+         if (mHolds == 0)
+            failed = !ApplyDeferred();
+      }
+      if (failed)
+         PostDeferredFailure();
+      lock.lock();
+   }
+}
+
+void DBConnection::StopWriter()
+{
+   {
+      std::lock_guard<std::mutex> guard(mDeferredMutex);
+      mWriterStop = true;
+      mDeferredCondition.notify_one();
+   }
+   if (mWriterThread.joinable())
+      mWriterThread.join();
+}
+
+DBConnection::DeferralHold::DeferralHold(DBConnection &connection)
+   : mConnection{ connection }
+{
+   // Count the hold first, so that the writer starts no new batch after
+   // the flush
+   {
+      std::lock_guard<std::mutex> guard(mConnection.mDeferredMutex);
+      ++mConnection.mHolds;
+   }
+   // Wake producers waiting for room, to apply their updates themselves
+   mConnection.mDeferredTaken.notify_all();
+   try
+   {
+      mConnection.FlushDeferred();
+   }
+   catch (...)
+   {
+      std::lock_guard<std::mutex> guard(mConnection.mDeferredMutex);
+      --mConnection.mHolds;
+      mConnection.mDeferredCondition.notify_one();
+      throw;
+   }
+}
+
+DBConnection::DeferralHold::~DeferralHold()
+{
+   std::lock_guard<std::mutex> guard(mConnection.mDeferredMutex);
+   --mConnection.mHolds;
+   mConnection.mDeferredCondition.notify_one();
+}
+
 void DBConnection::CheckpointThread(sqlite3 *db, const FilePath &fileName)
 {
    int rc = SQLITE_OK;
@@ -598,7 +932,12 @@ struct DBConnectionTransactionScopeImpl final : TransactionScopeImpl {
    bool TransactionCommit(const wxString &name) override;
    bool TransactionRollback(const wxString &name) override;
 
+   //! Release the savepoint, after it commits or rolls back
+   bool Release(const wxString &name);
+
    DBConnection &mConnection;
+   //! How many updates had joined enclosing transactions at the start
+   size_t mJoinedStart{ 0 };
 };
 
 static TransactionScope::Factory::Scope scope {
@@ -617,11 +956,16 @@ bool DBConnectionTransactionScopeImpl::TransactionStart(const wxString &name)
 {
    char *errmsg = nullptr;
 
+   // Deferred updates are not held; the writer thread applies them in the
+   // savepoint, between its batches, and they are committed with it
+   std::unique_lock<std::mutex> writing(mConnection.mWriteMutex);
+   mJoinedStart = mConnection.mJoined.size();
    int rc = sqlite3_exec(mConnection.DB(),
                          wxT("SAVEPOINT ") + name + wxT(";"),
                          nullptr,
                          nullptr,
                          &errmsg);
+   writing.unlock();
 
    if (errmsg)
    {
@@ -638,14 +982,41 @@ bool DBConnectionTransactionScopeImpl::TransactionStart(const wxString &name)
 }
 
 bool DBConnectionTransactionScopeImpl::TransactionCommit(const wxString &name)
+{
+   // Updates deferred and not yet applied join the savepoint now.  Do not
+   // throw; a failed batch stays queued, for a later flush to retry and
+   // report, and the caller rolls back.
+   try
+   {
+      mConnection.FlushDeferred();
+   }
+   catch (...)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "TransactionScope::TransactionCommit");
+
+      mConnection.SetDBError(
+         XO("Failed to release savepoint:\n\n%s").Format(name)
+      );
+      return false;
+   }
+
+   return Release(name);
+}
+
+bool DBConnectionTransactionScopeImpl::Release(const wxString &name)
 {
    char *errmsg = nullptr;
 
+   std::unique_lock<std::mutex> writing(mConnection.mWriteMutex);
    int rc = sqlite3_exec(mConnection.DB(),
                          wxT("RELEASE ") + name + wxT(";"),
                          nullptr,
                          nullptr,
                          &errmsg);
+   if (rc == SQLITE_OK)
+      // Does nothing unless this was the outermost savepoint
+      mConnection.CommitJoined();
+   writing.unlock();
 
    if (errmsg)
    {
@@ -665,11 +1036,16 @@ bool DBConnectionTransactionScopeImpl::TransactionRollback(const wxString &name)
 {
    char *errmsg = nullptr;
 
-   int rc = sqlite3_exec(mConnection.DB(),
-                         wxT("ROLLBACK TO ") + name + wxT(";"),
-                         nullptr,
-                         nullptr,
-                         &errmsg);
+   // Updates that joined the savepoint are undone, to be applied again
+   std::unique_lock<std::mutex> writing(mConnection.mWriteMutex);
+   int rc = mConnection.RollbackJoined(mJoinedStart, [&]{
+      return sqlite3_exec(mConnection.DB(),
+                          wxT("ROLLBACK TO ") + name + wxT(";"),
+                          nullptr,
+                          nullptr,
+                          &errmsg);
+   });
+   writing.unlock();
 
    if (errmsg)
    {
@@ -688,7 +1064,7 @@ bool DBConnectionTransactionScopeImpl::TransactionRollback(const wxString &name)
    // -- must do both; rolling back a savepoint only rewinds it
    // without removing it, unlike the ROLLBACK command
 
-   return TransactionCommit(name);
+   return Release(name);
 }
 
 ConnectionPtr::~ConnectionPtr()
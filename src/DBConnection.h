@@ -18,7 +18,9 @@ Paul Licameli -- split from ProjectFileIO.h
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "ClientData.h"
 #include "Identifier.h"
@@ -28,6 +30,8 @@ struct sqlite3_stmt;
 class wxString;
 class AudacityProject;
 
+using SampleBlockID = long long;
+
 struct DBConnectionErrors
 {
    TranslatableString mLastError;
@@ -72,19 +76,96 @@ public:
    enum StatementID
    {
       GetSamples,
+      GetSamplesBatch,
       GetSummary256,
       GetSummary64k,
       LoadSampleBlock,
+      LoadCompressedSampleBlock,
       InsertSampleBlock,
+      InsertCompressedSampleBlock,
       DeleteSampleBlock,
       GetSampleBlockSize,
-      GetAllSampleBlocksSize
+      GetAllSampleBlocksSize,
+      GetSpectra,
+      SetSpectra,
+      DeleteSpectra
    };
    sqlite3_stmt *Prepare(enum StatementID id, const char *sql);
 
    void SetBypass( bool bypass );
    bool ShouldBypass();
 
+   //! Whether the sampleblocks table has the codec column, so that samples
+   //! may be stored compressed
+   /*! Detected on the first call.  The column is only added when a connection
+    is opened, before any sample block is read or written. */
+   bool HasSampleBlockCodec();
+
+   //! Whether the spectra table exists, so that spectra may be stored with
+   //! sample blocks
+   /*! Detected on the first call.  The table is only created when a
+    connection is opened. */
+   bool HasSpectra();
+
+   //! Choose the id for a new row of the sampleblocks table
+   /*! Rows may then be inserted out of order, by deferred updates.  Ids are
+    never reused while the connection is open, even if no row was inserted. */
+   SampleBlockID NewSampleBlockID();
+
+   //! Type of a function that updates the database, returning an sqlite3
+   //! result code
+   /*! It may run in the writer thread, so it reports failure only by the
+    result, leaving the flush that finds the failure to throw */
+   using DeferredUpdate = std::function<int()>;
+   //! Type of a function told of a change in the state of a deferred update
+   using DeferredCallback = std::function<void()>;
+
+   //! Schedule an update, to be applied in order with others in a writer
+   //! thread, which groups the updates into large transactions
+   /*!
+    Updates may join the savepoint of an open TransactionScope, which
+    flushes the rest at commit.  Those joined are not committed until the
+    outermost transaction is, and are applied again if it rolls back.
+
+    While a DeferralHold exists, the updates wait; but if the queue is full,
+    apply them now instead, in this thread, joining any open transaction.
+
+    If a batch fails, none of it is kept, but all of it stays queued.  The
+    writer thread then waits, and asks the main thread to flush, which
+    tries again and throws if the failure recurs.  So does any other flush,
+    which may be this function's.
+
+    @param onApplied called after the batch including update is applied,
+    perhaps in the writer thread; from then on, reads through this
+    connection find the update, even before an enclosing transaction commits
+    @param onReverted called for an applied update before the rollback of an
+    enclosing transaction undoes it, and queues it again; it should keep what
+    the update needs to apply again, while reads still find it
+    */
+   void Defer(DeferredUpdate update,
+      DeferredCallback onApplied = {}, DeferredCallback onReverted = {});
+
+   //! Apply all updates deferred so far, or throw for the failure that
+   //! prevents it
+   void FlushDeferred();
+
+   //! While any of these exists, no deferred update is applied in the
+   //! writer thread
+   /*! Construct one before writing to the database other than by deferred
+    updates, so that earlier ones are applied first, and no batch of them
+    interleaves; a failed batch rolls back all statements since it began. */
+   class DeferralHold
+   {
+   public:
+      //! Flushes deferred updates; may throw
+      explicit DeferralHold(DBConnection &connection);
+      DeferralHold(const DeferralHold&) = delete;
+      DeferralHold &operator=(const DeferralHold&) = delete;
+      ~DeferralHold();
+   private:
+      DBConnection &mConnection;
+   };
+
    //! Just set stored errors
    void SetError(
       const TranslatableString &msg,
@@ -104,6 +185,24 @@ private:
    void CheckpointThread(sqlite3 *db, const FilePath &fileName);
    static int CheckpointHook(void *data, sqlite3 *db, const char *schema, int pages);
 
+   void WriterThread();
+   void StopWriter();
+   //! Apply waiting deferred updates; the caller must lock mWriteMutex
+   /*! @return whether there is no failure */
+   bool ApplyDeferred();
+   //! Ask the main thread to flush again, and report the failure if it recurs
+   void PostDeferredFailure();
+   //! If no transaction is open, forget the updates that joined one, now
+   //! committed; the caller must lock mWriteMutex
+   void CommitJoined();
+   //! Undo the joined updates from the given index by rolling back the
+   //! savepoint they joined, and queue them again, first; the caller must
+   //! lock mWriteMutex
+   /*! @return the result of rollback */
+   int RollbackJoined(size_t first, const std::function<int()> &rollback);
+
+   friend struct DBConnectionTransactionScopeImpl;
+
 private:
    std::weak_ptr<AudacityProject> mpProject;
    sqlite3 *mDB;
@@ -125,6 +224,42 @@ private:
 
    // Bypass transactions if database will be deleted after close
    bool mBypass;
+
+   // Negative until detected
+   std::atomic<int> mHasSampleBlockCodec{ -1 };
+   std::atomic<int> mHasSpectra{ -1 };
+
+   // Nonpositive until initialized from the database
+   SampleBlockID mNextSampleBlockID{ 0 };
+   std::mutex mSampleBlockIDMutex;
+
+   struct Deferred {
+      DeferredUpdate update;
+      DeferredCallback onApplied;
+      DeferredCallback onReverted;
+   };
+   std::thread mWriterThread;
+   //! Guards mDeferred, mWriterStop, mDeferredFailed, and changes of mHolds
+   std::mutex mDeferredMutex;
+   //! Signals the writer when there is work, or it should stop
+   std::condition_variable mDeferredCondition;
+   //! Signals producers waiting for room in the queue
+   std::condition_variable mDeferredTaken;
+   std::vector<Deferred> mDeferred;
+   bool mWriterStop{ false };
+   //! Whether the last batch failed and waits, in mDeferred, for a flush
+   bool mDeferredFailed{ false };
+   //! Count of DeferralHold objects
+   std::atomic<int> mHolds{ 0 };
+   //! Held while applying deferred updates, or opening or closing a
+   //! TransactionScope savepoint; guards mDeferredErrorCode,
+   //! mDeferredErrorMessage, and mJoined
+   std::mutex mWriteMutex;
+   //! The result of the batch that waits for a flush, if it failed
+   int mDeferredErrorCode{ 0 };
+   std::string mDeferredErrorMessage;
+   //! Updates applied in an enclosing transaction, not yet committed
+   std::vector<Deferred> mJoined;
 };
 
 using Connection = std::unique_ptr<DBConnection>;
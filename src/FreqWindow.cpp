@@ -566,7 +566,6 @@ bool FrequencyPlotDialog::Show(bool show)
       dBRange = DecibelScaleCutoff.Read();
       if(dBRange < 90.)
          dBRange = 90.;
-      GetAudio();
       // Don't send an event.  We need the recalc right away.
       // so that mAnalyst is valid when we paint.
       //SendRecalcEvent();
@@ -578,64 +577,33 @@ bool FrequencyPlotDialog::Show(bool show)
    return res;
 }
 
-void FrequencyPlotDialog::GetAudio()
+auto FrequencyPlotDialog::GetAudio() -> Tracks
 {
-   mData.reset();
+   Tracks tracks;
    mDataLen = 0;
 
-   int selcount = 0;
-   bool warning = false;
+   auto &selectedRegion = ViewInfo::Get( *mProject ).selectedRegion;
    for (auto track : TrackList::Get( *mProject ).Selected< const WaveTrack >()) {
-      auto &selectedRegion = ViewInfo::Get( *mProject ).selectedRegion;
-      if (selcount==0) {
+      if (tracks.empty()) {
          mRate = track->GetRate();
-         auto start = track->TimeToLongSamples(selectedRegion.t0());
+         mStart = track->TimeToLongSamples(selectedRegion.t0());
          auto end = track->TimeToLongSamples(selectedRegion.t1());
-         auto dataLen = end - start;
-         // Permit approximately 46.60 minutes of selected samples at
-         // a sampling frequency of 48 kHz (11.65 minutes at 192 kHz).
-         auto maxDataLen = size_t(2) << 26;
-         if (dataLen > maxDataLen) {
-            warning = true;
-            mDataLen = maxDataLen;
-         }
-         else {
-            mDataLen = dataLen.as_size_t();
-         }
-         mData = Floats{ mDataLen };
-         // Don't allow throw for bad reads
-         track->GetFloats(mData.get(), start, mDataLen,
-                    fillZero, false);
+         mDataLen = end - mStart;
       }
-      else {
-         if (track->GetRate() != mRate) {
-            AudacityMessageBox(
-               XO(
+      else if (track->GetRate() != mRate) {
+         AudacityMessageBox(
+            XO(
 "To plot the spectrum, all selected tracks must be the same sample rate.") );
-            mData.reset();
-            mDataLen = 0;
-            return;
-         }
-         auto start = track->TimeToLongSamples(selectedRegion.t0());
-         Floats buffer2{ mDataLen };
-         // Again, stop exceptions
-         track->GetFloats(buffer2.get(), start, mDataLen,
-                    fillZero, false);
-         for (size_t i = 0; i < mDataLen; i++)
-            mData[i] += buffer2[i];
+         mDataLen = 0;
+         return {};
       }
-      selcount++;
-   }
-
-   if (selcount == 0)
-      return;
-
-   if (warning) {
-      auto msg = XO(
-"Too much audio was selected. Only the first %.1f seconds of audio will be analyzed.")
-         .Format(mDataLen / mRate);
-      AudacityMessageBox( msg );
+      // The copy is cheap, and edits of the track during the analysis
+      // don't change it.  Samples are read only as the analyst needs them,
+      // so there is no limit on the length of the selection.
+      tracks.push_back(
+         std::static_pointer_cast<const WaveTrack>(track->Duplicate()));
    }
+   return tracks;
 }
 
 void FrequencyPlotDialog::OnSize(wxSizeEvent & WXUNUSED(event))
@@ -671,7 +639,7 @@ void FrequencyPlotDialog::DrawBackground(wxMemoryDC & dc)
 
 void FrequencyPlotDialog::DrawPlot()
 {
-   if (!mData || mDataLen < mWindowSize || mAnalyst->GetProcessedSize() == 0) {
+   if (mDataLen < mWindowSize || mAnalyst->GetProcessedSize() == 0) {
       wxMemoryDC memDC;
 
       vRuler->ruler.SetLog(false);
@@ -889,7 +857,7 @@ void FrequencyPlotDialog::PlotPaint(wxPaintEvent & event)
 
    dc.DrawBitmap( *mBitmap, 0, 0, true );
    // Fix for Bug 1226 "Plot Spectrum freezes... if insufficient samples selected"
-   if (!mData || mDataLen < mWindowSize)
+   if (mDataLen < mWindowSize)
       return;
 
    dc.SetFont(mFreqFont);
@@ -999,7 +967,6 @@ void FrequencyPlotDialog::OnCloseButton(wxCommandEvent & WXUNUSED(event))
    gPrefs->Write(wxT("/FrequencyPlotDialog/FuncChoice"), mFuncChoice->GetSelection());
    gPrefs->Write(wxT("/FrequencyPlotDialog/AxisChoice"), mAxisChoice->GetSelection());
    gPrefs->Flush();
-   mData.reset();
    Show(false);
 }
 
@@ -1011,7 +978,9 @@ void FrequencyPlotDialog::SendRecalcEvent()
 
 void FrequencyPlotDialog::Recalc()
 {
-   if (!mData || mDataLen < mWindowSize) {
+   // Read the selection as it is now, and keep no copies after
+   const auto tracks = GetAudio();
+   if (tracks.empty() || mDataLen < mWindowSize) {
       DrawPlot();
       return;
    }
@@ -1031,9 +1000,16 @@ void FrequencyPlotDialog::Recalc()
          blocker.emplace(this);
       wxYieldIfNeeded();
 
+      // Count thousandths, because there may be fewer windows than bars
+      // in the gauge
+      static constexpr int progressRange = 1000;
+      mProgress->SetRange(progressRange);
       mAnalyst->Calculate(alg, windowFunc, mWindowSize, mRate,
-         mData.get(), mDataLen,
-         &mYMin, &mYMax, mProgress);
+         tracks, mStart, mDataLen,
+         &mYMin, &mYMax, [this](size_t done, size_t total){
+            mProgress->SetValue(int(progressRange * done / total));
+         });
+      mProgress->Reset();
    }
    if (hadFocus) {
       hadFocus->SetFocus();
@@ -1103,7 +1079,6 @@ void FrequencyPlotDialog::OnReplot(wxCommandEvent & WXUNUSED(event))
    dBRange = DecibelScaleCutoff.Read();
    if(dBRange < 90.)
       dBRange = 90.;
-   GetAudio();
    SendRecalcEvent();
 }
 
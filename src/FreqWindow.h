@@ -31,6 +31,7 @@ class AudacityProject;
 class FrequencyPlotDialog;
 class FreqGauge;
 class RulerPanel;
+class SampleTrack;
 
 DECLARE_EXPORTED_EVENT_TYPE(AUDACITY_DLL_API, EVT_FREQWINDOW_RECALC, -1);
 
@@ -67,7 +68,10 @@ public:
 private:
    void Populate();
 
-   void GetAudio();
+   using Tracks = std::vector<std::shared_ptr<const SampleTrack>>;
+   //! Copies of the selected tracks, sharing their sample blocks; sets
+   //! mRate, mStart and mDataLen
+   Tracks GetAudio();
 
    void PlotMouseEvent(wxMouseEvent & event);
    void PlotPaint(wxPaintEvent & event);
@@ -137,8 +141,8 @@ private:
 
 
    double mRate;
-   size_t mDataLen;
-   Floats mData;
+   sampleCount mStart;
+   sampleCount mDataLen;
    size_t mWindowSize;
 
    bool mLogAxis;
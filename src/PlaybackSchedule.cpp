@@ -69,7 +69,7 @@ double PlaybackPolicy::OffsetTrackTime(
 std::chrono::milliseconds PlaybackPolicy::SleepInterval(PlaybackSchedule &)
 {
    using namespace std::chrono;
-   return 10ms;
+   return 50ms;
 }
 
 PlaybackSlice
@@ -115,7 +115,10 @@ public:
 
    //! @section Called by the AudioIO::TrackBufferExchange thread
 
-   //! How long to wait between calls to AudioIO::TrackBufferExchange
+   //! Longest wait between calls to AudioIO::TrackBufferExchange
+   /*! The PortAudio callback wakes the audio thread sooner, whenever the
+    ring buffers need service, so this need be short only for policies that
+    must poll other state */
    virtual std::chrono::milliseconds
       SleepInterval( PlaybackSchedule &schedule );
 
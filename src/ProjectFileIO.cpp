@@ -10,10 +10,13 @@ Paul Licameli split from AudacityProject.cpp
 
 #include "ProjectFileIO.h"
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <sqlite3.h>
 #include <optional>
 #include <cstring>
+#include <unordered_map>
 
 #include <wx/app.h>
 #include <wx/crt.h>
@@ -69,6 +72,10 @@ wxDEFINE_EVENT( EVT_RECONNECTION_FAILURE, wxCommandEvent);
 // types, such as the Linux "file" command.
 static const int ProjectFileID = PACK('A', 'U', 'D', 'Y');
 
+// Pages freed by each step of ProjectFileIO::VacuumIncrementally(); with the
+// page size of DBConnection, 4 MB, which takes milliseconds to move
+static const int IncrementalVacuumPages = 64;
+
 // The "ProjectFileVersion" represents the version of Audacity at which a specific
 // database schema was used. It is assumed that any changes to the database schema
 // will require a new Audacity version so if schema changes are required set this
@@ -98,6 +105,9 @@ static const char *ProjectFileSchema =
    //
    // See the CMakeList.txt for the SQLite lib for more
    // settings.
+   // Takes effect only before anything is written, so only new files, and
+   // copies, free unused pages in place.  See VacuumIncrementally().
+   "PRAGMA <schema>.auto_vacuum = INCREMENTAL;"
    "PRAGMA <schema>.application_id = %d;"
    "PRAGMA <schema>.user_version = %u;"
    ""
@@ -166,6 +176,52 @@ static const char *ProjectFileSchema =
    "  samples              BLOB"
    ");";
 
+// CREATE SQL sampleblocks codec
+// Added only to projects that store compressed samples, so that others
+// remain readable by older versions.  Zero means raw samples; other values
+// are those of SampleCompression::Codec.  The length of a compressed samples
+// blob is not that of the samples; the count is in the head of the blob.
+static const char *SampleBlockCodecSchema =
+   "ALTER TABLE <schema>.sampleblocks"
+   "  ADD COLUMN codec INTEGER NOT NULL DEFAULT 0;";
+
+// CREATE SQL spectra
+// Spectra of windows of samples lying within single sample blocks, cached
+// for drawing spectrograms.  Rows are keyed by the block and by the settings
+// that determine the spectra.  Blocks are immutable, so rows never become
+// stale, but are deleted with their blocks.
+//
+// Older versions of Audacity ignore this table, so it does not change the
+// project format version.
+static const char *SpectraSchema =
+   "CREATE TABLE IF NOT EXISTS <schema>.spectra"
+   "("
+   "  blockid              INTEGER NOT NULL,"
+   "  settings             INTEGER NOT NULL,"
+   "  frames               BLOB,"
+   "  PRIMARY KEY (blockid, settings)"
+   ");";
+
+// CREATE SQL autosavedelta
+// Changes to the autosave document since it was last written whole.  Each
+// row describes the whole document as a sequence of pieces, each a range of
+// bytes of the doc of the autosave row, of an earlier row of this table, or
+// of this row.  Only the row with the greatest id is current, and its dict
+// applies.  See ProjectFileIO::WriteAutoSave().
+//
+// Older versions of Audacity ignore this table, so it does not change the
+// project format version; they recover only the autosave document.
+static const char *AutoSaveDeltaSchema =
+   "CREATE TABLE IF NOT EXISTS <schema>.autosavedelta"
+   "("
+   "  id                   INTEGER PRIMARY KEY,"
+   "  dict                 BLOB,"
+   "  doc                  BLOB"
+   ");";
+
+BoolSetting CompressSampleBlocks{ L"/FileFormats/CompressSampleBlocks", false };
+BoolSetting StoreSpectra{ L"/FileFormats/StoreSpectra", false };
+
 // This singleton handles initialization/shutdown of the SQLite library.
 // It is needed because our local SQLite is built with SQLITE_OMIT_AUTOINIT
 // defined.
@@ -331,6 +387,17 @@ public:
       return mOffset == mBlobSize;
    }
 
+   size_t GetSize() const noexcept
+   {
+      return mBlobSize;
+   }
+
+   //! Move to the given offset, or to the end if it is beyond
+   void Seek(size_t offset) noexcept
+   {
+      mOffset = static_cast<int>(std::min(offset, mBlobSize));
+   }
+
 private:
    sqlite3_blob* mBlob { nullptr };
    size_t mBlobSize { 0 };
@@ -422,6 +489,167 @@ protected:
 
 constexpr std::array<const char*, 2> BufferedProjectBlobStream::Columns;
 
+namespace {
+//! One range of bytes of an autosave document, as an autosavedelta row
+//! lists it
+struct AutoSaveDeltaPiece
+{
+   //! 0 for the autosave row, else the id of an autosavedelta row
+   int64_t row;
+   uint64_t offset;
+   uint64_t length;
+};
+
+/*!
+ The doc of an autosavedelta row begins with a count of pieces, then as
+ many AutoSaveDeltaPiece structures, then the bytes of the pieces that
+ the row stores itself.  All are in native byte order.
+ */
+using AutoSaveDeltaCount = uint32_t;
+
+constexpr size_t AutoSaveDeltaHeadSize(size_t nPieces)
+{
+   return sizeof(AutoSaveDeltaCount) + nPieces * sizeof(AutoSaveDeltaPiece);
+}
+}
+
+//! Reads the dict of an autosavedelta row, then the pieces of the document
+//! that the row lists, from wherever they are
+class BufferedAutoSaveDeltaStream : public BufferedStreamReader
+{
+public:
+   BufferedAutoSaveDeltaStream(
+      sqlite3* db, int64_t autoSaveRowID, int64_t deltaRowID)
+       : BufferedStreamReader(32 * 1024)
+       , mDB(db)
+       , mAutoSaveRowID(autoSaveRowID)
+       , mDeltaRowID(deltaRowID)
+   {
+      mValid = ReadPieces();
+   }
+
+   //! Whether the list of pieces could be read
+   bool IsValid() const noexcept
+   {
+      return mValid;
+   }
+
+private:
+   bool ReadPieces()
+   {
+      auto blobStream = SQLiteBlobStream::Open(
+         mDB, "main", "autosavedelta", "doc", mDeltaRowID, true);
+      if (!blobStream)
+         return false;
+
+      const auto readAll = [&](void* buffer, size_t bytes) {
+         auto bytesRead = static_cast<int>(bytes);
+         return SQLITE_OK == blobStream->Read(buffer, bytesRead) &&
+            bytesRead == static_cast<int>(bytes);
+      };
+
+      AutoSaveDeltaCount count = 0;
+      if (!readAll(&count, sizeof(count)) ||
+          AutoSaveDeltaHeadSize(count) > blobStream->GetSize())
+         return false;
+
+      mPieces.resize(count);
+      return count == 0 ||
+         readAll(mPieces.data(), count * sizeof(AutoSaveDeltaPiece));
+   }
+
+   //! Open the dict, or else the next piece
+   bool OpenNext()
+   {
+      if (!mValid || mNextIndex > mPieces.size())
+      {
+         mBlobStream.reset();
+         return false;
+      }
+
+      if (mNextIndex++ == 0)
+      {
+         mBlobStream = SQLiteBlobStream::Open(
+            mDB, "main", "autosavedelta", "dict", mDeltaRowID, true);
+         mOpenRow = -1;
+         if (mBlobStream)
+            mRemaining = mBlobStream->GetSize();
+      }
+      else
+      {
+         const auto &piece = mPieces[mNextIndex - 2];
+         if (!mBlobStream || mOpenRow != piece.row)
+         {
+            mBlobStream = piece.row == 0
+               ? SQLiteBlobStream::Open(
+                  mDB, "main", "autosave", "doc", mAutoSaveRowID, true)
+               : SQLiteBlobStream::Open(
+                  mDB, "main", "autosavedelta", "doc", piece.row, true);
+            mOpenRow = piece.row;
+         }
+         if (mBlobStream)
+         {
+            if (piece.offset + piece.length > mBlobStream->GetSize())
+               mBlobStream.reset();
+            else
+            {
+               mBlobStream->Seek(piece.offset);
+               mRemaining = piece.length;
+            }
+         }
+      }
+
+      mValid = mBlobStream.has_value();
+      return mValid;
+   }
+
+   std::optional<SQLiteBlobStream> mBlobStream;
+   //! The row of the open blob, or -1 for the dict
+   int64_t mOpenRow { -1 };
+   //! Bytes of the dict or of the current piece not yet read
+   uint64_t mRemaining { 0 };
+   //! 0 for the dict, else one more than the index of the next piece
+   size_t mNextIndex { 0 };
+   std::vector<AutoSaveDeltaPiece> mPieces;
+   bool mValid { false };
+
+   sqlite3* mDB;
+   const int64_t mAutoSaveRowID;
+   const int64_t mDeltaRowID;
+
+protected:
+   bool HasMoreData() const override
+   {
+      return mValid && (mRemaining > 0 || mNextIndex <= mPieces.size());
+   }
+
+   size_t ReadData(void* buffer, size_t maxBytes) override
+   {
+      while (mRemaining == 0)
+      {
+         if (!OpenNext())
+            return {};
+      }
+
+      // Do not allow reading more then 2GB at a time (O_o)
+      maxBytes = std::min<uint64_t>(
+         { maxBytes, mRemaining, uint64_t(std::numeric_limits<int>::max()) });
+      auto bytesRead = static_cast<int>(maxBytes);
+
+      if (SQLITE_OK != mBlobStream->Read(buffer, bytesRead) || bytesRead == 0)
+      {
+         // Reading has failed, close the stream and do not allow opening
+         // another
+         mBlobStream.reset();
+         mValid = false;
+         return {};
+      }
+
+      mRemaining -= bytesRead;
+      return bytesRead;
+   }
+};
+
 bool ProjectFileIO::InitializeSQL()
 {
    static SQLiteIniter sqliteIniter;
@@ -835,7 +1063,12 @@ bool ProjectFileIO::CheckVersion()
    // must be a new project file.
    if (wxStrtol<char **>(result, nullptr, 10) == 0)
    {
-      return InstallSchema(db);
+      if (!(InstallSchema(db) &&
+         (!CompressSampleBlocks.Read() || InstallSampleBlockCodec(db)) &&
+         (!StoreSpectra.Read() || InstallSpectra(db))))
+         return false;
+      InstallAutoSaveDeltas(db);
+      return true;
    }
 
    // Check for our application ID
@@ -869,7 +1102,31 @@ bool ProjectFileIO::CheckVersion()
       );
       return false;
    }
-   
+
+   if (CompressSampleBlocks.Read())
+   {
+      int64_t hasCodec = 0;
+      if (!GetValue("SELECT Count(*) FROM pragma_table_info('sampleblocks')"
+                    "  WHERE name = 'codec';", hasCodec))
+      {
+         return false;
+      }
+
+      if (hasCodec == 0 && !InstallSampleBlockCodec(db))
+      {
+         return false;
+      }
+   }
+
+   if (StoreSpectra.Read())
+   {
+      // Only a cache; do without it if the file can't be changed
+      InstallSpectra(db);
+   }
+
+   // Without it, every autosave writes the whole document
+   InstallAutoSaveDeltas(db);
+
    return true;
 }
 
@@ -893,6 +1150,40 @@ bool ProjectFileIO::InstallSchema(sqlite3 *db, const char *schema /* = "main" */
    return true;
 }
 
+bool ProjectFileIO::InstallSampleBlockCodec(
+   sqlite3 *db, const char *schema /* = "main" */)
+{
+   wxString sql{ SampleBlockCodecSchema };
+   sql.Replace("<schema>", schema);
+
+   if (sqlite3_exec(db, sql, nullptr, nullptr, nullptr) != SQLITE_OK)
+   {
+      SetDBError(
+         XO("Unable to initialize the project file")
+      );
+      return false;
+   }
+
+   return true;
+}
+
+bool ProjectFileIO::InstallSpectra(sqlite3 *db, const char *schema /* = "main" */)
+{
+   wxString sql{ SpectraSchema };
+   sql.Replace("<schema>", schema);
+
+   return sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+bool ProjectFileIO::InstallAutoSaveDeltas(
+   sqlite3 *db, const char *schema /* = "main" */)
+{
+   wxString sql{ AutoSaveDeltaSchema };
+   sql.Replace("<schema>", schema);
+
+   return sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
 // The orphan block handling should be removed once autosave and related
 // blocks become part of the same transaction.
 
@@ -912,6 +1203,9 @@ bool ProjectFileIO::DeleteBlocks(const BlockIDs &blockids, bool complement)
    auto db = DB();
    int rc;
 
+   // Let no deferred block writes interleave
+   DBConnection::DeferralHold hold{ GetConnection() };
+
    auto cleanup = finally([&]
    {
       // Remove our function, whether it was successfully defined or not.
@@ -980,6 +1274,16 @@ bool ProjectFileIO::DeleteBlocks(const BlockIDs &blockids, bool complement)
       mRecovered = true;
    }
 
+   // Spectra of the deleted blocks are useless; failing to delete them
+   // only wastes space
+   if (GetConnection().HasSpectra())
+   {
+      sql = wxString::Format(
+         "DELETE FROM spectra WHERE %sinset(blockid);",
+         complement ? "NOT " : "" );
+      sqlite3_exec(db, sql, nullptr, nullptr, nullptr);
+   }
+
    return true;
 }
 
@@ -993,6 +1297,10 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
    if (!pConn)
       return false;
 
+   // Write all sample blocks first, and let no more be written until the
+   // copy is done
+   DBConnection::DeferralHold hold{ *pConn };
+
    // Get access to the active tracklist
    auto pProject = &mProject;
 
@@ -1108,6 +1416,13 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
       return false;
    }
 
+   // Match the columns of the source, so that rows copy verbatim
+   if (pConn->HasSampleBlockCodec() && !InstallSampleBlockCodec(db, "outbound"))
+   {
+      // Message already set
+      return false;
+   }
+
    {
       // Ensure statement gets cleaned up
       sqlite3_stmt *stmt = nullptr;
@@ -1208,6 +1523,15 @@ bool ProjectFileIO::CopyTo(const FilePath &destpath,
          }
       }
 
+      // Keep the spectra of the copied blocks; they are only a cache, so
+      // failure is no reason to fail the copy
+      if (pConn->HasSpectra() && InstallSpectra(db, "outbound"))
+         sqlite3_exec(db,
+            "INSERT INTO outbound.spectra"
+            "  SELECT * FROM main.spectra"
+            "  WHERE blockid IN (SELECT blockid FROM outbound.sampleblocks);",
+            nullptr, nullptr, nullptr);
+
       // Write the doc.
       //
       // If we're compacting a temporary project (user initiated from the File
@@ -1506,6 +1830,13 @@ void ProjectFileIO::Compact(
       }
    }
 
+   // Files that free pages in place need no copy, whatever their size
+   if (IsIncrementallyVacuumed())
+   {
+      CompactInPlace(tracks, force);
+      return;
+   }
+
    wxString origName = mFileName;
    wxString backName = origName + "_compact_back";
    wxString tempName = origName + "_compact_temp";
@@ -1605,6 +1936,121 @@ void ProjectFileIO::Compact(
    return;
 }
 
+void ProjectFileIO::CompactInPlace(
+   const std::vector<const TrackList *> &tracks, bool force)
+{
+   auto pConn = CurrConn().get();
+   if (!pConn)
+      return;
+
+   {
+      // Write all sample blocks first, and let no more be written until the
+      // unused ones are gone, as in CopyTo()
+      DBConnection::DeferralHold hold{ *pConn };
+
+      // Delete the blocks and rewrite the doc in one transaction, so that
+      // no doc survives a crash or a failure that refers to deleted blocks,
+      // as the original file did when CopyTo() failed
+      TransactionScope transaction(mProject, "CompactInPlace");
+
+      // Delete the blocks that a pruning CopyTo() would not copy
+      if (!tracks.empty())
+      {
+         bool recovered = mRecovered;
+         SampleBlockIDSet blockids;
+         for (auto pTracks : tracks)
+            if (pTracks)
+               InspectBlocks( *pTracks, {}, &blockids );
+         if (!DeleteBlocks(blockids, true))
+            return;
+         // Don't set mRecovered if any were deleted
+         mRecovered = recovered;
+      }
+
+      // Write the doc that CopyTo() would write, in the same table
+      ProjectSerializer doc;
+      std::vector<size_t> bounds{ 0 };
+      WriteXMLHeader(doc);
+      WriteXML(doc, false, tracks.empty() ? nullptr : tracks[0], [&]{
+         bounds.push_back(doc.GetData().GetSize());
+      });
+      bounds.push_back(doc.GetData().GetSize());
+      if (IsTemporary())
+      {
+         // The delta rows refer to offsets in the autosave row, and so must
+         // go with it.  Forgetting them, WriteAutoSave() writes the whole doc
+         // and deletes the rows in one transaction, and the next autosave
+         // makes deltas from this doc.
+         mpAutoSaveDeltas.reset();
+         if (!WriteAutoSave(doc, bounds))
+            return;
+      }
+      else if (!WriteDoc("project", doc) || !AutoSaveDelete())
+         return;
+
+      if (!transaction.Commit())
+         return;
+   }
+
+   // The committed deletion left free pages, which later writes reuse in any
+   // case.  Give them back to the file system:  all now, if the user asked;
+   // else as much as a short time allows, and the rest in idle time, or at
+   // the next close.
+   if (force)
+      while (!VacuumIncrementally(std::chrono::seconds{ 1 }))
+         ;
+   else
+      VacuumIncrementally(std::chrono::seconds{ 2 });
+
+   // As after a successful copy, the file has no blocks that the undo
+   // history might still delete
+   mWasCompacted = true;
+}
+
+bool ProjectFileIO::IsIncrementallyVacuumed()
+{
+   int64_t mode = 0;
+   // 2 is INCREMENTAL
+   return CurrConn() && GetValue("PRAGMA auto_vacuum;", mode, true) && mode == 2;
+}
+
+bool ProjectFileIO::VacuumIncrementally(std::chrono::milliseconds budget)
+{
+   auto pConn = CurrConn().get();
+   if (!pConn || !IsIncrementallyVacuumed())
+      return true;
+
+   // Usually there is nothing to free; then don't stop the deferred writes
+   int64_t freePages = 0;
+   if (!GetValue("PRAGMA freelist_count;", freePages, true) || freePages == 0)
+      return true;
+
+   // Let no deferred block writes interleave
+   DBConnection::DeferralHold hold{ *pConn };
+
+   const auto deadline = std::chrono::steady_clock::now() + budget;
+   while (true)
+   {
+      if (std::chrono::steady_clock::now() >= deadline)
+         return false;
+
+      // Each step moves pages from the end of the file into free pages, and
+      // truncates the file, in one short transaction.  The checkpoint after
+      // the commit truncates the file on disk.
+      const auto sql = wxString::Format(
+         "PRAGMA incremental_vacuum(%d);", IncrementalVacuumPages);
+      if (sqlite3_exec(DB(), sql, nullptr, nullptr, nullptr) != SQLITE_OK)
+      {
+         wxLogWarning(wxT("Incremental vacuum failed: %s"),
+            sqlite3_errmsg(DB()));
+         return true;
+      }
+
+      if (!GetValue("PRAGMA freelist_count;", freePages, true) || freePages == 0)
+         return true;
+   }
+}
+
 bool ProjectFileIO::WasCompacted()
 {
    return mWasCompacted;
@@ -1682,6 +2128,9 @@ void ProjectFileIO::SetFileName(const FilePath &fileName)
 
    mFileName = fileName;
 
+   // The connection may have changed too; the next autosave writes all
+   mpAutoSaveDeltas.reset();
+
    if (!mFileName.empty())
    {
       ActiveProjects::Add(mFileName);
@@ -1807,7 +2256,8 @@ void ProjectFileIO::WriteXMLHeader(XMLWriter &xmlFile) const
 
 void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
                              bool recording /* = false */,
-                             const TrackList *tracks /* = nullptr */)
+                             const TrackList *tracks /* = nullptr */,
+                             const std::function<void()> &beforeTrack /* = {} */)
 // may throw
 {
    auto &proj = mProject;
@@ -1840,21 +2290,117 @@ void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
          // when pushing.  Don't auto-save it.
          return;
       }
+      if (beforeTrack)
+         beforeTrack();
       useTrack->WriteXML(xmlFile);
    });
 
+   if (beforeTrack)
+      beforeTrack();
    xmlFile.EndTag(wxT("project"));
 
    //TIMER_STOP( xml_writer_timer );
 }
 
+namespace {
+//! Digest of a piece of a document, wide enough that pieces with equal
+//! digests and lengths may be taken as equal
+/*! Each of the two words is made by a chain of steps that are one-to-one in
+ the 64 bits of input, so pieces differing in only one such word of input
+ always differ in digest. */
+struct AutoSaveDigest
+{
+   uint64_t a, b;
+   bool operator ==(const AutoSaveDigest &other) const
+   { return a == other.a && b == other.b; }
+};
+
+AutoSaveDigest DigestAutoSavePiece(const char *bytes, size_t length)
+{
+   AutoSaveDigest digest{
+      0x9E3779B97F4A7C15ull ^ length, 0xC2B2AE3D27D4EB4Full + length };
+   const auto step = [&](uint64_t word){
+      digest.a = (digest.a ^ word) * 0xFF51AFD7ED558CCDull;
+      digest.a ^= digest.a >> 32;
+      digest.b = (digest.b + word) * 0xC4CEB9FE1A85EC53ull;
+      digest.b ^= digest.b >> 29;
+   };
+   size_t ii = 0;
+   for (; ii + sizeof(uint64_t) <= length; ii += sizeof(uint64_t))
+   {
+      uint64_t word;
+      memcpy(&word, bytes + ii, sizeof(word));
+      step(word);
+   }
+   uint64_t word = 0;
+   memcpy(&word, bytes + ii, length - ii);
+   step(word);
+   return digest;
+}
+}
+
+struct ProjectFileIO::AutoSaveDeltas
+{
+   struct Piece
+   {
+      //! Range of the bytes in the document when it was written; only the
+      //! length is used later
+      size_t begin, end;
+      AutoSaveDigest digest;
+      //! Where the bytes are stored, as AutoSaveDeltaPiece describes
+      int64_t row;
+      uint64_t offset;
+   };
+
+   //! The connection to which everything below was written
+   const DBConnection *pConnection{};
+   //! Whether deltas can be written at all
+   bool hasTable{};
+   //! Digests only, not the bytes of the previous document, are kept
+   std::vector<Piece> pieces;
+   //! Size of the doc of the autosave row
+   size_t baseSize{};
+   //! Total size of the docs of the autosavedelta rows
+   size_t deltaSize{};
+   //! Greatest id of the autosavedelta rows, 0 if there are none
+   int64_t lastRow{};
+};
+
+namespace {
+//! After so many deltas, the next autosave writes the whole document
+constexpr int64_t MaxAutoSaveDeltas = 100;
+
+//! Whether the file has the table, which it might lack if it could not be
+//! changed when opened
+bool HasAutoSaveDeltas(sqlite3 *db)
+{
+   return SQLITE_OK == sqlite3_table_column_metadata(db, "main",
+      "autosavedelta", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
+}
+
+//! Delete all rows of autosavedelta, if the table exists
+bool DeleteAutoSaveDeltas(sqlite3 *db)
+{
+   if (!HasAutoSaveDeltas(db))
+      return true;
+   return SQLITE_OK == sqlite3_exec(
+      db, "DELETE FROM autosavedelta;", nullptr, nullptr, nullptr);
+}
+}
+
 bool ProjectFileIO::AutoSave(bool recording)
 {
    ProjectSerializer autosave;
+   // Divide the document into the part before the tracks, each track, and
+   // the end, so that the next autosave can find what is unchanged
+   std::vector<size_t> bounds{ 0 };
    WriteXMLHeader(autosave);
-   WriteXML(autosave, recording);
+   WriteXML(autosave, recording, nullptr, [&]{
+      bounds.push_back(autosave.GetData().GetSize());
+   });
+   bounds.push_back(autosave.GetData().GetSize());
 
-   if (WriteDoc("autosave", autosave))
+   if (WriteAutoSave(autosave, bounds))
    {
       mModified = true;
       return true;
@@ -1863,16 +2409,139 @@ bool ProjectFileIO::AutoSave(bool recording)
    return false;
 }
 
+bool ProjectFileIO::WriteAutoSave(
+   const ProjectSerializer &doc, const std::vector<size_t> &bounds)
+{
+   using Piece = AutoSaveDeltas::Piece;
+
+   const auto &data = doc.GetData();
+   // Make the data contiguous, once
+   const auto bytes = static_cast<const char*>(data.GetData());
+   std::vector<Piece> pieces;
+   for (size_t ii = 1; ii < bounds.size(); ++ii)
+   {
+      const auto begin = bounds[ii - 1], end = bounds[ii];
+      pieces.push_back({ begin, end,
+         DigestAutoSavePiece(bytes + begin, end - begin) });
+   }
+
+   auto &conn = GetConnection();
+   auto &pDeltas = mpAutoSaveDeltas;
+   if (pDeltas && pDeltas->pConnection == &conn && pDeltas->hasTable &&
+       pDeltas->lastRow < MaxAutoSaveDeltas)
+   {
+      // Find pieces unchanged since the last autosave, usually all tracks
+      // but those just edited, and store only the others
+      std::unordered_multimap<uint64_t, const Piece*> oldPieces;
+      for (auto &piece : pDeltas->pieces)
+         oldPieces.emplace(piece.digest.a, &piece);
+
+      const auto row = pDeltas->lastRow + 1;
+      const auto headSize = AutoSaveDeltaHeadSize(pieces.size());
+      std::vector<char> literals;
+      std::vector<AutoSaveDeltaPiece> head;
+      for (auto &piece : pieces)
+      {
+         const auto length = piece.end - piece.begin;
+         const Piece *pFound = nullptr;
+         for (auto [iter, end] = oldPieces.equal_range(piece.digest.a);
+              iter != end; ++iter)
+         {
+            auto pOld = iter->second;
+            if (pOld->end - pOld->begin == length &&
+                pOld->digest == piece.digest)
+            {
+               pFound = pOld;
+               break;
+            }
+         }
+         if (pFound)
+         {
+            piece.row = pFound->row;
+            piece.offset = pFound->offset;
+         }
+         else
+         {
+            piece.row = row;
+            piece.offset = headSize + literals.size();
+            literals.insert(literals.end(),
+               bytes + piece.begin, bytes + piece.end);
+         }
+         head.push_back({ piece.row, piece.offset, length });
+      }
+
+      const auto deltaSize = headSize + literals.size();
+      // Bound the space the deltas take, and the time to recover from them
+      if (pDeltas->deltaSize + deltaSize <= pDeltas->baseSize)
+      {
+         MemoryStream delta;
+         const AutoSaveDeltaCount count = head.size();
+         delta.AppendData(&count, sizeof(count));
+         delta.AppendData(head.data(), head.size() * sizeof(head[0]));
+         delta.AppendData(literals.data(), literals.size());
+
+         if (WriteDoc("autosavedelta", doc.GetDict(), delta, "main", row))
+         {
+            pDeltas->pieces = std::move(pieces);
+            pDeltas->deltaSize += deltaSize;
+            pDeltas->lastRow = row;
+            return true;
+         }
+         // Fall back to writing all
+      }
+   }
+
+   // Write the whole document, and discard the deltas, which refer to the
+   // old one
+   pDeltas.reset();
+   {
+      // DeleteAutoSaveDeltas() writes directly too
+      DBConnection::DeferralHold hold{ conn };
+      TransactionScope transaction(mProject, "AutoSave");
+      if (!WriteDoc("autosave", doc))
+         return false;
+      if (!DeleteAutoSaveDeltas(DB()))
+      {
+         SetDBError(
+            XO("Failed to remove the autosave information from the project file.")
+         );
+         return false;
+      }
+      if (!transaction.Commit())
+         return false;
+   }
+
+   for (auto &piece : pieces)
+   {
+      piece.row = 0;
+      piece.offset = piece.begin;
+   }
+   pDeltas = std::make_unique<AutoSaveDeltas>();
+   pDeltas->pConnection = &conn;
+   pDeltas->hasTable = HasAutoSaveDeltas(DB());
+   pDeltas->baseSize = data.GetSize();
+   pDeltas->pieces = std::move(pieces);
+   return true;
+}
+
 bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
 {
    int rc;
 
+   std::optional<DBConnection::DeferralHold> hold;
    if (!db)
    {
       db = DB();
+      hold.emplace(GetConnection());
    }
 
+   mpAutoSaveDeltas.reset();
+
    rc = sqlite3_exec(db, "DELETE FROM autosave;", nullptr, nullptr, nullptr);
+   if (rc == SQLITE_OK && !DeleteAutoSaveDeltas(db))
+   {
+      rc = sqlite3_errcode(db);
+   }
    if (rc != SQLITE_OK)
    {
       ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
@@ -1892,21 +2561,32 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
 bool ProjectFileIO::WriteDoc(const char *table,
                              const ProjectSerializer &autosave,
                              const char *schema /* = "main" */)
+{
+   return WriteDoc(table, autosave.GetDict(), autosave.GetData(), schema);
+}
+
+bool ProjectFileIO::WriteDoc(const char *table,
+                             const MemoryStream &dict,
+                             const MemoryStream &data,
+                             const char *schema /* = "main" */,
+                             int64_t id /* = 1 */)
 {
    auto db = DB();
 
+   // Let no deferred block writes interleave
+   DBConnection::DeferralHold hold{ GetConnection() };
    TransactionScope transaction(mProject, "UpdateProject");
 
    int rc;
 
-   // For now, we always use an ID of 1. This will replace the previously
-   // written row every time.
+   // The project and autosave docs always use an ID of 1. This will replace
+   // the previously written row every time.
    char sql[256];
    sqlite3_snprintf(
       sizeof(sql), sql,
-      "INSERT INTO %s.%s(id, dict, doc) VALUES(1, ?1, ?2)"
+      "INSERT INTO %s.%s(id, dict, doc) VALUES(%lld, ?1, ?2)"
       "       ON CONFLICT(id) DO UPDATE SET dict = ?1, doc = ?2;",
-      schema, table);
+      schema, table, static_cast<long long>(id));
 
    sqlite3_stmt *stmt = nullptr;
    auto cleanup = finally([&]
@@ -1930,9 +2610,6 @@ bool ProjectFileIO::WriteDoc(const char *table,
       return false;
    }
 
-   const MemoryStream& dict = autosave.GetDict();
-   const MemoryStream& data = autosave.GetData();
-
    // Bind statement parameters
    // Might return SQL_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
@@ -1975,7 +2652,8 @@ bool ProjectFileIO::WriteDoc(const char *table,
    int64_t rowID = 0;
 
    const wxString rowIDSql =
-      wxString::Format("SELECT ROWID FROM %s.%s WHERE id = 1;", schema, table);
+      wxString::Format("SELECT ROWID FROM %s.%s WHERE id = %lld;",
+         schema, table, static_cast<long long>(id));
 
    if (!GetValue(rowIDSql, rowID, true))
    {
@@ -2103,11 +2781,32 @@ bool ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
    }
    else
    {
+      // The autosave document may have changed since it was written whole;
+      // then the last of the deltas describes it
+      int64_t deltaRowId = -1;
+      std::optional<BufferedAutoSaveDeltaStream> deltaStream;
+      if (useAutosave &&
+          GetValue("SELECT ROWID FROM main.autosavedelta"
+             "  ORDER BY ROWID DESC LIMIT 1;",
+             deltaRowId, true) &&
+          deltaRowId > 0)
+      {
+         deltaStream.emplace(DB(), rowId, deltaRowId);
+         if (!deltaStream->IsValid())
+         {
+            // Recover what was last written whole
+            wxLogWarning("Ignoring unreadable autosave changes");
+            deltaStream.reset();
+         }
+      }
+
       // Load 'er up
       BufferedProjectBlobStream stream(
          DB(), "main", useAutosave ? "autosave" : "project", rowId);
 
-      success = ProjectSerializer::Decode(stream, this);
+      success = deltaStream
+         ? ProjectSerializer::Decode(*deltaStream, this)
+         : ProjectSerializer::Decode(stream, this);
 
       if (!success)
       {
@@ -2622,6 +3321,9 @@ int64_t ProjectFileIO::GetDiskUsage(DBConnection &conn, SampleBlockID blockid /*
 {
    sqlite3_stmt* stmt = nullptr;
 
+   // Measure rows of blocks still in memory too
+   conn.FlushDeferred();
+
    if (blockid == 0)
    {
       static const char* statement =
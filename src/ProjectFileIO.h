@@ -11,8 +11,11 @@ Paul Licameli split from AudacityProject.h
 #ifndef __AUDACITY_PROJECT_FILE_IO__
 #define __AUDACITY_PROJECT_FILE_IO__
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include <wx/event.h>
 
@@ -28,6 +31,7 @@ struct sqlite3_value;
 class AudacityProject;
 class DBConnection;
 struct DBConnectionErrors;
+class MemoryStream;
 class ProjectSerializer;
 class SqliteSampleBlock;
 class TrackList;
@@ -177,9 +181,19 @@ public:
    };
 
    // Remove all unused space within a project file
+   // Copies the file, unless it frees pages in place; see VacuumIncrementally()
    void Compact(
       const std::vector<const TrackList *> &tracks, bool force = false);
 
+   // Whether the file was made with auto_vacuum = INCREMENTAL, so that
+   // compaction needs no copy
+   bool IsIncrementallyVacuumed();
+
+   // Give free pages back to the file system, by moving pages from the end
+   // of the file into free ones, in steps until the time budget is spent.
+   // Returns false if free pages remain for another call.
+   bool VacuumIncrementally(std::chrono::milliseconds budget);
+
    // The last compact check did actually compact the project file if true
    bool WasCompacted();
 
@@ -207,8 +221,11 @@ private:
    void OnCheckpointFailure();
 
    void WriteXMLHeader(XMLWriter &xmlFile) const;
+   //! @param beforeTrack if not null, called before each track is written,
+   //! and after the last
    void WriteXML(XMLWriter &xmlFile, bool recording = false,
-      const TrackList *tracks = nullptr) /* not override */;
+      const TrackList *tracks = nullptr,
+      const std::function<void()> &beforeTrack = {}) /* not override */;
 
    // XMLTagHandler callback methods
    bool HandleXMLTag(const std::string_view& tag, const AttributesList &attrs) override;
@@ -246,9 +263,29 @@ private:
 
    bool CheckVersion();
    bool InstallSchema(sqlite3 *db, const char *schema = "main");
+   //! Add the column that allows compressed sample blocks
+   bool InstallSampleBlockCodec(sqlite3 *db, const char *schema = "main");
+   //! Add the table of spectra stored with sample blocks
+   /*! Does not set an error message on failure */
+   bool InstallSpectra(sqlite3 *db, const char *schema = "main");
+
+   //! Add the table of changes to the autosave document
+   /*! Does not set an error message on failure */
+   bool InstallAutoSaveDeltas(sqlite3 *db, const char *schema = "main");
 
    // Write project or autosave XML (binary) documents
    bool WriteDoc(const char *table, const ProjectSerializer &autosave, const char *schema = "main");
+   //! Write the row with the given id, replacing any
+   bool WriteDoc(const char *table,
+      const MemoryStream &dict, const MemoryStream &data,
+      const char *schema = "main", int64_t id = 1);
+
+   //! Write the autosave document, or only the pieces of it that changed
+   /*!
+    @param bounds where the pieces of the document begin, and its end
+    */
+   bool WriteAutoSave(
+      const ProjectSerializer &doc, const std::vector<size_t> &bounds);
 
    // Application defined function to verify blockid exists is in set of blockids
    static void InSet(sqlite3_context *context, int argc, sqlite3_value **argv);
@@ -276,6 +313,10 @@ private:
 
    bool ShouldCompact(const std::vector<const TrackList *> &tracks);
 
+   // Compact() without a copy:  delete unused blocks, then vacuum
+   void CompactInPlace(
+      const std::vector<const TrackList *> &tracks, bool force);
+
    // Gets values from SQLite B-tree structures
    static unsigned int get2(const unsigned char *ptr);
    static unsigned int get4(const unsigned char *ptr);
@@ -310,6 +351,10 @@ private:
    Connection mPrevConn;
    FilePath mPrevFileName;
    bool mPrevTemporary;
+
+   //! What the last autosave wrote, and where
+   struct AutoSaveDeltas;
+   std::unique_ptr<AutoSaveDeltas> mpAutoSaveDeltas;
 };
 
 class wxTopLevelWindow;
@@ -329,6 +374,17 @@ public:
 wxDECLARE_EXPORTED_EVENT(AUDACITY_DLL_API,
                          EVT_PROJECT_TITLE_CHANGE, wxCommandEvent);
 
+//! Whether projects opened or created hereafter store sample blocks with
+//! lossless compression
+/*! Doing so upgrades the schema, and older versions of Audacity can no longer
+ open the project */
+extern AUDACITY_DLL_API BoolSetting CompressSampleBlocks;
+
+//! Whether projects opened or created hereafter store the spectra computed
+//! for spectrograms, so they need not be computed again after reopening
+/*! Older versions of Audacity can still open the project */
+extern AUDACITY_DLL_API BoolSetting StoreSpectra;
+
 //! Makes a temporary project that doesn't display on the screen
 class AUDACITY_DLL_API InvisibleTemporaryProject
 {
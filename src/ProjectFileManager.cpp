@@ -49,6 +49,7 @@ Paul Licameli split from AudacityProject.cpp
 #include "toolbars/SelectionBar.h"
 #include "widgets/AudacityMessageBox.h"
 #include "widgets/FileHistory.h"
+#include "widgets/ProgressDialog.h"
 #include "widgets/UnwritableLocationErrorDialog.h"
 #include "widgets/Warning.h"
 #include "widgets/wxPanelWrapper.h"
@@ -56,7 +57,10 @@ Paul Licameli split from AudacityProject.cpp
 
 #include "HelpText.h"
 
+#include <atomic>
+#include <chrono>
 #include <optional>
+#include <thread>
 
 static const AudacityProject::AttachedObjects::RegisteredFactory sFileManagerKey{
    []( AudacityProject &parent ){
@@ -1331,6 +1335,173 @@ bool ProjectFileManager::Import(
    return true;
 }
 
+bool ProjectFileManager::Import(
+   const FilePaths &fileNames, bool addToHistory /* = true */)
+{
+   auto &project = mProject;
+   using BasicUI::ProgressResult;
+
+   //! A file to import, and what its import makes
+   struct Job {
+      FilePath fileName;
+      TrackHolders newTracks;
+      //! Only the tags found in the file
+      std::shared_ptr<Tags> pTags;
+      //! Null unless the file is importing in the background
+      ImportFileHandle::BackgroundImport work;
+      std::thread thread;
+      std::atomic<double> fraction{ 0 };
+      std::atomic<bool> finished{ false };
+      //! Files not imported, or never begun, are not added
+      ProgressResult result{ ProgressResult::Cancelled };
+      std::exception_ptr pException;
+   };
+   std::vector<std::unique_ptr<Job>> jobs;
+
+   // Projects and lists of files import now by themselves
+   for (const auto &fileName : fileNames) {
+      const auto extension = fileName.AfterLast('.');
+      if (extension.IsSameAs(wxT("aup3"), false) ||
+          extension.IsSameAs(wxT("lof"), false) ||
+          extension.IsSameAs(wxT("aup"), false)) {
+         Import(fileName, addToHistory);
+         continue;
+      }
+      jobs.push_back(std::make_unique<Job>());
+      jobs.back()->fileName = fileName;
+   }
+
+   // Probe a file and make its tracks in this thread, only when it may
+   // begin, so that no more files are open than import at once.  Files
+   // whose importers can't work in the background import now.
+   const auto prepare = [&](Job &job){
+      job.pTags = Tags::Get( project ).Duplicate();
+      job.pTags->Clear();
+      TranslatableString errorMessage;
+      bool success = Importer::Get().Import(project, job.fileName,
+         &WaveTrackFactory::Get( project ), job.newTracks, job.pTags.get(),
+         errorMessage, &job.work);
+      if (!errorMessage.empty()) {
+         // Error message derived from Importer::Import
+         // Additional help via a Help button links to the manual.
+         ShowErrorDialog( *ProjectFramePlacement(&project),
+            XO("Error Importing"), errorMessage, wxT("Importing_Audio"));
+      }
+      if (success && !job.work)
+         job.result = ProgressResult::Success;
+      return success && job.work;
+   };
+
+   // Import several files at once, each in a thread of its own; each
+   // decodes in yet another thread and stores channels in parallel
+   {
+      auto busy = valueRestorer( project.mbBusyImporting, true );
+      const size_t filesAtOnce =
+         std::max(1, ImportMultipleFilesAtOnce.Read());
+      // What the jobs are told when they report progress
+      std::atomic<ProgressResult> command{ ProgressResult::Success };
+      std::exception_ptr pException;
+      auto cleanup = finally([&]{
+         command.store(ProgressResult::Cancelled);
+         for (auto &pJob : jobs)
+            if (pJob->thread.joinable())
+               pJob->thread.join();
+      });
+
+      // Shown once the first file imports in the background
+      std::optional<ProgressDialog> dialog;
+      size_t next = 0, running = 0;
+      while (true) {
+         // Begin more imports, in the given order
+         for (; command.load() == ProgressResult::Success &&
+              running < filesAtOnce && next < jobs.size(); ++next) {
+            auto &job = *jobs[next];
+            if (!prepare(job))
+               continue;
+            if (!dialog)
+               dialog.emplace(XO("Import"),
+                  XO("Importing %s").Format(
+                     XP("%lld file", "%lld files", 0)(
+                        static_cast<long long>(jobs.size()))));
+            ++running;
+            job.thread = std::thread{ [&job, &command]{
+               try {
+                  job.result = job.work([&](double fraction){
+                     job.fraction.store(fraction, std::memory_order_relaxed);
+                     return command.load(std::memory_order_relaxed);
+                  });
+               }
+               catch (...) {
+                  job.pException = std::current_exception();
+               }
+               job.finished.store(true, std::memory_order_release);
+            } };
+         }
+         if (running == 0)
+            break;
+
+         double done = 0;
+         for (size_t ii = 0; ii < next; ++ii) {
+            auto &job = *jobs[ii];
+            if (job.thread.joinable() &&
+                job.finished.load(std::memory_order_acquire)) {
+               job.thread.join();
+               // Close the file now, not after all the others
+               job.work = nullptr;
+               --running;
+               if (job.pException) {
+                  if (!pException)
+                     pException = job.pException;
+                  job.result = ProgressResult::Cancelled;
+                  command.store(ProgressResult::Cancelled);
+               }
+            }
+            done += job.work
+               ? job.fraction.load(std::memory_order_relaxed) : 1.0;
+         }
+
+         const auto update = dialog->Update(done, double(jobs.size()));
+         // Stop or cancel them all; files not begun are not imported
+         if (update != ProgressResult::Success &&
+             command.load() == ProgressResult::Success)
+            command.store(update);
+
+         std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+      }
+
+      if (pException)
+         std::rethrow_exception(pException);
+   }
+
+   // Add the tracks in the order of the files, each an undoable step
+   bool result = false;
+   for (auto &pJob : jobs) {
+      auto &job = *pJob;
+      if (job.result == ProgressResult::Failed)
+         ShowErrorDialog( *ProjectFramePlacement(&project),
+            XO("Error Importing"),
+            XO("Audacity could not import \"%s\".").Format( job.fileName ),
+            wxT("Importing_Audio"));
+      if (job.result != ProgressResult::Success &&
+          job.result != ProgressResult::Stopped)
+         continue;
+
+      auto newTags = Tags::Get( project ).Duplicate();
+      newTags->Merge( *job.pTags );
+      Tags::Set( project, newTags );
+
+      if (addToHistory) {
+         FileHistory::Global().Append(job.fileName);
+      }
+
+      // PRL: Undo history is incremented inside this:
+      AddImportedTracks(job.fileName, std::move(job.newTracks));
+      result = true;
+   }
+
+   return result;
+}
+
 #include "Clipboard.h"
 #include "ShuttleGui.h"
 #include "widgets/HelpSystem.h"
@@ -1447,6 +1618,10 @@ void ProjectFileManager::Compact()
 
       projectFileIO.Compact(trackLists, true);
 
+      // Compaction in place leaves the moved pages in the -wal file, until
+      // this checkpoints it
+      projectFileIO.ReopenProject();
+
       auto after = wxFileName::GetSize(projectFileIO.GetFileName());
 
       if (!isBatch)
@@ -98,6 +98,16 @@ public:
    bool Import(const FilePath &fileName,
                bool addToHistory = true);
 
+   //! Import the files, several at once when their importers allow it
+   /*!
+    Each file is one undoable step, and tracks are added in the order of the
+    files, except that projects and lists of files are imported by
+    themselves before the others
+    @return whether any file was imported
+    */
+   bool Import(const FilePaths &fileNames,
+               bool addToHistory = true);
+
    void Compact();
 
    void AddImportedTracks(const FilePath &fileName,
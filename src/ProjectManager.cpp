@@ -834,6 +834,14 @@ void ProjectManager::OnTimer(wxTimerEvent& WXUNUSED(event))
       }
    }
 
+   // While there is no playback or recording, give back to the file system
+   // a little of the space that deleted sample blocks left in the project
+   if (!gAudioIO->IsBusy())
+      GuardedCall( [&]{
+         ProjectFileIO::Get(project)
+            .VacuumIncrementally(std::chrono::milliseconds{ 50 });
+      } );
+
    // As also with the TrackPanel timer:  wxTimer may be unreliable without
    // some restarts
    RestartTimer();
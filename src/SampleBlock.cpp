@@ -25,9 +25,10 @@ SampleBlockFactory::~SampleBlockFactory() = default;
 
 SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src,
    size_t numsamples,
-   sampleFormat srcformat)
+   sampleFormat srcformat,
+   size_t srcStride)
 {
-   auto result = DoCreate(src, numsamples, srcformat);
+   auto result = DoCreate(src, numsamples, srcformat, srcStride);
    if (!result)
       THROW_INCONSISTENCY_EXCEPTION;
    return result;
@@ -53,8 +54,26 @@ SampleBlockPtr SampleBlockFactory::CreateFromXML(
    return result;
 }
 
+void SampleBlockFactory::Prefetch(const std::vector<SampleBlockPtr> &)
+{
+}
+
 SampleBlock::~SampleBlock() = default;
 
+bool SampleBlock::CanStoreSpectra() const
+{
+   return false;
+}
+
+bool SampleBlock::GetSpectra(long long, std::vector<char> &)
+{
+   return false;
+}
+
+void SampleBlock::SetSpectra(long long, std::vector<char>)
+{
+}
+
 size_t SampleBlock::GetSamples(samplePtr dest,
                    sampleFormat destformat,
                    size_t sampleoffset,
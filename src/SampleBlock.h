@@ -15,6 +15,7 @@ SampleBlock.h
 #include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "XMLTagHandler.h"
 
@@ -78,6 +79,18 @@ public:
 
    virtual size_t GetSpaceUsage() const = 0;
 
+   //! Whether SetSpectra() may store anything
+   virtual bool CanStoreSpectra() const;
+
+   //! Retrieve what SetSpectra() stored with the same key
+   /*! Non-throwing; returns false if nothing is stored, or if this kind of
+    block can't store spectra */
+   virtual bool GetSpectra(long long key, std::vector<char> &data);
+
+   //! Store spectra computed from the samples, replacing any with the key
+   /*! Non-throwing; the data are a cache, and may be lost */
+   virtual void SetSpectra(long long key, std::vector<char> data);
+
    virtual void SaveXML(XMLWriter &xmlFile) = 0;
 
 protected:
@@ -115,9 +128,14 @@ public:
    virtual ~SampleBlockFactory();
 
    // Returns a non-null pointer or else throws an exception
+   /*!
+    @param srcStride how many samples to advance src after each one; more
+    than one takes one channel of interleaved samples
+    */
    SampleBlockPtr Create(constSamplePtr src,
       size_t numsamples,
-      sampleFormat srcformat);
+      sampleFormat srcformat,
+      size_t srcStride = 1);
 
    // Returns a non-null pointer or else throws an exception
    SampleBlockPtr CreateSilent(
@@ -140,12 +158,19 @@ public:
    virtual BlockDeletionCallback SetBlockDeletionCallback(
       BlockDeletionCallback callback ) = 0;
 
+   //! Read the samples of blocks ahead of their GetSamples(), all at once
+   /*! Non-throwing; only a hint, and the default does nothing.  What is read
+    is kept for a limited number of blocks, so pass the blocks in the order
+    they will be read; each is kept until its last sample is read. */
+   virtual void Prefetch(const std::vector<SampleBlockPtr> &blocks);
+
 protected:
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by Create
    virtual SampleBlockPtr DoCreate(constSamplePtr src,
       size_t numsamples,
-      sampleFormat srcformat) = 0;
+      sampleFormat srcformat,
+      size_t srcStride) = 0;
 
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by CreateSilent
@@ -32,6 +32,7 @@
 #include "Sequence.h"
 
 #include <algorithm>
+#include <atomic>
 #include <optional>
 #include <float.h>
 #include <math.h>
@@ -44,6 +45,7 @@
 #include "BasicUI.h"
 #include "SampleBlock.h"
 #include "InconsistencyException.h"
+#include "ThreadPool.h"
 
 size_t Sequence::sMaxDiskBlockSize = 1048576;
 
@@ -74,6 +76,22 @@ Sequence::~Sequence()
 {
 }
 
+BlockArray &Sequence::MutableBlocks()
+{
+   if (mpBlock.use_count() > 1)
+      mpBlock = std::make_shared<BlockArray>(*mpBlock);
+   return *mpBlock;
+}
+
+void BlockArray::push_back(const SeqBlock::SampleBlockPtr &sb)
+{
+   // Whole-block statistics are already in memory, and don't throw
+   const auto results = sb->GetMinMaxRMS(false);
+   const auto len = sb->GetSampleCount();
+   mTree.PushBack({ sb, len,
+      { results.min, results.max, double(results.RMS) * results.RMS * len } });
+}
+
 size_t Sequence::GetMaxBlockSize() const
 {
    return mMaxSamples;
@@ -86,8 +104,8 @@ size_t Sequence::GetIdealBlockSize() const
 
 bool Sequence::CloseLock()
 {
-   for (unsigned int i = 0; i < mBlock.size(); i++)
-      mBlock[i].sb->CloseLock();
+   for (const auto &block : Blocks())
+      block.sb->CloseLock();
 
    return true;
 }
@@ -100,7 +118,7 @@ sampleFormat Sequence::GetSampleFormat() const
 /*
 bool Sequence::SetSampleFormat(sampleFormat format)
 {
-   if (mBlock.size() > 0 || mNumSamples > 0)
+   if (Blocks().size() > 0 || mNumSamples > 0)
       return false;
 
    mSampleFormat = format;
@@ -133,6 +151,15 @@ namespace {
    }
 }
 
+namespace {
+//! Shared by all conversions of sample format, which may run at once
+ThreadPool &ConversionPool()
+{
+   static ThreadPool pool;
+   return pool;
+}
+}
+
 /*! @excsafety{Strong} */
 bool Sequence::ConvertToSampleFormat(sampleFormat format,
    const std::function<void(size_t)> & progressReport)
@@ -141,89 +168,125 @@ bool Sequence::ConvertToSampleFormat(sampleFormat format,
       // no change
       return false;
 
-   if (mBlock.size() == 0)
-   {
-      mSampleFormat = format;
-      return true;
-   }
-
-   const sampleFormat oldFormat = mSampleFormat;
-   mSampleFormat = format;
+   ConvertToSampleFormat({ this }, format, progressReport);
+   return true;
+}
 
-   const auto oldMinSamples = mMinSamples, oldMaxSamples = mMaxSamples;
+/*! @excsafety{Weak} -- Each sequence is converted wholly or not at all, but
+ some may be converted and others not */
+void Sequence::ConvertToSampleFormat(const std::vector<Sequence*> &sequences,
+   sampleFormat format,
+   const std::function<void(size_t)> & progressReport)
+{
    // These are the same calculations as in the constructor.
-   mMinSamples = sMaxDiskBlockSize / SAMPLE_SIZE(mSampleFormat) / 2;
-   mMaxSamples = mMinSamples * 2;
-
-   bool bSuccess = false;
-   auto cleanup = finally( [&] {
-      if (!bSuccess) {
-         // Conversion failed. Revert these member vars.
-         mSampleFormat = oldFormat;
-         mMaxSamples = oldMaxSamples;
-         mMinSamples = oldMinSamples;
-      }
-   } );
-
-   BlockArray newBlockArray;
-   // Use the ratio of old to NEW mMaxSamples to make a reasonable guess
-   // at allocation.
-   newBlockArray.reserve
-      (1 + mBlock.size() * ((float)oldMaxSamples / (float)mMaxSamples));
-
-   {
-      size_t oldSize = oldMaxSamples;
-      SampleBuffer bufferOld(oldSize, oldFormat);
-      size_t newSize = oldMaxSamples;
-      SampleBuffer bufferNew(newSize, format);
-
-      for (size_t i = 0, nn = mBlock.size(); i < nn; i++)
-      {
-         SeqBlock &oldSeqBlock = mBlock[i];
-         const auto &oldBlockFile = oldSeqBlock.sb;
-         const auto len = oldBlockFile->GetSampleCount();
-         ensureSampleBufferSize(bufferOld, oldFormat, oldSize, len);
-         Read(bufferOld.ptr(), oldFormat, oldSeqBlock, 0, len, true);
-
-         ensureSampleBufferSize(bufferNew, format, newSize, len);
-         CopySamples(bufferOld.ptr(), oldFormat, bufferNew.ptr(), format, len);
-
-         // Note this fix for http://bugzilla.audacityteam.org/show_bug.cgi?id=451,
-         // using Blockify, allows (len < mMinSamples).
-         // This will happen consistently when going from more bytes per sample to fewer...
-         // This will create a block that's smaller than mMinSamples, which
-         // shouldn't be allowed, but we agreed it's okay for now.
-         //vvv ANSWER-ME: Does this cause any bugs, or failures on write, elsewhere?
-         //    If so, need to special-case (len < mMinSamples) and start combining data
-         //    from the old blocks... Oh no!
-
-         // Using Blockify will handle the cases where len > the NEW mMaxSamples. Previous code did not.
-         const auto blockstart = oldSeqBlock.start;
-         Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-                  newBlockArray, blockstart, bufferNew.ptr(), len);
-
-         if (progressReport)
-            progressReport(len);
-      }
+   const size_t minSamples = sMaxDiskBlockSize / SAMPLE_SIZE(format) / 2;
+   const size_t maxSamples = minSamples * 2;
+
+   // Each old block, in order, and what it becomes
+   struct Conversion {
+      Sequence *pSequence;
+      SeqBlock oldSeqBlock;
+      BlockArray newBlocks;
+   };
+   std::vector<Conversion> conversions;
+   for (const auto pSequence : sequences)
+      if (pSequence->mSampleFormat != format)
+         for (const auto &block : pSequence->Blocks())
+            conversions.push_back({ pSequence, block, {} });
+
+   // Convert the blocks of all the sequences in any order, in worker threads
+   std::atomic<long long> converted{ 0 };
+   const auto convert = [&](size_t ii) {
+      auto &conversion = conversions[ii];
+      const auto oldFormat = conversion.pSequence->mSampleFormat;
+      const auto &oldSeqBlock = conversion.oldSeqBlock;
+      const auto len = oldSeqBlock.sb->GetSampleCount();
+      SampleBuffer bufferOld(len, oldFormat);
+      Read(bufferOld.ptr(), oldFormat, oldSeqBlock, 0, len, true);
+
+      SampleBuffer bufferNew(len, format);
+      CopySamples(bufferOld.ptr(), oldFormat, bufferNew.ptr(), format, len);
+
+      // Note this fix for http://bugzilla.audacityteam.org/show_bug.cgi?id=451,
+      // using Blockify, allows (len < mMinSamples).
+      // This will happen consistently when going from more bytes per sample to fewer...
+      // This will create a block that's smaller than mMinSamples, which
+      // shouldn't be allowed, but we agreed it's okay for now.
+      //vvv ANSWER-ME: Does this cause any bugs, or failures on write, elsewhere?
+      //    If so, need to special-case (len < mMinSamples) and start combining data
+      //    from the old blocks... Oh no!
+
+      // Using Blockify will handle the cases where len > the NEW mMaxSamples. Previous code did not.
+      Blockify(*conversion.pSequence->mpFactory, maxSamples, format,
+               conversion.newBlocks, bufferNew.ptr(), len);
+
+      converted.fetch_add(len, std::memory_order_relaxed);
+   };
+   if (progressReport) {
+      // Report the progress of all threads, in this thread only
+      long long reported = 0;
+      ConversionPool().ParallelForPolling(conversions.size(), convert, [&]{
+         const auto total = converted.load(std::memory_order_relaxed);
+         if (total > reported) {
+            const auto newlyConverted = total - reported;
+            reported = total;
+            progressReport(newlyConverted);
+         }
+      });
    }
+   else
+      ConversionPool().ParallelFor(conversions.size(), convert);
 
    // Invalidate all the old, non-aliased block files.
    // Aliased files will be converted at save, per comment above.
 
-   // Commit the changes to block file array
-   CommitChangesIfConsistent
-      (newBlockArray, mNumSamples, wxT("Sequence::ConvertToSampleFormat()"));
+   auto iter = conversions.begin();
+   const auto end = conversions.end();
+   for (const auto pSequence : sequences) {
+      auto &sequence = *pSequence;
+      if (sequence.mSampleFormat == format)
+         continue;
 
-   // Commit the other changes
-   bSuccess = true;
+      if (sequence.Blocks().empty()) {
+         sequence.mSampleFormat = format;
+         continue;
+      }
 
-   return true;
+      BlockArray newBlockArray;
+      for (; iter != end && iter->pSequence == pSequence; ++iter)
+         newBlockArray.Append(iter->newBlocks);
+
+      const sampleFormat oldFormat = sequence.mSampleFormat;
+      const auto oldMinSamples = sequence.mMinSamples,
+         oldMaxSamples = sequence.mMaxSamples;
+      sequence.mSampleFormat = format;
+      sequence.mMinSamples = minSamples;
+      sequence.mMaxSamples = maxSamples;
+
+      bool bSuccess = false;
+      auto cleanup = finally( [&] {
+         if (!bSuccess) {
+            // Conversion failed. Revert these member vars.
+            sequence.mSampleFormat = oldFormat;
+            sequence.mMaxSamples = oldMaxSamples;
+            sequence.mMinSamples = oldMinSamples;
+         }
+      } );
+
+      // Commit the changes to block file array
+      sequence.SpliceIfConsistent(0, sequence.Blocks().size(),
+         newBlockArray, sequence.mNumSamples,
+         wxT("Sequence::ConvertToSampleFormat()"));
+
+      // Commit the other changes
+      bSuccess = true;
+   }
 }
 
 std::pair<float, float> Sequence::GetMinMax(
    sampleCount start, sampleCount len, bool mayThrow) const
 {
-   if (len == 0 || mBlock.size() == 0) {
+   if (len == 0 || Blocks().size() == 0) {
       return {
          0.f,
          // FLT_MAX?  So it doesn't look like a spurious '0' to a caller?
@@ -240,16 +303,13 @@ std::pair<float, float> Sequence::GetMinMax(
    unsigned int block1 = FindBlock(start + len - 1);
 
    // First calculate the min/max of the blocks in the middle of this region;
-   // this is very fast because we have the min/max of every entire block
-   // already in memory.
-
-   for (unsigned b = block0 + 1; b < block1; ++b) {
-      auto results = mBlock[b].sb->GetMinMaxRMS(mayThrow);
+   // this is very fast because the tree of whole-block statistics combines
+   // them in logarithmic time.
 
-      if (results.min < min)
-         min = results.min;
-      if (results.max > max)
-         max = results.max;
+   if (block0 + 1 < block1) {
+      auto results = Blocks().GetSummary(block0 + 1, block1);
+      min = results.min;
+      max = results.max;
    }
 
    // Now we take the first and last blocks into account, noting that the
@@ -257,16 +317,16 @@ std::pair<float, float> Sequence::GetMinMax(
    // of either of these blocks is within min...max, then we can ignore them.
    // If not, we need read some samples and summaries from disk.
    {
-      const SeqBlock &theBlock = mBlock[block0];
-      const auto &theFile = theBlock.sb;
+      sampleCount blockStart;
+      const auto &theFile = Blocks().BlockAt(block0, blockStart);
       auto results = theFile->GetMinMaxRMS(mayThrow);
 
       if (results.min < min || results.max > max) {
          // start lies within theBlock:
-         auto s0 = ( start - theBlock.start ).as_size_t();
+         auto s0 = ( start - blockStart ).as_size_t();
          const auto maxl0 = (
             // start lies within theBlock:
-            theBlock.start + theFile->GetSampleCount() - start
+            blockStart + theFile->GetSampleCount() - start
          ).as_size_t();
          wxASSERT(maxl0 <= mMaxSamples); // Vaughan, 2011-10-19
          const auto l0 = limitSampleBufferSize ( maxl0, len );
@@ -281,14 +341,14 @@ std::pair<float, float> Sequence::GetMinMax(
 
    if (block1 > block0)
    {
-      const SeqBlock &theBlock = mBlock[block1];
-      const auto &theFile = theBlock.sb;
+      sampleCount blockStart;
+      const auto &theFile = Blocks().BlockAt(block1, blockStart);
       auto results = theFile->GetMinMaxRMS(mayThrow);
 
       if (results.min < min || results.max > max) {
 
          // start + len - 1 lies in theBlock:
-         const auto l0 = ( start + len - theBlock.start ).as_size_t();
+         const auto l0 = ( start + len - blockStart ).as_size_t();
          wxASSERT(l0 <= mMaxSamples); // Vaughan, 2011-10-19
 
          results = theFile->GetMinMaxRMS(0, l0, mayThrow);
@@ -306,7 +366,7 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
 {
    // len is the number of samples that we want the rms of.
    // it may be longer than a block, and the code is carefully set up to handle that.
-   if (len == 0 || mBlock.size() == 0)
+   if (len == 0 || Blocks().size() == 0)
       return 0.f;
 
    double sumsq = 0.0;
@@ -316,30 +376,24 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
    unsigned int block1 = FindBlock(start + len - 1);
 
    // First calculate the rms of the blocks in the middle of this region;
-   // this is very fast because we have the rms of every entire block
-   // already in memory.
-   for (unsigned b = block0 + 1; b < block1; b++) {
-      const SeqBlock &theBlock = mBlock[b];
-      const auto &sb = theBlock.sb;
-      auto results = sb->GetMinMaxRMS(mayThrow);
-
-      const auto fileLen = sb->GetSampleCount();
-      const auto blockRMS = results.RMS;
-      sumsq += blockRMS * blockRMS * fileLen;
-      length += fileLen;
+   // this is very fast because the tree of whole-block statistics combines
+   // them in logarithmic time.
+   if (block0 + 1 < block1) {
+      sumsq += Blocks().GetSummary(block0 + 1, block1).sumsq;
+      length += Blocks().GetStart(block1) - Blocks().GetStart(block0 + 1);
    }
 
    // Now we take the first and last blocks into account, noting that the
    // selection may only partly overlap these blocks.
    // If not, we need read some samples and summaries from disk.
    {
-      const SeqBlock &theBlock = mBlock[block0];
-      const auto &sb = theBlock.sb;
+      sampleCount blockStart;
+      const auto &sb = Blocks().BlockAt(block0, blockStart);
       // start lies within theBlock
-      auto s0 = ( start - theBlock.start ).as_size_t();
+      auto s0 = ( start - blockStart ).as_size_t();
       // start lies within theBlock
       const auto maxl0 =
-         (theBlock.start + sb->GetSampleCount() - start).as_size_t();
+         (blockStart + sb->GetSampleCount() - start).as_size_t();
       wxASSERT(maxl0 <= mMaxSamples); // Vaughan, 2011-10-19
       const auto l0 = limitSampleBufferSize( maxl0, len );
 
@@ -350,11 +404,11 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
    }
 
    if (block1 > block0) {
-      const SeqBlock &theBlock = mBlock[block1];
-      const auto &sb = theBlock.sb;
+      sampleCount blockStart;
+      const auto &sb = Blocks().BlockAt(block1, blockStart);
 
       // start + len - 1 lies within theBlock
-      const auto l0 = ( start + len - theBlock.start ).as_size_t();
+      const auto l0 = ( start + len - blockStart ).as_size_t();
       wxASSERT(l0 <= mMaxSamples); // PRL: I think Vaughan missed this
 
       auto results = sb->GetMinMaxRMS(0, l0, mayThrow);
@@ -384,7 +438,7 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
    // contents are used -- must copy if factories are different:
    auto pUseFactory = (pFactory == mpFactory) ? nullptr : pFactory.get();
 
-   int numBlocks = mBlock.size();
+   int numBlocks = Blocks().size();
 
    int b0 = FindBlock(s0);
    const int b1 = FindBlock(s1 - 1);
@@ -394,8 +448,6 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
    wxUnusedVar(numBlocks);
    wxASSERT(b0 <= b1);
 
-   dest->mBlock.reserve(b1 - b0 + 1);
-
    auto bufferSize = mMaxSamples;
    SampleBuffer buffer(bufferSize, mSampleFormat);
 
@@ -403,12 +455,12 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
 
    // Do any initial partial block
 
-   const SeqBlock &block0 = mBlock[b0];
-   if (s0 != block0.start) {
-      const auto &sb = block0.sb;
+   sampleCount block0Start;
+   const auto &sb0 = Blocks().BlockAt(b0, block0Start);
+   if (s0 != block0Start) {
       // Nonnegative result is length of block0 or less:
       blocklen =
-         ( std::min(s1, block0.start + sb->GetSampleCount()) - s0 ).as_size_t();
+         ( std::min(s1, block0Start + sb0->GetSampleCount()) - s0 ).as_size_t();
       wxASSERT(blocklen <= (int)mMaxSamples); // Vaughan, 2012-02-29
       ensureSampleBufferSize(buffer, mSampleFormat, bufferSize, blocklen);
       Get(b0, buffer.ptr(), mSampleFormat, s0, blocklen, true);
@@ -419,15 +471,25 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
       --b0;
 
    // If there are blocks in the middle, use the blocks whole
-   for (int bb = b0 + 1; bb < b1; ++bb)
-      AppendBlock(pUseFactory, mSampleFormat,
-         dest->mBlock, dest->mNumSamples, mBlock[bb]);
-      // Increase ref count or duplicate file
+   if (b0 + 1 < b1) {
+      if (!pUseFactory) {
+         // Share them all at once
+         const auto middle = Blocks().Slice(b0 + 1, b1);
+         dest->MutableBlocks().Append(middle);
+         dest->mNumSamples += middle.GetNumSamples();
+      }
+      else
+         for (auto iter = Blocks().IteratorAt(b0 + 1),
+              end = Blocks().IteratorAt(b1); iter != end; ++iter)
+            AppendBlock(pUseFactory, mSampleFormat,
+               dest->MutableBlocks(), dest->mNumSamples, *iter);
+            // Duplicate file
+   }
 
    // Do the last block
    if (b1 > b0) {
       // Probable case of a partial block
-      const SeqBlock &block = mBlock[b1];
+      const SeqBlock block = Blocks()[b1];
       const auto &sb = block.sb;
       // s1 is within block:
       blocklen = (s1 - block.start).as_size_t();
@@ -440,7 +502,7 @@ std::unique_ptr<Sequence> Sequence::Copy( const SampleBlockFactoryPtr &pFactory,
       else
          // Special case of a whole block
          AppendBlock(pUseFactory, mSampleFormat,
-            dest->mBlock, dest->mNumSamples, block);
+            dest->MutableBlocks(), dest->mNumSamples, block);
          // Increase ref count or duplicate file
    }
 
@@ -505,7 +567,7 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       THROW_INCONSISTENCY_EXCEPTION;
    }
 
-   const BlockArray &srcBlock = src->mBlock;
+   const BlockArray &srcBlock = src->Blocks();
    auto addedLen = src->mNumSamples;
    const unsigned int srcNumBlocks = srcBlock.size();
    auto sampleSize = SAMPLE_SIZE(mSampleFormat);
@@ -513,37 +575,51 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    if (addedLen == 0 || srcNumBlocks == 0)
       return;
 
-   const size_t numBlocks = mBlock.size();
+   const size_t numBlocks = Blocks().size();
 
    // Decide whether to share sample blocks or make new copies, when whole block
    // contents are used -- must copy if factories are different:
    auto pUseFactory =
       (src->mpFactory == mpFactory) ? nullptr : mpFactory.get();
 
+   if (numBlocks == 0 && !pUseFactory) {
+      // Special case: share the whole array, until either sequence changes
+      mpBlock = src->mpBlock;
+      mNumSamples = addedLen;
+      return;
+   }
+
    if (numBlocks == 0 ||
-       (s == mNumSamples && mBlock.back().sb->GetSampleCount() >= mMinSamples)) {
+       (s == mNumSamples && Blocks().back().sb->GetSampleCount() >= mMinSamples)) {
       // Special case: this track is currently empty, or it's safe to append
       // onto the end because the current last block is longer than the
       // minimum size
 
-      // Build and swap a copy so there is a strong exception safety guarantee
-      BlockArray newBlock{ mBlock };
+      // Build the blocks to append, then splice them, so there is a strong
+      // exception safety guarantee
+      BlockArray newBlock;
       sampleCount samples = mNumSamples;
-      for (unsigned int i = 0; i < srcNumBlocks; i++)
-         // AppendBlock may throw for limited disk space, if pasting from
-         // one project into another.
-         AppendBlock(pUseFactory, mSampleFormat,
-            newBlock, samples, srcBlock[i]);
-
-      CommitChangesIfConsistent
-         (newBlock, samples, wxT("Paste branch one"));
+      if (!pUseFactory) {
+         // Share them all at once
+         newBlock = srcBlock;
+         samples += addedLen;
+      }
+      else
+         for (const auto &block : srcBlock)
+            // AppendBlock may throw for limited disk space, if pasting from
+            // one project into another.
+            AppendBlock(pUseFactory, mSampleFormat,
+               newBlock, samples, block);
+
+      SpliceIfConsistent(numBlocks, numBlocks,
+         newBlock, samples, wxT("Paste branch one"));
       return;
    }
 
-   const int b = (s == mNumSamples) ? mBlock.size() - 1 : FindBlock(s);
+   const int b = (s == mNumSamples) ? Blocks().size() - 1 : FindBlock(s);
    wxASSERT((b >= 0) && (b < (int)numBlocks));
-   SeqBlock *const pBlock = &mBlock[b];
-   const auto length = pBlock->sb->GetSampleCount();
+   const SeqBlock block = Blocks()[b];
+   const auto length = block.sb->GetSampleCount();
    const auto largerBlockLen = addedLen + length;
    // PRL: when insertion point is the first sample of a block,
    // and the following test fails, perhaps we could test
@@ -552,7 +628,6 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       // Special case: we can fit all of the NEW samples inside of
       // one block!
 
-      SeqBlock &block = *pBlock;
       // largerBlockLen is not more than mMaxSamples...
       SampleBuffer buffer(largerBlockLen.as_size_t(), mSampleFormat);
 
@@ -568,23 +643,16 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
            splitPoint, length - splitPoint, true);
 
       // largerBlockLen is not more than mMaxSamples...
-      block.sb = mpFactory->Create(
+      BlockArray newBlock;
+      newBlock.push_back(mpFactory->Create(
          buffer.ptr(),
          largerBlockLen.as_size_t(),
-         mSampleFormat);
-
-      // Don't make a duplicate array.  We can still give Strong-guarantee
-      // if we modify only one block in place.
-
-      // use No-fail-guarantee in remaining steps
-      for (unsigned int i = b + 1; i < numBlocks; i++)
-         mBlock[i].start += addedLen;
+         mSampleFormat));
 
-      mNumSamples += addedLen;
-
-      // This consistency check won't throw, it asserts.
-      // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Paste branch two"), false);
+      // Replace only the one block.  The blocks after it need no change,
+      // because starts are not stored.
+      SpliceIfConsistent(b, b + 1,
+         newBlock, mNumSamples + addedLen, wxT("Paste branch two"));
       return;
    }
 
@@ -593,15 +661,12 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    // into one big block along with the split block,
    // then resplit it all
    BlockArray newBlock;
-   newBlock.reserve(numBlocks + srcNumBlocks + 2);
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b);
 
-   SeqBlock &splitBlock = mBlock[b];
+   const SeqBlock &splitBlock = block;
    auto splitLen = splitBlock.sb->GetSampleCount();
    // s lies within splitBlock
    auto splitPoint = ( s - splitBlock.start ).as_size_t();
 
-   unsigned int i;
    if (srcNumBlocks <= 4) {
 
       // addedLen is at most four times maximum block size
@@ -618,7 +683,7 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
            splitLen - splitPoint, true);
 
       Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-               newBlock, splitBlock.start, sumBuffer.ptr(), sum);
+               newBlock, sumBuffer.ptr(), sum);
    } else {
 
       // The final case is that we're inserting at least five blocks.
@@ -631,7 +696,7 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
           srcBlock[0].sb->GetSampleCount() + srcBlock[1].sb->GetSampleCount();
       const auto leftLen = splitPoint + srcFirstTwoLen;
 
-      const SeqBlock &penultimate = srcBlock[srcNumBlocks - 2];
+      const SeqBlock penultimate = srcBlock[srcNumBlocks - 2];
       const auto srcLastTwoLen =
          penultimate.sb->GetSampleCount() +
          srcBlock[srcNumBlocks - 1].sb->GetSampleCount();
@@ -645,14 +710,12 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          mSampleFormat, 0, srcFirstTwoLen, true);
 
       Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-               newBlock, splitBlock.start, sampleBuffer.ptr(), leftLen);
+               newBlock, sampleBuffer.ptr(), leftLen);
 
-      for (i = 2; i < srcNumBlocks - 2; i++) {
-         const SeqBlock &block = srcBlock[i];
-         auto sb = ShareOrCopySampleBlock(
-            pUseFactory, mSampleFormat, block.sb );
-         newBlock.push_back(SeqBlock(sb, block.start + s));
-      }
+      for (auto iter = srcBlock.IteratorAt(2),
+           end = srcBlock.IteratorAt(srcNumBlocks - 2); iter != end; ++iter)
+         newBlock.push_back(ShareOrCopySampleBlock(
+            pUseFactory, mSampleFormat, (*iter).sb ));
 
       auto lastStart = penultimate.start;
       src->Get(srcNumBlocks - 2, sampleBuffer.ptr(), mSampleFormat,
@@ -661,16 +724,13 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
            splitBlock, splitPoint, rightSplit, true);
 
       Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-               newBlock, s + lastStart, sampleBuffer.ptr(), rightLen);
+               newBlock, sampleBuffer.ptr(), rightLen);
    }
 
-   // Copy remaining blocks to NEW block array and
-   // swap the NEW block array in for the old
-   for (i = b + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(addedLen));
-
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
+   // Splice the NEW blocks in for the split block; the remaining blocks
+   // need no change
+   SpliceIfConsistent(b, b + 1,
+      newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
 }
 
 /*! @excsafety{Strong} */
@@ -700,26 +760,32 @@ void Sequence::InsertSilence(sampleCount s0, sampleCount len)
 
    sampleCount pos = 0;
 
-   // Could nBlocks overflow a size_t?  Not very likely.  You need perhaps
-   // 2 ^ 52 samples which is over 3000 years at 44.1 kHz.
-   auto nBlocks = (len + idealSamples - 1) / idealSamples;
-   sTrack.mBlock.reserve(nBlocks.as_size_t());
+   auto &silentBlocks = sTrack.MutableBlocks();
 
    if (len >= idealSamples) {
       auto silentFile = factory.CreateSilent(
          idealSamples,
          mSampleFormat);
-      while (len >= idealSamples) {
-         sTrack.mBlock.push_back(SeqBlock(silentFile, pos));
-
-         pos += idealSamples;
-         len -= idealSamples;
+      // All full blocks share one file, so append repeated doublings of one
+      // block, in time logarithmic in the number of blocks
+      auto nFull = len / idealSamples;
+      BlockArray doubling;
+      doubling.push_back(silentFile);
+      while (true) {
+         if (nFull % 2 == 1)
+            silentBlocks.Append(doubling);
+         nFull /= 2;
+         if (nFull == 0)
+            break;
+         doubling.Append(doubling);
       }
+      pos = silentBlocks.GetNumSamples();
+      len -= pos;
    }
    if (len != 0) {
       // len is not more than idealSamples:
-      sTrack.mBlock.push_back(SeqBlock(
-         factory.CreateSilent(len.as_size_t(), mSampleFormat), pos));
+      silentBlocks.push_back(
+         factory.CreateSilent(len.as_size_t(), mSampleFormat));
       pos += len;
    }
 
@@ -737,12 +803,11 @@ void Sequence::AppendBlock( SampleBlockFactory *pFactory, sampleFormat format,
       THROW_INCONSISTENCY_EXCEPTION;
 
    auto sb = ShareOrCopySampleBlock( pFactory, format, b.sb );
-   SeqBlock newBlock(sb, mNumSamples);
 
-   // We can assume newBlock.sb is not null
+   // We can assume sb is not null
 
-   mBlock.push_back(newBlock);
-   mNumSamples += newBlock.sb->GetSampleCount();
+   mBlock.push_back(sb);
+   mNumSamples += sb->GetSampleCount();
 
    // Don't do a consistency check here because this
    // function gets called in an inner loop.
@@ -751,7 +816,7 @@ void Sequence::AppendBlock( SampleBlockFactory *pFactory, sampleFormat format,
 sampleCount Sequence::GetBlockStart(sampleCount position) const
 {
    int b = FindBlock(position);
-   return mBlock[b].start;
+   return Blocks().GetStart(b);
 }
 
 size_t Sequence::GetBestBlockSize(sampleCount start) const
@@ -764,17 +829,16 @@ size_t Sequence::GetBestBlockSize(sampleCount start) const
    if (start < 0 || start >= mNumSamples)
       return mMaxSamples;
 
-   int b = FindBlock(start);
-   int numBlocks = mBlock.size();
+   auto iter = Blocks().IteratorAt(FindBlock(start));
+   const auto end = Blocks().end();
 
-   const SeqBlock &block = mBlock[b];
    // start is in block:
-   auto result = (block.start + block.sb->GetSampleCount() - start).as_size_t();
+   auto result =
+      (iter.Start() + iter.Block()->GetSampleCount() - start).as_size_t();
 
    decltype(result) length;
-   while(result < mMinSamples && b+1<numBlocks &&
-         ((length = mBlock[b+1].sb->GetSampleCount()) + result) <= mMaxSamples) {
-      b++;
+   while(result < mMinSamples && ++iter != end &&
+         ((length = iter.Block()->GetSampleCount()) + result) <= mMaxSamples) {
       result += length;
    }
 
@@ -821,7 +885,23 @@ bool Sequence::HandleXMLTag(const std::string_view& tag, const AttributesList &a
          }
       }
 
-      mBlock.push_back(wb);
+      // Blocks are contiguous by construction; a start in the file that
+      // disagrees only warns of a gap
+      const auto numSamples = Blocks().GetNumSamples();
+      if (wb.start != numSamples)
+      {
+         wxLogWarning(
+            wxT("Gap detected in project file.\n")
+            wxT("   Start (%s) for block file %lld is not one sample past end of previous block (%s).\n")
+            wxT("   Moving start so blocks are contiguous."),
+            // PRL:  Why bother with Internat when the above is just wxT?
+            Internat::ToString(wb.start.as_double(), 0),
+            wb.sb->GetBlockID(),
+            Internat::ToString(numSamples.as_double(), 0));
+         mErrorOpening = true;
+      }
+
+      MutableBlocks().push_back(wb.sb);
 
       return true;
    }
@@ -896,27 +976,8 @@ void Sequence::HandleXMLEndTag(const std::string_view& tag)
    }
 
    // Make sure that the sequence is valid.
-
-   // Make sure that start times and lengths are consistent
-   sampleCount numSamples = 0;
-   for (unsigned b = 0, nn = mBlock.size(); b < nn;  b++)
-   {
-      SeqBlock &block = mBlock[b];
-      if (block.start != numSamples)
-      {
-         wxLogWarning(
-            wxT("Gap detected in project file.\n")
-            wxT("   Start (%s) for block file %lld is not one sample past end of previous block (%s).\n")
-            wxT("   Moving start so blocks are contiguous."),
-            // PRL:  Why bother with Internat when the above is just wxT?
-            Internat::ToString(block.start.as_double(), 0),
-            block.sb->GetBlockID(),
-            Internat::ToString(numSamples.as_double(), 0));
-         block.start = numSamples;
-         mErrorOpening = true;
-      }
-      numSamples += block.sb->GetSampleCount();
-   }
+   // (Starts of blocks were checked as they were read.)
+   const auto numSamples = Blocks().GetNumSamples();
 
    if (mNumSamples != numSamples)
    {
@@ -944,16 +1005,13 @@ XMLTagHandler *Sequence::HandleXMLChild(const std::string_view& tag)
 void Sequence::WriteXML(XMLWriter &xmlFile) const
 // may throw
 {
-   unsigned int b;
-
    xmlFile.StartTag(wxT("sequence"));
 
    xmlFile.WriteAttr(wxT("maxsamples"), mMaxSamples);
    xmlFile.WriteAttr(wxT("sampleformat"), (size_t)mSampleFormat);
    xmlFile.WriteAttr(wxT("numsamples"), mNumSamples.as_long_long() );
 
-   for (b = 0; b < mBlock.size(); b++) {
-      const SeqBlock &bb = mBlock[b];
+   for (const auto bb : Blocks()) {
 
       // See http://bugzilla.audacityteam.org/show_bug.cgi?id=451.
       if (bb.sb->GetSampleCount() > mMaxSamples)
@@ -995,44 +1053,12 @@ int Sequence::FindBlock(sampleCount pos) const
    if (pos == 0)
       return 0;
 
-   int numBlocks = mBlock.size();
-
-   size_t lo = 0, hi = numBlocks, guess;
-   sampleCount loSamples = 0, hiSamples = mNumSamples;
-
-   while (true) {
-      //this is not a binary search, but a
-      //dictionary search where we guess something smarter than the binary division
-      //of the unsearched area, since samples are usually proportional to block file number.
-      const double frac = (pos - loSamples).as_double() /
-         (hiSamples - loSamples).as_double();
-      guess = std::min(hi - 1, lo + size_t(frac * (hi - lo)));
-      const SeqBlock &block = mBlock[guess];
-
-      wxASSERT(block.sb->GetSampleCount() > 0);
-      wxASSERT(lo <= guess && guess < hi && lo < hi);
-
-      if (pos < block.start) {
-         wxASSERT(lo != guess);
-         hi = guess;
-         hiSamples = block.start;
-      }
-      else {
-         const sampleCount nextStart = block.start + block.sb->GetSampleCount();
-         if (pos < nextStart)
-            break;
-         else {
-            wxASSERT(guess < hi - 1);
-            lo = guess + 1;
-            loSamples = nextStart;
-         }
-      }
-   }
-
-   const int rval = guess;
-   wxASSERT(rval >= 0 && rval < numBlocks &&
-            pos >= mBlock[rval].start &&
-            pos < mBlock[rval].start + mBlock[rval].sb->GetSampleCount());
+   const int rval = Blocks().FindBlock(pos);
+   sampleCount blockStart;
+   const auto &sb = Blocks().BlockAt(rval, blockStart);
+   wxASSERT(rval >= 0 && rval < (int)Blocks().size() &&
+            pos >= blockStart &&
+            pos < blockStart + sb->GetSampleCount());
 
    return rval;
 }
@@ -1077,12 +1103,39 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
    return Get(b, buffer, format, start, len, mayThrow);
 }
 
+void Sequence::Prefetch(sampleCount start, sampleCount len) const
+{
+   const auto end = std::min(start + len, mNumSamples);
+   start = std::max<sampleCount>(start, 0);
+   if (start >= end)
+      return;
+   std::vector<SampleBlockPtr> blocks;
+   for (auto iter = Blocks().IteratorAt(FindBlock(start)),
+        last = Blocks().end(); iter != last; ++iter) {
+      if (iter.Start() >= end)
+         break;
+      blocks.push_back(iter.Block());
+   }
+   if (blocks.size() > 1)
+      mpFactory->Prefetch(blocks);
+}
+
 bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
    bool result = true;
+
+   auto iter = Blocks().IteratorAt(b);
+
+   // Read all blocks of a request spanning several at once
+   {
+      const auto block = *iter;
+      if (start + len > block.start + block.sb->GetSampleCount())
+         Prefetch(start, len);
+   }
+
    while (len) {
-      const SeqBlock &block = mBlock[b];
+      const auto block = *iter;
       // start is in block
       const auto bstart = (start - block.start).as_size_t();
       // bstart is not more than block length
@@ -1093,7 +1146,7 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
 
       len -= blen;
       buffer += (blen * SAMPLE_SIZE(format));
-      b++;
+      ++iter;
       start += blen;
    }
    return result;
@@ -1106,7 +1159,7 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
 {
    auto &factory = *mpFactory;
 
-   const auto size = mBlock.size();
+   const auto size = Blocks().size();
 
    if (start < 0 || start + len > mNumSamples)
       THROW_INCONSISTENCY_EXCEPTION;
@@ -1120,9 +1173,11 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       temp.Allocate(tempSize, mSampleFormat);
    }
 
-   int b = FindBlock(start);
+   const int b0 = FindBlock(start);
+   int b = b0;
+   auto iter = Blocks().IteratorAt(b);
+   // Replacements for blocks [b0, b)
    BlockArray newBlock;
-   std::copy( mBlock.begin(), mBlock.begin() + b, std::back_inserter(newBlock) );
 
    while (len > 0
       // Redundant termination condition,
@@ -1131,8 +1186,7 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       // that cause the loop to make no progress because blen == 0
       && b < (int)size
    ) {
-      newBlock.push_back( mBlock[b] );
-      SeqBlock &block = newBlock.back();
+      auto block = *iter;
       // start is within block
       const auto bstart = ( start - block.start ).as_size_t();
       const auto fileLength = block.sb->GetSampleCount();
@@ -1202,24 +1256,25 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       len -= blen;
       start += blen;
 
+      newBlock.push_back(block.sb);
+
       // ... but this, at least, always guarantees some loop progress:
       b++;
+      ++iter;
    }
 
-   std::copy( mBlock.begin() + b, mBlock.end(), std::back_inserter(newBlock) );
-
-   CommitChangesIfConsistent( newBlock, mNumSamples, wxT("SetSamples") );
+   SpliceIfConsistent( b0, b, newBlock, mNumSamples, wxT("SetSamples") );
 }
 
 size_t Sequence::GetIdealAppendLen() const
 {
-   int numBlocks = mBlock.size();
+   int numBlocks = Blocks().size();
    const auto max = GetMaxBlockSize();
 
    if (numBlocks == 0)
       return max;
 
-   const auto lastBlockLen = mBlock.back().sb->GetSampleCount();
+   const auto lastBlockLen = Blocks().back().sb->GetSampleCount();
    if (lastBlockLen >= max)
       return max;
    else
@@ -1228,9 +1283,9 @@ size_t Sequence::GetIdealAppendLen() const
 
 /*! @excsafety{Strong} */
 SeqBlock::SampleBlockPtr Sequence::AppendNewBlock(
-   constSamplePtr buffer, sampleFormat format, size_t len)
+   constSamplePtr buffer, sampleFormat format, size_t len, size_t stride)
 {
-   return DoAppend( buffer, format, len, false );
+   return DoAppend( buffer, format, len, false, stride );
 }
 
 /*! @excsafety{Strong} */
@@ -1243,11 +1298,12 @@ void Sequence::AppendSharedBlock(const SeqBlock::SampleBlockPtr &pBlock)
       THROW_INCONSISTENCY_EXCEPTION;
 
    BlockArray newBlock;
-   newBlock.emplace_back( pBlock, mNumSamples );
+   newBlock.push_back( pBlock );
    auto newNumSamples = mNumSamples + len;
 
-   AppendBlocksIfConsistent(newBlock, false,
-                            newNumSamples, wxT("Append"));
+   const auto numBlocks = Blocks().size();
+   SpliceIfConsistent(numBlocks, numBlocks, newBlock,
+                      newNumSamples, wxT("Append"));
 
 // JKC: During generate we use Append again and again.
 // If generating a long sequence this test would give O(n^2)
@@ -1265,7 +1321,8 @@ void Sequence::Append(constSamplePtr buffer, sampleFormat format, size_t len)
 
 /*! @excsafety{Strong} */
 SeqBlock::SampleBlockPtr Sequence::DoAppend(
-   constSamplePtr buffer, sampleFormat format, size_t len, bool coalesce)
+   constSamplePtr buffer, sampleFormat format, size_t len, bool coalesce,
+   size_t stride)
 {
    SeqBlock::SampleBlockPtr result;
 
@@ -1282,18 +1339,17 @@ SeqBlock::SampleBlockPtr Sequence::DoAppend(
    sampleCount newNumSamples = mNumSamples;
 
    // If the last block is not full, we need to add samples to it
-   int numBlocks = mBlock.size();
-   SeqBlock *pLastBlock;
-   decltype(pLastBlock->sb->GetSampleCount()) length;
+   int numBlocks = Blocks().size();
+   SeqBlock lastBlock;
+   decltype(lastBlock.sb->GetSampleCount()) length;
    size_t bufferSize = mMaxSamples;
    SampleBuffer buffer2(bufferSize, mSampleFormat);
    bool replaceLast = false;
    if (coalesce &&
        numBlocks > 0 &&
        (length =
-        (pLastBlock = &mBlock.back())->sb->GetSampleCount()) < mMinSamples) {
+        (lastBlock = Blocks().back()).sb->GetSampleCount()) < mMinSamples) {
       // Enlarge a sub-minimum block at the end
-      const SeqBlock &lastBlock = *pLastBlock;
       const auto addLen = std::min(mMaxSamples - length, len);
 
       Read(buffer2.ptr(), mSampleFormat, lastBlock, 0, length, true);
@@ -1302,20 +1358,21 @@ SeqBlock::SampleBlockPtr Sequence::DoAppend(
                   format,
                   buffer2.ptr() + length * SAMPLE_SIZE(mSampleFormat),
                   mSampleFormat,
-                  addLen);
+                  addLen,
+                  gHighQualityDither,
+                  stride);
 
       const auto newLastBlockLen = length + addLen;
       SampleBlockPtr pBlock = factory.Create(
          buffer2.ptr(),
          newLastBlockLen,
          mSampleFormat);
-      SeqBlock newLastBlock(pBlock, lastBlock.start);
 
-      newBlock.push_back( newLastBlock );
+      newBlock.push_back( pBlock );
 
       len -= addLen;
       newNumSamples += addLen;
-      buffer += addLen * SAMPLE_SIZE(format);
+      buffer += addLen * SAMPLE_SIZE(format) * stride;
 
       replaceLast = true;
    }
@@ -1325,26 +1382,27 @@ SeqBlock::SampleBlockPtr Sequence::DoAppend(
       const auto addedLen = std::min(idealSamples, len);
       SampleBlockPtr pBlock;
       if (format == mSampleFormat) {
-         pBlock = factory.Create(buffer, addedLen, mSampleFormat);
+         pBlock = factory.Create(buffer, addedLen, mSampleFormat, stride);
          // It's expected that when not requesting coalescence, the
          // data should fit in one block
          wxASSERT( coalesce || !result );
          result = pBlock;
       }
       else {
-         CopySamples(buffer, format, buffer2.ptr(), mSampleFormat, addedLen);
+         CopySamples(buffer, format, buffer2.ptr(), mSampleFormat, addedLen,
+            gHighQualityDither, stride);
          pBlock = factory.Create(buffer2.ptr(), addedLen, mSampleFormat);
       }
 
-      newBlock.push_back(SeqBlock(pBlock, newNumSamples));
+      newBlock.push_back(pBlock);
 
-      buffer += addedLen * SAMPLE_SIZE(format);
+      buffer += addedLen * SAMPLE_SIZE(format) * stride;
       newNumSamples += addedLen;
       len -= addedLen;
    }
 
-   AppendBlocksIfConsistent(newBlock, replaceLast,
-                            newNumSamples, wxT("Append"));
+   SpliceIfConsistent(numBlocks - (replaceLast ? 1 : 0), numBlocks, newBlock,
+                      newNumSamples, wxT("Append"));
 
 // JKC: During generate we use Append again and again.
 // If generating a long sequence this test would give O(n^2)
@@ -1358,26 +1416,20 @@ SeqBlock::SampleBlockPtr Sequence::DoAppend(
 
 void Sequence::Blockify(SampleBlockFactory &factory,
                         size_t mMaxSamples, sampleFormat mSampleFormat,
-                        BlockArray &list, sampleCount start,
+                        BlockArray &list,
                         constSamplePtr buffer, size_t len)
 {
    if (len <= 0)
       return;
 
    auto num = (len + (mMaxSamples - 1)) / mMaxSamples;
-   list.reserve(list.size() + num);
 
    for (decltype(num) i = 0; i < num; i++) {
-      SeqBlock b;
-
       const auto offset = i * len / num;
-      b.start = start + offset;
       int newLen = ((i + 1) * len / num) - offset;
       auto bufStart = buffer + (offset * SAMPLE_SIZE(mSampleFormat));
 
-      b.sb = factory.Create(bufStart, newLen, mSampleFormat);
-
-      list.push_back(b);
+      list.push_back(factory.Create(bufStart, newLen, mSampleFormat));
    }
 }
 
@@ -1392,15 +1444,15 @@ void Sequence::Delete(sampleCount start, sampleCount len)
 
    auto &factory = *mpFactory;
 
-   const unsigned int numBlocks = mBlock.size();
+   const unsigned int numBlocks = Blocks().size();
 
    const unsigned int b0 = FindBlock(start);
    unsigned int b1 = FindBlock(start + len - 1);
 
    auto sampleSize = SAMPLE_SIZE(mSampleFormat);
 
-   SeqBlock *pBlock;
-   decltype(pBlock->sb->GetSampleCount()) length;
+   SeqBlock b;
+   decltype(b.sb->GetSampleCount()) length;
 
    // One buffer for reuse in various branches here
    SampleBuffer scratch;
@@ -1411,8 +1463,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    // block and the resulting length is not too small, perform the
    // deletion within this block:
    if (b0 == b1 &&
-       (length = (pBlock = &mBlock[b0])->sb->GetSampleCount()) - len >= mMinSamples) {
-      SeqBlock &b = *pBlock;
+       (length = (b = Blocks()[b0]).sb->GetSampleCount()) - len >= mMinSamples) {
       // start is within block
       auto pos = ( start - b.start ).as_size_t();
 
@@ -1433,39 +1484,26 @@ void Sequence::Delete(sampleCount start, sampleCount len)
            // is not more than the length of the block
            ( pos + len ).as_size_t(), newLen - pos, true);
 
-      b.sb = factory.Create(scratch.ptr(), newLen, mSampleFormat);
-
-      // Don't make a duplicate array.  We can still give Strong-guarantee
-      // if we modify only one block in place.
-
-      // use No-fail-guarantee in remaining steps
-
-      for (unsigned int j = b0 + 1; j < numBlocks; j++)
-         mBlock[j].start -= len;
+      // Replace only the one block; the starts of later blocks follow
+      BlockArray newBlock;
+      newBlock.push_back(
+         factory.Create(scratch.ptr(), newLen, mSampleFormat));
 
-      mNumSamples -= len;
-
-      // This consistency check won't throw, it asserts.
-      // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Delete - branch one"), false);
+      SpliceIfConsistent
+         (b0, b0 + 1, newBlock, mNumSamples - len, wxT("Delete - branch one"));
       return;
    }
 
-   // Create a NEW array of blocks
+   // Create a NEW array of blocks, to replace blocks [first, b1]
    BlockArray newBlock;
-   newBlock.reserve(numBlocks - (b1 - b0) + 2);
-
-   // Copy the blocks before the deletion point over to
-   // the NEW array
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b0);
-   unsigned int i;
+   auto first = b0;
 
    // First grab the samples in block b0 before the deletion point
    // into preBuffer.  If this is enough samples for its own block,
    // or if this would be the first block in the array, write it out.
    // Otherwise combine it with the previous block (splitting them
    // 50/50 if necessary).
-   const SeqBlock &preBlock = mBlock[b0];
+   const SeqBlock preBlock = Blocks()[b0];
    // start is within preBlock
    auto preBufferLen = ( start - preBlock.start ).as_size_t();
    if (preBufferLen) {
@@ -1477,9 +1515,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          auto pFile =
             factory.Create(scratch.ptr(), preBufferLen, mSampleFormat);
 
-         newBlock.push_back(SeqBlock(pFile, preBlock.start));
+         newBlock.push_back(pFile);
       } else {
-         const SeqBlock &prepreBlock = mBlock[b0 - 1];
+         const SeqBlock prepreBlock = Blocks()[b0 - 1];
          const auto prepreLen = prepreBlock.sb->GetSampleCount();
          const auto sum = prepreLen + preBufferLen;
 
@@ -1492,9 +1530,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          Read(scratch.ptr() + prepreLen*sampleSize, mSampleFormat,
               preBlock, 0, preBufferLen, true);
 
-         newBlock.pop_back();
+         --first;
          Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-                  newBlock, prepreBlock.start, scratch.ptr(), sum);
+                  newBlock, scratch.ptr(), sum);
       }
    }
    else {
@@ -1507,7 +1545,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
    // for its own block, or if this would be the last block in
    // the array, write it out.  Otherwise combine it with the
    // subsequent block (splitting them 50/50 if necessary).
-   const SeqBlock &postBlock = mBlock[b1];
+   const SeqBlock postBlock = Blocks()[b1];
    // start + len - 1 lies within postBlock
    const auto postBufferLen = (
        (postBlock.start + postBlock.sb->GetSampleCount()) - (start + len)
@@ -1523,9 +1561,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          auto file =
             factory.Create(scratch.ptr(), postBufferLen, mSampleFormat);
 
-         newBlock.push_back(SeqBlock(file, start));
+         newBlock.push_back(file);
       } else {
-         SeqBlock &postpostBlock = mBlock[b1 + 1];
+         const SeqBlock postpostBlock = Blocks()[b1 + 1];
          const auto postpostLen = postpostBlock.sb->GetSampleCount();
          const auto sum = postpostLen + postBufferLen;
 
@@ -1539,7 +1577,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
               postpostBlock, 0, postpostLen, true);
 
          Blockify(*mpFactory, mMaxSamples, mSampleFormat,
-                  newBlock, start, scratch.ptr(), sum);
+                  newBlock, scratch.ptr(), sum);
          b1++;
       }
    }
@@ -1548,21 +1586,18 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       // right on the end of a block.
    }
 
-   // Copy the remaining blocks over from the old array
-   for (i = b1 + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(-len));
-
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples - len, wxT("Delete - branch two"));
+   SpliceIfConsistent
+      (first, b1 + 1, newBlock, mNumSamples - len, wxT("Delete - branch two"));
 }
 
 void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
 {
-   ConsistencyCheck(mBlock, mMaxSamples, 0, mNumSamples, whereStr, mayThrow);
+   ConsistencyCheck(Blocks(), mMaxSamples, 0, Blocks().size(), mNumSamples,
+                    whereStr, mayThrow);
 }
 
 void Sequence::ConsistencyCheck
-   (const BlockArray &mBlock, size_t maxSamples, size_t from,
+   (const BlockArray &mBlock, size_t maxSamples, size_t from, size_t to,
     sampleCount mNumSamples, const wxChar *whereStr,
     bool WXUNUSED(mayThrow))
 {
@@ -1570,28 +1605,19 @@ void Sequence::ConsistencyCheck
    // gives a little more discrimination
    std::optional<InconsistencyException> ex;
 
-   unsigned int numBlocks = mBlock.size();
-
-   unsigned int i;
-   sampleCount pos = from < numBlocks ? mBlock[from].start : mNumSamples;
-   if ( from == 0 && pos != 0 )
-      ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
-
-   for (i = from; !ex && i < numBlocks; i++) {
-      const SeqBlock &seqBlock = mBlock[i];
-      if (pos != seqBlock.start)
-         ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
-
+   // Starts follow from the lengths, so only the lengths need checking
+   to = std::min(to, mBlock.size());
+   auto iter = mBlock.IteratorAt(from);
+   for (auto i = from; !ex && i < to; ++i, ++iter) {
+      const auto seqBlock = *iter;
       if ( seqBlock.sb ) {
-         const auto length = seqBlock.sb->GetSampleCount();
-         if (length > maxSamples)
+         if (seqBlock.sb->GetSampleCount() > maxSamples)
             ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
-         pos += length;
       }
       else
          ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
    }
-   if ( !ex && pos != mNumSamples )
+   if ( !ex && mBlock.GetNumSamples() != mNumSamples )
       ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
 
    if ( ex )
@@ -1612,69 +1638,39 @@ void Sequence::ConsistencyCheck
    }
 }
 
-void Sequence::CommitChangesIfConsistent
-   (BlockArray &newBlock, sampleCount numSamples, const wxChar *whereStr)
+void Sequence::SpliceIfConsistent
+   (size_t b0, size_t b1, const BlockArray &newBlock,
+    sampleCount numSamples, const wxChar *whereStr)
 {
-   ConsistencyCheck( newBlock, mMaxSamples, 0, numSamples, whereStr ); // may throw
-
-   // now commit
-   // use No-fail-guarantee
-
-   mBlock.swap(newBlock);
-   mNumSamples = numSamples;
-}
-
-void Sequence::AppendBlocksIfConsistent
-(BlockArray &additionalBlocks, bool replaceLast,
- sampleCount numSamples, const wxChar *whereStr)
-{
-   // Any additional blocks are meant to be appended,
-   // replacing the final block if there was one.
-
-   if (additionalBlocks.empty())
-      return;
-
-   bool tmpValid = false;
-   SeqBlock tmp;
-
-   if ( replaceLast && ! mBlock.empty() ) {
-      tmp = mBlock.back(), tmpValid = true;
-      mBlock.pop_back();
-   }
-
-   auto prevSize = mBlock.size();
-
-   bool consistent = false;
-   auto cleanup = finally( [&] {
-      if ( !consistent ) {
-         mBlock.resize( prevSize );
-         if ( tmpValid )
-            mBlock.push_back( tmp );
-      }
-   } );
-
-   std::copy( additionalBlocks.begin(), additionalBlocks.end(),
-              std::back_inserter( mBlock ) );
+   // Copying the tree is cheap, and leaves this sequence unchanged if the
+   // check fails
+   auto newArray = Blocks();
+   newArray.Splice(b0, b1, newBlock);
 
    // Check consistency only of the blocks that were added,
    // avoiding quadratic time for repeated checking of repeating appends
-   ConsistencyCheck( mBlock, mMaxSamples, prevSize, numSamples, whereStr ); // may throw
+   ConsistencyCheck( newArray, mMaxSamples, b0, b0 + newBlock.size(),
+      numSamples, whereStr ); // may throw
 
    // now commit
    // use No-fail-guarantee
 
+   if (mpBlock.use_count() > 1)
+      // Don't disturb the copies that share the old array
+      mpBlock = std::make_shared<BlockArray>();
+   *mpBlock = std::move(newArray);
    mNumSamples = numSamples;
-   consistent = true;
 }
 
 void Sequence::DebugPrintf
    (const BlockArray &mBlock, sampleCount mNumSamples, wxString *dest)
 {
-   unsigned int i;
+   unsigned int i = 0;
    decltype(mNumSamples) pos = 0;
 
-   for (i = 0; i < mBlock.size(); i++) {
-      const SeqBlock &seqBlock = mBlock[i];
+   for (auto iter = mBlock.begin(), end = mBlock.end();
+        iter != end; ++iter, ++i) {
+      const auto seqBlock = *iter;
       *dest += wxString::Format
          (wxT("   Block %3u: start %8lld, len %8lld, refs %ld, id %lld"),
           i,
@@ -12,10 +12,13 @@
 #define __AUDACITY_SEQUENCE__
 
 
+#include <iterator>
+#include <memory>
 #include <vector>
 #include <functional>
 
 #include "SampleFormat.h"
+#include "SummaryTree.h"
 #include "XMLTagHandler.h"
 
 #include "SampleCount.h"
@@ -39,14 +42,113 @@ class SeqBlock {
    SeqBlock(const SampleBlockPtr &sb_, sampleCount start_)
       : sb(sb_), start(start_)
    {}
+};
+
+//! The blocks of a Sequence, without gaps, the first starting at 0
+/*!
+ Finding the block containing a sample, getting a block by index, and splicing
+ take logarithmic time.  Starts are computed from the lengths of the blocks
+ before, not stored, so that an edit changes nothing after the edited blocks.
+ Copying is cheap, and a copy never sees changes to the original.
+
+ The tree also holds the whole-block statistics, combined for any range of
+ blocks in logarithmic time.
+ */
+class BlockArray {
+public:
+   using Tree = SummaryTree<SeqBlock::SampleBlockPtr>;
+
+   //! Visits blocks in order, giving each with its start
+   class const_iterator {
+   public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = SeqBlock;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = SeqBlock;
+
+      const_iterator() = default;
+      explicit const_iterator(Tree::const_iterator iter)
+         : mIter{ std::move(iter) }
+      {}
+
+      SeqBlock operator *() const { return { mIter->item, mIter.Start() }; }
+      //! The block, without copying its pointer
+      const SeqBlock::SampleBlockPtr &Block() const { return mIter->item; }
+      sampleCount Start() const { return mIter.Start(); }
+      const_iterator &operator ++() { ++mIter; return *this; }
+
+      friend bool operator ==(
+         const const_iterator &a, const const_iterator &b)
+      { return a.mIter == b.mIter; }
+      friend bool operator !=(
+         const const_iterator &a, const const_iterator &b)
+      { return a.mIter != b.mIter; }
+
+   private:
+      Tree::const_iterator mIter;
+   };
+
+   size_t size() const { return mTree.size(); }
+   bool empty() const { return mTree.empty(); }
+   //! Sum of the lengths of all blocks
+   sampleCount GetNumSamples() const { return mTree.Length(); }
+
+   const_iterator begin() const { return const_iterator{ mTree.begin() }; }
+   const_iterator end() const { return {}; }
+   //! Iterator at block b, or end() if b is not less than size()
+   const_iterator IteratorAt(size_t b) const
+      { return const_iterator{ mTree.IteratorAt(b) }; }
+
+   //! Block b, and its start, without making an iterator
+   /*! @pre b < size() */
+   const SeqBlock::SampleBlockPtr &BlockAt(size_t b, sampleCount &start) const
+      { return mTree.At(b, start).item; }
+   //! Start of block b
+   /*! @pre b < size() */
+   sampleCount GetStart(size_t b) const
+   {
+      sampleCount start;
+      BlockAt(b, start);
+      return start;
+   }
+
+   //! Block b with its start
+   /*! @pre b < size() */
+   SeqBlock operator [](size_t b) const
+   {
+      sampleCount start;
+      const auto &sb = BlockAt(b, start);
+      return { sb, start };
+   }
+   SeqBlock back() const { return (*this)[size() - 1]; }
+
+   //! Index of the block containing sample pos
+   /*! @pre 0 <= pos && pos < GetNumSamples() */
+   size_t FindBlock(sampleCount pos) const { return mTree.Find(pos); }
+
+   //! Combined whole-block statistics of blocks [b0, b1)
+   RangeSummary GetSummary(size_t b0, size_t b1) const
+      { return mTree.Query(b0, b1); }
 
-   // Construct a SeqBlock with changed start, same file
-   SeqBlock Plus(sampleCount delta) const
+   //! Blocks [b0, b1), the first starting at 0
+   BlockArray Slice(size_t b0, size_t b1) const
    {
-      return SeqBlock(sb, start + delta);
+      BlockArray result;
+      result.mTree = mTree.Slice(b0, b1);
+      return result;
    }
+
+   void Append(const BlockArray &other) { mTree.Append(other.mTree); }
+   void push_back(const SeqBlock::SampleBlockPtr &sb);
+
+   //! Replace blocks [b0, b1) with all blocks of another array
+   void Splice(size_t b0, size_t b1, const BlockArray &other)
+      { mTree.Splice(b0, b1, other.mTree); }
+
+private:
+   Tree mTree;
 };
-class BlockArray : public std::vector<SeqBlock> {};
 using BlockPtrArray = std::vector<SeqBlock*>; // non-owning pointers
 
 // Put extra symbol information in the release build, for the purpose of gathering
@@ -93,6 +195,11 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    bool Get(samplePtr buffer, sampleFormat format,
             sampleCount start, size_t len, bool mayThrow) const;
 
+   //! Read ahead the sample blocks overlapping the range, all at once, for
+   //! later calls to Get()
+   /*! Non-throwing; the range may extend outside the sequence */
+   void Prefetch(sampleCount start, sampleCount len) const;
+
    // Note that len is not size_t, because nullptr may be passed for buffer, in
    // which case, silence is inserted, possibly a large amount.
    void SetSamples(constSamplePtr buffer, sampleFormat format,
@@ -109,8 +216,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    void Append(constSamplePtr buffer, sampleFormat format, size_t len);
 
    //! Append data, not coalescing blocks, returning a pointer to the new block.
+   /*! @param stride how many samples to advance buffer after each one */
    SeqBlock::SampleBlockPtr AppendNewBlock(
-      constSamplePtr buffer, sampleFormat format, size_t len);
+      constSamplePtr buffer, sampleFormat format, size_t len,
+      size_t stride = 1);
    //! Append a complete block, not coalescing
    void AppendSharedBlock(const SeqBlock::SampleBlockPtr &pBlock);
    void Delete(sampleCount start, sampleCount len);
@@ -148,6 +257,16 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    bool ConvertToSampleFormat(sampleFormat format, 
       const std::function<void(size_t)> & progressReport = {});
 
+   //! Convert several distinct sequences, sharing the work on all their
+   //! blocks among threads
+   /*!
+    @param progressReport called with counts of samples newly converted in
+    all the sequences, and only in this thread; it may throw to stop
+    */
+   static void ConvertToSampleFormat(const std::vector<Sequence*> &sequences,
+      sampleFormat format,
+      const std::function<void(size_t)> & progressReport = {});
+
    //
    // Retrieving summary info
    //
@@ -173,8 +292,8 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    // you're doing!
    //
 
-   BlockArray &GetBlockArray() { return mBlock; }
-   const BlockArray &GetBlockArray() const { return mBlock; }
+   BlockArray &GetBlockArray() { return MutableBlocks(); }
+   const BlockArray &GetBlockArray() const { return Blocks(); }
 
  private:
 
@@ -190,7 +309,9 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    SampleBlockFactoryPtr mpFactory;
 
-   BlockArray    mBlock;
+   //! Shared with copies of this sequence that use the same factory, such
+   //! as those in the undo history, until one of them changes
+   std::shared_ptr<BlockArray> mpBlock{ std::make_shared<BlockArray>() };
    sampleFormat  mSampleFormat;
 
    // Not size_t!  May need to be large:
@@ -205,8 +326,13 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    // Private methods
    //
 
+   const BlockArray &Blocks() const { return *mpBlock; }
+   //! Copy the array first if it is shared
+   BlockArray &MutableBlocks();
+
    SeqBlock::SampleBlockPtr DoAppend(
-      constSamplePtr buffer, sampleFormat format, size_t len, bool coalesce);
+      constSamplePtr buffer, sampleFormat format, size_t len, bool coalesce,
+      size_t stride = 1);
 
    static void AppendBlock(SampleBlockFactory *pFactory, sampleFormat format,
                            BlockArray &blocks,
@@ -215,12 +341,11 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    // Accumulate NEW block files onto the end of a block array.
    // Does not change this sequence.  The intent is to use
-   // CommitChangesIfConsistent later.
+   // SpliceIfConsistent later.
    static void Blockify(SampleBlockFactory &factory,
                         size_t maxSamples,
                         sampleFormat format,
                         BlockArray &list,
-                        sampleCount start,
                         constSamplePtr buffer,
                         size_t len);
 
@@ -253,20 +378,18 @@ public:
       (const BlockArray &block, sampleCount numSamples, wxString *dest);
 
 private:
+   // Checks blocks [from, to) and the total length
    static void ConsistencyCheck
-      (const BlockArray &block, size_t maxSamples, size_t from,
+      (const BlockArray &block, size_t maxSamples, size_t from, size_t to,
        sampleCount numSamples, const wxChar *whereStr,
        bool mayThrow = true);
 
-   // The next two are used in methods that give a strong guarantee.
-   // They either throw because final consistency check fails, or swap the
+   // This is used in methods that give a strong guarantee.
+   // It either throws because final consistency check fails, or swaps the
    // changed contents into place.
-
-   void CommitChangesIfConsistent
-      (BlockArray &newBlock, sampleCount numSamples, const wxChar *whereStr);
-
-   void AppendBlocksIfConsistent
-      (BlockArray &additionalBlocks, bool replaceLast,
+   // It replaces blocks [b0, b1) with the new blocks, and checks only those.
+   void SpliceIfConsistent
+      (size_t b0, size_t b1, const BlockArray &newBlock,
        sampleCount numSamples, const wxChar *whereStr);
 
 };
@@ -26,6 +26,10 @@ and in the spectrogram spectral selection.
 #include "FFT.h"
 
 #include "SampleFormat.h"
+#include "SampleTrackCache.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
 #include <wx/dcclient.h>
 
 FreqGauge::FreqGauge(wxWindow * parent, wxWindowID winid)
@@ -88,11 +92,112 @@ SpectrumAnalyst::~SpectrumAnalyst()
 {
 }
 
-bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
-                                size_t windowSize, double rate,
-                                const float *data, size_t dataLen,
-                                float *pYMin, float *pYMax,
-                                FreqGauge *progress)
+namespace {
+//! Buffers for the transforms of one window of samples at a time
+struct WindowAnalysis
+{
+   WindowAnalysis(SpectrumAnalyst::Algorithm alg_, size_t windowSize_)
+      : alg{ alg_ }, windowSize{ windowSize_ }
+      , in{ windowSize }, out{ windowSize }, out2{ windowSize }
+   {}
+
+   //! Apply the window to the samples in `in`, analyse them, and add the
+   //! results to the first windowSize / 2 of sums
+   void Add(const float *win, double *sums);
+
+   const SpectrumAnalyst::Algorithm alg;
+   const size_t windowSize;
+   Floats in;
+   Floats out;
+   Floats out2;
+};
+
+void WindowAnalysis::Add(const float *win, double *sums)
+{
+   const auto half = windowSize / 2;
+   for (size_t i = 0; i < windowSize; i++)
+      in[i] *= win[i];
+
+   switch (alg) {
+      case SpectrumAnalyst::Spectrum:
+         PowerSpectrum(windowSize, in.get(), out.get());
+
+         for (size_t i = 0; i < half; i++)
+            sums[i] += out[i];
+         break;
+
+      case SpectrumAnalyst::Autocorrelation:
+      case SpectrumAnalyst::CubeRootAutocorrelation:
+      case SpectrumAnalyst::EnhancedAutocorrelation:
+
+         // Take FFT
+         RealFFT(windowSize, in.get(), out.get(), out2.get());
+         // Compute power
+         for (size_t i = 0; i < windowSize; i++)
+            in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+
+         if (alg == SpectrumAnalyst::Autocorrelation) {
+            for (size_t i = 0; i < windowSize; i++)
+               in[i] = sqrt(in[i]);
+         }
+         if (alg == SpectrumAnalyst::CubeRootAutocorrelation ||
+             alg == SpectrumAnalyst::EnhancedAutocorrelation) {
+            // Tolonen and Karjalainen recommend taking the cube root
+            // of the power, instead of the square root
+
+            for (size_t i = 0; i < windowSize; i++)
+               in[i] = pow(in[i], 1.0f / 3.0f);
+         }
+         // Take FFT
+         RealFFT(windowSize, in.get(), out.get(), out2.get());
+
+         // Take real part of result
+         for (size_t i = 0; i < half; i++)
+            sums[i] += out[i];
+         break;
+
+      case SpectrumAnalyst::Cepstrum:
+         RealFFT(windowSize, in.get(), out.get(), out2.get());
+
+         // Compute log power
+         // Set a sane lower limit assuming maximum time amplitude of 1.0
+         {
+            float power;
+            float minpower = 1e-20*windowSize*windowSize;
+            for (size_t i = 0; i < windowSize; i++)
+            {
+               power = (out[i] * out[i]) + (out2[i] * out2[i]);
+               if(power < minpower)
+                  in[i] = log(minpower);
+               else
+                  in[i] = log(power);
+            }
+            // Take IFFT
+            InverseRealFFT(windowSize, in.get(), NULL, out.get());
+
+            // Take real part of result
+            for (size_t i = 0; i < half; i++)
+               sums[i] += out[i];
+         }
+
+         break;
+
+      default:
+         wxASSERT(false);
+         break;
+   }                         //switch
+}
+
+ThreadPool &AnalysisPool()
+{
+   static ThreadPool pool;
+   return pool;
+}
+}
+
+bool SpectrumAnalyst::Prepare(Algorithm alg, int windowFunc,
+   size_t windowSize, double rate, sampleCount dataLen,
+   std::vector<float> &window)
 {
    // Wipe old data
    mProcessed.resize(0);
@@ -118,116 +223,39 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
    mWindowSize = windowSize;
    mAlg = alg;
 
-   auto half = mWindowSize / 2;
-   mProcessed.resize(mWindowSize);
-
-   Floats in{ mWindowSize };
-   Floats out{ mWindowSize };
-   Floats out2{ mWindowSize };
-   Floats win{ mWindowSize };
-
-   for (size_t i = 0; i < mWindowSize; i++) {
-      mProcessed[i] = 0.0f;
-      win[i] = 1.0f;
-   }
-
-   WindowFunc(windowFunc, mWindowSize, win.get());
+   window.assign(mWindowSize, 1.0f);
+   WindowFunc(windowFunc, mWindowSize, window.data());
+   return true;
+}
 
-   // Scale window such that an amplitude of 1.0 in the time domain
-   // shows an amplitude of 0dB in the frequency domain
-   double wss = 0;
-   for (size_t i = 0; i<mWindowSize; i++)
-      wss += win[i];
-   if(wss > 0)
-      wss = 4.0 / (wss*wss);
-   else
-      wss = 1.0;
+bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
+                                size_t windowSize, double rate,
+                                const float *data, size_t dataLen,
+                                float *pYMin, float *pYMax,
+                                FreqGauge *progress)
+{
+   std::vector<float> win;
+   if (!Prepare(alg, windowFunc, windowSize, rate, dataLen, win))
+      return false;
 
    if (progress) {
       progress->SetRange(dataLen);
    }
 
+   WindowAnalysis analysis{ alg, mWindowSize };
+   std::vector<double> sums(mWindowSize / 2, 0.0);
    size_t start = 0;
-   int windows = 0;
+   size_t windows = 0;
    while (start + mWindowSize <= dataLen) {
-      for (size_t i = 0; i < mWindowSize; i++)
-         in[i] = win[i] * data[start + i];
-
-      switch (alg) {
-         case Spectrum:
-            PowerSpectrum(mWindowSize, in.get(), out.get());
-
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Autocorrelation:
-         case CubeRootAutocorrelation:
-         case EnhancedAutocorrelation:
-
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-            // Compute power
-            for (size_t i = 0; i < mWindowSize; i++)
-               in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
-
-            if (alg == Autocorrelation) {
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = sqrt(in[i]);
-            }
-            if (alg == CubeRootAutocorrelation ||
-                alg == EnhancedAutocorrelation) {
-               // Tolonen and Karjalainen recommend taking the cube root
-               // of the power, instead of the square root
-
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = pow(in[i], 1.0f / 3.0f);
-            }
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Take real part of result
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Cepstrum:
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Compute log power
-            // Set a sane lower limit assuming maximum time amplitude of 1.0
-            {
-               float power;
-               float minpower = 1e-20*mWindowSize*mWindowSize;
-               for (size_t i = 0; i < mWindowSize; i++)
-               {
-                  power = (out[i] * out[i]) + (out2[i] * out2[i]);
-                  if(power < minpower)
-                     in[i] = log(minpower);
-                  else
-                     in[i] = log(power);
-               }
-               // Take IFFT
-               InverseRealFFT(mWindowSize, in.get(), NULL, out.get());
-
-               // Take real part of result
-               for (size_t i = 0; i < half; i++)
-                  mProcessed[i] += out[i];
-            }
-
-            break;
-
-         default:
-            wxASSERT(false);
-            break;
-      }                         //switch
+      std::copy(data + start, data + start + mWindowSize, analysis.in.get());
+      analysis.Add(win.data(), sums.data());
 
       // Update the progress bar
       if (progress) {
          progress->SetValue(start);
       }
 
-      start += half;
+      start += mWindowSize / 2;
       windows++;
    }
 
@@ -236,9 +264,95 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       progress->Reset();
    }
 
+   Finish(win, sums, windows, pYMin, pYMax);
+   return true;
+}
+
+bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
+   size_t windowSize, double rate,
+   const std::vector<std::shared_ptr<const SampleTrack>> &tracks,
+   sampleCount start, sampleCount len,
+   float *pYMin, float *pYMax, const ProgressCallback &progress)
+{
+   std::vector<float> win;
+   if (tracks.empty() ||
+       !Prepare(alg, windowFunc, windowSize, rate, len, win))
+      return false;
+
+   const auto half = mWindowSize / 2;
+   const auto nWindows = ((len - mWindowSize) / half + 1).as_size_t();
+
+   // Give each thread a few stretches of consecutive windows, so that a slow
+   // stretch does not hold up the rest.  Each stretch sums its own results,
+   // and the sums are combined in order, so that the answer does not depend
+   // on how the threads happened to run.
+   auto &pool = AnalysisPool();
+   const auto nStretches =
+      std::min(nWindows, 2 * (pool.GetWorkerCount() + 1));
+   std::vector<std::vector<double>> stretchSums(nStretches);
+   std::atomic<size_t> done{ 0 };
+
+   const auto analyse = [&](size_t ii){
+      const auto first = nWindows * ii / nStretches;
+      const auto last = nWindows * (ii + 1) / nStretches;
+
+      // Caches can't be moved, so make all at once
+      std::vector<SampleTrackCache> caches(tracks.size());
+      for (size_t jj = 0; jj < tracks.size(); ++jj)
+         caches[jj].SetTrack(tracks[jj]);
+      WindowAnalysis analysis{ alg, mWindowSize };
+      auto &sums = stretchSums[ii];
+      sums.resize(half, 0.0);
+
+      const auto in = analysis.in.get();
+      for (auto ww = first; ww < last; ++ww) {
+         const auto pos = start + sampleCount{ ww } * half;
+         std::fill(in, in + mWindowSize, 0.0f);
+         for (auto &cache : caches)
+            // Don't allow throw for bad reads; treat them as silence
+            if (const auto samples = cache.GetFloats(pos, mWindowSize, false))
+               for (size_t i = 0; i < mWindowSize; i++)
+                  in[i] += samples[i];
+         analysis.Add(win.data(), sums.data());
+         done.fetch_add(1, std::memory_order_relaxed);
+      }
+   };
+   if (progress)
+      pool.ParallelForPolling(nStretches, analyse, [&]{
+         progress(done.load(std::memory_order_relaxed), nWindows);
+      });
+   else
+      pool.ParallelFor(nStretches, analyse);
+
+   std::vector<double> sums(half, 0.0);
+   for (const auto &stretch : stretchSums)
+      for (size_t i = 0; i < half; i++)
+         sums[i] += stretch[i];
+
+   Finish(win, sums, nWindows, pYMin, pYMax);
+   return true;
+}
+
+void SpectrumAnalyst::Finish(const std::vector<float> &win,
+   const std::vector<double> &sums, size_t windows,
+   float *pYMin, float *pYMax)
+{
+   const auto half = mWindowSize / 2;
+   mProcessed.assign(mWindowSize, 0.0f);
+
+   // Scale window such that an amplitude of 1.0 in the time domain
+   // shows an amplitude of 0dB in the frequency domain
+   double wss = 0;
+   for (size_t i = 0; i<mWindowSize; i++)
+      wss += win[i];
+   if(wss > 0)
+      wss = 4.0 / (wss*wss);
+   else
+      wss = 1.0;
+
    float mYMin = 1000000, mYMax = -1000000;
    double scale;
-   switch (alg) {
+   switch (mAlg) {
    case Spectrum:
       // Convert to decibels
       mYMin = 1000000.;
@@ -246,7 +360,7 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       scale = wss / (double)windows;
       for (size_t i = 0; i < half; i++)
       {
-         mProcessed[i] = 10 * log10(mProcessed[i] * scale);
+         mProcessed[i] = 10 * log10(sums[i] * scale);
          if(mProcessed[i] > mYMax)
             mYMax = mProcessed[i];
          else if(mProcessed[i] < mYMin)
@@ -257,7 +371,7 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
    case Autocorrelation:
    case CubeRootAutocorrelation:
       for (size_t i = 0; i < half; i++)
-         mProcessed[i] = mProcessed[i] / windows;
+         mProcessed[i] = sums[i] / windows;
 
       // Find min/max
       mYMin = mProcessed[0];
@@ -270,12 +384,14 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       break;
 
    case EnhancedAutocorrelation:
+   {
       for (size_t i = 0; i < half; i++)
-         mProcessed[i] = mProcessed[i] / windows;
+         mProcessed[i] = sums[i] / windows;
 
       // Peak Pruning as described by Tolonen and Karjalainen, 2000
 
       // Clip at zero, copy to temp array
+      Floats out{ half };
       for (size_t i = 0; i < half; i++) {
          if (mProcessed[i] < 0.0)
             mProcessed[i] = float(0.0);
@@ -304,10 +420,11 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
          else if (mProcessed[i] < mYMin)
             mYMin = mProcessed[i];
       break;
+   }
 
    case Cepstrum:
       for (size_t i = 0; i < half; i++)
-         mProcessed[i] = mProcessed[i] / windows;
+         mProcessed[i] = sums[i] / windows;
 
       // Find min/max, ignoring first and last few values
       {
@@ -331,8 +448,6 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       *pYMin = mYMin;
    if (pYMax)
       *pYMax = mYMax;
-
-   return true;
 }
 
 const float *SpectrumAnalyst::GetProcessed() const
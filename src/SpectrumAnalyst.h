@@ -12,10 +12,14 @@
 #ifndef __AUDACITY_SPECTRUM_ANALYST__
 #define __AUDACITY_SPECTRUM_ANALYST__
 
+#include <functional>
+#include <memory>
 #include <vector>
 #include <wx/statusbr.h>
+#include "SampleCount.h"
 
 class FreqGauge;
+class SampleTrack;
 
 class AUDACITY_DLL_API SpectrumAnalyst
 {
@@ -42,6 +46,26 @@ public:
       float *pYMin = NULL, float *pYMax = NULL, // outputs
       FreqGauge *progress = NULL);
 
+   //! Receives the count of windows done, and the total
+   using ProgressCallback = std::function<void(size_t done, size_t total)>;
+
+   //! Like the other Calculate(), for the sum of the tracks over the range of
+   //! samples [start, start + len)
+   /*!
+    The tracks are read in pieces, on several threads, each with its own
+    SampleTrackCache, so memory use depends on the window size and the number
+    of threads, not on len.  The tracks must not change until it returns.
+    progress is called only on this thread.
+    @return true iff successful
+    */
+   bool Calculate(Algorithm alg,
+      int windowFunc, // see FFT.h for values
+      size_t windowSize, double rate,
+      const std::vector<std::shared_ptr<const SampleTrack>> &tracks,
+      sampleCount start, sampleCount len,
+      float *pYMin = nullptr, float *pYMax = nullptr, // outputs
+      const ProgressCallback &progress = {});
+
    const float *GetProcessed() const;
    int GetProcessedSize() const;
 
@@ -49,6 +73,16 @@ public:
    float FindPeak(float xPos, float *pY) const;
 
 private:
+   //! Wipe old results, validate arguments, and if valid, store them and
+   //! compute the window function
+   bool Prepare(Algorithm alg, int windowFunc, size_t windowSize,
+      double rate, sampleCount dataLen, std::vector<float> &window);
+   //! Make mProcessed from the sums of results over all windows, and find
+   //! its range
+   void Finish(const std::vector<float> &window,
+      const std::vector<double> &sums, size_t windows,
+      float *pYMin, float *pYMax);
+
    float CubicInterpolate(float y0, float y1, float y2, float y3, float x) const;
    float CubicMaximize(float y0, float y1, float y2, float y3, float * max) const;
 
@@ -8,12 +8,19 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 **********************************************************************/
 
+#include <algorithm>
+#include <deque>
 #include <float.h>
+#include <mutex>
 #include <sqlite3.h>
 
 #include "DBConnection.h"
+#include "Dither.h"
 #include "ProjectFileIO.h"
+#include "ProjectFormatExtensionsRegistry.h"
+#include "SampleCompression.h"
 #include "SampleFormat.h"
+#include "SampleSummary.h"
 #include "XMLTagHandler.h"
 
 #include "SampleBlock.h" // to inherit
@@ -34,11 +41,12 @@ public:
 
    void CloseLock() override;
 
-   void SetSamples(
-      constSamplePtr src, size_t numsamples, sampleFormat srcformat);
+   void SetSamples(constSamplePtr src, size_t numsamples,
+      sampleFormat srcformat, size_t srcStride = 1);
 
    //! Numbers of bytes needed for 256 and for 64k summaries
    using Sizes = std::pair< size_t, size_t >;
+   //! Assign the block id, and schedule the writing of the row
    void Commit(Sizes sizes);
 
    void Delete();
@@ -65,6 +73,11 @@ public:
    MinMaxRMS DoGetMinMaxRMS() const override;
 
    size_t GetSpaceUsage() const override;
+
+   bool CanStoreSpectra() const override;
+   bool GetSpectra(long long key, std::vector<char> &data) override;
+   void SetSpectra(long long key, std::vector<char> data) override;
+
    void SaveXML(XMLWriter &xmlFile) override;
 
 private:
@@ -75,12 +88,19 @@ private:
                    size_t numframes,
                    DBConnection::StatementID id,
                    const char *sql);
+   static bool CopySummary(float *dest, size_t frameoffset, size_t numframes,
+      const char *src, size_t srcbytes);
+   //! Copy from all the samples, decoded, filling with zeroes past the end
+   size_t CopyDecoded(const char *src, samplePtr dest, sampleFormat destformat,
+      size_t sampleoffset, size_t numsamples) const;
    size_t GetBlob(void *dest,
                   sampleFormat destformat,
                   sqlite3_stmt *stmt,
                   sampleFormat srcformat,
                   size_t srcoffset,
-                  size_t srcbytes);
+                  size_t srcbytes,
+                  SampleCompression::Codec codec = SampleCompression::Raw);
+   size_t GetCompressedSampleCount(SampleBlockID sbid);
 
    enum {
       fields = 3, /* min, max, rms */
@@ -89,6 +109,17 @@ private:
    Sizes SetSizes( size_t numsamples, sampleFormat srcformat );
    void CalcSummary(Sizes sizes);
 
+   struct Pending;
+   static int InsertRow(DBConnection &conn, SampleBlockID sbid,
+      sampleFormat format, double sumMin, double sumMax, double sumRms,
+      SampleCompression::Codec codec, Pending &pending);
+   //! Read the row back into pending, before a rollback removes it
+   static void RestoreRow(DBConnection &conn, SampleBlockID sbid,
+      sampleFormat format, SampleCompression::Codec codec, Pending &pending);
+   static int DeleteRow(DBConnection &conn, SampleBlockID sbid);
+   static int InsertSpectra(DBConnection &conn, SampleBlockID sbid,
+      long long key, Pending *pPending, const std::vector<char> &data);
+
 private:
    //! This must never be called for silent blocks
    /*! @post return value is not null */
@@ -110,6 +141,7 @@ private:
    size_t mSampleBytes;
    size_t mSampleCount;
    sampleFormat mSampleFormat;
+   SampleCompression::Codec mCodec{ SampleCompression::Raw };
 
    ArrayOf<char> mSummary256;
    ArrayOf<char> mSummary64k;
@@ -117,16 +149,46 @@ private:
    double mSumMax;
    double mSumRms;
 
+   //! Not null for blocks made by Commit(), shared with the deferred insert
+   std::shared_ptr<Pending> mpPending;
+
 #if defined(WORDS_BIGENDIAN)
 #error All sample block data is little endian...big endian not yet supported
 #endif
 };
 
+//! The contents of a new block, kept in memory to serve reads until its
+//! row is inserted
+/*! Reads through the same connection find the row then, even in a transaction
+ not yet committed.  If that rolls back, the contents are read back first,
+ to insert again. */
+struct SqliteSampleBlock::Pending
+{
+   std::mutex mutex;
+
+   // All guarded by mutex:
+
+   //! Uncompressed; null after the row is inserted
+   ArrayOf<char> samples;
+   size_t sampleBytes{ 0 };
+   //! Empty when the row stores the samples uncompressed
+   std::vector<unsigned char> compressed;
+   ArrayOf<char> summary256;
+   ArrayOf<char> summary64k;
+   Sizes sizes;
+   //! Whether the insert was tried, so that the row may exist, though maybe
+   //! not yet committed; if its batch failed, it will be tried again
+   bool attempted{ false };
+   //! Whether the block was deleted before the insert, which is then skipped
+   bool cancelled{ false };
+};
+
 // Silent blocks use nonpositive id values to encode a length
 // and don't occupy any rows in the database; share blocks for repeatedly
 // used length values
 static std::map< SampleBlockID, std::shared_ptr<SqliteSampleBlock> >
    sSilentBlocks;
+static std::mutex sSilentBlocksMutex;
 
 ///\brief Implementation of @ref SampleBlockFactory using Sqlite database
 class SqliteSampleBlockFactory final
@@ -142,7 +204,8 @@ public:
 
    SampleBlockPtr DoCreate(constSamplePtr src,
       size_t numsamples,
-      sampleFormat srcformat) override;
+      sampleFormat srcformat,
+      size_t srcStride) override;
 
    SampleBlockPtr DoCreateSilent(
       size_t numsamples,
@@ -155,9 +218,22 @@ public:
    BlockDeletionCallback SetBlockDeletionCallback(
       BlockDeletionCallback callback ) override;
 
+   void Prefetch(const std::vector<SampleBlockPtr> &blocks) override;
+
 private:
    friend SqliteSampleBlock;
 
+   //! All the samples of a block, decoded, in the block's format
+   using ReadAheadSamples = std::shared_ptr<const std::vector<char>>;
+   //! Find what Prefetch() read for the block, and forget it if release
+   ReadAheadSamples FindReadAhead(SampleBlockID sbid, bool release);
+   void DropReadAhead(SampleBlockID sbid);
+
+   //! Most blocks whose samples are kept by Prefetch()
+   static constexpr size_t MaxReadAhead = 32;
+   //! Most blocks read by one query
+   static constexpr int ReadAheadBatch = 16;
+
    const std::shared_ptr<ConnectionPtr> mppConnection;
 
    // Track all blocks that this factory has created, but don't control
@@ -166,13 +242,25 @@ private:
    // to the factory and we can't have a leaky cycle of shared pointers)
    using AllBlocksMap =
       std::map< SampleBlockID, std::weak_ptr< SqliteSampleBlock > >;
+   //! Blocks may be created by several import threads at once
+   std::mutex mAllBlocksMutex;
+   //! Guarded by mAllBlocksMutex
    AllBlocksMap mAllBlocks;
 
    BlockDeletionCallback mCallback;
+
+   // Read preferences once here, because blocks may be committed by the
+   // recording thread
+   const bool mCompress;
+
+   std::mutex mReadAheadMutex;
+   //! Guarded by mReadAheadMutex; oldest first
+   std::deque<std::pair<SampleBlockID, ReadAheadSamples>> mReadAhead;
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
    : mppConnection{ ConnectionPtr::Get(project).shared_from_this() }
+   , mCompress{ CompressSampleBlocks.Read() }
 {
    
 }
@@ -180,11 +268,13 @@ SqliteSampleBlockFactory::SqliteSampleBlockFactory( AudacityProject &project )
 SqliteSampleBlockFactory::~SqliteSampleBlockFactory() = default;
 
 SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
-   constSamplePtr src, size_t numsamples, sampleFormat srcformat )
+   constSamplePtr src, size_t numsamples, sampleFormat srcformat,
+   size_t srcStride )
 {
    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
-   sb->SetSamples(src, numsamples, srcformat);
+   sb->SetSamples(src, numsamples, srcformat, srcStride);
    // block id has now been assigned
+   std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
    mAllBlocks[ sb->GetBlockID() ] = sb;
    return sb;
 }
@@ -192,6 +282,7 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
 auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
 {
    SampleBlockIDs result;
+   std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
    for (auto end = mAllBlocks.end(), it = mAllBlocks.begin(); it != end;) {
       if (it->second.expired())
          // Tighten up the map
@@ -208,6 +299,7 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateSilent(
    size_t numsamples, sampleFormat )
 {
    auto id = -static_cast< SampleBlockID >(numsamples);
+   std::lock_guard<std::mutex> lock{ sSilentBlocksMutex };
    auto &result = sSilentBlocks[ id ];
    if ( !result ) {
       result = std::make_shared<SqliteSampleBlock>(nullptr);
@@ -244,18 +336,27 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromXML(
          }
          else {
             // First see if this block id was previously loaded
-            auto &wb = mAllBlocks[ nValue ];
-            auto pb = wb.lock();
+            std::shared_ptr<SqliteSampleBlock> pb, ssb;
+            {
+               std::lock_guard<std::mutex> lock{ mAllBlocksMutex };
+               auto &wb = mAllBlocks[ nValue ];
+               pb = wb.lock();
+               if (!pb) {
+                  // First sight of this id
+                  ssb = std::make_shared<SqliteSampleBlock>(
+                     shared_from_this());
+                  wb = ssb;
+               }
+            }
             if (pb)
                // Reuse the block
                sb = pb;
             else {
-               // First sight of this id
-               auto ssb =
-                  std::make_shared<SqliteSampleBlock>(shared_from_this());
-               wb = ssb;
                sb = ssb;
                ssb->mSampleFormat = srcformat;
+               // Another factory may have made the block, and its row
+               // might not be written yet
+               ssb->Conn()->FlushDeferred();
                // This may throw database errors
                // It initializes the rest of the fields
                ssb->Load((SampleBlockID) nValue);
@@ -274,6 +375,122 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromXML(
    return sb;
 }
 
+void SqliteSampleBlockFactory::Prefetch(
+   const std::vector<SampleBlockPtr> &blocks)
+{
+   // Choose blocks that have rows, not yet read ahead
+   std::vector<const SqliteSampleBlock*> wanted;
+   {
+      std::lock_guard<std::mutex> lock{ mReadAheadMutex };
+      for (auto &pBlock : blocks) {
+         if (wanted.size() == MaxReadAhead)
+            break;
+         const auto pSqliteBlock =
+            dynamic_cast<const SqliteSampleBlock*>(pBlock.get());
+         if (!pSqliteBlock || pSqliteBlock->mpFactory.get() != this ||
+             pSqliteBlock->IsSilent() || !pSqliteBlock->mValid)
+            continue;
+         const auto sbid = pSqliteBlock->mBlockID;
+         if (auto &pPending = pSqliteBlock->mpPending) {
+            std::lock_guard<std::mutex> pendingLock{ pPending->mutex };
+            if (pPending->samples)
+               continue;
+         }
+         if (std::any_of(mReadAhead.begin(), mReadAhead.end(),
+               [&](auto &pair){ return pair.first == sbid; }) ||
+             std::any_of(wanted.begin(), wanted.end(),
+               [&](auto pOther){ return pOther->mBlockID == sbid; }))
+            continue;
+         wanted.push_back(pSqliteBlock);
+      }
+   }
+   if (wanted.size() < 2)
+      // Not worth it
+      return;
+
+   try {
+      auto &conn = *wanted[0]->Conn();
+      // Prepare and cache statement...automatically finalized at DB close
+      static const std::string sql = []{
+         std::string result =
+            "SELECT blockid, samples FROM sampleblocks WHERE blockid IN (";
+         for (int ii = 1; ii <= ReadAheadBatch; ++ii)
+            result += (ii > 1 ? ", ?" : "?") + std::to_string(ii);
+         return result + ");";
+      }();
+      const auto stmt = conn.Prepare(DBConnection::GetSamplesBatch, sql.c_str());
+
+      for (size_t first = 0; first < wanted.size(); first += ReadAheadBatch) {
+         const auto end = std::min(wanted.size(), first + ReadAheadBatch);
+         for (int ii = 0; ii < ReadAheadBatch; ++ii)
+            // Repeat the last id to fill the list
+            sqlite3_bind_int64(stmt, ii + 1,
+               wanted[std::min(first + ii, end - 1)]->mBlockID);
+
+         int rc;
+         while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            const SampleBlockID sbid = sqlite3_column_int64(stmt, 0);
+            const auto iter = std::find_if(
+               wanted.begin() + first, wanted.begin() + end,
+               [&](auto pBlock){ return pBlock->mBlockID == sbid; });
+            if (iter == wanted.begin() + end)
+               continue;
+            auto &block = **iter;
+
+            const auto src = sqlite3_column_blob(stmt, 1);
+            const size_t srcbytes = sqlite3_column_bytes(stmt, 1);
+            auto pSamples = std::make_shared<std::vector<char>>(
+               block.mSampleBytes);
+            // Anything unexpected is left for the usual reading to report
+            if (block.mCodec == SampleCompression::Raw) {
+               if (srcbytes != block.mSampleBytes)
+                  continue;
+               if (srcbytes)
+                  memcpy(pSamples->data(), src, srcbytes);
+            }
+            else if (SampleCompression::Decompress(src, srcbytes,
+                  block.mSampleFormat, pSamples->data(), block.mSampleCount)
+               != block.mSampleCount)
+               continue;
+
+            std::lock_guard<std::mutex> lock{ mReadAheadMutex };
+            mReadAhead.emplace_back(sbid, std::move(pSamples));
+            while (mReadAhead.size() > MaxReadAhead)
+               mReadAhead.pop_front();
+         }
+
+         // Clear statement bindings and rewind statement
+         sqlite3_clear_bindings(stmt);
+         sqlite3_reset(stmt);
+         if (rc != SQLITE_DONE)
+            break;
+      }
+   }
+   catch (...) {
+      // Only a hint; reading each block reports any error
+   }
+}
+
+auto SqliteSampleBlockFactory::FindReadAhead(SampleBlockID sbid, bool release)
+   -> ReadAheadSamples
+{
+   std::lock_guard<std::mutex> lock{ mReadAheadMutex };
+   const auto end = mReadAhead.end();
+   const auto iter = std::find_if(mReadAhead.begin(), end,
+      [&](auto &pair){ return pair.first == sbid; });
+   if (iter == end)
+      return {};
+   auto result = iter->second;
+   if (release)
+      mReadAhead.erase(iter);
+   return result;
+}
+
+void SqliteSampleBlockFactory::DropReadAhead(SampleBlockID sbid)
+{
+   FindReadAhead(sbid, true);
+}
+
 auto SqliteSampleBlockFactory::SetBlockDeletionCallback(
    BlockDeletionCallback callback ) -> BlockDeletionCallback
 {
@@ -301,6 +518,8 @@ SqliteSampleBlock::~SqliteSampleBlock()
       auto &callback = mpFactory->mCallback;
       if (callback)
          GuardedCall( [&]{ callback( *this ); } );
+      if (!IsSilent())
+         mpFactory->DropReadAhead(mBlockID);
    }
 
    if (IsSilent()) {
@@ -376,6 +595,19 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
       return numsamples;
    }
 
+   if (mpPending) {
+      std::lock_guard<std::mutex> lock{ mpPending->mutex };
+      if (auto src = mpPending->samples.get())
+         return CopyDecoded(src, dest, destformat, sampleoffset, numsamples);
+   }
+
+   // Maybe the factory read this block with others; keep that for further
+   // reads, unless this one reaches the end
+   if (auto pSamples = mpFactory->FindReadAhead(mBlockID,
+         sampleoffset + numsamples >= mSampleCount))
+      return CopyDecoded(pSamples->data(),
+         dest, destformat, sampleoffset, numsamples);
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::GetSamples,
       "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
@@ -385,16 +617,37 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
                   stmt,
                   mSampleFormat,
                   sampleoffset * SAMPLE_SIZE(mSampleFormat),
-                  numsamples * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
+                  numsamples * SAMPLE_SIZE(mSampleFormat),
+                  mCodec) / SAMPLE_SIZE(mSampleFormat);
+}
+
+size_t SqliteSampleBlock::CopyDecoded(const char *src,
+   samplePtr dest, sampleFormat destformat,
+   size_t sampleoffset, size_t numsamples) const
+{
+   const auto srcsize = SAMPLE_SIZE(mSampleFormat);
+   const auto count = sampleoffset < mSampleCount
+      ? std::min(numsamples, mSampleCount - sampleoffset) : 0;
+   CopySamples(src + sampleoffset * srcsize, mSampleFormat,
+      dest, destformat, count);
+   const auto size = SAMPLE_SIZE(destformat);
+   memset(dest + count * size, 0, (numsamples - count) * size);
+   return numsamples;
 }
 
 void SqliteSampleBlock::SetSamples(constSamplePtr src,
                                    size_t numsamples,
-                                   sampleFormat srcformat)
+                                   sampleFormat srcformat,
+                                   size_t srcStride)
 {
    auto sizes = SetSizes(numsamples, srcformat);
    mSamples.reinit(mSampleBytes);
-   memcpy(mSamples.get(), src, mSampleBytes);
+   if (srcStride == 1)
+      memcpy(mSamples.get(), src, mSampleBytes);
+   else
+      // Deinterleave as we copy
+      CopySamples(src, srcformat, mSamples.get(), srcformat, numsamples,
+         DitherType::none, srcStride);
 
    CalcSummary( sizes );
 
@@ -405,6 +658,12 @@ bool SqliteSampleBlock::GetSummary256(float *dest,
                                       size_t frameoffset,
                                       size_t numframes)
 {
+   if (mpPending) {
+      std::lock_guard<std::mutex> lock{ mpPending->mutex };
+      if (auto src = mpPending->summary256.get())
+         return CopySummary(dest, frameoffset, numframes,
+            src, mpPending->sizes.first);
+   }
    return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary256,
       "SELECT summary256 FROM sampleblocks WHERE blockid = ?1;");
 }
@@ -413,10 +672,28 @@ bool SqliteSampleBlock::GetSummary64k(float *dest,
                                       size_t frameoffset,
                                       size_t numframes)
 {
+   if (mpPending) {
+      std::lock_guard<std::mutex> lock{ mpPending->mutex };
+      if (auto src = mpPending->summary64k.get())
+         return CopySummary(dest, frameoffset, numframes,
+            src, mpPending->sizes.second);
+   }
    return GetSummary(dest, frameoffset, numframes, DBConnection::GetSummary64k,
       "SELECT summary64k FROM sampleblocks WHERE blockid = ?1;");
 }
 
+bool SqliteSampleBlock::CopySummary(float *dest,
+   size_t frameoffset, size_t numframes, const char *src, size_t srcbytes)
+{
+   // Like GetBlob, fill with zeroes past the end
+   const auto offset = std::min(frameoffset * bytesPerFrame, srcbytes);
+   const auto bytes = std::min(numframes * bytesPerFrame, srcbytes - offset);
+   memcpy(dest, src + offset, bytes);
+   memset(reinterpret_cast<char*>(dest) + bytes, 0,
+      numframes * bytesPerFrame - bytes);
+   return true;
+}
+
 bool SqliteSampleBlock::GetSummary(float *dest,
                                    size_t frameoffset,
                                    size_t numframes,
@@ -522,18 +799,141 @@ MinMaxRMS SqliteSampleBlock::DoGetMinMaxRMS() const
 
 size_t SqliteSampleBlock::GetSpaceUsage() const
 {
+   // GetDiskUsage waits for the row to be written, if it is not yet
    if (IsSilent())
       return 0;
    else
       return ProjectFileIO::GetDiskUsage(*Conn(), mBlockID);
 }
 
+bool SqliteSampleBlock::CanStoreSpectra() const
+{
+   if (IsSilent())
+      return false;
+   try {
+      return Conn()->HasSpectra();
+   }
+   catch ( const AudacityException & ) {
+   }
+   return false;
+}
+
+bool SqliteSampleBlock::GetSpectra(long long key, std::vector<char> &data)
+{
+   // Non-throwing, it returns true only if there was a row
+   if (IsSilent())
+      return false;
+
+   try {
+      auto &conn = *Conn();
+      if (!conn.HasSpectra())
+         return false;
+
+      // Prepare and cache statement...automatically finalized at DB close
+      auto stmt = conn.Prepare(DBConnection::GetSpectra,
+         "SELECT frames FROM spectra WHERE blockid = ?1 AND settings = ?2;");
+      auto cleanup = finally([stmt]{
+         // Clear statement bindings and rewind statement
+         sqlite3_clear_bindings(stmt);
+         sqlite3_reset(stmt);
+      });
+
+      if (sqlite3_bind_int64(stmt, 1, mBlockID) ||
+          sqlite3_bind_int64(stmt, 2, key))
+      {
+         wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+      }
+
+      if (sqlite3_step(stmt) != SQLITE_ROW)
+         return false;
+
+      auto src = static_cast<const char *>(sqlite3_column_blob(stmt, 0));
+      auto bytes = sqlite3_column_bytes(stmt, 0);
+      data.assign(src, src + bytes);
+      return true;
+   }
+   catch ( const AudacityException & ) {
+   }
+   return false;
+}
+
+void SqliteSampleBlock::SetSpectra(long long key, std::vector<char> data)
+{
+   if (IsSilent())
+      return;
+
+   try {
+      auto &conn = *Conn();
+      if (!conn.HasSpectra())
+         return;
+      auto pData = std::make_shared<std::vector<char>>(std::move(data));
+      conn.Defer(
+         [&conn, sbid = mBlockID, key, pPending = mpPending, pData]{
+            return InsertSpectra(conn, sbid, key, pPending.get(), *pData);
+         },
+         [pData]{
+            // A cache need not be inserted again after a rollback, so
+            // don't keep it till commit
+            std::vector<char>{}.swap(*pData);
+         }
+      );
+   }
+   catch ( const AudacityException & ) {
+      // The spectra are only a cache
+   }
+}
+
+int SqliteSampleBlock::InsertSpectra(DBConnection &conn, SampleBlockID sbid,
+   long long key, Pending *pPending, const std::vector<char> &data)
+{
+   // Does not fail, so that failure can't undo the other updates in the
+   // same transaction
+   if (data.empty())
+      // Applied already, before a rollback
+      return SQLITE_OK;
+   if (pPending) {
+      std::lock_guard<std::mutex> lock{ pPending->mutex };
+      if (pPending->cancelled)
+         // The block row was never inserted, so don't leave an orphan
+         return SQLITE_OK;
+   }
+
+   auto db = conn.DB();
+   sqlite3_stmt *stmt = nullptr;
+   try {
+      // Prepare and cache statement...automatically finalized at DB close
+      stmt = conn.Prepare(DBConnection::SetSpectra,
+         "INSERT OR REPLACE INTO spectra (blockid, settings, frames)"
+         "  VALUES(?1, ?2, ?3);");
+   }
+   catch ( const AudacityException & ) {
+      return SQLITE_OK;
+   }
+
+   if (sqlite3_bind_int64(stmt, 1, sbid) ||
+       sqlite3_bind_int64(stmt, 2, key) ||
+       sqlite3_bind_blob(stmt, 3, data.data(), (int)data.size(), SQLITE_STATIC))
+   {
+      wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+   }
+
+   if (sqlite3_step(stmt) != SQLITE_DONE)
+      wxLogDebug(wxT("SqliteSampleBlock::InsertSpectra - SQLITE error %s"),
+         sqlite3_errmsg(db));
+
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+   return SQLITE_OK;
+}
+
 size_t SqliteSampleBlock::GetBlob(void *dest,
                                   sampleFormat destformat,
                                   sqlite3_stmt *stmt,
                                   sampleFormat srcformat,
                                   size_t srcoffset,
-                                  size_t srcbytes)
+                                  size_t srcbytes,
+                                  SampleCompression::Codec codec)
 {
    auto db = DB();
 
@@ -588,6 +988,19 @@ size_t SqliteSampleBlock::GetBlob(void *dest,
    samplePtr src = (samplePtr) sqlite3_column_blob(stmt, 0);
    size_t blobbytes = (size_t) sqlite3_column_bytes(stmt, 0);
 
+   // Decode compressed samples, only as far as the requested range needs;
+   // a malformed blob is then treated like a short one
+   SampleBuffer decoded;
+   if (codec != SampleCompression::Raw)
+   {
+      const auto size = SAMPLE_SIZE(srcformat);
+      const auto count = std::min(mSampleCount, (srcoffset + srcbytes) / size);
+      decoded.Allocate(count, srcformat);
+      blobbytes = size * SampleCompression::Decompress(
+         src, blobbytes, srcformat, decoded.ptr(), count);
+      src = decoded.ptr();
+   }
+
    srcoffset = std::min(srcoffset, blobbytes);
    minbytes = std::min(srcbytes, blobbytes - srcoffset);
 
@@ -665,12 +1078,19 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    mSumMin = FLT_MAX;
    mSumMax = -FLT_MAX;
    mSumMin = 0.0;
+   mCodec = SampleCompression::Raw;
 
    // Prepare and cache statement...automatically finalized at DB close
-   sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::LoadSampleBlock,
-      "SELECT sampleformat, summin, summax, sumrms,"
-      "       length(samples)"
-      "  FROM sampleblocks WHERE blockid = ?1;");
+   const bool hasCodec = Conn()->HasSampleBlockCodec();
+   sqlite3_stmt *stmt = hasCodec
+      ? Conn()->Prepare(DBConnection::LoadCompressedSampleBlock,
+         "SELECT sampleformat, summin, summax, sumrms,"
+         "       length(samples), codec"
+         "  FROM sampleblocks WHERE blockid = ?1;")
+      : Conn()->Prepare(DBConnection::LoadSampleBlock,
+         "SELECT sampleformat, summin, summax, sumrms,"
+         "       length(samples)"
+         "  FROM sampleblocks WHERE blockid = ?1;");
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
@@ -712,125 +1132,283 @@ void SqliteSampleBlock::Load(SampleBlockID sbid)
    mSumRms = sqlite3_column_double(stmt, 3);
    mSampleBytes = sqlite3_column_int(stmt, 4);
    mSampleCount = mSampleBytes / SAMPLE_SIZE(mSampleFormat);
+   if (hasCodec)
+      mCodec = (SampleCompression::Codec) sqlite3_column_int(stmt, 5);
 
    // Clear statement bindings and rewind statement
    sqlite3_clear_bindings(stmt);
    sqlite3_reset(stmt);
 
+   if (mCodec != SampleCompression::Raw)
+   {
+      mSampleCount = GetCompressedSampleCount(sbid);
+      mSampleBytes = mSampleCount * SAMPLE_SIZE(mSampleFormat);
+   }
+
    mValid = true;
 }
 
+size_t SqliteSampleBlock::GetCompressedSampleCount(SampleBlockID sbid)
+{
+   // Read only the head of the blob, which records the count of samples
+   sqlite3_blob *blob = nullptr;
+   auto cleanup = finally([&]
+   {
+      if (blob)
+         sqlite3_blob_close(blob);
+   });
+
+   unsigned char header[SampleCompression::HeaderBytes];
+   int rc = sqlite3_blob_open(DB(), "main", "sampleblocks", "samples",
+      sbid, 0, &blob);
+   if (rc == SQLITE_OK)
+      rc = sqlite3_blob_read(blob, header, sizeof(header), 0);
+   if (rc != SQLITE_OK)
+   {
+      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context",
+         "SqliteSampleBlock::GetCompressedSampleCount");
+
+      wxLogDebug(wxT("SqliteSampleBlock::GetCompressedSampleCount - SQLITE error %s"),
+         sqlite3_errmsg(DB()));
+
+      Conn()->ThrowException( false );
+   }
+
+   return SampleCompression::GetSampleCount(header, sizeof(header));
+}
+
 void SqliteSampleBlock::Commit(Sizes sizes)
 {
-   const auto mSummary256Bytes = sizes.first;
-   const auto mSummary64kBytes = sizes.second;
+   auto &conn = *Conn();
+
+   // Store the samples compressed, if the project allows that and it saves
+   // space
+   auto pending = std::make_shared<Pending>();
+   if (mpFactory->mCompress && conn.HasSampleBlockCodec())
+      pending->compressed = SampleCompression::Compress(
+         mSamples.get(), mSampleFormat, mSampleCount);
+   mCodec = pending->compressed.empty()
+      ? SampleCompression::Raw : SampleCompression::FixedRice;
+
+   // Move local arrays where reads can find them until the row is committed
+   pending->samples = std::move(mSamples);
+   pending->sampleBytes = mSampleBytes;
+   pending->summary256 = std::move(mSummary256);
+   pending->summary64k = std::move(mSummary64k);
+   pending->sizes = sizes;
+   mpPending = pending;
+
+   // The id is known before the row exists
+   mBlockID = conn.NewSampleBlockID();
+   mValid = true;
 
-   auto db = DB();
+   // The writer thread may insert the row later, among others in one
+   // transaction
+   conn.Defer(
+      [&conn, sbid = mBlockID, format = mSampleFormat,
+         sumMin = mSumMin, sumMax = mSumMax, sumRms = mSumRms,
+         codec = mCodec, pending]{
+         return InsertRow(conn, sbid, format, sumMin, sumMax, sumRms, codec,
+            *pending);
+      },
+      [pending]{
+         // Reads go to the database now, so that memory is not kept for all
+         // of a long transaction
+         std::lock_guard<std::mutex> lock{ pending->mutex };
+         pending->samples.reset();
+         pending->compressed = {};
+         pending->summary256.reset();
+         pending->summary64k.reset();
+      },
+      [&conn, sbid = mBlockID, format = mSampleFormat, codec = mCodec,
+         pending]{
+         RestoreRow(conn, sbid, format, codec, *pending);
+      }
+   );
+}
+
+int SqliteSampleBlock::InsertRow(DBConnection &conn, SampleBlockID sbid,
+   sampleFormat format, double sumMin, double sumMax, double sumRms,
+   SampleCompression::Codec codec, Pending &pending)
+{
+   std::lock_guard<std::mutex> lock{ pending.mutex };
+   if (pending.cancelled)
+      return SQLITE_OK;
+   pending.attempted = true;
+
+   const auto mSummary256Bytes = pending.sizes.first;
+   const auto mSummary64kBytes = pending.sizes.second;
+
+   auto db = conn.DB();
    int rc;
 
+   const auto &compressed = pending.compressed;
+   const void *samples = compressed.empty()
+      ? (const void *) pending.samples.get() : compressed.data();
+   const size_t sampleBytes = compressed.empty()
+      ? pending.sampleBytes : compressed.size();
+
    // Prepare and cache statement...automatically finalized at DB close
-   sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::InsertSampleBlock,
-      "INSERT INTO sampleblocks (sampleformat, summin, summax, sumrms,"
-      "                          summary256, summary64k, samples)"
-      "                         VALUES(?1,?2,?3,?4,?5,?6,?7);");
+   sqlite3_stmt *stmt = (codec == SampleCompression::Raw)
+      ? conn.Prepare(DBConnection::InsertSampleBlock,
+         "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax,"
+         "                          sumrms, summary256, summary64k, samples)"
+         "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8);")
+      : conn.Prepare(DBConnection::InsertCompressedSampleBlock,
+         "INSERT INTO sampleblocks (blockid, sampleformat, summin, summax,"
+         "                          sumrms, summary256, summary64k, samples,"
+         "                          codec)"
+         "                         VALUES(?1,?2,?3,?4,?5,?6,?7,?8,?9);");
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
-   if (sqlite3_bind_int(stmt, 1, mSampleFormat) ||
-       sqlite3_bind_double(stmt, 2, mSumMin) ||
-       sqlite3_bind_double(stmt, 3, mSumMax) ||
-       sqlite3_bind_double(stmt, 4, mSumRms) ||
-       sqlite3_bind_blob(stmt, 5, mSummary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 6, mSummary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
-       sqlite3_bind_blob(stmt, 7, mSamples.get(), mSampleBytes, SQLITE_STATIC))
+   if (sqlite3_bind_int64(stmt, 1, sbid) ||
+       sqlite3_bind_int(stmt, 2, format) ||
+       sqlite3_bind_double(stmt, 3, sumMin) ||
+       sqlite3_bind_double(stmt, 4, sumMax) ||
+       sqlite3_bind_double(stmt, 5, sumRms) ||
+       sqlite3_bind_blob(stmt, 6, pending.summary256.get(), mSummary256Bytes, SQLITE_STATIC) ||
+       sqlite3_bind_blob(stmt, 7, pending.summary64k.get(), mSummary64kBytes, SQLITE_STATIC) ||
+       sqlite3_bind_blob(stmt, 8, samples, sampleBytes, SQLITE_STATIC) ||
+       (codec != SampleCompression::Raw && sqlite3_bind_int(stmt, 9, codec)))
    {
 
       ADD_EXCEPTION_CONTEXT(
-         "sqlite3.rc", std::to_string(sqlite3_errcode(Conn()->DB())));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::bind");
+         "sqlite3.rc", std::to_string(sqlite3_errcode(db)));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::InsertRow::bind");
 
 
       wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
    }
  
-   // Execute the statement
+   // Execute the statement; the connection reports any failure, in the
+   // thread that flushes
    rc = sqlite3_step(stmt);
-   if (rc != SQLITE_DONE)
-   {
-      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Commit::step");
 
-      wxLogDebug(wxT("SqliteSampleBlock::Commit - SQLITE error %s"), sqlite3_errmsg(db));
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
+
+   return rc == SQLITE_DONE ? SQLITE_OK : rc;
+}
 
-      // Clear statement bindings and rewind statement
-      sqlite3_clear_bindings(stmt);
-      sqlite3_reset(stmt);
+void SqliteSampleBlock::RestoreRow(DBConnection &conn, SampleBlockID sbid,
+   sampleFormat format, SampleCompression::Codec codec, Pending &pending)
+{
+   std::lock_guard<std::mutex> lock{ pending.mutex };
+   if (pending.cancelled || pending.samples)
+      return;
 
-      // Just showing the user a simple message, not the library error too
-      // which isn't internationalized
-      Conn()->ThrowException( true );
+   // Rare, so not worth caching the statement
+   sqlite3_stmt *stmt = nullptr;
+   auto cleanup = finally([&]{ sqlite3_finalize(stmt); });
+   if (sqlite3_prepare_v2(conn.DB(),
+         "SELECT summary256, summary64k, samples FROM sampleblocks"
+         "  WHERE blockid = ?1;", -1, &stmt, nullptr) != SQLITE_OK ||
+       sqlite3_bind_int64(stmt, 1, sbid) ||
+       sqlite3_step(stmt) != SQLITE_ROW)
+   {
+      // The row was deleted after the insert, in the same transaction;
+      // inserting again would only make an orphan
+      pending.cancelled = true;
+      return;
    }
 
-   // Retrieve returned data
-   mBlockID = sqlite3_last_insert_rowid(db);
+   const auto copy = [&](ArrayOf<char> &dest, int column, size_t bytes){
+      dest.reinit(bytes);
+      const auto src = sqlite3_column_blob(stmt, column);
+      const size_t srcbytes = sqlite3_column_bytes(stmt, column);
+      memcpy(dest.get(), src, std::min(bytes, srcbytes));
+      memset(dest.get() + std::min(bytes, srcbytes), 0,
+         bytes - std::min(bytes, srcbytes));
+   };
+   copy(pending.summary256, 0, pending.sizes.first);
+   copy(pending.summary64k, 1, pending.sizes.second);
+   if (codec == SampleCompression::Raw)
+      copy(pending.samples, 2, pending.sampleBytes);
+   else
+   {
+      const auto src =
+         static_cast<const unsigned char *>(sqlite3_column_blob(stmt, 2));
+      pending.compressed.assign(src, src + sqlite3_column_bytes(stmt, 2));
+      pending.samples.reinit(pending.sampleBytes);
+      SampleCompression::Decompress(
+         pending.compressed.data(), pending.compressed.size(), format,
+         pending.samples.get(), pending.sampleBytes / SAMPLE_SIZE(format));
+   }
+}
 
-   // Reset local arrays
-   mSamples.reset();
-   mSummary256.reset();
-   mSummary64k.reset();
+void SqliteSampleBlock::Delete()
+{
+   wxASSERT(!IsSilent());
 
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
+   if (mpPending) {
+      std::lock_guard<std::mutex> lock{ mpPending->mutex };
+      if (!mpPending->attempted) {
+         // There is no row to delete; don't make one, and free memory now
+         mpPending->cancelled = true;
+         mpPending->samples.reset();
+         mpPending->compressed = {};
+         mpPending->summary256.reset();
+         mpPending->summary64k.reset();
+         return;
+      }
+   }
 
-   mValid = true;
+   auto &conn = *Conn();
+   conn.Defer([&conn, sbid = mBlockID]{ return DeleteRow(conn, sbid); });
 }
 
-void SqliteSampleBlock::Delete()
+int SqliteSampleBlock::DeleteRow(DBConnection &conn, SampleBlockID sbid)
 {
-   auto db = DB();
+   auto db = conn.DB();
    int rc;
 
-   wxASSERT(!IsSilent());
-
    // Prepare and cache statement...automatically finalized at DB close
-   sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::DeleteSampleBlock,
+   sqlite3_stmt *stmt = conn.Prepare(DBConnection::DeleteSampleBlock,
       "DELETE FROM sampleblocks WHERE blockid = ?1;");
 
    // Bind statement parameters
    // Might return SQLITE_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
-   if (sqlite3_bind_int64(stmt, 1, mBlockID))
+   if (sqlite3_bind_int64(stmt, 1, sbid))
    {
       ADD_EXCEPTION_CONTEXT(
-         "sqlite3.rc", std::to_string(sqlite3_errcode(Conn()->DB())));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Delete::bind");
+         "sqlite3.rc", std::to_string(sqlite3_errcode(db)));
+      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::DeleteRow::bind");
 
       wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
    }
 
-   // Execute the statement
+   // Execute the statement; the connection reports any failure, in the
+   // thread that flushes
    rc = sqlite3_step(stmt);
-   if (rc != SQLITE_DONE)
-   {
-      ADD_EXCEPTION_CONTEXT("sqlite3.rc", std::to_string(rc));
-      ADD_EXCEPTION_CONTEXT("sqlite3.context", "SqliteSampleBlock::Delete::step");
 
-      wxLogDebug(wxT("SqliteSampleBlock::Load - SQLITE error %s"), sqlite3_errmsg(db));
+   // Clear statement bindings and rewind statement
+   sqlite3_clear_bindings(stmt);
+   sqlite3_reset(stmt);
 
-      // Clear statement bindings and rewind statement
+   if (rc != SQLITE_DONE)
+      return rc;
+
+   if (conn.HasSpectra())
+   {
+      // Failing to delete spectra only wastes space
+      stmt = conn.Prepare(DBConnection::DeleteSpectra,
+         "DELETE FROM spectra WHERE blockid = ?1;");
+      if (sqlite3_bind_int64(stmt, 1, sbid))
+      {
+         wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+      }
+      if (sqlite3_step(stmt) != SQLITE_DONE)
+         wxLogDebug(wxT("SqliteSampleBlock::DeleteRow - SQLITE error %s"),
+            sqlite3_errmsg(db));
       sqlite3_clear_bindings(stmt);
       sqlite3_reset(stmt);
-
-      // Just showing the user a simple message, not the library error too
-      // which isn't internationalized
-      Conn()->ThrowException( true );
    }
-
-   // Clear statement bindings and rewind statement
-   sqlite3_clear_bindings(stmt);
-   sqlite3_reset(stmt);
+   return SQLITE_OK;
 }
 
 void SqliteSampleBlock::SaveXML(XMLWriter &xmlFile)
@@ -891,12 +1469,13 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
    int sumLen = (mSampleCount + 255) / 256;
    int summaries = 256;
 
+   // Vectorized when the processor permits; this leaves sums of squares
+   // where the rms values go
+   static_assert(SampleSummary::FrameSize == 256 && fields == 3);
+   SampleSummary::Summarize256(samples, mSampleCount, summary256);
+
    for (int i = 0; i < sumLen; ++i)
    {
-      min = samples[i * 256];
-      max = samples[i * 256];
-      sumsq = min * min;
-
       int jcount = 256;
       if (jcount > mSampleCount - i * 256)
       {
@@ -904,25 +1483,9 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
          fraction = 1.0 - (jcount / 256.0);
       }
 
-      for (int j = 1; j < jcount; ++j)
-      {
-         float f1 = samples[i * 256 + j];
-         sumsq += f1 * f1;
-
-         if (f1 < min)
-         {
-            min = f1;
-         }
-         else if (f1 > max)
-         {
-            max = f1;
-         }
-      }
-
+      sumsq = summary256[i * fields + 2];
       totalSquares += sumsq;
 
-      summary256[i * fields] = min;
-      summary256[i * fields + 1] = max;
       // The rms is correct, but this may be for less than 256 samples in last loop.
       summary256[i * fields + 2] = (float) sqrt(sumsq / jcount);
    }
@@ -955,18 +1518,10 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
       {
          // we can overflow the useful summary256 values here, but have put
          // non-harmful values in them
-         if (summary256[3 * (i * 256 + j)] < min)
-         {
-            min = summary256[3 * (i * 256 + j)];
-         }
-
-         if (summary256[3 * (i * 256 + j) + 1] > max)
-         {
-            max = summary256[3 * (i * 256 + j) + 1];
-         }
-
-         float r1 = summary256[3 * (i * 256 + j) + 2];
-         sumsq += r1 * r1;
+         const float *frame = &summary256[3 * (i * 256 + j)];
+         min = std::min(min, frame[0]);
+         max = std::max(max, frame[1]);
+         sumsq += frame[2] * frame[2];
       }
 
       double denom = (i < sumLen - 1) ? 256.0 : summaries - fraction;
@@ -1013,3 +1568,16 @@ static SampleBlockFactory::Factory::Scope scope{ []( AudacityProject &project )
 {
    return std::make_shared<SqliteSampleBlockFactory>( project );
 } };
+
+// Compressed samples are not readable by older versions, and neither is the
+// schema that permits them
+static ProjectFormatExtensionsRegistry::Extension compressedBlocksExtension(
+   [](const AudacityProject &project) -> ProjectFormatVersion
+   {
+      auto &pConnection = ConnectionPtr::Get(project).mpConnection;
+      if (pConnection && pConnection->HasSampleBlockCodec())
+         return { 3, 2, 0, 0 };
+
+      return BaseProjectFormatVersion;
+   }
+);
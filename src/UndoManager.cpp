@@ -78,25 +78,44 @@ UndoManager::~UndoManager()
 
 namespace {
    SpaceArray::value_type
-   CalculateUsage(const TrackList &tracks, SampleBlockIDSet &seen)
+   CalculateUsage(const TrackList &tracks, SampleBlockIDSet &seen,
+      BlockArraySet &seenArrays)
    {
       SpaceArray::value_type result = 0;
       //TIMER_START( "CalculateSpaceUsage", space_calc );
       InspectBlocks(
          tracks,
          BlockSpaceUsageAccumulator( result ),
-         &seen
+         &seen, &seenArrays
       );
       return result;
    }
 }
 
 void UndoManager::CalculateSpaceUsage()
+{
+   if (mSpaceStale)
+      CalculateStatesSpaceUsage();
+
+   // Count the usage of the clipboard separately, using another set.  Do not
+   // multiple-count any block occurring multiple times within the clipboard.
+   // The clipboard is global and may change without notice to this object.
+   SampleBlockIDSet seen;
+   BlockArraySet seenArrays;
+   mClipboardSpaceUsage = CalculateUsage(
+      Clipboard::Get().GetTracks(), seen, seenArrays);
+}
+
+void UndoManager::CalculateStatesSpaceUsage()
 {
    space.clear();
    space.resize(stack.size(), 0);
 
    SampleBlockIDSet seen;
+   // Unchanged sequences of successive states share their arrays of blocks;
+   // skip those already seen, so the work is proportional to the changes,
+   // not to the number of states times the number of blocks
+   BlockArraySet seenArrays;
 
    // After copies and pastes, a block file may be used in more than
    // one place in one undo history state, and it may be used in more than
@@ -116,14 +135,10 @@ void UndoManager::CalculateSpaceUsage()
    {
       // Scan all tracks at current level
       auto &tracks = *stack[nn]->state.tracks;
-      space[nn] = CalculateUsage(tracks, seen);
+      space[nn] = CalculateUsage(tracks, seen, seenArrays);
    }
 
-   // Count the usage of the clipboard separately, using another set.  Do not
-   // multiple-count any block occurring multiple times within the clipboard.
-   seen.clear();
-   mClipboardSpaceUsage = CalculateUsage(
-      Clipboard::Get().GetTracks(), seen);
+   mSpaceStale = false;
 
    //TIMER_STOP( space_calc );
 }
@@ -168,6 +183,7 @@ void UndoManager::RemoveStateAt(int n)
    auto iter = stack.begin() + n;
    auto state = std::move(*iter);
    stack.erase(iter);
+   mSpaceStale = true;
 }
 
 
@@ -180,18 +196,20 @@ size_t UndoManager::EstimateRemovedBlocks(size_t begin, size_t end)
 
    // Collect ids that survive
    SampleBlockIDSet wontDelete;
+   BlockArraySet wontDeleteArrays;
    auto f = [&](const auto &p){
-      InspectBlocks(*p->state.tracks, {}, &wontDelete);
+      InspectBlocks(*p->state.tracks, {}, &wontDelete, &wontDeleteArrays);
    };
    auto first = stack.begin(), last = stack.end();
    std::for_each( first, first + begin, f );
    std::for_each( first + end, last, f );
    if (saved >= 0)
       std::for_each( first + saved, first + saved + 1, f );
-   InspectBlocks(TrackList::Get(mProject), {}, &wontDelete);
+   InspectBlocks(TrackList::Get(mProject), {}, &wontDelete, &wontDeleteArrays);
 
    // Collect ids that won't survive (and are not negative pseudo ids)
    SampleBlockIDSet seen, mayDelete;
+   BlockArraySet seenArrays;
    std::for_each( first + begin, first + end, [&](const auto &p){
       auto &tracks = *p->state.tracks;
       InspectBlocks(tracks, [&]( const SampleBlock &block ){
@@ -199,7 +217,7 @@ size_t UndoManager::EstimateRemovedBlocks(size_t begin, size_t end)
          if ( id > 0 && !wontDelete.count( id ) )
             mayDelete.insert( id );
       },
-      &seen);
+      &seen, &seenArrays);
    } );
    return mayDelete.size();
 }
@@ -284,6 +302,7 @@ void UndoManager::ModifyState(const TrackList * l,
 //   SonifyBeginModifyState();
    // Delete current -- not necessary, but let's reclaim space early
    stack[current]->state.tracks.reset();
+   mSpaceStale = true;
 
    // Duplicate
    auto tracksCopy = TrackList::Create( nullptr );
@@ -360,6 +379,7 @@ void UndoManager::PushState(const TrackList * l,
    );
 
    current++;
+   mSpaceStale = true;
 
    lastAction = longDescription;
 
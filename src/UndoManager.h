@@ -202,11 +202,14 @@ class AUDACITY_DLL_API UndoManager final
    wxLongLong_t GetClipboardSpaceUsage() const
    { return mClipboardSpaceUsage; }
 
+   //! Recomputes the usage of the states only if they changed since the
+   //! last call, and always that of the clipboard
    void CalculateSpaceUsage();
 
    // void Debug(); // currently unused
 
  private:
+   void CalculateStatesSpaceUsage();
    size_t EstimateRemovedBlocks(size_t begin, size_t end);
 
    void RemoveStateAt(int n);
@@ -221,6 +224,9 @@ class AUDACITY_DLL_API UndoManager final
    bool mayConsolidate { false };
 
    SpaceArray space;
+   //! Whether states were pushed, modified, or removed since space was
+   //! computed
+   bool mSpaceStale { true };
    unsigned long long mClipboardSpaceUsage {};
 };
 
@@ -19,6 +19,8 @@
 
 
 #include <math.h>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <wx/log.h>
 
@@ -28,6 +30,7 @@
 #include "Envelope.h"
 #include "Resample.h"
 #include "InconsistencyException.h"
+#include "ThreadPool.h"
 #include "UserException.h"
 
 #include "prefs/SpectrogramSettings.h"
@@ -129,6 +132,11 @@ bool WaveClip::GetSamples(samplePtr buffer, sampleFormat format,
    return mSequence->Get(buffer, format, start + TimeToSamples(mTrimLeft), len, mayThrow);
 }
 
+void WaveClip::PrefetchSamples(sampleCount start, sampleCount len) const
+{
+   mSequence->Prefetch(start + TimeToSamples(mTrimLeft), len);
+}
+
 /*! @excsafety{Strong} */
 void WaveClip::SetSamples(constSamplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len)
@@ -199,9 +207,29 @@ void WaveClip::ConvertToSampleFormat(sampleFormat format,
    // Note:  it is not necessary to do this recursively to cutlines.
    // They get converted as needed when they are expanded.
 
-   auto bChanged = mSequence->ConvertToSampleFormat(format, progressReport);
-   if (bChanged)
-      MarkChanged();
+   ConvertToSampleFormat({ this }, format, progressReport);
+}
+
+void WaveClip::ConvertToSampleFormat(const std::vector<WaveClip*> &clips,
+   sampleFormat format,
+   const std::function<void(size_t)> & progressReport)
+{
+   std::vector<WaveClip*> changing;
+   std::vector<Sequence*> sequences;
+   for (const auto pClip : clips)
+      if (pClip->mSequence->GetSampleFormat() != format) {
+         changing.push_back(pClip);
+         sequences.push_back(pClip->mSequence.get());
+      }
+
+   // Some may be converted even if others fail
+   auto cleanup = finally( [&] {
+      for (const auto pClip : changing)
+         if (pClip->mSequence->GetSampleFormat() == format)
+            pClip->MarkChanged();
+   } );
+
+   Sequence::ConvertToSampleFormat(sequences, format, progressReport);
 }
 
 /*! @excsafety{No-fail} */
@@ -214,9 +242,9 @@ void WaveClip::UpdateEnvelopeTrackLen()
 
 /*! @excsafety{Strong} */
 std::shared_ptr<SampleBlock> WaveClip::AppendNewBlock(
-   samplePtr buffer, sampleFormat format, size_t len)
+   constSamplePtr buffer, sampleFormat format, size_t len, size_t stride)
 {
-   return mSequence->AppendNewBlock( buffer, format, len );
+   return mSequence->AppendNewBlock( buffer, format, len, stride );
 }
 
 /*! @excsafety{Strong} */
@@ -771,26 +799,132 @@ void WaveClip::SetRate(int rate)
 
 /*! @excsafety{Strong} */
 void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
+{
+   Resample({ this }, rate, progress);
+}
+
+void WaveClip::Resample(const std::vector<WaveClip*> &clips,
+   int rate, BasicUI::ProgressDialog *progress)
+{
+   ResampleGroups({ clips }, rate, progress);
+}
+
+namespace {
+//! Shared by all resampling, which may run at once
+ThreadPool &ResamplePool()
+{
+   static ThreadPool pool;
+   return pool;
+}
+}
+
+/*! @excsafety{Strong} */
+void WaveClip::ResampleGroups(
+   const std::vector<std::vector<WaveClip*>> &groups,
+   int rate, BasicUI::ProgressDialog *progress)
 {
    // Note:  it is not necessary to do this recursively to cutlines.
    // They get resampled as needed when they are expanded.
 
-   if (rate == mRate)
-      return; // Nothing to do
+   std::vector<std::vector<WaveClip*>> lockstepGroups;
+   for (const auto &clips : groups) {
+      if (clips.empty())
+         continue;
+      const auto pFirst = clips[0];
+      const auto numSamples = pFirst->mSequence->GetNumSamples();
+      const bool lockstep = std::all_of(clips.begin(), clips.end(),
+         [&](WaveClip *pClip){
+            return pClip->mRate == pFirst->mRate &&
+               pClip->mSequence->GetNumSamples() == numSamples;
+         });
+      if (lockstep)
+         lockstepGroups.push_back(clips);
+      else
+         // Can't resample in lockstep
+         for (auto pClip : clips)
+            lockstepGroups.push_back({ pClip });
+   }
+   // Nothing to do for clips already at the rate
+   lockstepGroups.erase(std::remove_if(
+      lockstepGroups.begin(), lockstepGroups.end(),
+      [&](const std::vector<WaveClip*> &clips){
+         return clips[0]->mRate == rate;
+      }), lockstepGroups.end());
+   if (lockstepGroups.empty())
+      return;
+
+   sampleCount total = 0;
+   for (const auto &clips : lockstepGroups)
+      total += clips[0]->mSequence->GetNumSamples();
+
+   // Resample the groups in worker threads; each makes new sequences only
+   std::vector<std::vector<std::unique_ptr<Sequence>>>
+      newSequences(lockstepGroups.size());
+   std::atomic<long long> done{ 0 };
+   std::atomic<bool> stopping{ false };
+   const auto resample = [&](size_t ii) {
+      newSequences[ii] = ResampleSequences(lockstepGroups[ii], rate,
+         [&](size_t consumed) {
+            done.fetch_add(consumed, std::memory_order_relaxed);
+            if (stopping.load(std::memory_order_relaxed))
+               throw UserException{};
+         });
+   };
+   if (progress)
+      // Poll the dialog in this thread only, for all the groups
+      ResamplePool().ParallelForPolling(lockstepGroups.size(), resample, [&]{
+         auto updateResult = progress->Poll(
+            done.load(std::memory_order_relaxed),
+            total.as_long_long()
+         );
+         if (updateResult != BasicUI::ProgressResult::Success) {
+            stopping.store(true, std::memory_order_relaxed);
+            throw UserException{};
+         }
+      });
+   else
+      ResamplePool().ParallelFor(lockstepGroups.size(), resample);
+
+   // Use No-fail-guarantee in these steps
+   for (size_t ii = 0; ii < lockstepGroups.size(); ++ii) {
+      const auto &clips = lockstepGroups[ii];
+      for (size_t jj = 0; jj < clips.size(); ++jj) {
+         const auto pClip = clips[jj];
+         pClip->mSequence = std::move(newSequences[ii][jj]);
+         pClip->mRate = rate;
+         pClip->Caches::ForEach( std::mem_fn( &WaveClipListener::Invalidate ) );
+      }
+   }
+}
 
-   double factor = (double)rate / (double)mRate;
-   ::Resample resample(true, factor, factor); // constant rate resampling
+std::vector<std::unique_ptr<Sequence>> WaveClip::ResampleSequences(
+   const std::vector<WaveClip*> &clips, int rate,
+   const std::function<void(size_t)> &progressReport)
+{
+   const auto pFirst = clips[0];
+   const auto numSamples = pFirst->mSequence->GetNumSamples();
+   const auto nChannels = clips.size();
+   double factor = (double)rate / (double)pFirst->mRate;
+   // constant rate resampling
+   ::Resample resample(true, factor, factor, nChannels);
 
    const size_t bufsize = 65536;
-   Floats inBuffer{ bufsize };
-   Floats outBuffer{ bufsize };
+   FloatBuffers inBuffers{ nChannels, bufsize };
+   FloatBuffers outBuffers{ nChannels, bufsize };
+   std::vector<const float *> inPointers;
+   std::vector<float *> outPointers;
+   std::vector<std::unique_ptr<Sequence>> newSequences;
+   for (size_t ii = 0; ii < nChannels; ++ii) {
+      inPointers.push_back(inBuffers[ii].get());
+      outPointers.push_back(outBuffers[ii].get());
+      auto &sequence = *clips[ii]->mSequence;
+      newSequences.push_back(std::make_unique<Sequence>(
+         sequence.GetFactory(), sequence.GetSampleFormat()));
+   }
+
    sampleCount pos = 0;
    bool error = false;
    int outGenerated = 0;
-   auto numSamples = mSequence->GetNumSamples();
-
-   auto newSequence =
-      std::make_unique<Sequence>(mSequence->GetFactory(), mSequence->GetSampleFormat());
 
    /**
     * We want to keep going as long as we have something to feed the resampler
@@ -803,14 +937,14 @@ void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
 
       bool isLast = ((pos + inLen) == numSamples);
 
-      if (!mSequence->Get((samplePtr)inBuffer.get(), floatSample, pos, inLen, true))
-      {
-         error = true;
+      for (size_t ii = 0; !error && ii < nChannels; ++ii)
+         error = !clips[ii]->mSequence->Get(
+            (samplePtr)inBuffers[ii].get(), floatSample, pos, inLen, true);
+      if (error)
          break;
-      }
 
-      const auto results = resample.Process(factor, inBuffer.get(), inLen, isLast,
-                                            outBuffer.get(), bufsize);
+      const auto results = resample.Process(factor,
+         inPointers.data(), inLen, isLast, outPointers.data(), bufsize);
       outGenerated = results.second;
 
       pos += results.first;
@@ -821,19 +955,12 @@ void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
          break;
       }
 
-      newSequence->Append((samplePtr)outBuffer.get(), floatSample,
-                          outGenerated);
+      for (size_t ii = 0; ii < nChannels; ++ii)
+         newSequences[ii]->Append((samplePtr)outBuffers[ii].get(),
+            floatSample, outGenerated);
 
-      if (progress)
-      {
-         auto updateResult = progress->Poll(
-            pos.as_long_long(),
-            numSamples.as_long_long()
-         );
-         error = (updateResult != BasicUI::ProgressResult::Success);
-         if (error)
-            throw UserException{};
-      }
+      if (progressReport)
+         progressReport(results.first);
    }
 
    if (error)
@@ -843,13 +970,8 @@ void WaveClip::Resample(int rate, BasicUI::ProgressDialog *progress)
          XO("Warning"),
          "Error:_Resampling"
       };
-   else
-   {
-      // Use No-fail-guarantee in these steps
-      mSequence = std::move(newSequence);
-      mRate = rate;
-      Caches::ForEach( std::mem_fn( &WaveClipListener::Invalidate ) );
-   }
+
+   return newSequences;
 }
 
 // Used by commands which interact with clips using the keyboard.
@@ -130,6 +130,12 @@ public:
 
    void ConvertToSampleFormat(sampleFormat format,
       const std::function<void(size_t)> & progressReport = {});
+   //! Convert several clips, sharing the work on all their blocks among
+   //! threads
+   /*! progressReport is called only in this thread */
+   static void ConvertToSampleFormat(const std::vector<WaveClip*> &clips,
+      sampleFormat format,
+      const std::function<void(size_t)> & progressReport = {});
 
    // Always gives non-negative answer, not more than sample sequence length
    // even if t0 really falls outside that range
@@ -144,6 +150,16 @@ public:
    // Resample clip. This also will set the rate, but without changing
    // the length of the clip
    void Resample(int rate, BasicUI::ProgressDialog *progress = NULL);
+   //! Resample clips that are corresponding channels, all at once
+   /*! If they differ in rate or length, resample each alone instead */
+   static void Resample(const std::vector<WaveClip*> &clips,
+      int rate, BasicUI::ProgressDialog *progress = NULL);
+   //! Resample several groups of clips, each group as by
+   //! Resample(clips, rate, progress), sharing the groups among threads
+   /*! progress is polled only in this thread, for all the groups together */
+   static void ResampleGroups(
+      const std::vector<std::vector<WaveClip*>> &groups,
+      int rate, BasicUI::ProgressDialog *progress = NULL);
 
    void SetColourIndex( int index ){ mColourIndex = index;};
    int GetColourIndex( ) const { return mColourIndex;};
@@ -199,6 +215,8 @@ public:
 
    bool GetSamples(samplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len, bool mayThrow = true) const;
+   //! Read ahead for GetSamples(); non-throwing
+   void PrefetchSamples(sampleCount start, sampleCount len) const;
    void SetSamples(constSamplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
 
@@ -230,9 +248,15 @@ public:
     * function to tell the envelope about it. */
    void UpdateEnvelopeTrackLen();
 
-   //! For use in importing pre-version-3 projects to preserve sharing of blocks
+   //! For use in importing pre-version-3 projects to preserve sharing of
+   //! blocks, and in importing whole blocks from mapped files
+   /*!
+    @param stride how many samples to advance buffer after each one
+    Call UpdateEnvelopeTrackLen() and MarkChanged() after the last
+    */
    std::shared_ptr<SampleBlock> AppendNewBlock(
-      samplePtr buffer, sampleFormat format, size_t len);
+      constSamplePtr buffer, sampleFormat format, size_t len,
+      size_t stride = 1);
 
    //! For use in importing pre-version-3 projects to preserve sharing of blocks
    void AppendSharedBlock(const std::shared_ptr<SampleBlock> &pBlock);
@@ -332,6 +356,13 @@ protected:
    /// operation (but without putting the cut audio to the clipboard)
    void ClearSequence(double t0, double t1);
 
+   //! New sequences with the samples of the clips resampled in lockstep;
+   //! progressReport is called with counts of old samples consumed, and may
+   //! throw to stop
+   static std::vector<std::unique_ptr<Sequence>> ResampleSequences(
+      const std::vector<WaveClip*> &clips, int rate,
+      const std::function<void(size_t)> &progressReport);
+
    
 
    double mSequenceOffset { 0 };
@@ -610,9 +610,21 @@ sampleCount WaveTrack::GetSequenceSamplesCount() const
 void WaveTrack::ConvertToSampleFormat(sampleFormat format,
    const std::function<void(size_t)> & progressReport)
 {
-   for (const auto& clip : mClips)
-      clip->ConvertToSampleFormat(format, progressReport);
-   mFormat = format;
+   ConvertToSampleFormat({ this }, format, progressReport);
+}
+
+/*! @excsafety{Weak} -- Might complete on only some clips */
+void WaveTrack::ConvertToSampleFormat(const std::vector<WaveTrack*> &tracks,
+   sampleFormat format,
+   const std::function<void(size_t)> & progressReport)
+{
+   std::vector<WaveClip*> clips;
+   for (const auto pTrack : tracks)
+      for (const auto& clip : pTrack->mClips)
+         clips.push_back(clip.get());
+   WaveClip::ConvertToSampleFormat(clips, format, progressReport);
+   for (const auto pTrack : tracks)
+      pTrack->mFormat = format;
 }
 
 
@@ -2203,6 +2215,22 @@ bool WaveTrack::Get(samplePtr buffer, sampleFormat format,
    return result;
 }
 
+void WaveTrack::Prefetch(sampleCount start, sampleCount len) const
+{
+   // Clip the range to each clip, as in Get()
+   for (const auto &clip: mClips)
+   {
+      auto clipStart = clip->GetPlayStartSample();
+      auto clipEnd = clip->GetPlayEndSample();
+      if (clipEnd > start && clipStart < start + len)
+      {
+         const auto inclipStart = std::max(start, clipStart) - clipStart;
+         const auto inclipEnd = std::min(start + len, clipEnd) - clipStart;
+         clip->PrefetchSamples(inclipStart, inclipEnd - inclipStart);
+      }
+   }
+}
+
 /*! @excsafety{Weak} */
 void WaveTrack::Set(constSamplePtr buffer, sampleFormat format,
                     sampleCount start, size_t len)
@@ -2708,14 +2736,74 @@ void WaveTrack::MergeClips(int clipidx1, int clipidx2)
    mClips.erase(it);
 }
 
-/*! @excsafety{Weak} -- Partial completion may leave clips at differing sample rates!
-*/
+/*! @excsafety{Strong} */
 void WaveTrack::Resample(int rate, BasicUI::ProgressDialog *progress)
 {
-   for (const auto &clip : mClips)
-      clip->Resample(rate, progress);
+   Resample({ this }, rate, progress);
+}
+
+/*! @excsafety{Strong} */
+void WaveTrack::Resample(const std::vector<WaveTrack*> &tracks,
+   int rate, BasicUI::ProgressDialog *progress)
+{
+   std::vector<WaveTrack*> allChannels;
+   std::vector<std::vector<WaveClip*>> groups;
+   for (const auto pTrack : tracks) {
+      std::vector<WaveTrack*> channels{ pTrack };
+      if (pTrack->GetOwner() && pTrack->IsLeader())
+         for (auto pChannel : TrackList::Channels(pTrack).Excluding(pTrack))
+            if (pChannel->GetRate() == pTrack->GetRate())
+               channels.push_back(pChannel);
+            else {
+               // Its clips can't share a resampler with the leader's, but
+               // it is resampled too
+               for (const auto &clip : pChannel->mClips)
+                  groups.push_back({ clip.get() });
+               allChannels.push_back(pChannel);
+            }
+
+      // Clips of the other channels not yet grouped
+      std::vector<std::vector<WaveClip*>> others;
+      for (size_t ii = 1; ii < channels.size(); ++ii) {
+         others.emplace_back();
+         for (const auto &clip : channels[ii]->mClips)
+            others.back().push_back(clip.get());
+      }
+
+      for (const auto &clip : pTrack->mClips) {
+         // Find the corresponding clips, which are normally all there are
+         std::vector<WaveClip*> clips{ clip.get() };
+         for (auto &otherClips : others) {
+            const auto end = otherClips.end();
+            const auto iter = std::find_if(otherClips.begin(), end,
+               [&](WaveClip *pOther){
+                  return
+                     pOther->GetSequenceStartTime() ==
+                        clip->GetSequenceStartTime() &&
+                     pOther->GetRate() == clip->GetRate() &&
+                     pOther->GetSequenceSamplesCount() ==
+                        clip->GetSequenceSamplesCount();
+               });
+            if (iter != end) {
+               clips.push_back(*iter);
+               otherClips.erase(iter);
+            }
+         }
+         groups.push_back(std::move(clips));
+      }
+
+      for (auto &otherClips : others)
+         for (auto pClip : otherClips)
+            groups.push_back({ pClip });
+
+      allChannels.insert(allChannels.end(), channels.begin(), channels.end());
+   }
+
+   // All clips of all the tracks at once
+   WaveClip::ResampleGroups(groups, rate, progress);
 
-   mRate = rate;
+   for (auto pChannel : allChannels)
+      pChannel->mRate = rate;
 }
 
 namespace {
@@ -2770,13 +2858,18 @@ void WaveTrack::AllClipsIterator::push( WaveClipHolders &clips )
 
 #include "SampleBlock.h"
 void VisitBlocks(TrackList &tracks, BlockVisitor visitor,
-   SampleBlockIDSet *pIDs)
+   SampleBlockIDSet *pIDs, BlockArraySet *pArrays)
 {
    for (auto wt : tracks.Any< const WaveTrack >()) {
       // Scan all clips within current track
       for(const auto &clip : wt->GetAllClips()) {
-         // Scan all sample blocks within current clip
-         auto blocks = clip->GetSequenceBlockArray();
+         // Scan all sample blocks within current clip; don't ask for the
+         // mutable array, which would stop sharing it with undo states
+         const WaveClip &theClip = *clip;
+         auto blocks = theClip.GetSequenceBlockArray();
+         if ( pIDs && pArrays && !pArrays->insert(blocks).second )
+            // All of its blocks are already in *pIDs
+            continue;
          for (const auto &block : *blocks) {
             auto &pBlock = block.sb;
             if ( pBlock ) {
@@ -2791,10 +2884,10 @@ void VisitBlocks(TrackList &tracks, BlockVisitor visitor,
 }
 
 void InspectBlocks(const TrackList &tracks, BlockInspector inspector,
-   SampleBlockIDSet *pIDs)
+   SampleBlockIDSet *pIDs, BlockArraySet *pArrays)
 {
    VisitBlocks(
-      const_cast<TrackList &>(tracks), std::move( inspector ), pIDs );
+      const_cast<TrackList &>(tracks), std::move( inspector ), pIDs, pArrays );
 }
 
 #include "Project.h"
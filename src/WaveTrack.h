@@ -161,6 +161,12 @@ private:
 
    void ConvertToSampleFormat(sampleFormat format,
       const std::function<void(size_t)> & progressReport = {});
+   //! Convert several tracks, sharing the work on the blocks of all their
+   //! clips among threads
+   /*! progressReport is called only in this thread */
+   static void ConvertToSampleFormat(const std::vector<WaveTrack*> &tracks,
+      sampleFormat format,
+      const std::function<void(size_t)> & progressReport = {});
 
    const SpectrogramSettings &GetSpectrogramSettings() const;
    SpectrogramSettings &GetSpectrogramSettings();
@@ -261,6 +267,7 @@ private:
       // filled according to fillFormat; but these were not necessarily one
       // contiguous range.
       sampleCount * pNumWithinClips = nullptr) const override;
+   void Prefetch(sampleCount start, sampleCount len) const override;
    void Set(constSamplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
 
@@ -492,7 +499,14 @@ private:
    void Merge(const Track &orig) override;
 
    // Resample track (i.e. all clips in the track)
+   // If this is the leader of a group, resample also the other channels, and
+   // corresponding clips of the channels with the same rate together
    void Resample(int rate, BasicUI::ProgressDialog *progress = NULL);
+   //! Resample several tracks, each as by Resample(rate, progress), sharing
+   //! the clips of all of them among threads
+   /*! progress is polled only in this thread, for all the tracks together */
+   static void Resample(const std::vector<WaveTrack*> &tracks,
+      int rate, BasicUI::ProgressDialog *progress = NULL);
 
    const TypeInfo &GetTypeInfo() const override;
    static const TypeInfo &ClassTypeInfo();
@@ -587,17 +601,24 @@ using SampleBlockIDSet = std::unordered_set<SampleBlockID>;
 class TrackList;
 using BlockVisitor = std::function< void(SampleBlock&) >;
 using BlockInspector = std::function< void(const SampleBlock&) >;
+class BlockArray;
+using BlockArraySet = std::unordered_set<const BlockArray*>;
 
 // Function to visit all sample blocks from a list of tracks.
 // If a set is supplied, then only visit once each unique block ID not already
 // in that set, and accumulate those into the set as a side-effect.
+// If also a set of arrays is supplied, then skip the sequences whose arrays
+// of blocks are already in it, and accumulate the others.  Copies of tracks,
+// as in the undo history, share the arrays of unchanged sequences, so this
+// visits only the blocks of changed sequences.  Use the two sets together,
+// with no changes of the tracks in between.
 // The visitor function may be null.
 void VisitBlocks(TrackList &tracks, BlockVisitor visitor,
-   SampleBlockIDSet *pIDs = nullptr);
+   SampleBlockIDSet *pIDs = nullptr, BlockArraySet *pArrays = nullptr);
 
 // Non-mutating version of the above
 void InspectBlocks(const TrackList &tracks, BlockInspector inspector,
-   SampleBlockIDSet *pIDs = nullptr);
+   SampleBlockIDSet *pIDs = nullptr, BlockArraySet *pArrays = nullptr);
 
 class ProjectRate;
 
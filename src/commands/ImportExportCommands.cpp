@@ -10,7 +10,8 @@
 ******************************************************************//**
 
 \file ImportExportCommands.cpp
-\brief Contains definitions for the ImportCommand and ExportCommand classes
+\brief Contains definitions for the ImportCommand, ExportCommand and
+ExportMultipleCommand classes
 
 *//*******************************************************************/
 
@@ -21,10 +22,14 @@
 #include "../ProjectFileManager.h"
 #include "ViewInfo.h"
 #include "../export/Export.h"
+#include "../export/ExportMultiple.h"
+#include "../LabelTrack.h"
+#include "Prefs.h"
 #include "../SelectUtilities.h"
 #include "../Shuttle.h"
 #include "../ShuttleGui.h"
 #include "Track.h"
+#include "../WaveTrack.h"
 #include "wxFileNameWrapper.h"
 #include "CommandContext.h"
 
@@ -135,3 +140,162 @@ bool ExportCommand::Apply(const CommandContext & context)
    return false;
 }
 
+const ComponentInterfaceSymbol ExportMultipleCommand::Symbol
+{ XO("ExportMultiple2") };
+
+namespace{ BuiltinCommandsModule::Registration< ExportMultipleCommand > reg3; }
+
+enum {
+   kSplitByLabels,
+   kSplitByTracks,
+   nSplitBys
+};
+
+static const EnumValueSymbol kSplitBys[nSplitBys] =
+{
+   { XO("Labels") },
+   { XO("Tracks") },
+};
+
+template<bool Const>
+bool ExportMultipleCommand::VisitSettings( SettingsVisitorBase<Const> & S ){
+   S.Define( mFolder, wxT("Folder"),
+      FileNames::FindDefaultPath(FileNames::Operation::Export) );
+   S.Define( mFormat, wxT("Format"), wxString{ wxT("WAV") } );
+   S.DefineEnum( mSplitBy, wxT("SplitBy"), kSplitByTracks, kSplitBys, nSplitBys );
+   // Zero for the number in preferences
+   S.Define( mFilesAtOnce, wxT("FilesAtOnce"), 0, 0, 64 );
+   S.Define( mOverwrite, wxT("Overwrite"), false );
+   return true;
+}
+
+bool ExportMultipleCommand::VisitSettings( SettingsVisitor & S )
+   { return VisitSettings<false>(S); }
+
+bool ExportMultipleCommand::VisitSettings( ConstSettingsVisitor & S )
+   { return VisitSettings<true>(S); }
+
+void ExportMultipleCommand::PopulateOrExchange(ShuttleGui & S)
+{
+   S.AddSpace(0, 5);
+
+   S.StartMultiColumn(2, wxALIGN_CENTER);
+   {
+      S.TieTextBox(XXO("Folder:"),mFolder);
+      S.TieTextBox(XXO("Format:"),mFormat);
+      S.TieChoice(XXO("Split files based on:"),
+         mSplitBy, Msgids(kSplitBys, nSplitBys));
+      S.TieTextBox(XXO("Files at once:"),mFilesAtOnce);
+      S.TieCheckBox(XXO("Overwrite existing files"),mOverwrite);
+   }
+   S.EndMultiColumn();
+}
+
+bool ExportMultipleCommand::Apply(const CommandContext & context)
+{
+   auto &project = context.project;
+   auto &tracks = TrackList::Get( project );
+
+   Exporter exporter{ project };
+   ExportPlugin *pPlugin = nullptr;
+   int subformat = 0;
+   for (const auto &plugin : exporter.GetPlugins())
+      for (int j = 0; !pPlugin && j < plugin->GetFormatCount(); ++j)
+         if (plugin->GetFormat(j).IsSameAs(mFormat, false)) {
+            pPlugin = plugin.get();
+            subformat = j;
+         }
+   if (!pPlugin) {
+      context.Error(wxString::Format(wxT("Unknown export format %s!"), mFormat));
+      return false;
+   }
+
+   if (!wxFileName::DirExists(mFolder) &&
+       !wxFileName::Mkdir(mFolder, 0777, wxPATH_MKDIR_FULL)) {
+      context.Error(wxString::Format(wxT("Could not create folder %s!"), mFolder));
+      return false;
+   }
+
+   // Name the files as the dialog does by default, after the labels or
+   // tracks, but without asking to change names or tags
+   std::vector<ExportMultipleDialog::ExportKit> kits;
+   FilePaths otherNames;
+   const auto addKit = [&](wxString title,
+      double t0, double t1, unsigned channels, WaveTrack *track){
+      if (title.empty())
+         title = _("untitled");
+      ExportMultipleDialog::ExportKit kit;
+      kit.t0 = t0;
+      kit.t1 = t1;
+      kit.channels = channels;
+      kit.track = track;
+
+      auto name = title;
+      Internat::SanitiseFilename(name, wxT("_"));
+      kit.destfile.SetPath(mFolder);
+      kit.destfile.SetName(name);
+      kit.destfile.SetExt(pPlugin->GetExtension(subformat));
+      FileNames::MakeNameUnique(otherNames, kit.destfile);
+
+      kit.filetags = Tags::Get( project );
+      kit.filetags.LoadDefaults();
+      kit.filetags.SetTag(TAG_TITLE, title);
+      kit.filetags.SetTag(TAG_TRACK, (int)kits.size() + 1);
+      kits.push_back(std::move(kit));
+   };
+
+   if (mSplitBy == kSplitByLabels) {
+      // only the first label track
+      const auto labels = *tracks.Any< const LabelTrack >().begin();
+      if (!labels) {
+         context.Error(wxT("There is no label track to split by!"));
+         return false;
+      }
+      const auto channels =
+         ExportMultipleDialog::GetNumExportChannels( tracks );
+      const int numLabels = labels->GetNumLabels();
+      for (int l = 0; l < numLabels; ++l) {
+         const auto info = labels->GetLabel(l);
+         double t1;
+         if (!info->selectedRegion.isPoint())
+            t1 = info->selectedRegion.t1();
+         else if (l < numLabels - 1)
+            // Use start of next label as end
+            t1 = labels->GetLabel(l + 1)->selectedRegion.t0();
+         else
+            t1 = tracks.GetEndTime();
+         addKit(info->title, info->selectedRegion.t0(), t1, channels, nullptr);
+      }
+   }
+   else {
+      bool anySolo = !(( tracks.Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
+      bool skipSilenceAtBeginning;
+      gPrefs->Read(wxT("/AudioFiles/SkipSilenceAtBeginning"), &skipSilenceAtBeginning, false);
+      for (auto tr : tracks.Leaders<WaveTrack>() -
+         (anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute)) {
+         auto channels = TrackList::Channels(tr);
+         unsigned numChannels = channels.size();
+         if (numChannels == 1 &&
+             !(tr->GetChannel() == WaveTrack::MonoChannel &&
+               tr->GetPan() == 0.0))
+            numChannels = 2;
+         addKit(tr->GetName(),
+            skipSilenceAtBeginning ? channels.min(&Track::GetStartTime) : 0,
+            channels.max( &Track::GetEndTime ), numChannels, tr);
+      }
+   }
+
+   FilePaths exported;
+   const auto result = ExportMultipleDialog::ExportFiles(project,
+      *pPlugin, subformat, kits, mOverwrite, false, exported,
+      mFilesAtOnce > 0 ? mFilesAtOnce : ExportMultipleFilesAtOnce.Read());
+
+   for (const auto &path : exported)
+      context.Status(wxString::Format(wxT("Exported to %s format: %s"),
+         mFormat, path));
+   if (result == BasicUI::ProgressResult::Success)
+      return true;
+
+   context.Error(wxString::Format(wxT("Could not export to %s format!"), mFormat));
+   return false;
+}
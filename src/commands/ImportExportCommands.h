@@ -16,6 +16,9 @@
 \class ExportCommand
 \brief Command for exporting audio
 
+\class ExportMultipleCommand
+\brief Command for exporting audio to a file for each label or track
+
 *//*******************************************************************/
 
 #include "Command.h"
@@ -63,3 +66,27 @@ public:
    wxString mFileName;
    int mnChannels;
 };
+
+class ExportMultipleCommand : public AudacityCommand
+{
+public:
+   static const ComponentInterfaceSymbol Symbol;
+
+   // ComponentInterface overrides
+   ComponentInterfaceSymbol GetSymbol() const override {return Symbol;};
+   TranslatableString GetDescription() const override {return XO("Exports a file for each label or track, several at once.");};
+   template<bool Const> bool VisitSettings( SettingsVisitorBase<Const> &S );
+   bool VisitSettings( SettingsVisitor & S ) override;
+   bool VisitSettings( ConstSettingsVisitor & S ) override;
+   void PopulateOrExchange(ShuttleGui & S) override;
+   bool Apply(const CommandContext & context) override;
+
+   // AudacityCommand overrides
+   ManualPageID ManualPage() override {return L"Extra_Menu:_Scriptables_II#export_multiple";}
+public:
+   wxString mFolder;
+   wxString mFormat;
+   int mSplitBy;
+   int mFilesAtOnce;
+   bool mOverwrite;
+};
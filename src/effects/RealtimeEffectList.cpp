@@ -64,7 +64,7 @@ void RealtimeEffectList::Visit(StateVisitor func)
 
 RealtimeEffectState *RealtimeEffectList::AddState(const PluginID &id)
 {
-   auto pState = std::make_unique<RealtimeEffectState>(id);
+   auto pState = std::make_shared<RealtimeEffectState>(id);
    if (id.empty() || pState->GetEffect() != nullptr) {
       auto result = pState.get();
       mStates.emplace_back(move(pState));
@@ -75,13 +75,17 @@ RealtimeEffectState *RealtimeEffectList::AddState(const PluginID &id)
       return nullptr;
 }
 
-void RealtimeEffectList::RemoveState(RealtimeEffectState &state)
+std::shared_ptr<RealtimeEffectState>
+RealtimeEffectList::RemoveState(RealtimeEffectState &state)
 {
    auto end = mStates.end(),
       found = std::find_if(mStates.begin(), end,
          [&](const auto &item) { return item.get() == &state; } );
-   if (found != end)
-      mStates.erase(found);
+   if (found == end)
+      return {};
+   auto result = move(*found);
+   mStates.erase(found);
+   return result;
 }
 
 void RealtimeEffectList::Swap(size_t index1, size_t index2)
@@ -9,6 +9,7 @@
 #ifndef __AUDACITY_REALTIMEEFFECTLIST_H__
 #define __AUDACITY_REALTIMEEFFECTLIST_H__
 
+#include <memory>
 #include <vector>
 
 #include "TrackAttachment.h"
@@ -44,10 +45,16 @@ public:
 
    //! Returns null if the id is nonempty but no such effect was found
    RealtimeEffectState *AddState(const PluginID &id);
-   void RemoveState(RealtimeEffectState &state);
+   //! Returns the removed state, which may still be shared with a snapshot
+   std::shared_ptr<RealtimeEffectState>
+   RemoveState(RealtimeEffectState &state);
    void Swap(size_t index1, size_t index2);
 
-   using States = std::vector<std::unique_ptr<RealtimeEffectState>>;
+   //! Shared, so that a snapshot for the audio thread outlives removal
+   using States = std::vector<std::shared_ptr<RealtimeEffectState>>;
+
+   //! Copy of the sequence of states, to be given to another thread
+   States GetStates() const { return mStates; }
 
    static const std::string &XMLTag();
    bool HandleXMLTag(
@@ -38,6 +38,39 @@ const RealtimeEffectManager &RealtimeEffectManager::Get(const AudacityProject &p
    return Get(const_cast<AudacityProject &>(project));
 }
 
+//! What the audio thread needs of the lists, as they were when published
+/*! The states are shared, so that removal from a list does not destroy any
+ state, until the snapshot is replaced */
+struct RealtimeEffectManager::Snapshot {
+   struct Group {
+      Track *leader;
+      unsigned chans;
+      RealtimeEffectList::States states;
+   };
+
+   //! Per-project states, applied before the states of each group
+   RealtimeEffectList::States masterStates;
+   std::vector<Group> groups;
+
+   const Group *Find(const Track &leader) const
+   {
+      for (auto &group : groups)
+         if (group.leader == &leader)
+            return &group;
+      return nullptr;
+   }
+
+   //! Without std::function, which might allocate in the audio thread
+   template<typename Visitor> void VisitAll(const Visitor &visitor) const
+   {
+      for (auto &pState : masterStates)
+         visitor(*pState);
+      for (auto &group : groups)
+         for (auto &pState : group.states)
+            visitor(*pState);
+   }
+};
+
 RealtimeEffectManager::RealtimeEffectManager(AudacityProject &project)
    : mProject(project)
 {
@@ -70,6 +103,7 @@ void RealtimeEffectManager::Initialize(double rate)
    VisitAll([rate](RealtimeEffectState &state, bool){
       state.Initialize(rate);
    });
+   Publish();
 
    // Leave suspended state
    Resume();
@@ -89,6 +123,7 @@ void RealtimeEffectManager::AddTrack(Track &track, unsigned chans, float rate)
          state.AddTrack(*leader, chans, rate);
       }
    );
+   Publish();
 }
 
 void RealtimeEffectManager::Finalize() noexcept
@@ -96,7 +131,7 @@ void RealtimeEffectManager::Finalize() noexcept
    // Reenter suspended state
    Suspend();
 
-   // Assume it is now safe to clean up
+   // Suspend() waited for the audio thread, so it is now safe to clean up
    mLatency = std::chrono::microseconds(0);
 
    VisitAll([](auto &state, bool){ state.Finalize(); });
@@ -105,6 +140,7 @@ void RealtimeEffectManager::Finalize() noexcept
    mGroupLeaders.clear();
    mChans.clear();
    mRates.clear();
+   mPublisher.Publish(nullptr);
 
    // No longer active
    mActive = false;
@@ -112,9 +148,6 @@ void RealtimeEffectManager::Finalize() noexcept
 
 void RealtimeEffectManager::Suspend()
 {
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
-
    // Already suspended...bail
    if (mSuspended)
       return;
@@ -122,6 +155,10 @@ void RealtimeEffectManager::Suspend()
    // Show that we aren't going to be doing anything
    mSuspended = true;
 
+   // Wait for the audio thread to finish any block it began before it could
+   // see the flag
+   mPublisher.Synchronize();
+
    // And make sure the effects don't either
    VisitAll([](RealtimeEffectState &state, bool){
       state.Suspend();
@@ -130,9 +167,6 @@ void RealtimeEffectManager::Suspend()
 
 void RealtimeEffectManager::Resume() noexcept
 {
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
-
    // Already running...bail
    if (!mSuspended)
       return;
@@ -148,21 +182,26 @@ void RealtimeEffectManager::Resume() noexcept
 
 //
 // This will be called in a different thread than the main GUI thread.
+// It takes no lock, so the main thread never delays it; instead the main
+// thread waits, while this thread holds the snapshot, until ProcessEnd.
 //
 void RealtimeEffectManager::ProcessStart()
 {
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
+   // Announce the use of the snapshot before examining the flag, so that
+   // Suspend() waits for this block if it comes after
+   mReading.emplace(mPublisher);
 
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
-   if (!mSuspended)
-   {
-      VisitAll([](RealtimeEffectState &state, bool bypassed){
-         if (!bypassed)
-            state.ProcessStart();
-      });
+   if (mSuspended || !*mReading) {
+      mReading.reset();
+      return;
    }
+
+   (*mReading)->VisitAll([](RealtimeEffectState &state){
+      if (state.IsActive())
+         state.ProcessStart();
+   });
 }
 
 //
@@ -172,15 +211,16 @@ size_t RealtimeEffectManager::Process(Track &track,
    float *const *buffers, float *const *scratch,
    size_t numSamples)
 {
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
-
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended, so allow the samples to pass as-is.
-   if (mSuspended)
+   if (!mReading)
       return numSamples;
 
-   auto chans = mChans[&track];
+   auto &snapshot = *mReading->get();
+   const auto pGroup = snapshot.Find(track);
+   if (!pGroup)
+      return numSamples;
+   const auto chans = pGroup->chans;
 
    // Remember when we started so we can calculate the amount of latency we
    // are introducing
@@ -204,18 +244,21 @@ size_t RealtimeEffectManager::Process(Track &track,
    // output of one effect as the input to the next effect
    // Tracks how many processors were called
    size_t called = 0;
-   VisitGroup(track,
-      [&](RealtimeEffectState &state, bool bypassed)
-      {
-         if (bypassed)
-            return;
-
-         state.Process(track, chans, ibuf, obuf, scratch[chans], numSamples);
-         for (auto i = 0; i < chans; ++i)
-            std::swap(ibuf[i], obuf[i]);
-         called++;
-      }
-   );
+   const auto visit = [&](RealtimeEffectState &state)
+   {
+      if (!state.IsActive())
+         return;
+
+      state.Process(track, chans, ibuf, obuf, scratch[chans], numSamples);
+      for (auto i = 0; i < chans; ++i)
+         std::swap(ibuf[i], obuf[i]);
+      called++;
+   };
+   // The per-project states first, as in VisitGroup
+   for (auto &pState : snapshot.masterStates)
+      visit(*pState);
+   for (auto &pState : pGroup->states)
+      visit(*pState);
 
    // Once we're done, we might wind up with the last effect storing its results
    // in the temporary buffers.  If that's the case, we need to copy it over to
@@ -240,18 +283,17 @@ size_t RealtimeEffectManager::Process(Track &track,
 //
 void RealtimeEffectManager::ProcessEnd() noexcept
 {
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
+   // Not reading if ProcessStart() found processing suspended
+   if (!mReading)
+      return;
 
-   // Can be suspended because of the audio stream being paused or because effects
-   // have been suspended.
-   if (!mSuspended)
-   {
-      VisitAll([](RealtimeEffectState &state, bool bypassed){
-         if (!bypassed)
-            state.ProcessEnd();
-      });
-   }
+   (*mReading)->VisitAll([](RealtimeEffectState &state){
+      if (state.IsActive())
+         state.ProcessEnd();
+   });
+
+   // Let the main thread replace or free the snapshot
+   mReading.reset();
 }
 
 void RealtimeEffectManager::VisitGroup(Track &leader, StateVisitor func)
@@ -273,6 +315,18 @@ void RealtimeEffectManager::VisitAll(StateVisitor func)
       RealtimeEffectList::Get(*leader).Visit(func);
 }
 
+void RealtimeEffectManager::Publish()
+{
+   auto pSnapshot = std::make_unique<Snapshot>();
+   pSnapshot->masterStates = RealtimeEffectList::Get(mProject).GetStates();
+   for (auto leader : mGroupLeaders)
+      pSnapshot->groups.push_back({
+         leader, mChans[leader], RealtimeEffectList::Get(*leader).GetStates()
+      });
+   // Returns when the audio thread is done with the previous snapshot
+   mPublisher.Publish(move(pSnapshot));
+}
+
 RealtimeEffectState *
 RealtimeEffectManager::AddState(
    RealtimeEffects::InitializationScope *pScope,
@@ -283,15 +337,8 @@ RealtimeEffectManager::AddState(
       ? RealtimeEffectList::Get(*pLeader)
       : RealtimeEffectList::Get(mProject);
 
-   std::optional<RealtimeEffects::SuspensionScope> myScope;
-   if (mActive) {
-      if (pScope)
-         myScope.emplace(*pScope, mProject.weak_from_this());
-      else
-         return nullptr;
-   }
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
+   if (mActive && !pScope)
+      return nullptr;
 
    auto pState = states.AddState(id);
    if (!pState)
@@ -300,7 +347,8 @@ RealtimeEffectManager::AddState(
    
    if (mActive)
    {
-      // Adding a state while playback is in-flight
+      // Adding a state while playback is in-flight.  The audio thread can't
+      // reach it until it is published, so there is no need to suspend.
       state.Initialize(mRate);
 
       for (auto &leader : mGroupLeaders) {
@@ -314,6 +362,11 @@ RealtimeEffectManager::AddState(
 
          state.AddTrack(*leader, chans, rate);
       }
+
+      // States begin suspended
+      if (!mSuspended)
+         state.Resume();
+      Publish();
    }
    return &state;
 }
@@ -327,20 +380,16 @@ void RealtimeEffectManager::RemoveState(
       ? RealtimeEffectList::Get(*pLeader)
       : RealtimeEffectList::Get(mProject);
 
-   std::optional<RealtimeEffects::SuspensionScope> myScope;
-   if (mActive) {
-      if (pScope)
-         myScope.emplace(*pScope, mProject.weak_from_this());
-      else
-         return;
-   }
-   // Protect...
-   std::lock_guard<std::mutex> guard(mLock);
-
-   if (mActive)
-      state.Finalize();
+   if (mActive && !pScope)
+      return;
 
-   states.RemoveState(state);
+   const auto pState = states.RemoveState(state);
+   if (mActive && pState) {
+      // Wait until the audio thread is done with any snapshot that has the
+      // state, before finalizing it; it is then destroyed in this thread
+      Publish();
+      pState->Finalize();
+   }
 }
 
 auto RealtimeEffectManager::GetLatency() const -> Latency
@@ -14,12 +14,13 @@
 #include <atomic>
 #include <chrono>
 #include <memory>
-#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
 #include "ClientData.h"
 #include "PluginProvider.h" // for PluginID
+#include "SnapshotPublisher.h"
 
 class AudacityProject;
 class EffectProcessor;
@@ -54,6 +55,7 @@ public:
 
    //! Main thread appends a global or per-track effect
    /*!
+    The audio thread sees the new effect from its next block, without pause
     @param pScope if realtime is active but scope is absent, there is no effect
     @param pTrack if null, then state is added to the global list
     @param id identifies the effect
@@ -64,6 +66,8 @@ public:
 
    //! Main thread removes a global or per-track effect
    /*!
+    Waits for the audio thread to finish any block using the effect, then
+    finalizes and destroys it in this thread
     @param pScope if realtime is active but scope is absent, there is no effect
     @param pTrack if null, then state is added to the global list
     @param state the state to be removed
@@ -103,10 +107,18 @@ private:
    /*! Tracks are visited in unspecified order */
    void VisitAll(StateVisitor func);
 
+   //! Main thread gives the audio thread a copy of the current lists
+   void Publish();
+
    AudacityProject &mProject;
 
-   std::mutex mLock;
-   Latency mLatency{ 0 };
+   //! Immutable copy of the lists, which the audio thread processes
+   struct Snapshot;
+   SnapshotPublisher<Snapshot> mPublisher;
+   //! Audio thread's hold on a snapshot, from ProcessStart to ProcessEnd
+   std::optional<SnapshotPublisher<Snapshot>::ReadScope> mReading;
+
+   std::atomic<Latency> mLatency{ Latency{ 0 } };
 
    double mRate;
 
@@ -31,6 +31,11 @@
 
 #include "Export.h"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include <wx/bmpbuttn.h>
 #include <wx/dcclient.h>
 #include <wx/file.h>
@@ -54,6 +59,7 @@
 #include "AllThemeResources.h"
 #include "BasicUI.h"
 #include "Mix.h"
+#include "PipelineQueue.h"
 #include "Prefs.h"
 #include "../prefs/ImportExportPrefs.h"
 #include "Project.h"
@@ -248,6 +254,147 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
                   true, mixerSpec);
 }
 
+auto ExportPlugin::MixStage(Mixer &mixer, size_t maxFrames,
+   unsigned numChannels, bool interleaved, sampleFormat format)
+   -> PipelineStage
+{
+   return [&mixer, maxFrames, numChannels, interleaved, format]
+   (PipelineBlock &block){
+      block.frames = mixer.Process(maxFrames);
+      if (block.frames == 0)
+         return false;
+      block.time = mixer.MixGetCurrentTime();
+      const auto size = block.frames * SAMPLE_SIZE(format);
+      block.mixed.resize(size * numChannels);
+      if (interleaved)
+         memcpy(block.mixed.data(), mixer.GetBuffer(), size * numChannels);
+      else
+         for (unsigned c = 0; c < numChannels; ++c)
+            memcpy(block.mixed.data() + c * size, mixer.GetBuffer(c), size);
+      return true;
+   };
+}
+
+auto ExportPlugin::PrepareBackgroundExport(AudacityProject *,
+   unsigned, const wxFileNameWrapper &, bool, double, double,
+   const Tags *, int) -> BackgroundExport
+{
+   return {};
+}
+
+auto ExportPlugin::ExportPipelined(ProgressDialog &progress,
+   double t0, double t1, const PipelineStage &mix,
+   const PipelineStage &encode, const PipelineStage &write, size_t nBlocks)
+   -> ProgressResult
+{
+   return ExportPipelined([&](double time){
+      return progress.Update(time - t0, t1 - t0);
+   }, t0, mix, encode, write, nBlocks);
+}
+
+auto ExportPlugin::ExportPipelined(const ExportProgress &progress,
+   double t0, const PipelineStage &mix,
+   const PipelineStage &encode, const PipelineStage &write, size_t nBlocks)
+   -> ProgressResult
+{
+   std::vector<PipelineBlock> blocks(std::max<size_t>(1, nBlocks));
+   PipelineQueue<PipelineBlock> free, mixed, encoded;
+   for (auto &block : blocks)
+      free.Push(&block);
+
+   std::atomic<bool> stopping{ false };
+   std::mutex exceptionMutex;
+   std::exception_ptr pException;
+   const auto abort = [&]{
+      free.Abort();
+      mixed.Abort();
+      encoded.Abort();
+   };
+   const auto fail = [&]{
+      {
+         std::lock_guard<std::mutex> lock{ exceptionMutex };
+         if (!pException)
+            pException = std::current_exception();
+      }
+      abort();
+   };
+
+   std::thread mixThread{ [&]{
+      try {
+         while (!stopping.load(std::memory_order_relaxed)) {
+            const auto pBlock = free.Pop();
+            if (!pBlock || !mix(*pBlock))
+               break;
+            mixed.Push(pBlock);
+         }
+      }
+      catch (...) {
+         fail();
+      }
+      mixed.Close();
+   } };
+
+   std::atomic<bool> encodeFailed{ false };
+   std::thread encodeThread{ [&]{
+      try {
+         while (const auto pBlock = mixed.Pop()) {
+            if (!encode(*pBlock)) {
+               encodeFailed.store(true, std::memory_order_relaxed);
+               abort();
+               break;
+            }
+            encoded.Push(pBlock);
+         }
+      }
+      catch (...) {
+         fail();
+      }
+      encoded.Close();
+   } };
+
+   auto result = ProgressResult::Success;
+   double time = t0;
+   try {
+      while (true) {
+         bool timedOut = false;
+         // Wake now and then to keep the dialog responsive
+         const auto pBlock =
+            encoded.Pop(std::chrono::milliseconds{ 50 }, timedOut);
+         if (!pBlock && !timedOut)
+            break;
+         if (pBlock) {
+            if (!write(*pBlock)) {
+               result = ProgressResult::Cancelled;
+               abort();
+               break;
+            }
+            time = pBlock->time;
+            free.Push(pBlock);
+         }
+         if (result == ProgressResult::Success) {
+            result = progress(time);
+            if (result == ProgressResult::Stopped)
+               stopping.store(true, std::memory_order_relaxed);
+            else if (result != ProgressResult::Success) {
+               abort();
+               break;
+            }
+         }
+      }
+   }
+   catch (...) {
+      fail();
+   }
+
+   mixThread.join();
+   encodeThread.join();
+   if (pException)
+      std::rethrow_exception(pException);
+   if (encodeFailed)
+      return ProgressResult::Cancelled;
+   return result;
+}
+
 void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
    const TranslatableString &title, const TranslatableString &message)
 {
@@ -134,6 +134,42 @@ public:
                        const Tags *metadata = NULL,
                        int subformat = 0) = 0;
 
+   //! A buffer that ExportPipelined() passes from stage to stage
+   struct PipelineBlock {
+      //! Samples from the mixer; all of each channel in turn if it is not
+      //! interleaved
+      std::vector<char> mixed;
+      size_t frames{ 0 };
+      //! The mixer's time after these samples, for the progress indicator
+      double time{ 0 };
+      //! For the output of the encoder
+      std::vector<char> encoded;
+   };
+   //! Returns false at the end of mixing, or on failure of the other stages
+   using PipelineStage = std::function<bool(PipelineBlock &)>;
+
+   //! Receives the time reached in the mix, and returns whether to go on,
+   //! as ProgressDialog::Update() does
+   using ExportProgress = std::function<ProgressResult(double time)>;
+   //! The rest of an export that PrepareBackgroundExport() began
+   using BackgroundExport = std::function<ProgressResult(const ExportProgress &)>;
+
+   //! Do in the main thread what Export() does before mixing, and return the
+   //! rest, which may run in another thread, so that files export at once
+   /*!
+    The returned function shows nothing, but it may alert the user later by
+    BasicUI::CallAfter(); it returns as Export() does, and reports progress
+    from time to time in its own thread.
+
+    The default returns null, as overrides also do if the export cannot
+    begin; then the caller should call Export() instead, which alerts the user.
+
+    @param metadata not null, and must outlive the returned function
+    */
+   virtual BackgroundExport PrepareBackgroundExport(AudacityProject *project,
+      unsigned channels, const wxFileNameWrapper &fName, bool selectedOnly,
+      double t0, double t1, const Tags *metadata, int subformat);
+
 protected:
    std::unique_ptr<Mixer> CreateMixer(const TrackList &tracks,
          bool selectionOnly,
@@ -142,6 +178,36 @@ protected:
          double outRate, sampleFormat outFormat,
          MixerSpec *mixerSpec);
 
+   //! Make the first stage for ExportPipelined(), which copies each output
+   //! of the mixer
+   static PipelineStage MixStage(Mixer &mixer, size_t maxFrames,
+      unsigned numChannels, bool interleaved, sampleFormat format);
+
+   //! Mix, encode and write at once, each in its own thread
+   /*!
+    mix runs in one worker thread and encode in another, so they must not
+    show anything; after a failure of encode, which stops the export, the
+    caller may alert the user.  write runs in the calling thread, which also
+    updates the progress dialog; it should alert the user of its own failures.
+    Any of them may throw, stopping the others; the exception is rethrown here.
+
+    A fixed number of blocks circulate, so that a stage that is ahead waits
+    for the next to catch up.  After the user stops the export, the blocks
+    already mixed are still encoded and written.
+
+    @return as for Export(), Cancelled if encode or write failed
+    */
+   static ProgressResult ExportPipelined(ProgressDialog &progress,
+      double t0, double t1, const PipelineStage &mix,
+      const PipelineStage &encode, const PipelineStage &write,
+      size_t nBlocks = 4);
+   //! Like the other overload, but reporting progress to a function, which
+   //! is called in the same thread as write, first with t0
+   static ProgressResult ExportPipelined(const ExportProgress &progress,
+      double t0, const PipelineStage &mix,
+      const PipelineStage &encode, const PipelineStage &write,
+      size_t nBlocks = 4);
+
    // Create or recycle a dialog.
    static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
          const TranslatableString &title, const TranslatableString &message);
@@ -1129,24 +1129,18 @@ ProgressResult ExportFFmpeg::Export(AudacityProject *project,
                  .Format( ExportFFmpegOptions::fmts[mSubFormat].description ) );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success) {
-         auto pcmNumSamples = mixer->Process(pcmBufferSize);
-
-         if (pcmNumSamples == 0)
-            break;
-
-         short *pcmBuffer = (short *)mixer->GetBuffer();
-
-         if (!EncodeAudioFrame(
-            pcmBuffer, (pcmNumSamples)*sizeof(int16_t)*mChannels)) {
+      // EncodeAudioFrame() both encodes and writes, and reports its own
+      // errors, so it is the last stage, in this thread; only mixing is
+      // done meanwhile, in another
+      updateResult = ExportPipelined(progress, t0, t1,
+         MixStage(*mixer, pcmBufferSize, mChannels, true, int16Sample),
+         [](PipelineBlock &){ return true; },
+         [&](PipelineBlock &block){
             // All errors should already have been reported.
-            //ShowDiskFullExportErrorDialog(mName);
-            updateResult = ProgressResult::Cancelled;
-            break;
-         }
-
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
-      }
+            return EncodeAudioFrame(
+               reinterpret_cast<int16_t *>(block.mixed.data()),
+               block.mixed.size());
+         });
    }
 
    if ( updateResult != ProgressResult::Cancelled )
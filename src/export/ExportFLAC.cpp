@@ -371,46 +371,53 @@ ProgressResult ExportFLAC::Export(AudacityProject *project,
                             numChannels, SAMPLES_PER_RUN, false,
                             rate, format, mixerSpec);
 
-   ArraysOf<FLAC__int32> tmpsmplbuf{ numChannels, SAMPLES_PER_RUN, true };
-
    InitProgress( pDialog, fName,
       selectionOnly
          ? XO("Exporting the selected audio as FLAC")
          : XO("Exporting the audio as FLAC") );
    auto &progress = *pDialog;
 
-   while (updateResult == ProgressResult::Success) {
-      auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
-      if (samplesThisRun == 0) { //stop encoding
-         break;
-      }
-      else {
-         for (size_t i = 0; i < numChannels; i++) {
-            auto mixed = mixer->GetBuffer(i);
-            if (format == int24Sample) {
-               for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
-                  tmpsmplbuf[i][j] = ((const int *)mixed)[j];
-               }
-            }
-            else {
-               for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
-                  tmpsmplbuf[i][j] = ((const short *)mixed)[j];
-               }
+   // Widen the samples for libFLAC, which encodes as it writes, in the
+   // calling thread
+   auto encode = [&](PipelineBlock &block){
+      const auto samplesThisRun = block.frames;
+      block.encoded.resize(
+         numChannels * samplesThisRun * sizeof(FLAC__int32));
+      for (size_t i = 0; i < numChannels; i++) {
+         auto mixed = block.mixed.data()
+            + i * samplesThisRun * SAMPLE_SIZE(format);
+         auto tmpsmplbuf = reinterpret_cast<FLAC__int32*>(
+            block.encoded.data()) + i * samplesThisRun;
+         if (format == int24Sample) {
+            for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
+               tmpsmplbuf[j] = ((const int *)mixed)[j];
             }
          }
-         if (! encoder.process(
-               reinterpret_cast<FLAC__int32**>( tmpsmplbuf.get() ),
-               samplesThisRun) ) {
-            // TODO: more precise message
-            ShowDiskFullExportErrorDialog(fName);
-            updateResult = ProgressResult::Cancelled;
-            break;
+         else {
+            for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
+               tmpsmplbuf[j] = ((const short *)mixed)[j];
+            }
          }
-         if (updateResult == ProgressResult::Success)
-            updateResult =
-               progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
       }
-   }
+      return true;
+   };
+
+   std::vector<const FLAC__int32 *> channelBuffers(numChannels);
+   auto write = [&](PipelineBlock &block){
+      for (size_t i = 0; i < numChannels; i++)
+         channelBuffers[i] = reinterpret_cast<const FLAC__int32*>(
+            block.encoded.data()) + i * block.frames;
+      if (! encoder.process(channelBuffers.data(), block.frames) ) {
+         // TODO: more precise message
+         ShowDiskFullExportErrorDialog(fName);
+         return false;
+      }
+      return true;
+   };
+
+   updateResult = ExportPipelined(progress, t0, t1,
+      MixStage(*mixer, SAMPLES_PER_RUN, numChannels, false, format),
+      encode, write);
 
    if (updateResult == ProgressResult::Success ||
        updateResult == ProgressResult::Stopped) {
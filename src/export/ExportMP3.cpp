@@ -1968,48 +1968,55 @@ ProgressResult ExportMP3::Export(AudacityProject *project,
       InitProgress( pDialog, fName, title );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success) {
-         auto blockLen = mixer->Process(inSamples);
-
-         if (blockLen == 0) {
-            break;
-         }
-
-         float *mixed = (float *)mixer->GetBuffer();
+      // Encode the blocks in a worker thread
+      auto encode = [&](PipelineBlock &block){
+         const auto blockLen = block.frames;
+         float *mixed = reinterpret_cast<float *>(block.mixed.data());
+         block.encoded.resize(bufferSize);
+         const auto out =
+            reinterpret_cast<unsigned char *>(block.encoded.data());
 
          if ((int)blockLen < inSamples) {
             if (channels > 1) {
-               bytes = exporter.EncodeRemainder(mixed, blockLen, buffer.get());
+               bytes = exporter.EncodeRemainder(mixed, blockLen, out);
             }
             else {
-               bytes = exporter.EncodeRemainderMono(mixed, blockLen, buffer.get());
+               bytes = exporter.EncodeRemainderMono(mixed, blockLen, out);
             }
          }
          else {
             if (channels > 1) {
-               bytes = exporter.EncodeBuffer(mixed, buffer.get());
+               bytes = exporter.EncodeBuffer(mixed, out);
             }
             else {
-               bytes = exporter.EncodeBufferMono(mixed, buffer.get());
+               bytes = exporter.EncodeBufferMono(mixed, out);
             }
          }
 
-         if (bytes < 0) {
-            auto msg = XO("Error %ld returned from MP3 encoder")
-               .Format( bytes );
-            AudacityMessageBox( msg );
-            updateResult = ProgressResult::Cancelled;
-            break;
-         }
+         if (bytes < 0)
+            return false;
+         block.encoded.resize(bytes);
+         return true;
+      };
 
-         if (bytes > (int)outFile.Write(buffer.get(), bytes)) {
+      auto write = [&](PipelineBlock &block){
+         if (block.encoded.size() >
+             outFile.Write(block.encoded.data(), block.encoded.size())) {
             // TODO: more precise message
             ShowDiskFullExportErrorDialog(fName);
-            updateResult = ProgressResult::Cancelled;
-            break;
+            return false;
          }
+         return true;
+      };
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+      updateResult = ExportPipelined(progress, t0, t1,
+         MixStage(*mixer, inSamples, channels, true, floatSample),
+         encode, write);
+
+      if (bytes < 0) {
+         auto msg = XO("Error %ld returned from MP3 encoder")
+            .Format( bytes );
+         AudacityMessageBox( msg );
       }
    }
 
@@ -18,6 +18,11 @@
 
 #include "ExportMultiple.h"
 
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <thread>
+
 #include <wx/defs.h>
 #include <wx/button.h>
 #include <wx/checkbox.h>
@@ -55,28 +60,6 @@
 #include "../widgets/ProgressDialog.h"
 
 
-namespace {
-/** \brief A private class used to store the information needed to do an
-    * export.
-    *
-    * We create a set of these during the interactive phase of the export
-    * cycle, then use them when the actual exports are done. */
-   class ExportKit
-   {
-   public:
-      Tags filetags; /**< The set of metadata to use for the export */
-      wxFileNameWrapper destfile; /**< The file to export to */
-      double t0;           /**< Start time for the export */
-      double t1;           /**< End time for the export */
-      unsigned channels;   /**< Number of channels for ExportMultipleByTrack */
-   };  // end of ExportKit declaration
-   /* we are going to want an set of these kits, and don't know how many until
-    * runtime. I would dearly like to use a std::vector, but it seems that
-    * this isn't done anywhere else in Audacity, presumably for a reason?, so
-    * I'm stuck with wxArrays, which are much harder, as well as non-standard.
-    */
-}
-
 /* define our dynamic array of export settings */
 
 enum {
@@ -93,9 +76,15 @@ enum {
    ByNameID,
    ByNumberID,
    PrefixID,
-   OverwriteID
+   OverwriteID,
+   FilesAtOnceID
 };
 
+IntSetting ExportMultipleFilesAtOnce{ L"/Export/MultipleFilesAtOnce", []{
+   // Each export also encodes and writes in threads of its own
+   return std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+} };
+
 //
 // ExportMultipleDialog methods
 //
@@ -131,7 +120,6 @@ ExportMultipleDialog::ExportMultipleDialog(AudacityProject *project)
 : wxDialogWrapper( &GetProjectFrame( *project ),
    wxID_ANY, XO("Export Multiple") )
 , mExporter{ *project }
-, mSelectionState{ SelectionState::Get( *project ) }
 {
    SetName();
 
@@ -430,6 +418,9 @@ void ExportMultipleDialog::PopulateOrExchange(ShuttleGui& S)
       mOverwrite = S.Id(OverwriteID).TieCheckBox(XXO("Overwrite existing files"),
                                                  {wxT("/Export/OverwriteExisting"),
                                                   false});
+      S.AddSpace(20, 0);
+      S.Id(FilesAtOnceID)
+         .TieSpinCtrl(XXO("Files at once:"), ExportMultipleFilesAtOnce, 64, 1);
    }
    S.EndHorizontalLay();
 
@@ -691,7 +682,7 @@ bool ExportMultipleDialog::DirOk()
    return fn.Mkdir(0777, wxPATH_MKDIR_FULL);
 }
 
-static unsigned GetNumExportChannels( const TrackList &tracks )
+unsigned ExportMultipleDialog::GetNumExportChannels( const TrackList &tracks )
 {
    /* counters for tracks panned different places */
    int numLeft = 0;
@@ -762,12 +753,11 @@ ProgressResult ExportMultipleDialog::ExportMultipleByLabel(bool byName,
       numFiles++;
    }
 
-   // Figure out how many channels we should export.
-   auto channels = GetNumExportChannels( *mTracks );
-
    FilePaths otherNames;  // keep track of file names we will use, so we
    // don't duplicate them
    ExportKit setting;   // the current batch of settings
+   // Figure out how many channels we should export.
+   setting.channels = GetNumExportChannels( *mTracks );
    setting.destfile.SetPath(mDir->GetValue());
    setting.destfile.SetExt(mPlugins[mPluginIndex]->GetExtension(mSubFormatIndex));
    wxLogDebug(wxT("Plug-in index = %d, Sub-format = %d"), mPluginIndex, mSubFormatIndex);
@@ -866,39 +856,11 @@ ProgressResult ExportMultipleDialog::ExportMultipleByLabel(bool byName,
       l++;  // next label, count up one
    }
 
-   auto ok = ProgressResult::Success;   // did it work?
-   int count = 0; // count the number of successful runs
-   ExportKit activeSetting;  // pointer to the settings in use for this export
    /* Go round again and do the exporting (so this run is slow but
     * non-interactive) */
-   std::unique_ptr<ProgressDialog> pDialog;
-   for (count = 0; count < numFiles; count++) {
-      /* get the settings to use for the export from the array */
-      activeSetting = exportSettings[count];
-      // Bug 1440 fix.
-      if( activeSetting.destfile.GetName().empty() )
-         continue;
-
-      // Export it
-      ok = DoExport(pDialog, channels, activeSetting.destfile, false,
-         activeSetting.t0, activeSetting.t1, activeSetting.filetags);
-      if (ok == ProgressResult::Stopped) {
-         AudacityMessageDialog dlgMessage(
-            nullptr,
-            XO("Continue to export remaining files?"),
-            XO("Export"),
-            wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
-         if (dlgMessage.ShowModal() != wxID_YES ) {
-            // User decided not to continue - bail out!
-            break;
-         }
-      }
-      else if (ok != ProgressResult::Success) {
-         break;
-      }
-   }
-
-   return ok;
+   return ExportFiles(*mProject, *mPlugins[mPluginIndex], mSubFormatIndex,
+      exportSettings, mOverwrite->GetValue(), true, mExported,
+      ExportMultipleFilesAtOnce.Read());
 }
 
 ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
@@ -906,7 +868,6 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
 {
    wxASSERT(mProject);
    int l = 0;     // track counter
-   auto ok = ProgressResult::Success;
    FilePaths otherNames;
    std::vector<ExportKit> exportSettings; // dynamic array we will use to store the
                                   // settings needed to do the exports with in
@@ -918,11 +879,6 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    wxString name;    // used to hold file name whilst we mess with it
    wxString title;   // un-messed-with title of file for tagging with
 
-   /* Remember which tracks were selected, and set them to deselected */
-   SelectionStateChanger changer{ mSelectionState, *mTracks };
-   for (auto tr : mTracks->Selected<WaveTrack>())
-      tr->SetSelected(false);
-
    bool anySolo = !(( mTracks->Any<const WaveTrack>() + &WaveTrack::GetSolo ).empty());
 
    bool skipSilenceAtBeginning;
@@ -932,6 +888,9 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    for (auto tr : mTracks->Leaders<WaveTrack>() - 
       (anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute)) {
 
+      // ExportFiles() selects the track for its export
+      setting.track = tr;
+
       // Get the times for the track
       auto channels = TrackList::Channels(tr);
       setting.t0 = skipSilenceAtBeginning ? channels.min(&Track::GetStartTime) : 0;
@@ -1010,137 +969,300 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    }
    // end of user-interactive data gathering loop, start of export processing
    // loop
-   int count = 0; // count the number of successful runs
-   ExportKit activeSetting;  // pointer to the settings in use for this export
-   std::unique_ptr<ProgressDialog> pDialog;
+   return ExportFiles(*mProject, *mPlugins[mPluginIndex], mSubFormatIndex,
+      exportSettings, mOverwrite->GetValue(), true, mExported,
+      ExportMultipleFilesAtOnce.Read());
+}
 
-   for (auto tr : mTracks->Leaders<WaveTrack>() - 
-      (anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute)) {
+namespace {
+//! Chooses the name of one exported file, moving aside any file that it
+//! replaces; when destroyed, restores or removes files as the result of
+//! the export requires
+class ExportedFile
+{
+public:
+   using ProgressResult = BasicUI::ProgressResult;
 
-      wxLogDebug( "Get setting %i", count );
-      /* get the settings to use for the export from the array */
-      activeSetting = exportSettings[count];
-      if( activeSetting.destfile.GetName().empty() ){
-         count++;
-         continue;
-      }
+   ExportedFile(const wxFileName &inName, bool overwrite)
+   {
+      wxFileName name;
 
-      /* Select the track */
-      SelectionStateChanger changer2{ mSelectionState, *mTracks };
-      const auto range = TrackList::Channels(tr);
-      for (auto channel : range)
-         channel->SetSelected(true);
+      wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (inName.GetFullName()));
 
-      // Export the data. "channels" are per track.
-      ok = DoExport(pDialog,
-         activeSetting.channels, activeSetting.destfile, true,
-         activeSetting.t0, activeSetting.t1, activeSetting.filetags);
-      if (ok == ProgressResult::Stopped) {
-         AudacityMessageDialog dlgMessage(
-            nullptr,
-            XO("Continue to export remaining files?"),
-            XO("Export"),
-            wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
-         if (dlgMessage.ShowModal() != wxID_YES ) {
-            // User decided not to continue - bail out!
-            break;
+      if (overwrite) {
+         name = inName;
+         mBackup.Assign(name);
+
+         int suffix = 0;
+         do {
+            mBackup.SetName(name.GetName() +
+                              wxString::Format(wxT("%d"), suffix));
+            ++suffix;
          }
+         while (mBackup.FileExists());
+         ::wxRenameFile(inName.GetFullPath(), mBackup.GetFullPath());
       }
-      else if (ok != ProgressResult::Success) {
-         break;
+      else {
+         name = inName;
+         int i = 2;
+         wxString base(name.GetName());
+         while (name.FileExists()) {
+            name.SetName(wxString::Format(wxT("%s-%d"), base, i++));
+         }
       }
-      // increment export counter
-      count++;
 
+      mFullPath = name.GetFullPath();
    }
 
-   return ok ;
-}
-
-ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &pDialog,
-                              unsigned channels,
-                              const wxFileName &inName,
-                              bool selectedOnly,
-                              double t0,
-                              double t1,
-                              const Tags &tags)
-{
-   wxFileName name;
-
-   wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (inName.GetFullName()));
-   wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "), channels, t0, t1);
-   if (selectedOnly)
-      wxLogDebug(wxT("Selected Region Only"));
-   else
-      wxLogDebug(wxT("Whole Project"));
-
-   wxFileName backup;
-   if (mOverwrite->GetValue()) {
-      name = inName;
-      backup.Assign(name);
-
-      int suffix = 0;
-      do {
-         backup.SetName(name.GetName() +
-                           wxString::Format(wxT("%d"), suffix));
-         ++suffix;
-      }
-      while (backup.FileExists());
-      ::wxRenameFile(inName.GetFullPath(), backup.GetFullPath());
-   }
-   else {
-      name = inName;
-      int i = 2;
-      wxString base(name.GetName());
-      while (name.FileExists()) {
-         name.SetName(wxString::Format(wxT("%s-%d"), base, i++));
-      }
-   }
-
-   ProgressResult success = ProgressResult::Cancelled;
-   const wxString fullPath{name.GetFullPath()};
-
-   auto cleanup = finally( [&] {
+   ~ExportedFile()
+   {
       bool ok =
-         success == ProgressResult::Stopped ||
-         success == ProgressResult::Success;
-      if (backup.IsOk()) {
+         result == ProgressResult::Stopped ||
+         result == ProgressResult::Success;
+      if (mBackup.IsOk()) {
          if ( ok )
             // Remove backup
-            ::wxRemoveFile(backup.GetFullPath());
+            ::wxRemoveFile(mBackup.GetFullPath());
          else {
             // Restore original
-            ::wxRemoveFile(fullPath);
-            ::wxRenameFile(backup.GetFullPath(), fullPath);
+            ::wxRemoveFile(mFullPath);
+            ::wxRenameFile(mBackup.GetFullPath(), mFullPath);
          }
       }
       else {
          if ( ! ok )
             // Remove any new, and only partially written, file.
-            ::wxRemoveFile(fullPath);
+            ::wxRemoveFile(mFullPath);
       }
-   } );
+   }
+
+   const wxString &GetFullPath() const { return mFullPath; }
+
+   ProgressResult result{ ProgressResult::Cancelled };
+
+private:
+   wxFileName mBackup;
+   wxString mFullPath;
+};
+}
+
+auto ExportMultipleDialog::ExportFiles(AudacityProject &project,
+   ExportPlugin &plugin, int subformat,
+   const std::vector<ExportKit> &kits, bool overwrite, bool askToContinue,
+   FilePaths &exported, int filesAtOnce) -> ProgressResult
+{
+   auto &tracks = TrackList::Get( project );
+   auto &selectionState = SelectionState::Get( project );
+
+   // The mixer takes the tracks that are selected when the export begins
+   const auto selectTrack = [&](
+      std::optional<SelectionStateChanger> &changer, const ExportKit &kit){
+      if (!kit.track)
+         return;
+      changer.emplace(selectionState, tracks);
+      for (auto tr : tracks.Selected<WaveTrack>())
+         tr->SetSelected(false);
+      for (auto channel : TrackList::Channels(kit.track))
+         channel->SetSelected(true);
+   };
+
+   const auto goOn = [askToContinue]{
+      if (!askToContinue)
+         return false;
+      AudacityMessageDialog dlgMessage(
+         nullptr,
+         XO("Continue to export remaining files?"),
+         XO("Export"),
+         wxYES_NO | wxNO_DEFAULT | wxICON_WARNING);
+      return dlgMessage.ShowModal() == wxID_YES;
+   };
 
-   // Call the format export routine
-   success = mPlugins[mPluginIndex]->Export(mProject,
-                                            pDialog,
-                                                channels,
-                                                fullPath,
-                                                selectedOnly,
-                                                t0,
-                                                t1,
-                                                NULL,
-                                                &tags,
-                                                mSubFormatIndex);
-
-   if (success == ProgressResult::Success || success == ProgressResult::Stopped) {
-      mExported.push_back(fullPath);
+   auto ok = ProgressResult::Success;
+   std::unique_ptr<ProgressDialog> pDialog;
+   size_t next = 0;
+
+   // Export several files at once, each in a thread of its own, while the
+   // plug-in can prepare them; the progress indicator sums them all
+   if (filesAtOnce > 1) {
+      struct Job {
+         std::unique_ptr<ExportedFile> file;
+         double t0, t1;
+         std::thread thread;
+         //! Time reached in the mix
+         std::atomic<double> time;
+         std::atomic<bool> finished{ false };
+         ProgressResult result{ ProgressResult::Cancelled };
+         std::exception_ptr pException;
+      };
+      std::vector<std::unique_ptr<Job>> jobs;
+      // What the jobs are told when they report progress, after the user
+      // stops or cancels, or when one of them fails
+      std::atomic<ProgressResult> command{ ProgressResult::Success };
+      std::exception_ptr pException;
+      // Let no job outlive the files it writes, even if this throws
+      auto cleanup = finally([&]{
+         command.store(ProgressResult::Cancelled);
+         for (auto &pJob : jobs)
+            if (pJob->thread.joinable())
+               pJob->thread.join();
+      });
+
+      double total = 0, done = 0;
+      for (const auto &kit : kits)
+         if (!kit.destfile.GetName().empty())
+            total += kit.t1 - kit.t0;
+
+      bool serial = false;
+      while (true) {
+         // Begin more exports, if there are threads free
+         while (!serial && command.load() == ProgressResult::Success &&
+            jobs.size() < static_cast<size_t>(filesAtOnce) &&
+            next < kits.size()) {
+            const auto &kit = kits[next];
+            // Bug 1440 fix.
+            if (kit.destfile.GetName().empty()) {
+               ++next;
+               continue;
+            }
+
+            auto pJob = std::make_unique<Job>();
+            auto &job = *pJob;
+            job.file = std::make_unique<ExportedFile>(kit.destfile, overwrite);
+            job.t0 = kit.t0;
+            job.t1 = kit.t1;
+            job.time.store(kit.t0);
+
+            ExportPlugin::BackgroundExport work;
+            {
+               std::optional<SelectionStateChanger> changer;
+               selectTrack(changer, kit);
+               work = plugin.PrepareBackgroundExport(&project, kit.channels,
+                  job.file->GetFullPath(), kit.track != nullptr,
+                  kit.t0, kit.t1, &kit.filetags, subformat);
+            }
+            if (!work) {
+               // Export the rest one at a time, after the others finish
+               serial = true;
+               break;
+            }
+            ++next;
+
+            job.thread = std::thread{ [&job, &command, work]{
+               try {
+                  job.result = work([&](double time){
+                     job.time.store(time, std::memory_order_relaxed);
+                     return command.load(std::memory_order_relaxed);
+                  });
+               }
+               catch (...) {
+                  job.pException = std::current_exception();
+               }
+               job.finished.store(true, std::memory_order_release);
+            } };
+            jobs.push_back(std::move(pJob));
+         }
+
+         if (jobs.empty()) {
+            if (command.load() == ProgressResult::Stopped &&
+                next < kits.size() && goOn()) {
+               command.store(ProgressResult::Success);
+               pDialog->Reinit();
+               continue;
+            }
+            break;
+         }
+
+         if (!pDialog)
+            pDialog = std::make_unique<ProgressDialog>(
+               XO("Export Multiple"),
+               XO("Exporting the audio as %s")
+                  .Format( plugin.GetDescription(subformat) ));
+
+         // Finish the exports that are done
+         for (auto iter = jobs.begin(); iter != jobs.end();) {
+            auto &job = **iter;
+            if (!job.finished.load(std::memory_order_acquire)) {
+               ++iter;
+               continue;
+            }
+            job.thread.join();
+            if (job.pException) {
+               if (!pException)
+                  pException = job.pException;
+               job.result = ProgressResult::Cancelled;
+            }
+            job.file->result = job.result;
+            if (job.result == ProgressResult::Success ||
+                job.result == ProgressResult::Stopped)
+               exported.push_back(job.file->GetFullPath());
+            // A failure is not forgotten when other exports finish
+            if (ok == ProgressResult::Success || ok == ProgressResult::Stopped)
+               ok = job.result;
+            if (job.result != ProgressResult::Success &&
+                job.result != ProgressResult::Stopped)
+               // Stop the others too
+               command.store(ProgressResult::Cancelled);
+            done += job.t1 - job.t0;
+            iter = jobs.erase(iter);
+         }
+
+         auto time = done;
+         for (auto &pJob : jobs)
+            time += pJob->time.load(std::memory_order_relaxed) - pJob->t0;
+         const auto update = pDialog->Update(time, total);
+         if (update != ProgressResult::Success &&
+             command.load() != ProgressResult::Cancelled)
+            command.store(update);
+
+         std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+      }
+
+      if (pException)
+         std::rethrow_exception(pException);
+      if (command.load() != ProgressResult::Success)
+         return ok;
    }
 
-   Refresh();
-   Update();
+   // Export the rest one at a time, each reporting its own progress
+   for (; next < kits.size(); ++next) {
+      const auto &kit = kits[next];
+      // Bug 1440 fix.
+      if (kit.destfile.GetName().empty())
+         continue;
+
+      wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "),
+         kit.channels, kit.t0, kit.t1);
 
-   return success;
+      std::optional<SelectionStateChanger> changer;
+      selectTrack(changer, kit);
+      ExportedFile file{ kit.destfile, overwrite };
+
+      // Call the format export routine
+      file.result = ok = plugin.Export(&project,
+                                       pDialog,
+                                       kit.channels,
+                                       file.GetFullPath(),
+                                       kit.track != nullptr,
+                                       kit.t0,
+                                       kit.t1,
+                                       NULL,
+                                       &kit.filetags,
+                                       subformat);
+
+      if (ok == ProgressResult::Success || ok == ProgressResult::Stopped)
+         exported.push_back(file.GetFullPath());
+
+      if (ok == ProgressResult::Stopped) {
+         if (!goOn())
+            // User decided not to continue - bail out!
+            break;
+      }
+      else if (ok != ProgressResult::Success) {
+         break;
+      }
+   }
+
+   return ok;
 }
 
 wxString ExportMultipleDialog::MakeFileName(const wxString &input)
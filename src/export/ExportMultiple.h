@@ -13,6 +13,7 @@
 
 #include "Export.h"
 #include "wxFileNameWrapper.h" // member variable
+#include "../Tags.h" // member variable
 
 class wxButton;
 class wxCheckBox;
@@ -25,10 +26,14 @@ class wxTextCtrl;
 
 class AudacityProject;
 class LabelTrack;
-class SelectionState;
 class ShuttleGui;
 class Track;
 
+class IntSetting;
+
+//! How many files Export Multiple may write at once
+extern AUDACITY_DLL_API IntSetting ExportMultipleFilesAtOnce;
+
 class AUDACITY_DLL_API ExportMultipleDialog final : public wxDialogWrapper
 {
 public:
@@ -39,6 +44,41 @@ public:
 
    int ShowModal();
 
+   /** \brief The information needed to export one file of a set.
+    *
+    * We create a set of these during the interactive phase of the export
+    * cycle, then use them when the actual exports are done. */
+   struct ExportKit
+   {
+      Tags filetags; /**< The set of metadata to use for the export */
+      wxFileNameWrapper destfile; /**< The file to export to; none if the
+                                    name is empty */
+      double t0;           /**< Start time for the export */
+      double t1;           /**< End time for the export */
+      unsigned channels;   /**< Number of channels to export */
+      WaveTrack *track{};  /**< The only track to export, or null for all */
+   };
+
+   /** \brief Export each of a set of files, and several at once, if the
+    * format supports it
+    *
+    * Files export one at a time if the plug-in cannot prepare a background
+    * export.  Unless overwriting, files take new names rather than replace
+    * others; replaced files are restored if their exports fail.
+    * @param askToContinue whether to ask the user to go on after stopping
+    * @param exported receives the paths of the files exported
+    * @param filesAtOnce the most files to export at once, as in
+    * ExportMultipleFilesAtOnce
+    * @return the first failure, or else the result of the last export */
+   static ProgressResult ExportFiles(AudacityProject &project,
+      ExportPlugin &plugin, int subformat,
+      const std::vector<ExportKit> &kits, bool overwrite, bool askToContinue,
+      FilePaths &exported, int filesAtOnce);
+
+   //! Number of channels to export all unmuted tracks without loss of
+   //! stereo placement
+   static unsigned GetNumExportChannels( const TrackList &tracks );
+
 private:
 
    // Export
@@ -63,23 +103,6 @@ private:
     * numbered rather than named */
    ProgressResult ExportMultipleByTrack(bool byName, const wxString &prefix, bool addNumber);
 
-   /** Export one file of an export multiple set
-    *
-    * Called once for each file in the list to do a (non-interactive) export
-    * @param channels Number of channels to export
-    * @param name The file name (and path) to export to
-    * @param selectedOnly Should we  export the selected tracks only?
-    * @param t0 Start time for export
-    * @param t1 End time for export
-    * @param tags Metadata to include in the file (if possible).
-    */
-   ProgressResult DoExport(std::unique_ptr<ProgressDialog> &pDialog,
-                 unsigned channels,
-                 const wxFileName &name,
-                 bool selectedOnly,
-                 double t0,
-                 double t1,
-                 const Tags &tags);
    /** \brief Takes an arbitrary text string and converts it to a form that can
     * be used as a file name, if necessary prompting the user to edit the file
     * name produced */
@@ -161,8 +184,6 @@ private:
 
    wxSimplebook   *mBook;
 
-   SelectionState &mSelectionState;
-
    DECLARE_EVENT_TABLE()
 
 };
@@ -283,20 +283,23 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
             : XO("Exporting the audio as Ogg Vorbis") );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success && !eos) {
-         float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
-         auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
-
+      // Encode samples, or signal the end if there are none, and collect the
+      // pages that are complete; returns nonzero on error
+      auto encodeSamples = [&](size_t samplesThisRun, const char *mixed,
+         std::vector<char> &pages){
+         pages.clear();
          int err;
          if (samplesThisRun == 0) {
             // Tell the library that we wrote 0 bytes - signalling the end.
             err = vorbis_analysis_wrote(&dsp, 0);
          }
          else {
-
+            float **vorbis_buffer =
+               vorbis_analysis_buffer(&dsp, samplesThisRun);
             for (size_t i = 0; i < numChannels; i++) {
-               float *temp = (float *)mixer->GetBuffer(i);
-               memcpy(vorbis_buffer[i], temp, sizeof(float)*SAMPLES_PER_RUN);
+               memcpy(vorbis_buffer[i],
+                  mixed + i * sizeof(float) * samplesThisRun,
+                  sizeof(float) * samplesThisRun);
             }
 
             // tell the encoder how many samples we have
@@ -331,12 +334,10 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
                      break;
                   }
 
-                  if ( outFile.Write(page.header, page.header_len).GetLastError() ||
-                       outFile.Write(page.body, page.body_len).GetLastError()) {
-                     // TODO: more precise message
-                     ShowDiskFullExportErrorDialog(fName);
-                     return ProgressResult::Cancelled;
-                  }
+                  pages.insert(pages.end(),
+                     page.header, page.header + page.header_len);
+                  pages.insert(pages.end(),
+                     page.body, page.body + page.body_len);
 
                   if (ogg_page_eos(&page)) {
                      eos = 1;
@@ -344,15 +345,39 @@ ProgressResult ExportOGG::Export(AudacityProject *project,
                }
             }
          }
+         return err;
+      };
 
-         if (err) {
-            updateResult = ProgressResult::Cancelled;
+      auto writePages = [&](const std::vector<char> &pages){
+         if ( outFile.Write(pages.data(), pages.size()).GetLastError() ) {
             // TODO: more precise message
-            ShowExportErrorDialog("OGG:355");
-            break;
+            ShowDiskFullExportErrorDialog(fName);
+            return false;
          }
+         return true;
+      };
+
+      int err = 0;
+      updateResult = ExportPipelined(progress, t0, t1,
+         MixStage(*mixer, SAMPLES_PER_RUN, numChannels, false, floatSample),
+         [&](PipelineBlock &data){
+            err = encodeSamples(data.frames, data.mixed.data(), data.encoded);
+            return !err;
+         },
+         [&](PipelineBlock &data){ return writePages(data.encoded); });
+
+      if (updateResult == ProgressResult::Success ||
+          updateResult == ProgressResult::Stopped) {
+         std::vector<char> pages;
+         err = encodeSamples(0, nullptr, pages);
+         if (!err && !writePages(pages))
+            updateResult = ProgressResult::Cancelled;
+      }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+      if (err) {
+         updateResult = ProgressResult::Cancelled;
+         // TODO: more precise message
+         ShowExportErrorDialog("OGG:355");
       }
    }
 
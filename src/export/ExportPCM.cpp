@@ -24,6 +24,7 @@
 
 #include "sndfile.h"
 
+#include "BasicUI.h"
 #include "Dither.h"
 #include "../FileFormats.h"
 #include "Mix.h"
@@ -399,11 +400,23 @@ public:
                          const Tags *metadata = NULL,
                          int subformat = 0) override;
    // optional
+   BackgroundExport PrepareBackgroundExport(AudacityProject *project,
+      unsigned channels, const wxFileNameWrapper &fName, bool selectedOnly,
+      double t0, double t1, const Tags *metadata, int subformat) override;
    wxString GetFormat(int index) override;
    FileExtension GetExtension(int index) override;
    unsigned GetMaxChannels(int index) override;
 
 private:
+   //! Does all the checks and opens the file, returning null if the export
+   //! cannot begin, after alerting the user unless in the background
+   /*!
+    @param result set for a null return, when it is not Cancelled
+    */
+   BackgroundExport Prepare(AudacityProject *project,
+      unsigned channels, const wxFileNameWrapper &fName, bool selectedOnly,
+      double t0, double t1, MixerSpec *mixerSpec, const Tags *metadata,
+      int subformat, bool background, ProgressResult &result);
    void ReportTooBigError(wxWindow * pParent);
    ArrayOf<char> AdjustString(const wxString & wxStr, int sf_format);
    bool AddStrings(AudacityProject *project, SNDFILE *sf, const Tags *tags, int sf_format);
@@ -459,25 +472,8 @@ void ExportPCM::ReportTooBigError(wxWindow * pParent)
 #endif
 }
 
-/**
- *
- * @param subformat Control whether we are doing a "preset" export to a popular
- * file type, or giving the user full control over libsndfile.
- */
-ProgressResult ExportPCM::Export(AudacityProject *project,
-                                 std::unique_ptr<ProgressDialog> &pDialog,
-                                 unsigned numChannels,
-                                 const wxFileNameWrapper &fName,
-                                 bool selectionOnly,
-                                 double t0,
-                                 double t1,
-                                 MixerSpec *mixerSpec,
-                                 const Tags *metadata,
-                                 int subformat)
+static int GetSFFormat(int subformat)
 {
-   double rate = ProjectRate::Get( *project ).GetRate();
-   const auto &tracks = TrackList::Get( *project );
-
    // Set a default in case the settings aren't found
    int sf_format;
 
@@ -512,217 +508,297 @@ ProgressResult ExportPCM::Export(AudacityProject *project,
       sf_format |= SF_FORMAT_PCM_16;
    }
 
-   int fileFormat = sf_format & SF_FORMAT_TYPEMASK;
-   
-   auto updateResult = ProgressResult::Success;
-   {
-      wxFile f;   // will be closed when it goes out of scope
-      SFFile       sf; // wraps f
+   return sf_format;
+}
 
-      wxString     formatStr;
-      SF_INFO      info;
-      //int          err;
+/**
+ *
+ * @param subformat Control whether we are doing a "preset" export to a popular
+ * file type, or giving the user full control over libsndfile.
+ */
+ProgressResult ExportPCM::Export(AudacityProject *project,
+                                 std::unique_ptr<ProgressDialog> &pDialog,
+                                 unsigned numChannels,
+                                 const wxFileNameWrapper &fName,
+                                 bool selectionOnly,
+                                 double t0,
+                                 double t1,
+                                 MixerSpec *mixerSpec,
+                                 const Tags *metadata,
+                                 int subformat)
+{
+   auto result = ProgressResult::Cancelled;
+   const auto job = Prepare(project, numChannels, fName, selectionOnly,
+      t0, t1, mixerSpec, metadata, subformat, false, result);
+   if (!job)
+      return result;
+
+   const auto formatStr = SFCall<wxString>(sf_header_name,
+      GetSFFormat(subformat) & SF_FORMAT_TYPEMASK);
+   InitProgress( pDialog, fName,
+      (selectionOnly
+         ? XO("Exporting the selected audio as %s")
+         : XO("Exporting the audio as %s"))
+         .Format( formatStr ) );
+   auto &progress = *pDialog;
+
+   return job([&](double time){
+      return progress.Update(time - t0, t1 - t0);
+   });
+}
 
-      //This whole operation should not occur while a file is being loaded on OD,
-      //(we are worried about reading from a file being written to,) so we block.
-      //Furthermore, we need to do this because libsndfile is not threadsafe.
-      formatStr = SFCall<wxString>(sf_header_name, fileFormat);
+auto ExportPCM::PrepareBackgroundExport(AudacityProject *project,
+   unsigned numChannels, const wxFileNameWrapper &fName, bool selectionOnly,
+   double t0, double t1, const Tags *metadata, int subformat)
+   -> BackgroundExport
+{
+   auto result = ProgressResult::Cancelled;
+   return Prepare(project, numChannels, fName, selectionOnly,
+      t0, t1, nullptr, metadata, subformat, true, result);
+}
 
-      // Use libsndfile to export file
+auto ExportPCM::Prepare(AudacityProject *project,
+   unsigned numChannels, const wxFileNameWrapper &fName, bool selectionOnly,
+   double t0, double t1, MixerSpec *mixerSpec, const Tags *metadata,
+   int subformat, bool background, ProgressResult &result)
+   -> BackgroundExport
+{
+   double rate = ProjectRate::Get( *project ).GetRate();
+   const auto &tracks = TrackList::Get( *project );
 
-      info.samplerate = (unsigned int)(rate + 0.5);
-      info.frames = (unsigned int)((t1 - t0)*rate + 0.5);
-      info.channels = numChannels;
-      info.format = sf_format;
-      info.sections = 1;
-      info.seekable = 0;
+   const int sf_format = GetSFFormat(subformat);
+   const int fileFormat = sf_format & SF_FORMAT_TYPEMASK;
 
-      // Bug 46.  Trap here, as sndfile.c does not trap it properly.
-      if( (numChannels != 1) && ((sf_format & SF_FORMAT_SUBMASK) == SF_FORMAT_GSM610) )
-      {
-         AudacityMessageBox( XO("GSM 6.10 requires mono") );
-         return ProgressResult::Cancelled;
-      }
+   // What the rest of the export needs, shared by copies of the function
+   struct State {
+      wxFile f;   // will be closed when it goes out of scope
+      SFFile sf;  // wraps f
+      SF_INFO info;
+      std::unique_ptr<Mixer> mixer;
+   };
+   const auto pState = std::make_shared<State>();
+   auto &f = pState->f;
+   auto &sf = pState->sf;
+   auto &info = pState->info;
+
+   // Alert the user now, unless preparing for the background, in which
+   // case the caller calls Export() instead, which alerts the user
+   const auto alert = [background](const TranslatableString &message){
+      if (!background)
+         AudacityMessageBox( message );
+   };
 
-      if (sf_format == SF_FORMAT_WAVEX + SF_FORMAT_GSM610) {
-         AudacityMessageBox(
-            XO("WAVEX and GSM 6.10 formats are not compatible") );
-         return ProgressResult::Cancelled;
-      }
+   // Use libsndfile to export file
 
-      // If we can't export exactly the format they requested,
-      // try the default format for that header type...
-      // 
-      // LLL: I don't think this is valid since libsndfile checks
-      // for all allowed subtypes explicitly and doesn't provide
-      // for an unspecified subtype.
-      if (!sf_format_check(&info))
-         info.format = (info.format & SF_FORMAT_TYPEMASK);
-      if (!sf_format_check(&info)) {
-         AudacityMessageBox( XO("Cannot export audio in this format.") );
-         return ProgressResult::Cancelled;
-      }
-      const auto path = fName.GetFullPath();
-      if (f.Open(path, wxFile::write)) {
-         // Even though there is an sf_open() that takes a filename, use the one that
-         // takes a file descriptor since wxWidgets can open a file with a Unicode name and
-         // libsndfile can't (under Windows).
-         sf.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_WRITE, &info, FALSE));
-         //add clipping for integer formats.  We allow floats to clip.
-         sf_command(sf.get(), SFC_SET_CLIPPING, NULL, sf_subtype_is_integer(sf_format)?SF_TRUE:SF_FALSE) ;
-      }
+   info.samplerate = (unsigned int)(rate + 0.5);
+   info.frames = (unsigned int)((t1 - t0)*rate + 0.5);
+   info.channels = numChannels;
+   info.format = sf_format;
+   info.sections = 1;
+   info.seekable = 0;
 
-      if (!sf) {
-         AudacityMessageBox( XO("Cannot export audio to %s").Format( path ) );
-         return ProgressResult::Cancelled;
-      }
-      // Retrieve tags if not given a set
-      if (metadata == NULL)
-         metadata = &Tags::Get( *project );
-
-      // Install the meta data at the beginning of the file (except for
-      // WAV and WAVEX formats)
-      if (fileFormat != SF_FORMAT_WAV &&
-          fileFormat != SF_FORMAT_WAVEX) {
-         if (!AddStrings(project, sf.get(), metadata, sf_format)) {
-            return ProgressResult::Cancelled;
-         }
-      }
+   // Bug 46.  Trap here, as sndfile.c does not trap it properly.
+   if( (numChannels != 1) && ((sf_format & SF_FORMAT_SUBMASK) == SF_FORMAT_GSM610) )
+   {
+      alert( XO("GSM 6.10 requires mono") );
+      return {};
+   }
 
-      sampleFormat format;
-      if (sf_subtype_more_than_16_bits(info.format))
-         format = floatSample;
-      else
-         format = int16Sample;
-
-      // Bug 2200
-      // Only trap size limit for file types we know have an upper size limit.
-      // The error message mentions aiff and wav.
-      if( (fileFormat == SF_FORMAT_WAV) ||
-          (fileFormat == SF_FORMAT_WAVEX) ||
-          (fileFormat == SF_FORMAT_AIFF ))
+   if (sf_format == SF_FORMAT_WAVEX + SF_FORMAT_GSM610) {
+      alert( XO("WAVEX and GSM 6.10 formats are not compatible") );
+      return {};
+   }
+
+   // If we can't export exactly the format they requested,
+   // try the default format for that header type...
+   // 
+   // LLL: I don't think this is valid since libsndfile checks
+   // for all allowed subtypes explicitly and doesn't provide
+   // for an unspecified subtype.
+   if (!sf_format_check(&info))
+      info.format = (info.format & SF_FORMAT_TYPEMASK);
+   if (!sf_format_check(&info)) {
+      alert( XO("Cannot export audio in this format.") );
+      return {};
+   }
+
+   // Bug 2200
+   // Only trap size limit for file types we know have an upper size limit.
+   // The error message mentions aiff and wav.
+   if( (fileFormat == SF_FORMAT_WAV) ||
+       (fileFormat == SF_FORMAT_WAVEX) ||
+       (fileFormat == SF_FORMAT_AIFF ))
+   {
+      float sampleCount = (float)(t1-t0)*rate*info.channels;
+      float byteCount = sampleCount * sf_subtype_bytes_per_sample( info.format);
+      // Test for 4 Gibibytes, rather than 4 Gigabytes
+      if( byteCount > 4.295e9)
       {
-         float sampleCount = (float)(t1-t0)*rate*info.channels;
-         float byteCount = sampleCount * sf_subtype_bytes_per_sample( info.format);
-         // Test for 4 Gibibytes, rather than 4 Gigabytes
-         if( byteCount > 4.295e9)
-         {
+         if (!background)
             ReportTooBigError( wxTheApp->GetTopWindow() );
-            return ProgressResult::Failed;
-         }
+         result = ProgressResult::Failed;
+         return {};
       }
-      size_t maxBlockLen = 44100 * 5;
-
-      {
-         std::vector<char> dither;
-         if ((info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24) {
-            dither.reserve(maxBlockLen * info.channels * SAMPLE_SIZE(int24Sample));
-         }
+   }
 
-         wxASSERT(info.channels >= 0);
-         auto mixer = CreateMixer(tracks, selectionOnly,
-                                  t0, t1,
-                                  info.channels, maxBlockLen, true,
-                                  rate, format, mixerSpec);
-
-         InitProgress( pDialog, fName,
-            (selectionOnly
-               ? XO("Exporting the selected audio as %s")
-               : XO("Exporting the audio as %s"))
-               .Format( formatStr ) );
-         auto &progress = *pDialog;
-
-         while (updateResult == ProgressResult::Success) {
-            sf_count_t samplesWritten;
-            size_t numSamples = mixer->Process(maxBlockLen);
-
-            if (numSamples == 0)
-               break;
-
-            auto mixed = mixer->GetBuffer();
-
-            // Bug 1572: Not ideal, but it does add the desired dither
-            if ((info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24) {
-               for (int c = 0; c < info.channels; ++c) {
-                  CopySamples(
-                     mixed + (c * SAMPLE_SIZE(format)), format,
-                     dither.data() + (c * SAMPLE_SIZE(int24Sample)), int24Sample,
-                     numSamples, gHighQualityDither, info.channels, info.channels
-                  );
-                  // Copy back without dither
-                  CopySamples(
-                     dither.data() + (c * SAMPLE_SIZE(int24Sample)), int24Sample,
-                     const_cast<samplePtr>(mixed) // PRL fix this!
-                        + (c * SAMPLE_SIZE(format)), format,
-                     numSamples, DitherType::none, info.channels, info.channels);
-               }
-            }
+   const auto path = fName.GetFullPath();
+   if (f.Open(path, wxFile::write)) {
+      // Even though there is an sf_open() that takes a filename, use the one that
+      // takes a file descriptor since wxWidgets can open a file with a Unicode name and
+      // libsndfile can't (under Windows).
+      sf.reset(SFCall<SNDFILE*>(sf_open_fd, f.fd(), SFM_WRITE, &info, FALSE));
+      //add clipping for integer formats.  We allow floats to clip.
+      sf_command(sf.get(), SFC_SET_CLIPPING, NULL, sf_subtype_is_integer(sf_format)?SF_TRUE:SF_FALSE) ;
+   }
 
-            if (format == int16Sample)
-               samplesWritten = SFCall<sf_count_t>(sf_writef_short, sf.get(), (const short *)mixed, numSamples);
-            else
-               samplesWritten = SFCall<sf_count_t>(sf_writef_float, sf.get(), (const float *)mixed, numSamples);
+   if (!sf) {
+      alert( XO("Cannot export audio to %s").Format( path ) );
+      return {};
+   }
+   // Retrieve tags if not given a set
+   if (metadata == NULL)
+      metadata = &Tags::Get( *project );
+
+   // Install the meta data at the beginning of the file (except for
+   // WAV and WAVEX formats)
+   if (fileFormat != SF_FORMAT_WAV &&
+       fileFormat != SF_FORMAT_WAVEX) {
+      if (!AddStrings(project, sf.get(), metadata, sf_format)) {
+         return {};
+      }
+   }
 
-            if (static_cast<size_t>(samplesWritten) != numSamples) {
-               char buffer2[1000];
-               sf_error_str(sf.get(), buffer2, 1000);
-               //Used to give this error message
+   sampleFormat format;
+   if (sf_subtype_more_than_16_bits(info.format))
+      format = floatSample;
+   else
+      format = int16Sample;
+
+   size_t maxBlockLen = 44100 * 5;
+
+   wxASSERT(info.channels >= 0);
+   pState->mixer = CreateMixer(tracks, selectionOnly,
+                            t0, t1,
+                            info.channels, maxBlockLen, true,
+                            rate, format, mixerSpec);
+
+   return [this, pState, project, fName, t0, metadata,
+      sf_format, fileFormat, format, maxBlockLen, background]
+   (const ExportProgress &progress){
+      auto &state = *pState;
+      auto &sf = state.sf;
+      const auto &info = state.info;
+
+      // Close the file when done, so that the caller may remove it
+      auto cleanup = finally([&]{
+         state.mixer.reset();
+         sf.reset();
+         state.f.Close();
+      });
+
+      // Alert the user now, or later in the main thread
+      const auto alert = [background](const wxString &code){
+         if (background)
+            BasicUI::CallAfter([code]{ ShowExportErrorDialog(code); });
+         else
+            ShowExportErrorDialog(code);
+      };
+
+      // libsndfile converts the samples as it writes them, so there is
+      // little to do between mixing and writing
+      auto encode = [&](PipelineBlock &block){
+         // Bug 1572: Not ideal, but it does add the desired dither
+         if ((info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24) {
+            auto &dither = block.encoded;
+            dither.resize(
+               block.frames * info.channels * SAMPLE_SIZE(int24Sample));
+            const auto mixed = block.mixed.data();
+            for (int c = 0; c < info.channels; ++c) {
+               CopySamples(
+                  mixed + (c * SAMPLE_SIZE(format)), format,
+                  dither.data() + (c * SAMPLE_SIZE(int24Sample)), int24Sample,
+                  block.frames, gHighQualityDither, info.channels, info.channels
+               );
+               // Copy back without dither
+               CopySamples(
+                  dither.data() + (c * SAMPLE_SIZE(int24Sample)), int24Sample,
+                  mixed + (c * SAMPLE_SIZE(format)), format,
+                  block.frames, DitherType::none, info.channels, info.channels);
+            }
+         }
+         return true;
+      };
+
+      auto write = [&](PipelineBlock &block){
+         sf_count_t samplesWritten;
+         const auto mixed = block.mixed.data();
+         const auto numSamples = block.frames;
+         if (format == int16Sample)
+            samplesWritten = SFCall<sf_count_t>(sf_writef_short, sf.get(), (const short *)mixed, numSamples);
+         else
+            samplesWritten = SFCall<sf_count_t>(sf_writef_float, sf.get(), (const float *)mixed, numSamples);
+
+         if (static_cast<size_t>(samplesWritten) != numSamples) {
+            char buffer2[1000];
+            sf_error_str(sf.get(), buffer2, 1000);
+            //Used to give this error message
 #if 0
-               AudacityMessageBox(
-                  XO(
-                  /* i18n-hint: %s will be the error message from libsndfile, which
-                   * is usually something unhelpful (and untranslated) like "system
-                   * error" */
+            AudacityMessageBox(
+               XO(
+               /* i18n-hint: %s will be the error message from libsndfile, which
+                * is usually something unhelpful (and untranslated) like "system
+                * error" */
 "Error while writing %s file (disk full?).\nLibsndfile says \"%s\"")
-                     .Format( formatStr, wxString::FromAscii(buffer2) ));
+                  .Format( formatStr, wxString::FromAscii(buffer2) ));
 #else
-               // But better to give the same error message as for
-               // other cases of disk exhaustion.
-               // The thrown exception doesn't escape but GuardedCall
-               // will enqueue a message.
-               GuardedCall([&fName]{
-                  throw FileException{
-                     FileException::Cause::Write, fName }; });
+            // But better to give the same error message as for
+            // other cases of disk exhaustion.
+            // The thrown exception doesn't escape but GuardedCall
+            // will enqueue a message.
+            GuardedCall([&fName]{
+               throw FileException{
+                  FileException::Cause::Write, fName }; });
 #endif
-               updateResult = ProgressResult::Cancelled;
-               break;
-            }
-            
-            updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+            return false;
          }
-      }
-      
+         return true;
+      };
+
+      const auto updateResult = ExportPipelined(progress, t0,
+         MixStage(*state.mixer, maxBlockLen, info.channels, true, format),
+         encode, write);
+
+      if (updateResult != ProgressResult::Success &&
+          updateResult != ProgressResult::Stopped)
+         return updateResult;
+
       // Install the WAV metata in a "LIST" chunk at the end of the file
-      if (updateResult == ProgressResult::Success ||
-          updateResult == ProgressResult::Stopped) {
-         if (fileFormat == SF_FORMAT_WAV ||
-             fileFormat == SF_FORMAT_WAVEX) {
-            if (!AddStrings(project, sf.get(), metadata, sf_format)) {
-               // TODO: more precise message
-               ShowExportErrorDialog("PCM:675");
-               return ProgressResult::Cancelled;
-            }
-         }
-         if (0 != sf.close()) {
+      if (fileFormat == SF_FORMAT_WAV ||
+          fileFormat == SF_FORMAT_WAVEX) {
+         if (!AddStrings(project, sf.get(), metadata, sf_format)) {
             // TODO: more precise message
-            ShowExportErrorDialog("PCM:681");
+            alert("PCM:675");
             return ProgressResult::Cancelled;
          }
       }
-   }
+      if (0 != sf.close()) {
+         // TODO: more precise message
+         alert("PCM:681");
+         return ProgressResult::Cancelled;
+      }
+      state.f.Close();
 
-   if (updateResult == ProgressResult::Success ||
-       updateResult == ProgressResult::Stopped)
       if ((fileFormat == SF_FORMAT_AIFF) ||
           (fileFormat == SF_FORMAT_WAV))
          // Note: file has closed, and gets reopened and closed again here:
          if (!AddID3Chunk(fName, metadata, sf_format) ) {
             // TODO: more precise message
-            ShowExportErrorDialog("PCM:694");
+            alert("PCM:694");
             return ProgressResult::Cancelled;
          }
 
-   return updateResult;
+      return updateResult;
+   };
 }
 
 ArrayOf<char> ExportPCM::AdjustString(const wxString & wxStr, int sf_format)
@@ -41,6 +41,7 @@ ImportLOF.cpp, and ImportAUP.cpp.
 #include "ImportPlugin.h"
 
 #include <algorithm>
+#include <thread>
 #include <unordered_set>
 
 #include <wx/textctrl.h>
@@ -459,8 +460,12 @@ bool Importer::Import( AudacityProject &project,
                      WaveTrackFactory *trackFactory,
                      TrackHolders &tracks,
                      Tags *tags,
-                     TranslatableString &errorMessage)
+                     TranslatableString &errorMessage,
+                     ImportFileHandle::BackgroundImport *pBackground)
 {
+   if (pBackground)
+      *pBackground = nullptr;
+
    AudacityProject *pProj = &project;
    auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
 
@@ -627,6 +632,26 @@ bool Importer::Import( AudacityProject &project,
          else
             inFile->SetStreamUsage(0,TRUE);
 
+         if (pBackground) {
+            if (auto work =
+                inFile->PrepareBackgroundImport(trackFactory, tracks, tags)) {
+               std::shared_ptr<ImportFileHandle> pFile{ std::move(inFile) };
+               *pBackground = [pFile, work, &tracks](const auto &progress){
+                  auto res = work(progress);
+                  if (res == ProgressResult::Success ||
+                      res == ProgressResult::Stopped) {
+                     tracks.erase(std::remove_if(tracks.begin(), tracks.end(),
+                        std::mem_fn(&NewChannelGroup::empty)), tracks.end());
+                     // Unlike Import(), no other plug-in can be tried now
+                     if (tracks.empty())
+                        res = ProgressResult::Failed;
+                  }
+                  return res;
+               };
+               return true;
+            }
+         }
+
          auto res = inFile->Import(trackFactory, tracks, tags);
 
          if (res == ProgressResult::Success || res == ProgressResult::Stopped)
@@ -895,3 +920,8 @@ void ImportStreamDialog::OnCancel(wxCommandEvent & WXUNUSED(event))
 }
 
 BoolSetting NewImportingSession{ L"/NewImportingSession", false };
+
+IntSetting ImportMultipleFilesAtOnce{ L"/Import/MultipleFilesAtOnce", []{
+   // Each import also decodes and stores channels in threads of its own
+   return std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+} };
@@ -12,6 +12,7 @@
 #define _IMPORT_
 
 #include "ImportForwards.h"
+#include "ImportPlugin.h"
 #include "Identifier.h"
 #include <vector>
 #include <wx/tokenzr.h> // for enum wxStringTokenizerMode
@@ -168,12 +169,19 @@ public:
     std::unique_ptr<ExtImportItem> CreateDefaultImportItem();
 
    // if false, the import failed and errorMessage will be set.
+   /*!
+    If pBackground is not null, and the file's importer can do the rest of
+    the work in another thread, then only prepare it and store that work in
+    *pBackground, to be run while tracks and tags persist; else import now,
+    leaving *pBackground null
+    */
    bool Import( AudacityProject &project,
               const FilePath &fName,
               WaveTrackFactory *trackFactory,
               TrackHolders &tracks,
               Tags *tags,
-              TranslatableString &errorMessage);
+              TranslatableString &errorMessage,
+              ImportFileHandle::BackgroundImport *pBackground = nullptr);
 
 private:
    static Importer mInstance;
@@ -213,4 +221,7 @@ private:
 
 extern AUDACITY_DLL_API BoolSetting NewImportingSession;
 
+//! How many files an import of several may read at once
+extern AUDACITY_DLL_API IntSetting ImportMultipleFilesAtOnce;
+
 #endif
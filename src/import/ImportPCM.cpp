@@ -49,8 +49,19 @@
 #include "../ShuttleGui.h"
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
+#include "CodeConversions.h"
+#include "MappedFile.h"
+#include "PipelineQueue.h"
+#include "ThreadPool.h"
+#include "../WaveClip.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <thread>
 
 #ifdef USE_LIBID3TAG
    #include <id3tag.h>
@@ -66,6 +77,8 @@
 
 #define DESC XO("WAV, AIFF, and other uncompressed types")
 
+using NewChannelGroup = std::vector< std::shared_ptr<WaveTrack> >;
+
 class PCMImportPlugin final : public ImportPlugin
 {
 public:
@@ -93,6 +106,8 @@ public:
    ByteCount GetFileUncompressedBytes() override;
    ProgressResult Import(WaveTrackFactory *trackFactory, TrackHolders &outTracks,
               Tags *tags) override;
+   BackgroundImport PrepareBackgroundImport(WaveTrackFactory *trackFactory,
+      TrackHolders &outTracks, Tags *tags) override;
 
    wxInt32 GetStreamCount() override { return 1; }
 
@@ -106,6 +121,17 @@ public:
    {}
 
 private:
+   //! Create the tracks, which must be done in the main thread
+   NewChannelGroup MakeChannels(WaveTrackFactory &trackFactory);
+   //! Decode and append the samples; may be done in any thread
+   ProgressResult ImportSamples(
+      const NewChannelGroup &channels, const ImportProgress &progress);
+   //! Fast path of ImportSamples() for WAV files, making whole sample blocks
+   //! from the mapped file, or null if the file's samples can't be used so
+   std::optional<ProgressResult> ImportMapped(
+      const NewChannelGroup &channels, const ImportProgress &progress);
+   void ReadTags(Tags *tags);
+
    SFFile                mFile;
    const SF_INFO         mInfo;
    sampleFormat          mFormat;
@@ -283,103 +309,257 @@ struct id3_tag_deleter {
 using id3_tag_holder = std::unique_ptr<id3_tag, id3_tag_deleter>;
 #endif
 
-using NewChannelGroup = std::vector< std::shared_ptr<WaveTrack> >;
-
-ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
-                                TrackHolders &outTracks,
-                                Tags *tags)
+namespace {
+//! Frames decoded from the file, interleaved
+struct DecodedBlock
 {
-   outTracks.clear();
+   SampleBuffer buffer;
+   size_t frames{};
+};
 
-   wxASSERT(mFile.get());
+//! Shared by all imports, which may call ParallelFor() on it at once
+ThreadPool &ChannelPool()
+{
+   static ThreadPool pool;
+   return pool;
+}
 
-   CreateProgress();
+//! The samples of a mapped RIFF WAV file, or null if there are fewer bytes
+/*! Only the RIFF chunks are parsed; libsndfile has checked the rest */
+const char *FindWAVSamples(const MappedFile &file, size_t bytes)
+{
+   const auto data = file.Data();
+   const auto size = file.Size();
+   const auto readUInt32 = [&](size_t pos) {
+      const auto p = reinterpret_cast<const unsigned char *>(data + pos);
+      return p[0] | (p[1] << 8) | (p[2] << 16) |
+         (static_cast<size_t>(p[3]) << 24);
+   };
+   if (size < 12 ||
+       memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0)
+      return nullptr;
+   for (size_t pos = 12; pos + 8 <= size;) {
+      const auto length = readUInt32(pos + 4);
+      if (memcmp(data + pos, "data", 4) == 0)
+         return (length >= bytes && size - (pos + 8) >= bytes)
+            ? data + pos + 8 : nullptr;
+      // Chunks are padded to even lengths
+      pos += 8 + length + (length & 1);
+   }
+   return nullptr;
+}
+}
 
+NewChannelGroup PCMImportFileHandle::MakeChannels(
+   WaveTrackFactory &trackFactory)
+{
    NewChannelGroup channels(mInfo.channels);
+   for (auto &channel : channels) {
+      channel = NewWaveTrack(trackFactory, mFormat, mInfo.samplerate);
+      // Make the clip now, so that appending to it needs nothing of the
+      // main thread
+      channel->RightmostOrNewClip();
+   }
+   return channels;
+}
 
-   {
-      // iter not used outside this scope.
-      auto iter = channels.begin();
-      for (int c = 0; c < mInfo.channels; ++iter, ++c)
-         *iter = NewWaveTrack(*trackFactory, mFormat, mInfo.samplerate);
+std::optional<ProgressResult> PCMImportFileHandle::ImportMapped(
+   const NewChannelGroup &channels, const ImportProgress &progress)
+{
+   // Samples in the file must be as in memory:  little-endian WAV, on a
+   // little-endian machine, in a format the tracks can take as it is, or
+   // widen while copying
+   const auto major = mInfo.format & SF_FORMAT_TYPEMASK;
+   const auto subtype = mInfo.format & SF_FORMAT_SUBMASK;
+   const uint16_t one = 1;
+   if (*reinterpret_cast<const unsigned char *>(&one) != 1 ||
+       (major != SF_FORMAT_WAV && major != SF_FORMAT_WAVEX) ||
+       (mInfo.format & SF_FORMAT_ENDMASK) != SF_ENDIAN_FILE ||
+       (subtype != SF_FORMAT_PCM_16 && subtype != SF_FORMAT_FLOAT) ||
+       mInfo.frames <= 0)
+      return {};
+   const auto format =
+      subtype == SF_FORMAT_PCM_16 ? int16Sample : floatSample;
+
+   const size_t nChannels = channels.size();
+   const size_t frameBytes = nChannels * SAMPLE_SIZE(format);
+   const auto totalFrames = sampleCount{ mInfo.frames };
+   if (totalFrames.as_double() * frameBytes >
+       double(std::numeric_limits<size_t>::max()))
+      return {};
+
+   const MappedFile file{ audacity::ToUTF8(mFilename) };
+   if (!file)
+      return {};
+   const auto samples = FindWAVSamples(file,
+      static_cast<size_t>(totalFrames.as_long_long()) * frameBytes);
+   if (!samples)
+      return {};
+
+   std::vector<WaveClip *> clips;
+   for (const auto &channel : channels)
+      clips.push_back(channel->RightmostOrNewClip());
+   auto cleanup = finally([&]{
+      for (const auto clip : clips) {
+         clip->UpdateEnvelopeTrackLen();
+         clip->MarkChanged();
+      }
+   });
+
+   // Each block is copied once from the mapping, taking one channel of the
+   // interleaved samples; there are no staging buffers, and the operating
+   // system reads ahead
+   auto updateResult = ProgressResult::Success;
+   sampleCount framesCompleted = 0;
+   while (framesCompleted < totalFrames) {
+      const auto len = limitSampleBufferSize(
+         clips[0]->GetSequence()->GetIdealAppendLen(),
+         totalFrames - framesCompleted);
+      const auto start = samples +
+         static_cast<size_t>(framesCompleted.as_long_long()) * frameBytes;
+      ChannelPool().ParallelFor(nChannels, [&](size_t c){
+         clips[c]->AppendNewBlock(start + c * SAMPLE_SIZE(format), format,
+            len, nChannels);
+      });
+      framesCompleted += len;
+
+      updateResult = progress(
+         framesCompleted.as_double() / totalFrames.as_double());
+      if (updateResult != ProgressResult::Success)
+         break;
    }
+   return updateResult;
+}
 
+ProgressResult PCMImportFileHandle::ImportSamples(
+   const NewChannelGroup &channels, const ImportProgress &progress)
+{
+   if (auto result = ImportMapped(channels, progress))
+      return *result;
+
+   const size_t nChannels = channels.size();
    auto fileTotalFrames =
       (sampleCount)mInfo.frames; // convert from sf_count_t
    auto maxBlockSize = channels.begin()->get()->GetMaxBlockSize();
-   auto updateResult = ProgressResult::Cancelled;
 
-   {
-      // Otherwise, we're in the "copy" mode, where we read in the actual
-      // samples from the file and store our own local copy of the
-      // samples in the tracks.
-
-      // PRL:  guard against excessive memory buffer allocation in case of many channels
-      using type = decltype(maxBlockSize);
-      if (mInfo.channels < 1)
-         return ProgressResult::Failed;
-      auto maxBlock = std::min(maxBlockSize,
-         std::numeric_limits<type>::max() /
-            (mInfo.channels * SAMPLE_SIZE(mFormat))
-      );
-      if (maxBlock < 1)
-         return ProgressResult::Failed;
-
-      SampleBuffer srcbuffer, buffer;
-      wxASSERT(mInfo.channels >= 0);
-      while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr() ||
-             NULL == buffer.Allocate(maxBlock, mFormat).ptr())
+   // PRL:  guard against excessive memory buffer allocation in case of many channels
+   using type = decltype(maxBlockSize);
+   auto maxBlock = std::min(maxBlockSize,
+      std::numeric_limits<type>::max() /
+         (nChannels * SAMPLE_SIZE(mFormat))
+   );
+   if (maxBlock < 1)
+      return ProgressResult::Failed;
+
+   // A few blocks circulate between a thread that decodes the file and
+   // this one, which appends the channels to their tracks in parallel,
+   // computing summaries and compressing; the database writer thread then
+   // stores the sample blocks
+   std::vector<DecodedBlock> blocks(4);
+   for (auto &block : blocks)
+      while (NULL ==
+             block.buffer.Allocate(maxBlock * nChannels, mFormat).ptr())
       {
          maxBlock /= 2;
          if (maxBlock < 1)
             return ProgressResult::Failed;
       }
 
-      decltype(fileTotalFrames) framescompleted = 0;
-
-      long block;
-      do {
-         block = maxBlock;
+   PipelineQueue<DecodedBlock> free, decoded;
+   for (auto &block : blocks)
+      free.Push(&block);
 
-         if (mFormat == int16Sample)
-            block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short *)srcbuffer.ptr(), block);
-         //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
-         else
-            block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float *)srcbuffer.ptr(), block);
+   std::atomic<bool> stopping{ false };
+   std::exception_ptr pException;
+   auto updateResult = ProgressResult::Success;
+   {
+      std::thread decodeThread{ [&]{
+         try {
+            while (!stopping.load(std::memory_order_relaxed)) {
+               const auto pBlock = free.Pop();
+               if (!pBlock)
+                  break;
 
-         if(block < 0 || block > (long)maxBlock) {
-            wxASSERT(false);
-            block = maxBlock;
-         }
+               long block = maxBlock;
+               if (mFormat == int16Sample)
+                  block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short *)pBlock->buffer.ptr(), block);
+               //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
+               else
+                  block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float *)pBlock->buffer.ptr(), block);
 
-         if (block) {
-            auto iter = channels.begin();
-            for(int c=0; c<mInfo.channels; ++iter, ++c) {
-               if (mFormat==int16Sample) {
-                  for(int j=0; j<block; j++)
-                     ((short *)buffer.ptr())[j] =
-                        ((short *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
-               else {
-                  for(int j=0; j<block; j++)
-                     ((float *)buffer.ptr())[j] =
-                        ((float *)srcbuffer.ptr())[mInfo.channels*j+c];
+               if(block < 0 || block > (long)maxBlock) {
+                  wxASSERT(false);
+                  block = maxBlock;
                }
+               if (block == 0)
+                  break;
 
-               iter->get()->Append(buffer.ptr(), (mFormat == int16Sample)?int16Sample:floatSample, block);
+               pBlock->frames = block;
+               decoded.Push(pBlock);
             }
-            framescompleted += block;
          }
+         catch (...) {
+            pException = std::current_exception();
+         }
+         decoded.Close();
+      } };
+      auto cleanup = finally([&]{
+         stopping.store(true, std::memory_order_relaxed);
+         free.Abort();
+         decoded.Abort();
+         decodeThread.join();
+      });
 
-         updateResult = mProgress->Update(
-            framescompleted.as_long_long(),
-            fileTotalFrames.as_long_long()
-         );
-         if (updateResult != ProgressResult::Success)
+      decltype(fileTotalFrames) framescompleted = 0;
+      while (true) {
+         bool timedOut = false;
+         // Wake now and then to keep the progress indicator responsive
+         const auto pBlock =
+            decoded.Pop(std::chrono::milliseconds{ 50 }, timedOut);
+         if (!pBlock && !timedOut)
             break;
 
-      } while (block > 0);
+         if (pBlock) {
+            const auto frames = pBlock->frames;
+            ChannelPool().ParallelFor(nChannels, [&](size_t c){
+               channels[c]->Append(
+                  pBlock->buffer.ptr() + c * SAMPLE_SIZE(mFormat), mFormat,
+                  frames, nChannels);
+            });
+            framescompleted += frames;
+            free.Push(pBlock);
+         }
+
+         updateResult = progress(fileTotalFrames > 0
+            ? framescompleted.as_double() / fileTotalFrames.as_double()
+            : 1.0);
+         if (updateResult != ProgressResult::Success)
+            break;
+      }
    }
+   if (pException)
+      std::rethrow_exception(pException);
+
+   return updateResult;
+}
+
+ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
+                                TrackHolders &outTracks,
+                                Tags *tags)
+{
+   outTracks.clear();
+
+   wxASSERT(mFile.get());
+
+   CreateProgress();
+
+   if (mInfo.channels < 1)
+      return ProgressResult::Failed;
+
+   auto channels = MakeChannels(*trackFactory);
+   auto updateResult = ImportSamples(channels, [this](double fraction){
+      return mProgress->Update(fraction, 1.0);
+   });
 
    if (updateResult == ProgressResult::Failed || updateResult == ProgressResult::Cancelled) {
       return updateResult;
@@ -391,6 +571,38 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
    if (!channels.empty())
       outTracks.push_back(std::move(channels));
 
+   ReadTags(tags);
+
+   return updateResult;
+}
+
+auto PCMImportFileHandle::PrepareBackgroundImport(
+   WaveTrackFactory *trackFactory, TrackHolders &outTracks, Tags *tags)
+   -> BackgroundImport
+{
+   outTracks.clear();
+
+   wxASSERT(mFile.get());
+
+   if (mInfo.channels < 1)
+      return {};
+
+   return [this, channels = MakeChannels(*trackFactory), &outTracks, tags]
+   (const ImportProgress &progress){
+      auto updateResult = ImportSamples(channels, progress);
+      if (updateResult == ProgressResult::Failed || updateResult == ProgressResult::Cancelled)
+         return updateResult;
+
+      for(const auto &channel : channels)
+         channel->Flush();
+      outTracks.push_back(channels);
+      ReadTags(tags);
+      return updateResult;
+   };
+}
+
+void PCMImportFileHandle::ReadTags(Tags *tags)
+{
    const char *str;
 
    str = sf_get_string(mFile.get(), SF_STR_TITLE);
@@ -580,8 +792,6 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
       }
    }
 #endif
-
-   return updateResult;
 }
 
 PCMImportFileHandle::~PCMImportFileHandle()
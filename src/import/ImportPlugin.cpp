@@ -51,6 +51,12 @@ void ImportFileHandle::CreateProgress()
       title, Verbatim( ff.GetFullName() ) );
 }
 
+auto ImportFileHandle::PrepareBackgroundImport(
+   WaveTrackFactory *, TrackHolders &, Tags *) -> BackgroundImport
+{
+   return {};
+}
+
 sampleFormat ImportFileHandle::ChooseFormat(sampleFormat effectiveFormat)
 {
    // Consult user preference
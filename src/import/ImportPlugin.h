@@ -47,6 +47,7 @@ but little else.
 
 
 
+#include <functional>
 #include <memory>
 #include "audacity/Types.h"
 #include "Identifier.h"
@@ -147,6 +148,24 @@ public:
    virtual ProgressResult Import(WaveTrackFactory *trackFactory, TrackHolders &outTracks,
                       Tags *tags) = 0;
 
+   //! Reports the fraction of the file imported; says whether to go on
+   using ImportProgress = std::function<ProgressResult(double fraction)>;
+   //! The rest of an import, which may run in any thread
+   using BackgroundImport =
+      std::function<ProgressResult(const ImportProgress &progress)>;
+
+   //! Alternative to Import(), so that several files may import at once
+   /*!
+    Do in the main thread what must be done there, such as creating the
+    tracks, and return the rest, which fills outTracks and tags as Import()
+    would and shows no dialogs.  The handle, outTracks and tags must outlive
+    the job.
+
+    The default returns null, and then Import() must be called instead.
+    */
+   virtual BackgroundImport PrepareBackgroundImport(
+      WaveTrackFactory *trackFactory, TrackHolders &outTracks, Tags *tags);
+
    //! Choose appropriate format, which will not be narrower than the specified one
    static sampleFormat ChooseFormat(sampleFormat effectiveFormat);
 
@@ -161,10 +161,11 @@ void DoImport(const CommandContext &context, bool isRaw)
                .AddImportedTracks(fileName, std::move(newTracks));
          }
       }
-      else {
-         ProjectFileManager::Get( project ).Import(fileName);
-      }
    }
+
+   if (!isRaw)
+      // Several files may import at once
+      ProjectFileManager::Get( project ).Import(selectedFiles);
 }
 
 }
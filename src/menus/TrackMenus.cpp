@@ -634,7 +634,6 @@ void OnResample(const CommandContext &context)
    auto &project = context.project;
    auto projectRate = ProjectRate::Get(project).GetRate();
    auto &tracks = TrackList::Get( project );
-   auto &undoManager = UndoManager::Get( project );
    auto &window = ProjectWindow::Get( project );
 
    int newRate;
@@ -705,33 +704,28 @@ void OnResample(const CommandContext &context)
          &window);
    }
 
-   int ndx = 0;
-   auto flags = UndoPush::NONE;
-   for (auto wt : tracks.Selected< WaveTrack >())
-   {
-      auto msg = XO("Resampling track %d").Format( ++ndx );
+   // Each leader resamples its other channels too
+   std::vector<WaveTrack*> leaders;
+   for (auto wt : tracks.SelectedLeaders< WaveTrack >())
+      leaders.push_back(wt);
 
+   if (!leaders.empty()) {
       using namespace BasicUI;
-      auto progress = MakeProgress(XO("Resample"), msg);
+      auto progress = MakeProgress(XO("Resample"),
+         XO("Resampling %d track(s)")
+            .Format( static_cast<int>(leaders.size()) ));
 
-      // The resampling of a track may be stopped by the user.  This might
-      // leave a track with multiple clips in a partially resampled state.
-      // But the thrown exception will cause rollback in the application
-      // level handler.
+      // The resampling may be stopped by the user, leaving all tracks
+      // unchanged; the thrown exception will cause rollback in the
+      // application level handler.
 
-       wt->Resample(newRate, progress.get());
-
-      // Each time a track is successfully, completely resampled,
-      // commit that to the undo stack.  The second and later times,
-      // consolidate.
+      // The clips of all the tracks are resampled at once, in several threads
+      WaveTrack::Resample(leaders, newRate, progress.get());
 
       ProjectHistory::Get( project ).PushState(
-         XO("Resampled audio track(s)"), XO("Resample Track"), flags);
-      flags = flags | UndoPush::CONSOLIDATE;
+         XO("Resampled audio track(s)"), XO("Resample Track"));
    }
 
-   undoManager.StopConsolidating();
-
    // Need to reset
    window.FinishAutoScroll();
 }
@@ -22,6 +22,7 @@
 
 #include "Prefs.h"
 #include "../ShuttleGui.h"
+#include "../import/Import.h"
 
 ImportExportPrefs::ImportExportPrefs(wxWindow * parent, wxWindowID winid)
 :   PrefsPanel(parent, winid, XO("Import / Export"))
@@ -108,6 +109,17 @@ void ImportExportPrefs::PopulateOrExchange(ShuttleGui & S)
    S.SetBorder(2);
    S.StartScroller();
 
+   S.StartStatic(XO("When importing several audio files"));
+   {
+      S.StartMultiColumn(2);
+      {
+         S.TieSpinCtrl(XXO("&Files at once:"),
+                       ImportMultipleFilesAtOnce, 64, 1);
+      }
+      S.EndMultiColumn();
+   }
+   S.EndStatic();
+
    S.StartStatic(XO("When exporting tracks to an audio file"));
    {
       // Bug 2692: Place button group in panel so tabbing will work and,
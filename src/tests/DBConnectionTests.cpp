@@ -0,0 +1,261 @@
+/*!********************************************************************
+
+ Audacity: A Digital Audio Editor
+
+ @file DBConnectionTests.cpp
+ @brief Tests of the deferred updates of DBConnection, alone and joining
+ transactions
+
+ **********************************************************************/
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "BasicUI.h"
+#include "DBConnection.h"
+#include "FileException.h"
+#include "Project.h"
+#include "TransactionScope.h"
+#include "sqlite3.h"
+
+namespace
+{
+//! A project with a connection to a new database file, removed after
+struct TestProject
+{
+   TestProject()
+   {
+      Remove();
+      auto &connectionPtr = ConnectionPtr::Get(*pProject);
+      connectionPtr.mpConnection = std::make_unique<DBConnection>(
+         pProject, std::make_shared<DBConnectionErrors>(), nullptr);
+      REQUIRE(connectionPtr.mpConnection->Open(path) == SQLITE_OK);
+      REQUIRE(sqlite3_exec(Connection().DB(),
+         "CREATE TABLE items (id INTEGER PRIMARY KEY);",
+         nullptr, nullptr, nullptr) == SQLITE_OK);
+   }
+
+   ~TestProject()
+   {
+      auto &connectionPtr = ConnectionPtr::Get(*pProject);
+      connectionPtr.mpConnection->Close();
+      connectionPtr.mpConnection.reset();
+      Remove();
+   }
+
+   DBConnection &Connection()
+   {
+      return *ConnectionPtr::Get(*pProject).mpConnection;
+   }
+
+   void Remove()
+   {
+      remove(path);
+      remove((std::string{ path } + "-wal").c_str());
+      remove((std::string{ path } + "-shm").c_str());
+   }
+
+   //! Count of rows, as another connection sees them, or this one
+   int Count(bool committed)
+   {
+      sqlite3 *db = Connection().DB();
+      if (committed)
+         sqlite3_open(path, &db);
+      sqlite3_stmt *stmt = nullptr;
+      sqlite3_prepare_v2(db,
+         "SELECT count(*) FROM items;", -1, &stmt, nullptr);
+      const int result =
+         sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : -1;
+      sqlite3_finalize(stmt);
+      if (committed)
+         sqlite3_close(db);
+      return result;
+   }
+
+   const char *const path = "DBConnectionTests.aup3";
+   const std::shared_ptr<AudacityProject> pProject =
+      std::make_shared<AudacityProject>();
+};
+
+//! Counts of calls of the functions given to DBConnection::Defer
+struct Counts
+{
+   std::atomic<int> updates{ 0 }, applied{ 0 }, reverted{ 0 };
+};
+
+//! Defer the insertion of a row; fail instead while *pFail
+void DeferInsert(DBConnection &connection, int id, Counts &counts,
+   const std::atomic<bool> *pFail = nullptr)
+{
+   connection.Defer(
+      [&connection, id, &counts, pFail]{
+         ++counts.updates;
+         if (pFail && *pFail)
+            return SQLITE_IOERR;
+         const auto sql =
+            "INSERT INTO items (id) VALUES (" + std::to_string(id) + ");";
+         return sqlite3_exec(
+            connection.DB(), sql.c_str(), nullptr, nullptr, nullptr);
+      },
+      [&counts]{ ++counts.applied; },
+      [&counts]{ ++counts.reverted; }
+   );
+}
+
+//! Wait for the writer thread
+template<typename Predicate> bool WaitFor(const Predicate &predicate)
+{
+   using namespace std::chrono;
+   const auto deadline = steady_clock::now() + 5s;
+   while (!predicate()) {
+      if (steady_clock::now() > deadline)
+         return false;
+      std::this_thread::sleep_for(1ms);
+   }
+   return true;
+}
+}
+
+TEST_CASE("DBConnection applies deferred updates", "[DBConnection]")
+{
+   TestProject project;
+   auto &connection = project.Connection();
+   Counts counts;
+
+   SECTION("None")
+   {
+      connection.FlushDeferred();
+      REQUIRE(project.Count(true) == 0);
+   }
+
+   SECTION("One")
+   {
+      DeferInsert(connection, 1, counts);
+      connection.FlushDeferred();
+      REQUIRE(counts.applied == 1);
+      REQUIRE(project.Count(true) == 1);
+   }
+
+   SECTION("More than the queue holds")
+   {
+      for (int id = 0; id < 1000; ++id)
+         DeferInsert(connection, id, counts);
+      connection.FlushDeferred();
+      REQUIRE(counts.updates == 1000);
+      REQUIRE(counts.applied == 1000);
+      REQUIRE(counts.reverted == 0);
+      REQUIRE(project.Count(true) == 1000);
+   }
+}
+
+TEST_CASE("DBConnection keeps a failed batch until a flush succeeds",
+   "[DBConnection]")
+{
+   TestProject project;
+   auto &connection = project.Connection();
+   Counts counts;
+   std::atomic<bool> fail{ true };
+
+   // Hold, so that the batch fails in this thread
+   {
+      DBConnection::DeferralHold hold{ connection };
+      DeferInsert(connection, 1, counts);
+      DeferInsert(connection, 2, counts, &fail);
+      REQUIRE_THROWS_AS(connection.FlushDeferred(), FileException);
+   }
+   // None of the batch is kept, nor applied by the writer meanwhile
+   REQUIRE(counts.applied == 0);
+   REQUIRE(project.Count(false) == 0);
+   REQUIRE_THROWS_AS(connection.FlushDeferred(), FileException);
+
+   fail = false;
+   connection.FlushDeferred();
+   REQUIRE(counts.applied == 2);
+   REQUIRE(project.Count(true) == 2);
+}
+
+TEST_CASE("DBConnection hands the writer's failure to the main thread",
+   "[DBConnection]")
+{
+   TestProject project;
+   auto &connection = project.Connection();
+   Counts counts;
+   std::atomic<bool> fail{ true };
+
+   DeferInsert(connection, 1, counts, &fail);
+   REQUIRE(WaitFor([&]{ return counts.updates > 0; }));
+   fail = false;
+
+   // The writer waits after failing, and only the flush enqueued for the
+   // main thread applies the update
+   REQUIRE(WaitFor([&]{ BasicUI::Yield(); return counts.applied > 0; }));
+   REQUIRE(project.Count(true) == 1);
+}
+
+TEST_CASE("DBConnection joins updates to an open transaction",
+   "[DBConnection]")
+{
+   TestProject project;
+   auto &connection = project.Connection();
+   Counts counts;
+
+   SECTION("and commits them with it")
+   {
+      TransactionScope trans{ *project.pProject, "Test" };
+      DeferInsert(connection, 1, counts);
+      // The writer applies it within the transaction, so that this
+      // connection reads it, but no other yet
+      REQUIRE(WaitFor([&]{ return counts.applied > 0; }));
+      REQUIRE(project.Count(false) == 1);
+      REQUIRE(project.Count(true) == 0);
+
+      // Commit flushes the rest
+      DeferInsert(connection, 2, counts);
+      REQUIRE(trans.Commit());
+      REQUIRE(counts.applied == 2);
+      REQUIRE(project.Count(true) == 2);
+      REQUIRE(counts.reverted == 0);
+   }
+
+   SECTION("and applies them again after a rollback")
+   {
+      DeferInsert(connection, 1, counts);
+      connection.FlushDeferred();
+      {
+         TransactionScope outer{ *project.pProject, "Outer" };
+         DeferInsert(connection, 2, counts);
+         REQUIRE(WaitFor([&]{ return counts.applied == 2; }));
+         {
+            TransactionScope inner{ *project.pProject, "Inner" };
+            DeferInsert(connection, 3, counts);
+            REQUIRE(WaitFor([&]{ return counts.applied == 3; }));
+            // Roll back the inner scope only
+         }
+         REQUIRE(counts.reverted == 1);
+         REQUIRE(project.Count(false) == 2);
+         REQUIRE(outer.Commit());
+      }
+      // Applied again at the commit of the outer scope
+      REQUIRE(counts.updates == 4);
+      REQUIRE(counts.applied == 4);
+      REQUIRE(project.Count(true) == 3);
+   }
+
+   SECTION("and applies them again after rolling back all")
+   {
+      {
+         TransactionScope trans{ *project.pProject, "Test" };
+         for (int id = 0; id < 10; ++id)
+            DeferInsert(connection, id, counts);
+         REQUIRE(WaitFor([&]{ return counts.applied == 10; }));
+      }
+      REQUIRE(counts.reverted == 10);
+      connection.FlushDeferred();
+      REQUIRE(counts.applied == 20);
+      REQUIRE(project.Count(true) == 10);
+   }
+}
@@ -92,7 +92,8 @@ bool GetWaveDisplay(const Sequence &sequence,
    const auto &blocks = sequence.GetBlockArray();
    unsigned nBlocks = blocks.size();
    const unsigned int block0 = sequence.FindBlock(s0);
-   for (unsigned int b = block0; b < nBlocks; ++b) {
+   auto iter = blocks.IteratorAt(block0);
+   for (unsigned int b = block0; b < nBlocks; ++b, ++iter) {
       if (b > block0)
          srcX = nextSrcX;
       if (srcX >= s1)
@@ -100,7 +101,7 @@ bool GetWaveDisplay(const Sequence &sequence,
 
       // Find the range of sample values for this block that
       // are in the display.
-      const SeqBlock &seqBlock = blocks[b];
+      const SeqBlock seqBlock = *iter;
       const auto start = seqBlock.start;
       nextSrcX = std::min(s1, start + seqBlock.sb->GetSampleCount());
 
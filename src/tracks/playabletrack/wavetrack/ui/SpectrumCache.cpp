@@ -10,9 +10,15 @@
 
 #include "SpectrumCache.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include "RealFFTf.h"
+#include "SampleBlock.h"
 #include "SampleTrackCache.h"
+#include "Sequence.h"
+#include "SpectrumScheduler.h"
 #include "../../../../prefs/SpectrogramSettings.h"
 #include "Spectrum.h"
 #include "WaveClipUtilities.h"
@@ -51,6 +57,8 @@ static void ComputeSpectrumUsingRealFFTf
    }
 }
 
+}
+
 void ComputeSpectrogramGainFactors
    (size_t fftLen, double rate, int frequencyGain, std::vector<float> &gainFactors)
 {
@@ -71,6 +79,141 @@ void ComputeSpectrogramGainFactors
    }
 }
 
+namespace {
+// Change when the stored spectra would be computed differently
+constexpr long long SpectraVersion = 1;
+// Stored spectra are in hundredths of dB
+constexpr float SpectraScale = 100.0f;
+}
+
+bool BlockSpectra::Applies(
+   const SpectrogramSettings &settings, double samplesPerPixel)
+{
+   return settings.algorithm == SpectrogramSettings::algSTFT &&
+      samplesPerPixel >= settings.WindowSize();
+}
+
+BlockSpectra::BlockSpectra(
+   const Sequence &sequence, const SpectrogramSettings &settings)
+   // The settings that determine the spectra, and not the gain
+   : mKey{ (long long)settings.WindowSize()
+      | (long long)settings.ZeroPaddingFactor() << 32
+      | (long long)settings.windowType << 40
+      | SpectraVersion << 56 }
+   , mWindowSize{ settings.WindowSize() }
+   , mNBins{ settings.NBins() }
+{
+   for (const auto &seqBlock : sequence.GetBlockArray()) {
+      const auto &sb = seqBlock.sb;
+      if (sb->CanStoreSpectra())
+         mBlocks.push_back({ sb, seqBlock.start, sb->GetSampleCount() });
+   }
+}
+
+BlockSpectra::~BlockSpectra() = default;
+
+auto BlockSpectra::FindFrame(sampleCount start) const -> std::optional<Frame>
+{
+   const auto middle = start + mWindowSize / 2;
+   auto iter = std::upper_bound(mBlocks.begin(), mBlocks.end(), middle,
+      [](sampleCount pos, const Block &block){ return pos < block.start; });
+   if (iter == mBlocks.begin())
+      return {};
+   auto &block = *--iter;
+   if (middle >= block.start + block.count)
+      return {};
+   const auto index =
+      (middle - block.start).as_size_t() / mWindowSize;
+   if ((index + 1) * mWindowSize > block.count)
+      return {};
+   return Frame{ size_t(iter - mBlocks.begin()), index,
+      block.start + index * mWindowSize };
+}
+
+void BlockSpectra::Load(Block &block)
+{
+   if (block.loaded)
+      return;
+   block.loaded = true;
+
+   // The layout of the blob:  the number of bins, then the index of each
+   // frame followed by its bins
+   std::vector<char> data;
+   if (!block.sb->GetSpectra(mKey, data))
+      return;
+   const auto frameBytes = sizeof(uint32_t) + mNBins * sizeof(int16_t);
+   uint32_t nBins;
+   if (data.size() < sizeof nBins)
+      return;
+   memcpy(&nBins, data.data(), sizeof nBins);
+   if (nBins != mNBins)
+      return;
+   std::vector<int16_t> values(mNBins);
+   for (auto pos = sizeof nBins; pos + frameBytes <= data.size();
+      pos += frameBytes) {
+      uint32_t index;
+      memcpy(&index, &data[pos], sizeof index);
+      memcpy(values.data(), &data[pos + sizeof index],
+         mNBins * sizeof(int16_t));
+      auto &spectrum = block.frames[index];
+      spectrum.resize(mNBins);
+      std::transform(values.begin(), values.end(), spectrum.begin(),
+         [](int16_t value){ return value / SpectraScale; });
+   }
+}
+
+bool BlockSpectra::Get(const Frame &frame, float *out)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   auto &block = mBlocks[frame.block];
+   Load(block);
+   auto iter = block.frames.find(frame.index);
+   if (iter == block.frames.end())
+      return false;
+   std::copy(iter->second.begin(), iter->second.end(), out);
+   return true;
+}
+
+void BlockSpectra::Put(const Frame &frame, const float *spectrum)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   auto &block = mBlocks[frame.block];
+   // Don't lose the stored frames when saving
+   Load(block);
+   block.frames[frame.index].assign(spectrum, spectrum + mNBins);
+   block.changed = true;
+}
+
+void BlockSpectra::Save()
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   std::vector<int16_t> values(mNBins);
+   for (auto &block : mBlocks) {
+      if (!block.changed)
+         continue;
+      block.changed = false;
+
+      std::vector<char> data;
+      const uint32_t nBins = mNBins;
+      data.reserve(sizeof nBins +
+         block.frames.size() * (sizeof(uint32_t) + mNBins * sizeof(int16_t)));
+      auto append = [&](const void *src, size_t bytes){
+         auto p = static_cast<const char *>(src);
+         data.insert(data.end(), p, p + bytes);
+      };
+      append(&nBins, sizeof nBins);
+      for (const auto &[index, spectrum] : block.frames) {
+         const uint32_t index32 = index;
+         append(&index32, sizeof index32);
+         std::transform(spectrum.begin(), spectrum.end(), values.begin(),
+            [](float value){
+               return (int16_t) std::clamp(
+                  std::lround(value * SpectraScale), -32768L, 32767L);
+            });
+         append(values.data(), mNBins * sizeof(int16_t));
+      }
+      block.sb->SetSpectra(mKey, std::move(data));
+   }
 }
 
 bool SpecCache::Matches
@@ -101,7 +244,8 @@ bool SpecCache::CalculateOneSpectrum
     double offset, double rate, double pixelsPerSecond,
     int lowerBoundX, int upperBoundX,
     const std::vector<float> &gainFactors,
-    float* __restrict scratch, float* __restrict out) const
+    float* __restrict scratch, float* __restrict out,
+    BlockSpectra *pSpectra) const
 {
    bool result = false;
    const bool reassignment =
@@ -140,7 +284,22 @@ bool SpecCache::CalculateOneSpectrum
       }
    }
    else {
-
+      // Maybe use the spectrum of a nearby window stored with the samples
+      std::optional<BlockSpectra::Frame> frame;
+      if (pSpectra && !autocorrelation && !reassignment &&
+          (frame = pSpectra->FindFrame(from - (windowSizeSetting >> 1)))) {
+         float *const results = &out[nBins * xx];
+         if (pSpectra->Get(*frame, results)) {
+            if (!gainFactors.empty()) {
+               // Apply a frequency-dependent gain factor
+               for (size_t ii = 0; ii < nBins; ++ii)
+                  results[ii] += gainFactors[ii];
+            }
+            return result;
+         }
+         // Compute that window instead, and store it
+         from = frame->start + (windowSizeSetting >> 1);
+      }
 
       // We can avoid copying memory when ComputeSpectrum is used below
       bool copy = !autocorrelation || (padding > 0) || reassignment;
@@ -307,6 +466,8 @@ bool SpecCache::CalculateOneSpectrum
          // This function mutates useBuffer
          ComputeSpectrumUsingRealFFTf
             (useBuffer, settings.hFFT.get(), settings.window.get(), fftLen, results);
+         if (frame)
+            pSpectra->Put(*frame, results);
          if (!gainFactors.empty()) {
             // Apply a frequency-dependent gain factor
             for (size_t ii = 0; ii < nBins; ++ii)
@@ -345,7 +506,8 @@ void SpecCache::Populate
    (const SpectrogramSettings &settings, SampleTrackCache &waveTrackCache,
     int copyBegin, int copyEnd, size_t numPixels,
     sampleCount numSamples,
-    double offset, double rate, double pixelsPerSecond)
+    double offset, double rate, double pixelsPerSecond,
+    BlockSpectra *pSpectra)
 {
    const int &frequencyGainSetting = settings.frequencyGain;
    const size_t windowSizeSetting = settings.WindowSize();
@@ -407,7 +569,7 @@ void SpecCache::Populate
             settings, cache, xx, numSamples,
             offset, rate, pixelsPerSecond,
             lowerBoundX, upperBoundX,
-            gainFactors, buffer, &freq[0]);
+            gainFactors, buffer, &freq[0], pSpectra);
       }
 
       if (reassignment) {
@@ -471,7 +633,8 @@ bool WaveClipSpectrumCache::GetSpectrogram(const WaveClip &clip,
    const float *& spectrogram,
    const sampleCount *& where,
    size_t numPixels,
-   double t0, double pixelsPerSecond)
+   double t0, double pixelsPerSecond,
+   std::function<void()> notify)
 {
    t0 += clip.GetTrimLeft();
 
@@ -482,13 +645,48 @@ bool WaveClipSpectrumCache::GetSpectrogram(const WaveClip &clip,
 
    //Trim offset comparison failure forces spectrogram cache rebuild
    //and skip copying "unchanged" data after clip border was trimmed.
-   bool match =
-      mSpecCache &&
-      mSpecCache->leftTrim == clip.GetTrimLeft() &&
-      mSpecCache->rightTrim == clip.GetTrimRight() &&
-      mSpecCache->len > 0 &&
-      mSpecCache->Matches
-      (mDirty, pixelsPerSecond, settings, rate);
+   const auto matches = [&](const SpecCache &specCache){
+      return
+         specCache.leftTrim == clip.GetTrimLeft() &&
+         specCache.rightTrim == clip.GetTrimRight() &&
+         specCache.len > 0 &&
+         specCache.Matches(mDirty, pixelsPerSecond, settings, rate);
+   };
+
+   bool taken = false;
+   if (mpJob) {
+      const auto stage = mpJob->GetStage();
+      if (stage == SpectrumJob::Done) {
+         // Finished, even if no longer wanted as it is; perhaps some of it
+         // can be reused below
+         mSpecCache = mpJob->TakeCache();
+         mpJob.reset();
+         taken = true;
+      }
+      else if (matches(mpJob->GetCache()) &&
+         mpJob->GetCache().start == t0 &&
+         mpJob->GetCache().len >= numPixels) {
+         // Still wanted; show the progress, if any
+         bool updated = false;
+         if (stage == SpectrumJob::Coarse &&
+             mShownStage == SpectrumJob::Queued) {
+            mpJob->UpdatePreview(*mSpecCache);
+            mShownStage = stage;
+            updated = true;
+         }
+         spectrogram = &mSpecCache->freq[0];
+         where = &mSpecCache->where[0];
+         return updated;
+      }
+      else {
+         // The preview is no good for anything else
+         mpJob->Abandon();
+         mpJob.reset();
+         mSpecCache = std::make_unique<SpecCache>();
+      }
+   }
+
+   bool match = mSpecCache && matches(*mSpecCache);
 
    if (match &&
        mSpecCache->start == t0 &&
@@ -496,7 +694,7 @@ bool WaveClipSpectrumCache::GetSpectrogram(const WaveClip &clip,
       spectrogram = &mSpecCache->freq[0];
       where = &mSpecCache->where[0];
 
-      return false;  //hit cache completely
+      return taken;  //hit cache completely
    }
 
    // Caching is not implemented for reassignment, unless for
@@ -576,10 +774,37 @@ bool WaveClipSpectrumCache::GetSpectrogram(const WaveClip &clip,
    fillWhere(mSpecCache->where, numPixels, 0.5, correction,
       t0, rate, samplesPerPixel);
 
-   mSpecCache->Populate
-      (settings, waveTrackCache, copyBegin, copyEnd, numPixels,
-       clip.GetSequenceSamplesCount(),
-       clip.GetSequenceStartTime(), rate, pixelsPerSecond);
+   std::shared_ptr<BlockSpectra> pSpectra;
+   if (BlockSpectra::Applies(settings, samplesPerPixel)) {
+      pSpectra = std::make_shared<BlockSpectra>(*clip.GetSequence(), settings);
+      if (pSpectra->empty())
+         pSpectra.reset();
+   }
+
+   const auto nDirty = numPixels - std::max(0, copyEnd - copyBegin);
+   if (!notify || nDirty <= SpectrumJob::MaxImmediateColumns) {
+      // As when scrolling; quicker done than delegated
+      mSpecCache->Populate
+         (settings, waveTrackCache, copyBegin, copyEnd, numPixels,
+          clip.GetSequenceSamplesCount(),
+          clip.GetSequenceStartTime(), rate, pixelsPerSecond,
+          pSpectra.get());
+      if (pSpectra)
+         pSpectra->Save();
+   }
+   else {
+      mSpecCache->dirty = mDirty;
+      mpJob = std::make_shared<SpectrumJob>(std::move(mSpecCache),
+         settings, std::make_shared<const WaveTrack>(*track),
+         std::move(pSpectra),
+         copyBegin, copyEnd, numPixels,
+         clip.GetSequenceSamplesCount(),
+         clip.GetSequenceStartTime(), rate, pixelsPerSecond,
+         std::move(notify));
+      mSpecCache = mpJob->MakePreview();
+      mShownStage = SpectrumJob::Queued;
+      SpectrumScheduler::Get().Submit(mpJob);
+   }
 
    mSpecCache->dirty = mDirty;
    spectrogram = &mSpecCache->freq[0];
@@ -596,6 +821,8 @@ WaveClipSpectrumCache::WaveClipSpectrumCache()
 
 WaveClipSpectrumCache::~WaveClipSpectrumCache()
 {
+   if (mpJob)
+      mpJob->Abandon();
 }
 
 static WaveClip::Caches::RegisteredFactory sKeyS{ []( WaveClip& ){
@@ -616,5 +843,9 @@ void WaveClipSpectrumCache::MarkChanged()
 void WaveClipSpectrumCache::Invalidate()
 {
    // Invalidate the spectrum display cache
+   if (mpJob) {
+      mpJob->Abandon();
+      mpJob.reset();
+   }
    mSpecCache = std::make_unique<SpecCache>();
 }
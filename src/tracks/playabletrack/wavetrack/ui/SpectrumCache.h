@@ -11,16 +11,95 @@
 #ifndef __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 #define __AUDACITY_WAVECLIP_SPECTRUM_CACHE__
 
-class sampleCount;
+class SampleBlock;
+class Sequence;
 class SpectrogramSettings;
 class SampleTrackCache;
+class SpectrumJob;
 
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
 #include <vector>
 #include "MemoryX.h"
+#include "SampleCount.h"
 #include "WaveClip.h" // to inherit WaveClipListener
 
 using Floats = ArrayOf<float>;
 
+//! Gains in dB to add to the bins of each column, or none if frequencyGain
+//! is zero
+AUDACITY_DLL_API
+void ComputeSpectrogramGainFactors(
+   size_t fftLen, double rate, int frequencyGain,
+   std::vector<float> &gainFactors);
+
+//! Spectra of windows of samples that lie within single sample blocks,
+//! which are stored in the project file with the blocks
+/*!
+ Windows start at multiples of the window size from the start of a block.
+ When a column of a spectrogram is at least a window wide, it uses the
+ window nearest to its own, which is less than half a column away.  So
+ columns of far zoomed out spectrograms reuse the spectra computed before,
+ even in an earlier session.  Blocks never change, so the spectra never
+ become stale.
+
+ Spectra are kept without the frequency dependent gain.
+
+ Methods are thread-safe, except as noted.
+ */
+class AUDACITY_DLL_API BlockSpectra {
+public:
+   //! Whether columns of so many samples may use stored spectra
+   static bool Applies(
+      const SpectrogramSettings &settings, double samplesPerPixel);
+
+   //! Copies the list of the blocks of the sequence that can store spectra
+   /*! Call only in the main thread */
+   BlockSpectra(const Sequence &sequence, const SpectrogramSettings &settings);
+   ~BlockSpectra();
+
+   //! Whether no block can store spectra
+   bool empty() const { return mBlocks.empty(); }
+
+   struct Frame {
+      size_t block;
+      size_t index;
+      //! First sample of the window, relative to the sequence
+      sampleCount start;
+   };
+   //! The window within one block that is nearest the window beginning at
+   //! start, if less than half a window away
+   std::optional<Frame> FindFrame(sampleCount start) const;
+
+   //! Copy the spectrum of the frame into out, if it is known
+   bool Get(const Frame &frame, float *out);
+   void Put(const Frame &frame, const float *spectrum);
+
+   //! Store the spectra put since construction
+   /*! Call only in the main thread */
+   void Save();
+
+private:
+   struct Block {
+      std::shared_ptr<SampleBlock> sb;
+      sampleCount start;
+      size_t count;
+      // Guarded by mMutex:
+      bool loaded{ false };
+      bool changed{ false };
+      std::map<size_t, std::vector<float>> frames;
+   };
+   void Load(Block &block);
+
+   const long long mKey;
+   const size_t mWindowSize;
+   const size_t mNBins;
+   std::vector<Block> mBlocks;
+   std::mutex mMutex;
+};
+
 class AUDACITY_DLL_API SpecCache {
 public:
 
@@ -51,7 +130,8 @@ public:
        int lowerBoundX, int upperBoundX,
        const std::vector<float> &gainFactors,
        float* __restrict scratch,
-       float* __restrict out) const;
+       float* __restrict out,
+       BlockSpectra *pSpectra = nullptr) const;
 
    // Grow the cache while preserving the (possibly now invalid!) contents
    void Grow(size_t len_, const SpectrogramSettings& settings,
@@ -62,7 +142,8 @@ public:
       (const SpectrogramSettings &settings, SampleTrackCache &waveTrackCache,
        int copyBegin, int copyEnd, size_t numPixels,
        sampleCount numSamples,
-       double offset, double rate, double pixelsPerSecond);
+       double offset, double rate, double pixelsPerSecond,
+       BlockSpectra *pSpectra = nullptr);
 
    size_t       len { 0 }; // counts pixels, not samples
    int          algorithm;
@@ -113,17 +194,30 @@ struct WaveClipSpectrumCache final : WaveClipListener
    std::unique_ptr<SpecCache> mSpecCache;
    int mDirty { 0 };
 
+   //! Computes the columns of a future mSpecCache in other threads, while
+   //! mSpecCache holds a preview
+   std::shared_ptr<SpectrumJob> mpJob;
+   //! Stage of mpJob that the preview last showed
+   int mShownStage { 0 };
+
    static WaveClipSpectrumCache &Get( const WaveClip &clip );
 
    void MarkChanged() override; // NOFAIL-GUARANTEE
    void Invalidate() override; // NOFAIL-GUARANTEE
 
    /** Getting high-level data for screen display */
+   /*!
+    @param notify if not empty, many columns may be computed in other
+    threads, with a preview given meanwhile; notify is called in the main
+    thread when there is more to show, and then this should be called again
+    @return whether the results differ from those of the previous call
+    */
    bool GetSpectrogram(const WaveClip &clip, SampleTrackCache &cache,
                        const float *& spectrogram,
                        const sampleCount *& where,
                        size_t numPixels,
-                       double t0, double pixelsPerSecond);
+                       double t0, double pixelsPerSecond,
+                       std::function<void()> notify = {});
 };
 
 #endif
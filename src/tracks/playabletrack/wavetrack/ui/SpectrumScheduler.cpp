@@ -0,0 +1,269 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SpectrumScheduler.cpp
+
+*******************************************************************/
+
+#include "SpectrumScheduler.h"
+
+#include <algorithm>
+#include <cstring>
+#include "BasicUI.h"
+#include "SampleTrackCache.h"
+#include "SpectrumCache.h"
+#include "WaveTrack.h"
+
+namespace {
+//! Columns computed by one task
+constexpr size_t ChunkSize = 16;
+//! Shown where nothing is computed yet; the value used for zero power
+constexpr float LeastPower = -160.0f;
+}
+
+SpectrumJob::SpectrumJob(std::unique_ptr<SpecCache> pCache,
+   const SpectrogramSettings &settings,
+   std::shared_ptr<const WaveTrack> pTrack,
+   std::shared_ptr<BlockSpectra> pSpectra,
+   int copyBegin, int copyEnd, size_t numPixels,
+   sampleCount numSamples, double offset, double rate,
+   double pixelsPerSecond, std::function<void()> notify)
+   : mpCache{ std::move(pCache) }
+   , mSettings{ settings }
+   , mpTrack{ std::move(pTrack) }
+   , mpSpectra{ std::move(pSpectra) }
+   , mCopyBegin{ copyBegin }, mCopyEnd{ copyEnd }
+   , mNumPixels{ numPixels }
+   , mNumSamples{ numSamples }
+   , mOffset{ offset }, mRate{ rate }, mPixelsPerSecond{ pixelsPerSecond }
+   , mNotify{ std::move(notify) }
+   , mReassignment{
+      settings.algorithm == SpectrogramSettings::algReassignment }
+{
+   // The copy of the settings has its own FFT tables, which the worker
+   // threads share
+   mSettings.CacheWindows();
+
+   if (mReassignment)
+      // Populate() does all, in one task
+      return;
+
+   if (settings.algorithm != SpectrogramSettings::algPitchEAC)
+      ComputeSpectrogramGainFactors(FFTLength(),
+         rate, mSettings.frequencyGain, mGainFactors);
+
+   // The same ranges as in SpecCache::Populate(), one possibly empty
+   for (int jj = 0; jj < 2; ++jj) {
+      const int lowerBoundX = jj == 0 ? 0 : copyEnd;
+      const int upperBoundX = jj == 0 ? copyBegin : numPixels;
+      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx)
+         ((xx - lowerBoundX) % CoarseStride == 0
+            ? mCoarseColumns : mFineColumns).push_back(xx);
+   }
+}
+
+SpectrumJob::~SpectrumJob() = default;
+
+std::unique_ptr<SpecCache> SpectrumJob::MakePreview() const
+{
+   // Called before any worker thread writes into the cache
+   wxASSERT(GetStage() == Queued);
+   auto pPreview = std::make_unique<SpecCache>(*mpCache);
+   const auto nBins = mSettings.NBins();
+   auto &freq = pPreview->freq;
+   std::fill(freq.begin(), freq.begin() + nBins * mCopyBegin, LeastPower);
+   std::fill(freq.begin() + nBins * mCopyEnd,
+      freq.begin() + nBins * mNumPixels, LeastPower);
+   return pPreview;
+}
+
+void SpectrumJob::UpdatePreview(SpecCache &preview) const
+{
+   // Only the columns of the first pass are read, which no thread writes
+   // any more
+   wxASSERT(GetStage() >= Coarse);
+   const auto nBins = mSettings.NBins();
+   const float *const src = &mpCache->freq[0];
+   float *const dst = &preview.freq[0];
+   for (int jj = 0; jj < 2; ++jj) {
+      const int lowerBoundX = jj == 0 ? 0 : mCopyEnd;
+      const int upperBoundX = jj == 0 ? mCopyBegin : mNumPixels;
+      for (auto xx = lowerBoundX; xx < upperBoundX; ++xx) {
+         const auto from = xx - (xx - lowerBoundX) % CoarseStride;
+         memcpy(dst + nBins * xx, src + nBins * from, nBins * sizeof(float));
+      }
+   }
+}
+
+std::unique_ptr<SpecCache> SpectrumJob::TakeCache()
+{
+   wxASSERT(GetStage() == Done);
+   Release();
+   return std::move(mpCache);
+}
+
+void SpectrumJob::Abandon()
+{
+   {
+      std::unique_lock<std::mutex> lock{ mMutex };
+      mAbandoned = true;
+      mIdle.wait(lock, [this]{ return mRunning == 0; });
+   }
+   mpTrack.reset();
+   mpSpectra.reset();
+}
+
+void SpectrumJob::Release()
+{
+   if (mpSpectra) {
+      mpSpectra->Save();
+      mpSpectra.reset();
+   }
+   mpTrack.reset();
+}
+
+size_t SpectrumJob::CountTasks(Stage pass) const
+{
+   if (mReassignment)
+      return pass == Done ? 1 : 0;
+   const auto &columns = (pass == Coarse) ? mCoarseColumns : mFineColumns;
+   return (columns.size() + ChunkSize - 1) / ChunkSize;
+}
+
+void SpectrumJob::DoTask(Stage pass, size_t index) noexcept
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      if (mAbandoned)
+         return;
+      ++mRunning;
+   }
+
+   try {
+      if (mReassignment) {
+         SampleTrackCache cache{ mpTrack };
+         mpCache->Populate(mSettings, cache, mCopyBegin, mCopyEnd,
+            mNumPixels, mNumSamples, mOffset, mRate, mPixelsPerSecond);
+      }
+      else {
+         const auto &columns =
+            (pass == Coarse) ? mCoarseColumns : mFineColumns;
+         const auto begin = index * ChunkSize;
+         Compute(columns, begin, std::min(columns.size(), begin + ChunkSize));
+      }
+   }
+   catch (...) {
+      // As in drawing, which this serves, don't let failure stop anything;
+      // the columns are left as they were
+   }
+
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      if (--mRunning == 0)
+         mIdle.notify_all();
+   }
+}
+
+size_t SpectrumJob::FFTLength() const
+{
+   return mSettings.WindowSize() * mSettings.ZeroPaddingFactor();
+}
+
+void SpectrumJob::Compute(
+   const std::vector<int> &columns, size_t begin, size_t end)
+{
+   SampleTrackCache cache{ mpTrack };
+   std::vector<float> scratch(FFTLength());
+   for (auto ii = begin; ii < end; ++ii)
+      mpCache->CalculateOneSpectrum(mSettings, cache, columns[ii],
+         mNumSamples, mOffset, mRate, mPixelsPerSecond,
+         0, mNumPixels, mGainFactors, scratch.data(), &mpCache->freq[0],
+         mpSpectra.get());
+}
+
+void SpectrumJob::Finish(Stage pass)
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      if (mAbandoned)
+         return;
+   }
+   if (CountTasks(pass) == 0 && pass != Done)
+      // Nothing new to show
+      return;
+
+   mStage.store(pass, std::memory_order_release);
+   BasicUI::CallAfter([wJob = weak_from_this(), pass]{
+      if (auto pJob = wJob.lock()) {
+         {
+            std::lock_guard<std::mutex> lock{ pJob->mMutex };
+            if (pJob->mAbandoned)
+               return;
+         }
+         if (pass == Done)
+            // No other thread reads the copy now
+            pJob->Release();
+         if (pJob->mNotify)
+            pJob->mNotify();
+      }
+   });
+}
+
+SpectrumScheduler &SpectrumScheduler::Get()
+{
+   static SpectrumScheduler instance;
+   return instance;
+}
+
+SpectrumScheduler::SpectrumScheduler()
+   : mThread{ [this]{ Run(); } }
+{
+}
+
+SpectrumScheduler::~SpectrumScheduler()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStop = true;
+   }
+   mCondition.notify_one();
+   mThread.join();
+}
+
+void SpectrumScheduler::Submit(std::shared_ptr<SpectrumJob> pJob)
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mQueue.push_back(std::move(pJob));
+   }
+   mCondition.notify_one();
+}
+
+void SpectrumScheduler::Run()
+{
+   while (true) {
+      std::vector<std::shared_ptr<SpectrumJob>> jobs;
+      {
+         std::unique_lock<std::mutex> lock{ mMutex };
+         mCondition.wait(lock, [this]{ return mStop || !mQueue.empty(); });
+         if (mStop)
+            return;
+         jobs.swap(mQueue);
+      }
+
+      for (auto pass : { SpectrumJob::Coarse, SpectrumJob::Done }) {
+         // Number the tasks of all jobs together, so that the threads
+         // spread over all clips
+         std::vector<std::pair<SpectrumJob*, size_t>> tasks;
+         for (auto &pJob : jobs)
+            for (size_t ii = 0, nn = pJob->CountTasks(pass); ii < nn; ++ii)
+               tasks.emplace_back(pJob.get(), ii);
+         mPool.ParallelFor(tasks.size(), [&](size_t ii){
+            tasks[ii].first->DoTask(pass, tasks[ii].second);
+         });
+         for (auto &pJob : jobs)
+            pJob->Finish(pass);
+      }
+   }
+}
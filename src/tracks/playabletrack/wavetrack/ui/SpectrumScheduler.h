@@ -0,0 +1,161 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SpectrumScheduler.h
+
+  Computation of spectrogram caches in worker threads, for all clips
+  that need them at once
+
+*******************************************************************/
+
+#ifndef __AUDACITY_SPECTRUM_SCHEDULER__
+#define __AUDACITY_SPECTRUM_SCHEDULER__
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SampleCount.h"
+#include "ThreadPool.h"
+#include "../../../../prefs/SpectrogramSettings.h"
+
+class BlockSpectra;
+class SpecCache;
+class WaveTrack;
+
+//! Fills the columns of one SpecCache that were not copied from an older one
+/*!
+ Columns are computed in two passes:  first every CoarseStride-th column,
+ then the rest.  After each pass, the notification passed to the
+ constructor is called in the main thread.
+
+ The job reads its own copy of the track, which shares the sample blocks,
+ so that the track may be edited meanwhile.  It is released in the main
+ thread, where any new spectra for BlockSpectra are also saved.
+ */
+class SpectrumJob final
+   : public std::enable_shared_from_this<SpectrumJob>
+{
+public:
+   enum Stage : int {
+      Queued,
+      //! Every CoarseStride-th column is computed
+      Coarse,
+      //! All columns are computed
+      Done,
+   };
+
+   //! Spacing of the columns of the first pass
+   static constexpr int CoarseStride = 8;
+   //! Not worth a job; compute so few columns at once in the main thread
+   static constexpr size_t MaxImmediateColumns = 64;
+
+   //! Columns [copyBegin, copyEnd) of *pCache are already correct
+   SpectrumJob(std::unique_ptr<SpecCache> pCache,
+      const SpectrogramSettings &settings,
+      std::shared_ptr<const WaveTrack> pTrack,
+      std::shared_ptr<BlockSpectra> pSpectra,
+      int copyBegin, int copyEnd, size_t numPixels,
+      sampleCount numSamples, double offset, double rate,
+      double pixelsPerSecond, std::function<void()> notify);
+   ~SpectrumJob();
+
+   //! The fields other than freq may be examined at any time
+   const SpecCache &GetCache() const { return *mpCache; }
+
+   Stage GetStage() const { return mStage.load(std::memory_order_acquire); }
+
+   //! Copy of the cache for display, showing least power in the columns
+   //! not yet computed
+   /*! Call only in the main thread, before submitting the job */
+   std::unique_ptr<SpecCache> MakePreview() const;
+
+   //! Fill each column of the preview not yet computed from the nearest
+   //! column to its left that the first pass computed
+   /*! Call only in the main thread, at stage Coarse or later */
+   void UpdatePreview(SpecCache &preview) const;
+
+   //! Give up the results
+   /*! Call only in the main thread, at stage Done */
+   std::unique_ptr<SpecCache> TakeCache();
+
+   //! Skip the remaining work, wait for any that is in progress in other
+   //! threads, and release the copy of the track, saving nothing
+   /*! Call only in the main thread */
+   void Abandon();
+
+private:
+   friend class SpectrumScheduler;
+
+   size_t CountTasks(Stage pass) const;
+   void DoTask(Stage pass, size_t index) noexcept;
+   //! Publish the stage and notify, unless abandoned
+   void Finish(Stage pass);
+   //! Save new spectra and release what the other threads read
+   /*! Call only in the main thread */
+   void Release();
+
+   size_t FFTLength() const;
+   //! Compute columns [begin, end) of the pass
+   void Compute(const std::vector<int> &columns, size_t begin, size_t end);
+
+   std::unique_ptr<SpecCache> mpCache;
+   const SpectrogramSettings mSettings;
+   std::shared_ptr<const WaveTrack> mpTrack;
+   //! May be null
+   std::shared_ptr<BlockSpectra> mpSpectra;
+   const int mCopyBegin, mCopyEnd;
+   const size_t mNumPixels;
+   const sampleCount mNumSamples;
+   const double mOffset, mRate, mPixelsPerSecond;
+   const std::function<void()> mNotify;
+   const bool mReassignment;
+
+   std::vector<float> mGainFactors;
+   //! Columns of the first and second passes
+   std::vector<int> mCoarseColumns, mFineColumns;
+
+   std::atomic<Stage> mStage{ Queued };
+
+   std::mutex mMutex;
+   std::condition_variable mIdle;
+   // Guarded by mMutex:
+   bool mAbandoned{ false };
+   //! How many threads are in DoTask()
+   size_t mRunning{ 0 };
+};
+
+//! Runs SpectrumJob objects in a ThreadPool
+/*!
+ Jobs submitted while others are running wait for the current batch to
+ finish.  Within a batch, the first passes of all jobs complete before any
+ second pass begins, so every clip gets a rough picture quickly.
+ */
+class SpectrumScheduler final
+{
+public:
+   static SpectrumScheduler &Get();
+
+   ~SpectrumScheduler();
+
+   void Submit(std::shared_ptr<SpectrumJob> pJob);
+
+private:
+   SpectrumScheduler();
+   void Run();
+
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   std::vector<std::shared_ptr<SpectrumJob>> mQueue;
+   bool mStop{ false };
+
+   ThreadPool mPool;
+   std::thread mThread;
+};
+
+#endif
@@ -28,6 +28,7 @@ Paul Licameli split from WaveTrackView.cpp
 #include "NumberScale.h"
 #include "../../../../TrackArt.h"
 #include "../../../../TrackArtist.h"
+#include "../../../../TrackPanel.h"
 #include "../../../../TrackPanelDrawingContext.h"
 #include "ViewInfo.h"
 #include "../../../../WaveClip.h"
@@ -38,6 +39,7 @@ Paul Licameli split from WaveTrackView.cpp
 
 #include <wx/dcmemory.h>
 #include <wx/graphics.h>
+#include <wx/weakref.h>
 
 #include "float_cast.h"
 
@@ -415,10 +417,12 @@ void DrawClipSpectrum(TrackPanelDrawingContext &context,
    bool updated;
    {
       const double pps = averagePixelsPerSample * rate;
+      // Draw again as the columns computed in other threads arrive
+      wxWeakRef<TrackPanel> pPanel{ artist->parent };
       updated = WaveClipSpectrumCache::Get( *clip ).GetSpectrogram( *clip,
          waveTrackCache, freq, where,
          (size_t)hiddenMid.width,
-         t0, pps);
+         t0, pps, [pPanel]{ if (pPanel) pPanel->Refresh(false); });
    }
    auto nBins = settings.NBins();
 
@@ -0,0 +1,176 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SummaryPyramid.cpp
+
+*******************************************************************/
+
+#include "SummaryPyramid.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "Sequence.h"
+
+WaveClipSummaryPyramid::WaveClipSummaryPyramid() = default;
+
+WaveClipSummaryPyramid::~WaveClipSummaryPyramid() = default;
+
+static WaveClip::Caches::RegisteredFactory sKeyP{ []( WaveClip& ){
+   return std::make_unique< WaveClipSummaryPyramid >();
+} };
+
+WaveClipSummaryPyramid &WaveClipSummaryPyramid::Get( const WaveClip &clip )
+{
+   return const_cast< WaveClip& >( clip ) // Consider it mutable data
+      .Caches::Get< WaveClipSummaryPyramid >( sKeyP );
+}
+
+void WaveClipSummaryPyramid::MarkChanged()
+{
+   // Defer the comparison of blocks until the next drawing
+   mDirty = true;
+}
+
+void WaveClipSummaryPyramid::Invalidate()
+{
+   mStarts.clear();
+   mBlockIDs.clear();
+   mLevels.clear();
+   mNumSamples = 0;
+   mDirty = true;
+}
+
+bool WaveClipSummaryPyramid::Applies(
+   const Sequence &sequence, double samplesPerPixel)
+{
+   // Narrower columns may fall within one block; the 64k summaries of the
+   // blocks serve them better
+   return samplesPerPixel >= sequence.GetMaxBlockSize();
+}
+
+void WaveClipSummaryPyramid::Update(const Sequence &sequence)
+{
+   if (!mDirty)
+      return;
+
+   const auto &blocks = sequence.GetBlockArray();
+   const auto nBlocks = blocks.size();
+
+   // Keep the nodes for the unchanged leading blocks
+   size_t first = 0;
+   const auto nKept = std::min(nBlocks, mStarts.size());
+   for (auto iter = blocks.begin(); first < nKept; ++iter, ++first) {
+      const auto block = *iter;
+      if (mStarts[first] != block.start ||
+         mBlockIDs[first] != block.sb->GetBlockID())
+         break;
+   }
+
+   mStarts.resize(nBlocks);
+   mBlockIDs.resize(nBlocks);
+   if (mLevels.empty())
+      mLevels.emplace_back();
+   auto &leaves = mLevels[0];
+   leaves.resize(nBlocks);
+   auto iter = blocks.IteratorAt(first);
+   for (auto ii = first; ii < nBlocks; ++ii, ++iter) {
+      const auto block = *iter;
+      mStarts[ii] = block.start;
+      mBlockIDs[ii] = block.sb->GetBlockID();
+      // In memory; no database access.  Don't throw for display.
+      const auto results = block.sb->GetMinMaxRMS(false);
+      const double rms = results.RMS;
+      leaves[ii] = { results.min, results.max,
+         rms * rms * block.sb->GetSampleCount() };
+   }
+
+   // Recompute the nodes above the changed leaves
+   size_t level = 0;
+   while (mLevels[level].size() > 1) {
+      const auto &below = mLevels[level];
+      if (mLevels.size() == level + 1)
+         mLevels.emplace_back();
+      auto &above = mLevels[level + 1];
+      above.resize((below.size() + 3) / 4);
+      first /= 4;
+      for (auto ii = first; ii < above.size(); ++ii) {
+         const auto begin = below.begin() + 4 * ii;
+         const auto end = below.begin() + std::min(below.size(), 4 * ii + 4);
+         Node node{ FLT_MAX, -FLT_MAX, 0.0 };
+         std::for_each(begin, end, [&](const Node &child){
+            node.min = std::min(node.min, child.min);
+            node.max = std::max(node.max, child.max);
+            node.sumsq += child.sumsq;
+         });
+         above[ii] = node;
+      }
+      ++level;
+   }
+   mLevels.resize(level + 1);
+
+   mNumSamples = sequence.GetNumSamples();
+   mDirty = false;
+}
+
+auto WaveClipSummaryPyramid::Accumulate(size_t begin, size_t end) const
+   -> Node
+{
+   Node result{ FLT_MAX, -FLT_MAX, 0.0 };
+   for (auto ii = begin; ii < end;) {
+      // Climb as long as ii begins a node lying wholly in the range
+      size_t level = 0, span = 1;
+      while (level + 1 < mLevels.size() &&
+         ii % (4 * span) == 0 && ii + 4 * span <= end)
+         ++level, span *= 4;
+      const auto &node = mLevels[level][ii / span];
+      result.min = std::min(result.min, node.min);
+      result.max = std::max(result.max, node.max);
+      result.sumsq += node.sumsq;
+      ii += span;
+   }
+   return result;
+}
+
+bool WaveClipSummaryPyramid::GetWaveDisplay(const Sequence &sequence,
+   float *min, float *max, float *rms, int* bl,
+   size_t len, const sampleCount *where)
+{
+   Update(sequence);
+
+   const auto nBlocks = mStarts.size();
+   if (len == 0 || nBlocks == 0 || where[0] >= mNumSamples)
+      // None of the samples asked for are in range. Abandon.
+      return false;
+
+   const auto startsBegin = mStarts.begin(), startsEnd = mStarts.end();
+   auto next = std::lower_bound(startsBegin, startsEnd, where[0]);
+   for (size_t pixel = 0; pixel < len; ++pixel) {
+      // The column includes the blocks that begin in it, as
+      // ::GetWaveDisplay() includes the summary frames that begin in it
+      auto begin = next;
+      next = std::lower_bound(begin, startsEnd, where[pixel + 1]);
+      auto end = next;
+      if (begin == end) {
+         // No block begins in this column, at an end of the sequence or
+         // an unusually short block; show the block containing it
+         if (begin != startsBegin)
+            --begin;
+         end = begin + 1;
+      }
+
+      const size_t b0 = begin - startsBegin, b1 = end - startsBegin;
+      const auto node = Accumulate(b0, b1);
+      const auto numSamples =
+         (b1 < nBlocks ? mStarts[b1] : mNumSamples) - mStarts[b0];
+      min[pixel] = node.min;
+      max[pixel] = node.max;
+      rms[pixel] = numSamples > 0
+         ? (float)sqrt(node.sumsq / numSamples.as_double())
+         : 0.0f;
+      bl[pixel] = static_cast<int>(b0);
+   }
+
+   return true;
+}
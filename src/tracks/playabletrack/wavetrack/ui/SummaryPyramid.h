@@ -0,0 +1,78 @@
+/**********************************************************************
+
+  Audacity: A Digital Audio Editor
+
+  @file SummaryPyramid.h
+
+  Summaries of whole blocks of a clip's sequence at resolutions
+  increasing by powers of four, for drawing waveforms zoomed far out
+
+*******************************************************************/
+
+#ifndef __AUDACITY_SUMMARY_PYRAMID__
+#define __AUDACITY_SUMMARY_PYRAMID__
+
+#include <vector>
+#include "SampleBlock.h" // for SampleBlockID
+#include "SampleCount.h"
+#include "WaveClip.h" // to inherit WaveClipListener
+
+class Sequence;
+
+//! Min, max, and RMS of the sequence of a WaveClip, for each sample block
+//! and for each aligned run of 4, 16, 64 ... blocks
+/*!
+ The pyramid is built on first use from the summaries that every block keeps
+ in memory, so building it reads nothing from the database.  After edits
+ it is brought up to date incrementally: blocks before the first changed
+ one, and the nodes above them, are kept.  So appending during recording
+ costs time proportional only to the new blocks.
+
+ When a pixel column spans at least a whole block, its values are composed
+ of at most a few nodes per level, so the cost of drawing stays
+ proportional to the number of columns however long the clip is.
+ */
+struct WaveClipSummaryPyramid final : WaveClipListener
+{
+   WaveClipSummaryPyramid();
+   ~WaveClipSummaryPyramid() override;
+
+   static WaveClipSummaryPyramid &Get( const WaveClip &clip );
+
+   void MarkChanged() override; // NOFAIL-GUARANTEE
+   void Invalidate() override; // NOFAIL-GUARANTEE
+
+   //! Whether GetWaveDisplay() applies for columns of this many samples
+   static bool Applies(const Sequence &sequence, double samplesPerPixel);
+
+   //! Same contract as the free function ::GetWaveDisplay()
+   /*! bl receives the index of the first block in each column */
+   bool GetWaveDisplay(const Sequence &sequence,
+      float *min, float *max, float *rms, int* bl,
+      size_t len, const sampleCount *where);
+
+private:
+   struct Node {
+      float min, max;
+      double sumsq;
+   };
+
+   //! Bring mStarts and mLevels up to date with the sequence
+   void Update(const Sequence &sequence);
+   //! Combine nodes for blocks [begin, end), which must not be empty
+   Node Accumulate(size_t begin, size_t end) const;
+
+   //! For each block:  its first sample, and the identity of its contents
+   std::vector<sampleCount> mStarts;
+   std::vector<SampleBlockID> mBlockIDs;
+   //! Total number of samples
+   sampleCount mNumSamples{ 0 };
+
+   //! mLevels[0] has a node per block; each node of mLevels[k + 1]
+   //! combines four of mLevels[k], the last possibly fewer
+   std::vector<std::vector<Node>> mLevels;
+
+   bool mDirty{ true };
+};
+
+#endif
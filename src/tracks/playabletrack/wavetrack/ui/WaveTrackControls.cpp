@@ -259,14 +259,18 @@ void FormatMenuTable::OnFormatChange(wxCommandEvent & event)
                             pdlgHideStopButton };
 
    sampleCount totalSamples{ 0 };
-   for (const auto& channel : TrackList::Channels(pTrack))
+   std::vector<WaveTrack*> channels;
+   for (const auto& channel : TrackList::Channels(pTrack)) {
       // Hidden samples are processed too, they should be counted as well
       totalSamples += channel->GetSequenceSamplesCount();
+      channels.push_back(channel);
+   }
    sampleCount processedSamples{ 0 };
 
    // Below is the lambda function that is passed along the call chain to
    // the Sequence::ConvertToSampleFormat. This callback function is used
    // to report the conversion progress and update the progress dialog.
+   // It is called in this thread only, with the progress of all channels.
    auto progressUpdate = [&progress, &totalSamples, &processedSamples]
    (size_t newlyProcessedCount)->void
    {
@@ -282,9 +286,8 @@ void FormatMenuTable::OnFormatChange(wxCommandEvent & event)
          throw UserException{};
    };
 
-   for (auto channel : TrackList::Channels(pTrack))
-      channel->ConvertToSampleFormat(
-         newFormat, progressUpdate);
+   // Convert the blocks of all channels at once
+   WaveTrack::ConvertToSampleFormat(channels, newFormat, progressUpdate);
          
    ProjectHistory::Get( *project )
    /* i18n-hint: The strings name a track and a format */
@@ -13,6 +13,7 @@
 #include <cmath>
 #include "Sequence.h"
 #include "GetWaveDisplay.h"
+#include "SummaryPyramid.h"
 #include "WaveClipUtilities.h"
 
 class WaveCache {
@@ -253,12 +254,21 @@ bool WaveClipWaveformCache::GetWaveDisplay(
       // Done with append buffer, now fetch the rest of the cache miss
       // from the sequence
       if (p1 > p0) {
-         if (!::GetWaveDisplay(*sequence, &min[p0],
+         // Zoomed out so that columns span whole blocks?  Then compose
+         // block summaries, at a cost not growing with the clip's length
+         const double samplesPerPixel =
+            (where[p1] - where[p0]).as_double() / (p1 - p0);
+         const bool success =
+            WaveClipSummaryPyramid::Applies(*sequence, samplesPerPixel)
+            ? WaveClipSummaryPyramid::Get(clip).GetWaveDisplay(*sequence,
+               &min[p0], &max[p0], &rms[p0], &bl[p0], p1-p0, &where[p0])
+            : ::GetWaveDisplay(*sequence, &min[p0],
                                         &max[p0],
                                         &rms[p0],
                                         &bl[p0],
                                         p1-p0,
-                                        &where[p0]))
+                                        &where[p0]);
+         if (!success)
          {
             return false;
          }